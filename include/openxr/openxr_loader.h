@@ -0,0 +1,97 @@
+/*
+** Copyright (c) 2017-2020 The Khronos Group Inc.
+**
+** SPDX-License-Identifier: Apache-2.0
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef OPENXR_LOADER_H_
+#define OPENXR_LOADER_H_ 1
+
+/* Functions exported by the OpenXR loader itself, rather than by the OpenXR
+ * API.  They are only available when linking against this loader, so they
+ * use the openxrLoader prefix instead of xr.
+ */
+
+#include <openxr/openxr.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What the loader is allocating memory for, passed to the allocation callbacks
+ * and used to group the loader's allocation statistics.
+ */
+typedef enum OpenXRLoaderAllocationSubsystem {
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE = 0,    /* Loader instances, API layer and runtime interfaces */
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_MANIFEST,        /* API layer and runtime manifest files */
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE,  /* Dispatch tables of the loader and API layers */
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP,      /* Maps from handles to the instances and tables they use */
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_LOGGER,          /* Log recorders */
+    OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT
+} OpenXRLoaderAllocationSubsystem;
+
+/* Allocate size bytes aligned to alignment, a power of two, or return NULL on failure. */
+typedef void *(XRAPI_PTR *PFN_openxrLoaderAllocationFunction)(void *userData, size_t size, size_t alignment,
+                                                              OpenXRLoaderAllocationSubsystem subsystem);
+
+/* Free memory returned by the matching allocation function.  memory is never NULL. */
+typedef void(XRAPI_PTR *PFN_openxrLoaderFreeFunction)(void *userData, void *memory);
+
+/* Allocator an application may give the loader, like VkAllocationCallbacks,
+ * for the memory the loader and the API layers shipped with it allocate for
+ * their own objects.  Memory is always freed through the callbacks that
+ * allocated it, so the callbacks must stay usable until every allocation made
+ * with them has been freed.
+ */
+#define OPENXR_LOADER_ALLOCATION_CALLBACKS_STRUCT_VERSION 1
+typedef struct OpenXRLoaderAllocationCallbacks {
+    uint32_t structVersion;                            /* OPENXR_LOADER_ALLOCATION_CALLBACKS_STRUCT_VERSION */
+    size_t structSize;                                 /* sizeof(OpenXRLoaderAllocationCallbacks) */
+    void *userData;                                    /* Passed to both functions */
+    PFN_openxrLoaderAllocationFunction pfnAllocation;  /* Allocates memory */
+    PFN_openxrLoaderFreeFunction pfnFree;              /* Frees memory from pfnAllocation */
+} OpenXRLoaderAllocationCallbacks;
+
+/* Allocations the loader has made for one subsystem. */
+typedef struct OpenXRLoaderAllocationStatistics {
+    uint64_t liveAllocations;   /* Allocations not yet freed */
+    uint64_t liveBytes;         /* Bytes requested by the allocations not yet freed */
+    uint64_t totalAllocations;  /* Allocations made since the loader was loaded */
+    uint64_t totalBytes;        /* Bytes requested since the loader was loaded */
+} OpenXRLoaderAllocationStatistics;
+
+/* Set the allocator the loader uses from now on, or go back to the default one
+ * if callbacks is NULL.  The callbacks are copied.  Objects the loader has
+ * already allocated are freed through the allocator they came from.
+ */
+typedef XrResult(XRAPI_PTR *PFN_openxrLoaderSetAllocationCallbacks)(const OpenXRLoaderAllocationCallbacks *callbacks);
+
+/* Get the allocations the loader has made for a subsystem. */
+typedef XrResult(XRAPI_PTR *PFN_openxrLoaderGetAllocationStatistics)(OpenXRLoaderAllocationSubsystem subsystem,
+                                                                     OpenXRLoaderAllocationStatistics *statistics);
+
+#ifndef XR_NO_PROTOTYPES
+XRAPI_ATTR XrResult XRAPI_CALL openxrLoaderSetAllocationCallbacks(const OpenXRLoaderAllocationCallbacks *callbacks);
+XRAPI_ATTR XrResult XRAPI_CALL openxrLoaderGetAllocationStatistics(OpenXRLoaderAllocationSubsystem subsystem,
+                                                                   OpenXRLoaderAllocationStatistics *statistics);
+#endif /* !XR_NO_PROTOTYPES */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -36,19 +36,26 @@ class CStruct:
 class CBitmask:
     """Represents a OpenXR mask type"""
 
-    def __init__(self, typeName, maskTuples):
+    def __init__(self, typeName, maskTuples, protect):
         self.typeName = typeName
         self.maskTuples = maskTuples
+        self.protect = protect
+        self.maskTuplesByName = sorted(maskTuples, key=lambda member: member[0])
 
 
 class CEnum:
     """Represents a OpenXR group enum type"""
 
-    def __init__(self, typeName, typeNamePrefix, typeNameSuffix, enumTuples):
+    def __init__(self, typeName, typeNamePrefix, typeNameSuffix, enumTuples, protect):
         self.typeName = typeName
         self.typeNamePrefix = typeNamePrefix
         self.typeNameSuffix = typeNameSuffix
         self.enumTuples = enumTuples
+        self.protect = protect
+
+        # The same enumerants, with the max enum, sorted by name for a binary search.
+        maxEnum = ('{}_MAX_ENUM{}'.format(typeNamePrefix, typeNameSuffix), '0x7FFFFFFF')
+        self.enumTuplesByName = sorted(enumTuples + [maxEnum], key=lambda member: member[0])
 
 
 class CReflectionOutputGenerator(OutputGenerator):
@@ -124,7 +131,7 @@ class CReflectionOutputGenerator(OutputGenerator):
                 (numVal, strVal) = self.enumToValue(elem, True)
                 bitmaskTuples.append((getElemName(elem), strVal))
 
-            self.bitmasks.append(CBitmask(bitmaskTypeName, bitmaskTuples))
+            self.bitmasks.append(CBitmask(bitmaskTypeName, bitmaskTuples, self.featureExtraProtect))
         else:
             groupElem = groupinfo.elem
 
@@ -143,4 +150,4 @@ class CReflectionOutputGenerator(OutputGenerator):
                 (numVal, strVal) = self.enumToValue(elem, True)
                 enumTuples.append((getElemName(elem), strVal))
 
-            self.enums.append(CEnum(groupName, expandPrefix, expandSuffix, enumTuples))
+            self.enums.append(CEnum(groupName, expandPrefix, expandSuffix, enumTuples, self.featureExtraProtect))
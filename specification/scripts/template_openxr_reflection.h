@@ -40,6 +40,17 @@ Example of how to use expansion macros to make an enum-to-string function:
     }                                                 \
 
 XR_ENUM_STR(XrResult);
+
+XR_LIST_ENUM_BY_NAME_<enum> lists the same enumerants, including the max enum, sorted by name as
+strcmp orders them, so they can be expanded into a table that is searched with a binary search
+to parse names. XR_LIST_BITS_BY_NAME_<flags> lists the bits of a flags type sorted the same way.
+
+XR_LIST_ENUM_TYPES lists every enumeration, and XR_LIST_BITMASK_TYPES every flags type that has
+any bits, so that something can be defined for each of them:
+
+XR_LIST_ENUM_TYPES(XR_ENUM_STR)
+
+Those only declared in openxr_platform.h are left out, as they are only defined for their platform.
 */
 
 //# for enum in enums
@@ -50,8 +61,23 @@ XR_ENUM_STR(XrResult);
 //# endfor
     _(/*{enum.typeNamePrefix}*/_MAX_ENUM/*{enum.typeNameSuffix}*/, 0x7FFFFFFF)
 
+#define XR_LIST_ENUM_BY_NAME_/*{enum.typeName}*/(_) \
+//# for member in enum.enumTuplesByName
+    _(/*{", ".join(member)}*/)/*{" \\" if not loop.last else ""}*/
+//# endfor
+//## Intentionally left blank.
 //# endfor
 
+#define XR_LIST_ENUM_TYPES(_) \
+//# for enum in enums if not enum.protect
+    _(/*{enum.typeName}*/)/*{" \\" if not loop.last else ""}*/
+//# endfor
+//## Intentionally left blank.
+#define XR_LIST_BITMASK_TYPES(_) \
+//# for bitmask in bitmasks if bitmask.maskTuples and not bitmask.protect
+    _(/*{bitmask.typeName}*/)/*{" \\" if not loop.last else ""}*/
+//# endfor
+//## Intentionally left blank.
 //# for bitmask in bitmasks
 
 #define XR_LIST_BITS_/*{bitmask.typeName}*/(_)/*{" \\" if bitmask.maskTuples else ""}*/
@@ -59,6 +85,11 @@ XR_ENUM_STR(XrResult);
     _(/*{", ".join(member)}*/)/*{ " \\" if member != bitmask.maskTuples[-1] else ""}*/
 //# endfor
 //## Intentionally left blank.
+#define XR_LIST_BITS_BY_NAME_/*{bitmask.typeName}*/(_)/*{" \\" if bitmask.maskTuplesByName else ""}*/
+//# for member in bitmask.maskTuplesByName
+    _(/*{", ".join(member)}*/)/*{" \\" if not loop.last else ""}*/
+//# endfor
+//## Intentionally left blank.
 //# endfor
 
 //# for struct in structs
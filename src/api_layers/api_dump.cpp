@@ -20,6 +20,12 @@
 // Author: Dave Houlton <daveh@lunarg.com>
 //
 
+#include "allocation_callbacks.h"
+#include "api_dump_capture.hpp"
+#include "api_dump_filter.hpp"
+#include "api_dump_merger.hpp"
+#include "api_dump_output.hpp"
+#include "api_dump_record.hpp"
 #include "hex_and_handles.h"
 #include "loader_interfaces.h"
 #include "platform_utils.hpp"
@@ -29,15 +35,14 @@
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstring>
-#include <fstream>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -68,13 +73,32 @@ struct ApiDumpRecordInfo {
 
 static ApiDumpRecordInfo g_record_info = {};
 static std::mutex g_record_mutex = {};
+// Open while there are instances to dump to a file.  Closed, and so flushed, at exit if instances remain.
+static ApiDumpOutputFile g_record_file;
+
+// Write out the text of one command, formatted by ApiDumpLayerWriteContent on whichever thread called it.
+static void ApiDumpLayerWriteMerged(const char *text, size_t size) {
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
+    if (g_record_info.type == RECORD_TEXT_COUT) {
+        std::cout.write(text, static_cast<std::streamsize>(size));
+    } else {
+        g_record_file.Write(text, size);
+        g_record_file.EndRecord();
+    }
+}
+
+// Collects the commands each thread formats, and writes them out in order.  Flushed at exit before the file it writes
+// to is closed.
+static ApiDumpMerger g_merger(ApiDumpLayerWriteMerged);
 
 // HTML utilities
 bool ApiDumpLayerWriteHtmlHeader() {
     try {
         std::unique_lock<std::mutex> mlock(g_record_mutex);
-        std::ofstream html_file;
-        html_file.open(g_record_info.file_name, std::ios::out);
+        if (!g_record_file.Open(g_record_info.file_name, false, ApiDumpOutputFile::SettingsFromEnvironment())) {
+            return false;
+        }
+        ApiDumpOutputFile &html_file = g_record_file;
         html_file << "<!doctype html>\n"
                      "<html>\n"
                      "    <head>\n"
@@ -163,6 +187,8 @@ bool ApiDumpLayerWriteHtmlHeader() {
                      "            text-align: right;\n"
                      "        }\n"
                      "        .thd {\n"
+                     "            display: inline;\n"
+                     "            margin: 0 9px;\n"
                      "            color: #888;\n"
                      "        }\n"
                      "        </style>\n"
@@ -181,12 +207,12 @@ bool ApiDumpLayerWriteHtmlHeader() {
 
 bool ApiDumpLayerWriteHtmlFooter() {
     try {
+        g_merger.Flush();
         std::unique_lock<std::mutex> mlock(g_record_mutex);
-        std::ofstream html_file;
-        html_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
-        html_file << "        </div>\n"
-                     "    </body>\n"
-                     "</html>";
+        g_record_file << "        </div>\n"
+                         "    </body>\n"
+                         "</html>";
+        g_record_file.Close();
 
         // Writing the footer means we're done.
         if (g_record_info.initialized) {
@@ -200,6 +226,30 @@ bool ApiDumpLayerWriteHtmlFooter() {
     }
 }
 
+// Open the text file to dump to if it is not already open, and pick up any changed output settings.  A file that
+// cannot be opened is left out of the dump, as it always has been.
+void ApiDumpLayerPrepareFile() {
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
+    const ApiDumpOutputFile::Settings settings = ApiDumpOutputFile::SettingsFromEnvironment();
+    if (g_record_info.type == RECORD_TEXT_FILE &&
+        (!g_record_file.IsOpen() || g_record_file.FileName() != g_record_info.file_name)) {
+        g_record_file.Open(g_record_info.file_name, true, settings);
+    } else if (g_record_file.IsOpen()) {
+        g_record_file.SetSettings(settings);
+    }
+}
+
+// Write out everything recorded so far, syncing it if enabled, and close the file if no instances are left.
+void ApiDumpLayerFlushFile(bool close) {
+    g_merger.Flush();
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
+    if (close) {
+        g_record_file.Close();
+    } else {
+        g_record_file.Flush(true);
+    }
+}
+
 // Api Dump Utility function to return an instance based on the generated dispatch table
 // pointer.
 XrInstance FindInstanceFromDispatchTable(XrGeneratedDispatchTable *dispatch_table) {
@@ -214,197 +264,228 @@ XrInstance FindInstanceFromDispatchTable(XrGeneratedDispatchTable *dispatch_tabl
     return instance;
 }
 
-// Function to record all the API dump information
-bool ApiDumpLayerRecordContent(std::vector<std::tuple<std::string, std::string, std::string>> contents) {
-    bool success = false;
-    if (g_record_info.initialized) {
-        std::unique_lock<std::mutex> mlock(g_record_mutex);
-        uint32_t count = 0;
-        switch (g_record_info.type) {
-            case RECORD_TEXT_COUT: {
-                for (const auto &content : contents) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = content;
-                    if (count++ != 0) {
-                        std::cout << "    ";
-                    }
-                    if (!content_value.empty()) {
-                        std::cout << content_type << " " << content_name << " = " << content_value << "\n";
-                    } else {
-                        std::cout << content_type << " " << content_name << "\n";
-                    }
+// Format one command as text, after the thread that called it, with each line after the first indented.
+static void ApiDumpLayerFormatText(std::string &out, const ApiDumpRecord &record, uint32_t thread_id) {
+    out += "Thread ";
+    out += std::to_string(thread_id);
+    out += ":\n";
+    for (size_t line = 0; line < record.LineCount(); ++line) {
+        if (line != 0) {
+            out.append("    ", 4);
+        }
+        const ApiDumpRecord::Text type = record.Type(line);
+        const ApiDumpRecord::Text name = record.Name(line);
+        const ApiDumpRecord::Text value = record.Value(line);
+        out.append(type.data, type.size);
+        out += ' ';
+        out.append(name.data, name.size);
+        if (!value.empty()) {
+            out.append(" = ", 3);
+            out.append(value.data, value.size);
+        }
+        out += '\n';
+    }
+}
+
+// Format one command as HTML, with the thread that called it in its summary.
+static void ApiDumpLayerFormatHtml(std::string &out, const ApiDumpRecord &record, uint32_t thread_id) {
+    out += "<details class='data'>\n";
+    std::vector<std::string> prefixes;
+    uint32_t last_deref_count = 0;
+    for (size_t content_index = 0; content_index < record.LineCount(); ++content_index) {
+        const std::string content_type = record.Type(content_index).str();
+        const std::string content_name = record.Name(content_index).str();
+        const std::string content_value = record.Value(content_index).str();
+        if (content_index == 0) {
+            out += "   <summary>\n"
+                   "      <div class='headertype'>";
+            out += content_type;
+            out += "</div>\n"
+                   "      <div class='headervar'>";
+            out += content_name;
+            out += "</div>\n"
+                   "      <div class='thd'>Thread ";
+            out += std::to_string(thread_id);
+            out += "</div>\n"
+                   "   </summary>\n";
+        } else {
+            uint32_t cur_deref_count = 0;
+            uint32_t next_deref_count = 0;
+
+            // Count number of structure and pointer dereferences for the current line
+            cur_deref_count = static_cast<uint32_t>(std::count(content_name.begin(), content_name.end(), '.'));
+            std::string::size_type start = 0;
+            while ((start = content_name.find("->", start)) != std::string::npos) {
+                ++cur_deref_count;
+                start += 2;
+            }
+            // Now look for array dereferences
+            start = 0;
+            while ((start = content_name.find('[', start)) != std::string::npos) {
+                ++cur_deref_count;
+                start++;
+            }
+
+            // If there's something after this, see if it's a sub-component of this.
+            if (content_index < record.LineCount() - 1) {
+                const std::string next_content_name = record.Name(content_index + 1).str();
+
+                // Count number of structure and pointer dereferences for the next line
+                next_deref_count =
+                    static_cast<uint32_t>(std::count(next_content_name.begin(), next_content_name.end(), '.'));
+                start = 0;
+                while ((start = next_content_name.find("->", start)) != std::string::npos) {
+                    ++next_deref_count;
+                    start += 2;
+                }
+                // Now look for array dereferences
+                start = 0;
+                while ((start = next_content_name.find('[', start)) != std::string::npos) {
+                    ++next_deref_count;
+                    start++;
                 }
-                success = true;
-                break;
             }
-            case RECORD_TEXT_FILE: {
-                std::ofstream text_file;
-                text_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
-                for (const auto &content : contents) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = content;
-                    if (count++ != 0) {
-                        text_file << "    ";
-                    }
-                    if (!content_value.empty()) {
-                        text_file << content_type << " " << content_name << " = " << content_value << "\n";
-                    } else {
-                        text_file << content_type << " " << content_name << "\n";
-                    }
+
+            // If we've reduced the number of dereferences in the name from last time, we need
+            // to close up those detail sections.
+            if (cur_deref_count < last_deref_count) {
+                uint32_t diff_count = last_deref_count - cur_deref_count;
+                while ((diff_count--) != 0u) {
+                    out += "   </details>\n";
+                    prefixes.pop_back();
                 }
-                text_file.close();
-                success = true;
-                break;
             }
-            case RECORD_HTML_FILE: {
-                std::ofstream text_file;
-                text_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
-                text_file << "<details class='data'>\n";
-                std::vector<std::string> prefixes;
-                uint32_t last_deref_count = 0;
-                for (uint32_t content_index = 0; content_index < contents.size(); ++content_index) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = contents[content_index];
-                    if (content_index == 0) {
-                        text_file << "   <summary>\n"
-                                  << "      <div class='headertype'>" << content_type << "</div>\n"
-                                  << "      <div class='headervar'>" << content_name << "</div>\n"
-                                  << "   </summary>\n";
-                    } else {
-                        uint32_t cur_deref_count = 0;
-                        uint32_t next_deref_count = 0;
-
-                        // Count number of structure and pointer dereferences for the current line
-                        cur_deref_count = static_cast<uint32_t>(std::count(content_name.begin(), content_name.end(), '.'));
-                        std::string::size_type start = 0;
-                        while ((start = content_name.find("->", start)) != std::string::npos) {
-                            ++cur_deref_count;
-                            start += 2;
-                        }
-                        // Now look for array dereferences
-                        start = 0;
-                        while ((start = content_name.find('[', start)) != std::string::npos) {
-                            ++cur_deref_count;
-                            start++;
-                        }
 
-                        // If there's something after this, see if it's a sub-component of this.
-                        if (content_index < contents.size() - 1) {
-                            std::string next_content_type;
-                            std::string next_content_name;
-                            std::string next_content_value;
-                            std::tie(next_content_type, next_content_name, next_content_value) = contents[content_index + 1];
-
-                            // Count number of structure and pointer dereferences for the next line
-                            next_deref_count =
-                                static_cast<uint32_t>(std::count(next_content_name.begin(), next_content_name.end(), '.'));
-                            start = 0;
-                            while ((start = next_content_name.find("->", start)) != std::string::npos) {
-                                ++next_deref_count;
-                                start += 2;
-                            }
-                            // Now look for array dereferences
-                            start = 0;
-                            while ((start = next_content_name.find('[', start)) != std::string::npos) {
-                                ++next_deref_count;
-                                start++;
-                            }
+            // Look through any prefixes we've saved (going backwards through the list)
+            // and find the one that matches our beginning.
+            std::string short_name = content_name;
+            if (cur_deref_count > 0) {
+                for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
+                    if (content_name.find(*it) == 0) {
+                        std::string::size_type additional_offset = it->size() + 1;
+                        if (content_name[additional_offset - 1] == '-') {
+                            additional_offset++;
+                        } else if (content_name[additional_offset - 1] == '[') {
+                            additional_offset--;
                         }
+                        short_name = content_name.substr(additional_offset);
+                        break;
+                    }
+                }
+            }
 
-                        // If we've reduced the number of dereferences in the name from last time, we need
-                        // to close up those detail sections.
-                        if (cur_deref_count < last_deref_count) {
-                            uint32_t diff_count = last_deref_count - cur_deref_count;
-                            while ((diff_count--) != 0u) {
-                                text_file << "   </details>\n";
-                                prefixes.pop_back();
-                            }
-                        }
+            bool writing_summary = false;
+
+            // If the next item contains this item as a prefix, start the summary.  Otherwise,
+            // start a <div> marker so that each component lands on its own line.
+            if (cur_deref_count < next_deref_count) {
+                out += "   <details class='data'>\n"
+                       "      <summary>\n";
+                writing_summary = true;
+                prefixes.push_back(content_name);
+            } else {
+                out += "      <div class='data'>\n";
+            }
 
-                        // Look through any prefixes we've saved (going backwards through the list)
-                        // and find the one that matches our beginning.
-                        std::string short_name = content_name;
-                        if (cur_deref_count > 0) {
-                            for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
-                                if (content_name.find(*it) == 0) {
-                                    std::string::size_type additional_offset = it->size() + 1;
-                                    if (content_name[additional_offset - 1] == '-') {
-                                        additional_offset++;
-                                    } else if (content_name[additional_offset - 1] == '[') {
-                                        additional_offset--;
-                                    }
-                                    short_name = content_name.substr(additional_offset);
-                                    break;
-                                }
-                            }
-                        }
+            // Write out the content
+            out += "         <div class='type'>";
+            out += content_type;
+            out += "</div>\n"
+                   "         <div class='var'>";
+            out += short_name;
+            out += "</div>\n";
+            bool value_needs_printing = true;
+            if (content_type.find("char") != std::string::npos) {
+                uint64_t star_count = std::count(content_type.begin(), content_type.end(), '*');
+                uint64_t bracket_count = std::count(content_type.begin(), content_type.end(), '[');
+                if (star_count + bracket_count < 2) {
+                    out += "         <div class='val'>\"";
+                    out += content_value;
+                    out += "\"</div>";
+                    value_needs_printing = false;
+                }
+            }
+            if (!content_value.empty() && value_needs_printing) {
+                out += "         <div class='val'>";
+                out += content_value;
+                out += "</div>";
+            }
+            out += "\n";
+
+            // Wrap up any summary we may have started.  Otherwise, just wrap up the
+            // <div> marker wrapping this entry.
+            if (writing_summary) {
+                out += "      </summary>\n";
+            } else {
+                out += "      </div>\n";
+            }
 
-                        bool writing_summary = false;
-
-                        // If the next item contains this item as a prefix, start the summary.  Otherwise,
-                        // start a <div> marker so that each component lands on its own line.
-                        if (cur_deref_count < next_deref_count) {
-                            text_file << "   <details class='data'>\n"
-                                      << "      <summary>\n";
-                            writing_summary = true;
-                            prefixes.push_back(content_name);
-                        } else {
-                            text_file << "      <div class='data'>\n";
-                        }
+            last_deref_count = cur_deref_count;
+        }
+    }
 
-                        // Write out the content
-                        text_file << "         <div class='type'>" << content_type << "</div>\n"
-                                  << "         <div class='var'>" << short_name << "</div>\n";
-                        bool value_needs_printing = true;
-                        if (content_type.find("char") != std::string::npos) {
-                            uint64_t star_count = std::count(content_type.begin(), content_type.end(), '*');
-                            uint64_t bracket_count = std::count(content_type.begin(), content_type.end(), '[');
-                            if (star_count + bracket_count < 2) {
-                                text_file << "         <div class='val'>\"" << content_value << "\"</div>";
-                                value_needs_printing = false;
-                            }
-                        }
-                        if (!content_value.empty() && value_needs_printing) {
-                            text_file << "         <div class='val'>" << content_value << "</div>";
-                        }
-                        text_file << "\n";
-
-                        // Wrap up any summary we may have started.  Otherwise, just wrap up the
-                        // <div> marker wrapping this entry.
-                        if (writing_summary) {
-                            text_file << "      </summary>\n";
-                        } else {
-                            text_file << "      </div>\n";
-                        }
+    // Wrap up any remaining items
+    if (last_deref_count != 0u) {
+        while ((last_deref_count--) != 0u) {
+            out += "   </details>\n";
+            prefixes.pop_back();
+        }
+    }
+    out += "</details>\n";
+}
 
-                        last_deref_count = cur_deref_count;
-                    }
-                }
+// Where commands are dumped to, or RECORD_NONE before the first instance is created.
+static ApiDumpRecordType ApiDumpLayerRecordType() {
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
+    return g_record_info.initialized ? g_record_info.type : RECORD_NONE;
+}
 
-                // Wrap up any remaining items
-                if (last_deref_count != 0u) {
-                    while ((last_deref_count--) != 0u) {
-                        text_file << "   </details>\n";
-                        prefixes.pop_back();
-                    }
-                }
-                text_file << "</details>\n";
-                break;
-            }
-            default:
-                break;
+// Write the API dump information of one command, called on thread_id.  Each thread formats its commands itself, and
+// they are written out in order by g_merger.
+static bool ApiDumpLayerWriteContent(const ApiDumpRecord &record, uint32_t thread_id) {
+    bool success = false;
+    switch (ApiDumpLayerRecordType()) {
+        case RECORD_TEXT_COUT:
+        case RECORD_TEXT_FILE: {
+            g_merger.Add([&record, thread_id](std::string &out) { ApiDumpLayerFormatText(out, record, thread_id); });
+            success = true;
+            break;
+        }
+        case RECORD_HTML_FILE: {
+            g_merger.Add([&record, thread_id](std::string &out) { ApiDumpLayerFormatHtml(out, record, thread_id); });
+            break;
         }
+        default:
+            break;
     }
     return success;
 }
 
+// Formats captured commands when XR_API_DUMP_DEFER_FORMATTING is set.  Stopped, and so drained, before the file it
+// writes to is closed at exit.
+static ApiDumpCaptureQueue g_capture_queue(ApiDumpLayerWriteContent);
+
+ApiDumpCaptureQueue *ApiDumpLayerCaptureQueue() { return g_capture_queue.IsRunning() ? &g_capture_queue : nullptr; }
+
+// Which calls are dumped, set up whenever an instance is created while there are none.
+static ApiDumpFilter g_filter;
+
+// Gets the application's allocation callbacks from the loader, if the loader gave the layer this function.
+static std::atomic<PFN_openxrLoaderGetAllocationCallbacks> g_get_allocation_callbacks{nullptr};
+
+bool ApiDumpLayerDumpCommand(uint32_t command) { return g_filter.Dump(command); }
+
+void ApiDumpLayerEndFrame() { g_filter.EndFrame(); }
+
+// Function to record all the API dump information
+bool ApiDumpLayerRecordContent(const ApiDumpRecord &record) {
+    // Commands captured before this one are recorded first.
+    g_capture_queue.Drain();
+    return ApiDumpLayerWriteContent(record, ApiDumpThreadId());
+}
+
 XrResult ApiDumpLayerXrCreateInstance(const XrInstanceCreateInfo * /*info*/, XrInstance * /*instance*/) {
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
     if (!g_record_info.initialized) {
         g_record_info.initialized = true;
         g_record_info.type = RECORD_TEXT_COUT;
@@ -418,6 +499,26 @@ XrResult ApiDumpLayerXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
         PFN_xrGetInstanceProcAddr next_get_instance_proc_addr = nullptr;
         PFN_xrCreateApiLayerInstance next_create_api_layer_instance = nullptr;
         XrApiLayerCreateInfo new_api_layer_info = {};
+
+        // Validate the API layer info and next API layer info structures before we try to use them
+        if (nullptr == apiLayerInfo || XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO != apiLayerInfo->structType ||
+            XR_API_LAYER_CREATE_INFO_STRUCT_VERSION > apiLayerInfo->structVersion ||
+            sizeof(XrApiLayerCreateInfo) > apiLayerInfo->structSize || nullptr == apiLayerInfo->nextInfo ||
+            XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO != apiLayerInfo->nextInfo->structType ||
+            XR_API_LAYER_NEXT_INFO_STRUCT_VERSION > apiLayerInfo->nextInfo->structVersion ||
+            sizeof(XrApiLayerNextInfo) > apiLayerInfo->nextInfo->structSize ||
+            0 != strcmp("XR_APILAYER_LUNARG_api_dump", apiLayerInfo->nextInfo->layerName) ||
+            nullptr == apiLayerInfo->nextInfo->nextGetInstanceProcAddr ||
+            nullptr == apiLayerInfo->nextInfo->nextCreateApiLayerInstance) {
+            return XR_ERROR_INITIALIZATION_FAILED;
+        }
+
+        // Record settings are read by every thread dumping commands, so they change under the record mutex.  The HTML
+        // header is written once the mutex is released, since writing it takes the mutex too.
+        std::string export_type = PlatformUtilsGetEnv("XR_API_DUMP_EXPORT_TYPE");
+        std::string file_name = PlatformUtilsGetEnv("XR_API_DUMP_FILE_NAME");
+        bool write_html_header = false;
+        std::unique_lock<std::mutex> record_lock(g_record_mutex);
         bool first_time = !g_record_info.initialized;
 
         if (!g_record_info.initialized) {
@@ -425,8 +526,6 @@ XrResult ApiDumpLayerXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
             g_record_info.type = RECORD_TEXT_COUT;
         }
 
-        std::string export_type = PlatformUtilsGetEnv("XR_API_DUMP_EXPORT_TYPE");
-        std::string file_name = PlatformUtilsGetEnv("XR_API_DUMP_FILE_NAME");
         if (!file_name.empty()) {
             g_record_info.file_name = file_name;
             g_record_info.type = RECORD_TEXT_FILE;
@@ -445,81 +544,85 @@ XrResult ApiDumpLayerXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
                 }
             } else if (export_type_lower == "html" && first_time) {
                 g_record_info.type = RECORD_HTML_FILE;
-                if (!ApiDumpLayerWriteHtmlHeader()) {
-                    return XR_ERROR_INITIALIZATION_FAILED;
-                }
+                write_html_header = true;
             } else if (export_type_lower == "code") {
                 g_record_info.type = RECORD_CODE_FILE;
             }
         }
-
-        // Validate the API layer info and next API layer info structures before we try to use them
-        if (nullptr == apiLayerInfo || XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO != apiLayerInfo->structType ||
-            XR_API_LAYER_CREATE_INFO_STRUCT_VERSION > apiLayerInfo->structVersion ||
-            sizeof(XrApiLayerCreateInfo) > apiLayerInfo->structSize || nullptr == apiLayerInfo->nextInfo ||
-            XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO != apiLayerInfo->nextInfo->structType ||
-            XR_API_LAYER_NEXT_INFO_STRUCT_VERSION > apiLayerInfo->nextInfo->structVersion ||
-            sizeof(XrApiLayerNextInfo) > apiLayerInfo->nextInfo->structSize ||
-            0 != strcmp("XR_APILAYER_LUNARG_api_dump", apiLayerInfo->nextInfo->layerName) ||
-            nullptr == apiLayerInfo->nextInfo->nextGetInstanceProcAddr ||
-            nullptr == apiLayerInfo->nextInfo->nextCreateApiLayerInstance) {
+        record_lock.unlock();
+        if (write_html_header && !ApiDumpLayerWriteHtmlHeader()) {
             return XR_ERROR_INITIALIZATION_FAILED;
         }
+        ApiDumpLayerPrepareFile();
+        // Filters apply from the first of the instances that exist together, with frames counted from there.
+        std::unique_lock<std::mutex> instance_lock(g_instance_dispatch_mutex);
+        const bool no_instances = g_instance_dispatch_map.empty();
+        instance_lock.unlock();
+        if (no_instances) {
+            g_filter.SetSettings(ApiDumpFilter::SettingsFromEnvironment(), g_api_dump_command_names, API_DUMP_COMMAND_COUNT);
+        }
+        // Deferred formatting, with each calling thread capturing into a ring of XR_API_DUMP_CAPTURE_BUFFER_SIZE bytes.
+        if (PlatformUtilsGetEnvSet("XR_API_DUMP_DEFER_FORMATTING")) {
+            const uint64_t ring_size = ApiDumpGetEnvUnsigned("XR_API_DUMP_CAPTURE_BUFFER_SIZE", 4 * 1024 * 1024);
+            g_capture_queue.Start(static_cast<size_t>(ring_size));
+        }
 
         // Generate output for this command as if it were the standard xrCreateInstance
-        std::vector<std::tuple<std::string, std::string, std::string>> contents;
-        contents.emplace_back("XrResult", "xrCreateInstance", "");
-        contents.emplace_back("const XrInstanceCreateInfo*", "info", PointerToHexString(info));
-        if (nullptr != info) {
-            std::string info_prefix = "info->";
-            contents.emplace_back("XrStructureType", "info->type", std::to_string(info->type));
-            std::string next_prefix = info_prefix;
-            next_prefix += "next";
-            // Decode the next chain if it exists
-            if (!ApiDumpDecodeNextChain(nullptr, info->next, next_prefix, contents)) {
-                throw std::invalid_argument("Invalid Operation");
-            }
-            std::string flags_prefix = info_prefix;
-            flags_prefix += "createFlags";
-            contents.emplace_back("XrInstanceCreateFlags", flags_prefix, std::to_string(info->createFlags));
-            std::string applicationinfo_prefix = info_prefix;
-            applicationinfo_prefix += "applicationInfo";
-            if (!ApiDumpOutputXrStruct(nullptr, &info->applicationInfo, applicationinfo_prefix, "XrApplicationInfo", true,
-                                       contents)) {
-                throw std::invalid_argument("Invalid Operation");
-            }
-            std::string enabledapilayercount_prefix = info_prefix;
-            enabledapilayercount_prefix += "enabledApiLayerCount";
-            std::ostringstream oss_enabledApiLayerCount;
-            oss_enabledApiLayerCount << "0x" << std::hex << (info->enabledApiLayerCount);
-            contents.emplace_back("uint32_t", enabledapilayercount_prefix, oss_enabledApiLayerCount.str());
-            std::string enabledapilayernames_prefix = info_prefix;
-            enabledapilayernames_prefix += "enabledApiLayerNames";
-            std::ostringstream oss_enabledApiLayerNames_array;
-            oss_enabledApiLayerNames_array << "0x" << std::hex << (info->enabledApiLayerNames);
-            contents.emplace_back("const char* const*", enabledapilayernames_prefix, oss_enabledApiLayerNames_array.str());
-            for (uint32_t i = 0; i < info->enabledApiLayerCount; ++i) {
-                std::string prefix = enabledapilayernames_prefix + "[" + std::to_string(i) + "]";
-                contents.emplace_back("const char* const*", prefix, info->enabledApiLayerNames[i]);
-            }
-            std::string enabledextensioncount_prefix = info_prefix;
-            enabledextensioncount_prefix += "enabledExtensionCount";
-            std::ostringstream oss_enabledExtensionCount;
-            oss_enabledExtensionCount << "0x" << std::hex << (info->enabledExtensionCount);
-            contents.emplace_back("uint32_t", enabledextensioncount_prefix, oss_enabledExtensionCount.str());
-            std::string enabledextensionnames_prefix = info_prefix;
-            enabledextensionnames_prefix += "enabledExtensionNames";
-            std::ostringstream oss_enabledExtensionNames_array;
-            oss_enabledExtensionNames_array << "0x" << std::hex << (info->enabledExtensionNames);
-            contents.emplace_back("const char* const*", enabledextensionnames_prefix, oss_enabledExtensionNames_array.str());
-            for (uint32_t ii = 0; ii < info->enabledExtensionCount; ++ii) {
-                std::string prefix = enabledextensionnames_prefix + "[" + std::to_string(ii) + "]";
-                contents.emplace_back("const char* const*", prefix, info->enabledExtensionNames[ii]);
+        if (ApiDumpLayerDumpCommand(API_DUMP_COMMAND_CREATE_INSTANCE)) {
+            ApiDumpRecord record;
+            record.Add("XrResult", "xrCreateInstance");
+            record.Add("const XrInstanceCreateInfo*", "info", PointerToHexString(info));
+            if (nullptr != info) {
+                std::string info_prefix = "info->";
+                record.Add("XrStructureType", "info->type", std::to_string(info->type));
+                std::string next_prefix = info_prefix;
+                next_prefix += "next";
+                // Decode the next chain if it exists
+                if (!ApiDumpDecodeNextChain(nullptr, info->next, next_prefix, record)) {
+                    throw std::invalid_argument("Invalid Operation");
+                }
+                std::string flags_prefix = info_prefix;
+                flags_prefix += "createFlags";
+                record.Add("XrInstanceCreateFlags", flags_prefix, std::to_string(info->createFlags));
+                std::string applicationinfo_prefix = info_prefix;
+                applicationinfo_prefix += "applicationInfo";
+                if (!ApiDumpOutputXrStruct(nullptr, &info->applicationInfo, applicationinfo_prefix, "XrApplicationInfo", true,
+                                           record)) {
+                    throw std::invalid_argument("Invalid Operation");
+                }
+                std::string enabledapilayercount_prefix = info_prefix;
+                enabledapilayercount_prefix += "enabledApiLayerCount";
+                std::ostringstream oss_enabledApiLayerCount;
+                oss_enabledApiLayerCount << "0x" << std::hex << (info->enabledApiLayerCount);
+                record.Add("uint32_t", enabledapilayercount_prefix, oss_enabledApiLayerCount.str());
+                std::string enabledapilayernames_prefix = info_prefix;
+                enabledapilayernames_prefix += "enabledApiLayerNames";
+                std::ostringstream oss_enabledApiLayerNames_array;
+                oss_enabledApiLayerNames_array << "0x" << std::hex << (info->enabledApiLayerNames);
+                record.Add("const char* const*", enabledapilayernames_prefix, oss_enabledApiLayerNames_array.str());
+                for (uint32_t i = 0; i < info->enabledApiLayerCount; ++i) {
+                    std::string prefix = enabledapilayernames_prefix + "[" + std::to_string(i) + "]";
+                    record.Add("const char* const*", prefix, info->enabledApiLayerNames[i]);
+                }
+                std::string enabledextensioncount_prefix = info_prefix;
+                enabledextensioncount_prefix += "enabledExtensionCount";
+                std::ostringstream oss_enabledExtensionCount;
+                oss_enabledExtensionCount << "0x" << std::hex << (info->enabledExtensionCount);
+                record.Add("uint32_t", enabledextensioncount_prefix, oss_enabledExtensionCount.str());
+                std::string enabledextensionnames_prefix = info_prefix;
+                enabledextensionnames_prefix += "enabledExtensionNames";
+                std::ostringstream oss_enabledExtensionNames_array;
+                oss_enabledExtensionNames_array << "0x" << std::hex << (info->enabledExtensionNames);
+                record.Add("const char* const*", enabledextensionnames_prefix, oss_enabledExtensionNames_array.str());
+                for (uint32_t ii = 0; ii < info->enabledExtensionCount; ++ii) {
+                    std::string prefix = enabledextensionnames_prefix + "[" + std::to_string(ii) + "]";
+                    record.Add("const char* const*", prefix, info->enabledExtensionNames[ii]);
+                }
             }
-        }
 
-        contents.emplace_back("XrInstance*", "instance", PointerToHexString(instance));
-        ApiDumpLayerRecordContent(contents);
+            record.Add("XrInstance*", "instance", PointerToHexString(instance));
+            ApiDumpLayerRecordContent(record);
+        }
 
         // Copy the contents of the layer info struct, but then move the next info up by
         // one slot so that the next layer gets information.
@@ -530,13 +633,21 @@ XrResult ApiDumpLayerXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
         next_get_instance_proc_addr = apiLayerInfo->nextInfo->nextGetInstanceProcAddr;
         next_create_api_layer_instance = apiLayerInfo->nextInfo->nextCreateApiLayerInstance;
 
+        // Allocate the dispatch table to the next levels before anything needs cleaning up if that fails
+        OpenXRLoaderAllocationCallbacks allocation_callbacks;
+        auto *next_dispatch = XrSdkNew<XrGeneratedDispatchTable>(
+            XrSdkGetLayerAllocationCallbacks(g_get_allocation_callbacks.load(), &allocation_callbacks),
+            OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE);
+        if (nullptr == next_dispatch) {
+            return XR_ERROR_OUT_OF_MEMORY;
+        }
+
         // Create the instance
         XrInstance returned_instance = *instance;
         XrResult result = next_create_api_layer_instance(info, &new_api_layer_info, &returned_instance);
         *instance = returned_instance;
 
-        // Create the dispatch table to the next levels
-        auto *next_dispatch = new XrGeneratedDispatchTable();
+        // Fill in the dispatch table to the next levels
         GeneratedXrPopulateDispatchTable(next_dispatch, returned_instance, next_get_instance_proc_addr);
 
         std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
@@ -550,10 +661,12 @@ XrResult ApiDumpLayerXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
 
 XrResult ApiDumpLayerXrDestroyInstance(XrInstance instance) {
     // Generate output for this command
-    std::vector<std::tuple<std::string, std::string, std::string>> contents;
-    contents.emplace_back("XrResult", "xrDestroyInstance", "");
-    contents.emplace_back("XrInstance", "instance", HandleToHexString(instance));
-    ApiDumpLayerRecordContent(contents);
+    if (ApiDumpLayerDumpCommand(API_DUMP_COMMAND_DESTROY_INSTANCE)) {
+        ApiDumpRecord record;
+        record.Add("XrResult", "xrDestroyInstance");
+        record.Add("XrInstance", "instance", HandleToHexString(instance));
+        ApiDumpLayerRecordContent(record);
+    }
 
     std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
     XrGeneratedDispatchTable *next_dispatch = nullptr;
@@ -567,12 +680,23 @@ XrResult ApiDumpLayerXrDestroyInstance(XrInstance instance) {
         return XR_ERROR_HANDLE_INVALID;
     }
 
+    // Captured commands may still be formatted through the instance and its dispatch table.
+    g_capture_queue.Drain();
     next_dispatch->DestroyInstance(instance);
     ApiDumpCleanUpMapsForTable(next_dispatch);
+    XrSdkDelete(next_dispatch);
 
-    // Write out the HTML footer if we destroy the last instance
-    if (g_instance_dispatch_map.empty() && g_record_info.type == RECORD_HTML_FILE) {
+    // Write out the HTML footer if we destroy the last instance, otherwise just make sure the dump is written out.
+    mlock.lock();
+    const bool last_instance = g_instance_dispatch_map.empty();
+    mlock.unlock();
+    if (last_instance) {
+        g_capture_queue.Stop();
+    }
+    if (last_instance && ApiDumpLayerRecordType() == RECORD_HTML_FILE) {
         ApiDumpLayerWriteHtmlFooter();
+    } else {
+        ApiDumpLayerFlushFile(last_instance);
     }
     return XR_SUCCESS;
 }
@@ -604,4 +728,10 @@ XrResult LAYER_EXPORT XRAPI_CALL xrNegotiateLoaderApiLayerInterface(const XrNego
     return XR_SUCCESS;
 }
 
+// Function the loader calls, if found, to let the layer allocate through the application's allocation callbacks.
+void LAYER_EXPORT XRAPI_CALL
+openxrLoaderNegotiateApiLayerAllocation(PFN_openxrLoaderGetAllocationCallbacks getAllocationCallbacks) {
+    g_get_allocation_callbacks.store(getAllocationCallbacks);
+}
+
 }  // extern "C"
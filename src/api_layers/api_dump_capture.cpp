@@ -0,0 +1,332 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "api_dump_capture.hpp"
+
+#include "api_dump_merger.hpp"
+#include "api_dump_record.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+// Records start on this alignment, and rings are a multiple of it in size.
+static const size_t kRecordAlignment = alignof(std::max_align_t);
+static const size_t kMinimumRingSize = 4096;
+// How long the formatting thread sleeps when it has not been asked to format.
+static const std::chrono::milliseconds kFormatInterval(2);
+
+static size_t AlignUp(size_t value, size_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+static char *AlignUp(char *pointer, size_t alignment) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + (AlignUp(address, alignment) - address);
+}
+
+struct ApiDumpCaptureQueue::Ring {
+    explicit Ring(size_t ring_size) : storage(new char[ring_size]), size(ring_size) {}
+
+    std::unique_ptr<char[]> storage;
+    size_t size;
+    // Bytes written by the capturing thread and read by the formatting thread since the ring was made.
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> read{0};
+    // Cleared when the capturing thread exits, so that another thread can take the ring over.
+    std::atomic<bool> owned{true};
+};
+
+// Gives up the ring of a thread when the thread exits.
+struct ApiDumpThreadRing {
+    ~ApiDumpThreadRing() {
+        if (nullptr != ring) {
+            ring->owned.store(false, std::memory_order_release);
+        }
+    }
+    ApiDumpCaptureQueue::Ring *ring = nullptr;
+};
+
+static thread_local ApiDumpThreadRing t_thread_ring;
+static thread_local bool t_formatting_thread = false;
+// The record being formatted on this thread, if any.
+static thread_local const ApiDumpCaptureRecord *t_formatting_record = nullptr;
+
+const void *ApiDumpOriginalPointer(const void *pointer) {
+    const ApiDumpCaptureRecord *record = t_formatting_record;
+    if (nullptr == record || nullptr == pointer) {
+        return pointer;
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    for (size_t block_index = 0; block_index < record->block_count; ++block_index) {
+        const ApiDumpCapturedBlock &block = record->blocks[block_index];
+        const uintptr_t copy = reinterpret_cast<uintptr_t>(block.copy);
+        if (address >= copy && address - copy < block.size) {
+            return static_cast<const char *>(block.original) + (address - copy);
+        }
+    }
+    return pointer;
+}
+
+void *ApiDumpCapture::Reserve(size_t size, size_t alignment) {
+    char *start = AlignUp(_next, alignment);
+    if (start > _blocks || size > static_cast<size_t>(_blocks - start)) {
+        throw ApiDumpCaptureFull();
+    }
+    _next = start + size;
+    return start;
+}
+
+void *ApiDumpCapture::CopyBlock(const void *source, size_t size, size_t alignment) {
+    if (static_cast<size_t>(_blocks - _next) < sizeof(ApiDumpCapturedBlock)) {
+        throw ApiDumpCaptureFull();
+    }
+    _blocks -= sizeof(ApiDumpCapturedBlock);
+    // Every copy takes at least a byte, so that even an empty array has an address of its own to map back.
+    const size_t block_size = std::max<size_t>(size, 1);
+    void *copy = Reserve(block_size, alignment);
+    memcpy(copy, source, size);
+    ApiDumpCapturedBlock block = {static_cast<const char *>(copy), block_size, source};
+    memcpy(_blocks, &block, sizeof(block));
+    return copy;
+}
+
+const char *ApiDumpCapture::CopyString(const char *source) {
+    if (nullptr == source) {
+        return nullptr;
+    }
+    return Copy(source, strlen(source) + 1);
+}
+
+ApiDumpCaptureQueue::ApiDumpCaptureQueue(RecordFunction record) : _record(record) {}
+
+ApiDumpCaptureQueue::~ApiDumpCaptureQueue() { Stop(); }
+
+void ApiDumpCaptureQueue::Start(size_t ring_size) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _ring_size = AlignUp(std::max(ring_size, kMinimumRingSize), kRecordAlignment);
+    if (_thread.joinable()) {
+        return;
+    }
+    _stop = false;
+    _thread = std::thread(&ApiDumpCaptureQueue::FormatThread, this);
+    _running.store(true, std::memory_order_release);
+}
+
+void ApiDumpCaptureQueue::Stop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_thread.joinable()) {
+        return;
+    }
+    // Commands called from here on are formatted as they are called.
+    _running.store(false, std::memory_order_release);
+    _stop = true;
+    _wake_formatter.notify_one();
+    std::thread thread = std::move(_thread);
+    lock.unlock();
+    thread.join();
+    _formatted.notify_all();
+}
+
+void ApiDumpCaptureQueue::Drain() {
+    if (!IsRunning() || t_formatting_thread) {
+        return;
+    }
+    const uint64_t captured = _captured.load(std::memory_order_acquire);
+    if (_recorded.load(std::memory_order_acquire) >= captured) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wake = true;
+    _wake_formatter.notify_one();
+    // The formatting thread only says when it runs out of records, so look again every so often.
+    while (_recorded.load(std::memory_order_acquire) < captured && IsRunning()) {
+        _formatted.wait_for(lock, kFormatInterval);
+    }
+}
+
+ApiDumpCaptureQueue::Ring *ApiDumpCaptureQueue::ThreadRing() {
+    if (!IsRunning()) {
+        return nullptr;
+    }
+    if (nullptr != t_thread_ring.ring) {
+        return t_thread_ring.ring;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (auto &ring : _rings) {
+        // The ring of a thread that has exited is taken over once everything in it has been recorded.
+        if (!ring->owned.load(std::memory_order_acquire) &&
+            ring->read.load(std::memory_order_acquire) == ring->written.load(std::memory_order_relaxed)) {
+            ring->owned.store(true, std::memory_order_relaxed);
+            t_thread_ring.ring = ring.get();
+            return ring.get();
+        }
+    }
+    try {
+        std::unique_ptr<Ring> ring(new Ring(_ring_size));
+        _rings.push_back(std::move(ring));
+    } catch (const std::bad_alloc &) {
+        // Without a ring, this thread's commands are formatted as they are called.
+        return nullptr;
+    }
+    t_thread_ring.ring = _rings.back().get();
+    return t_thread_ring.ring;
+}
+
+bool ApiDumpCaptureQueue::BeginRecord(Ring &ring, ApiDumpCapture &capture) {
+    const uint64_t written = ring.written.load(std::memory_order_relaxed);
+    const uint64_t read = ring.read.load(std::memory_order_acquire);
+    const size_t position = static_cast<size_t>(written % ring.size);
+    const size_t to_end = ring.size - position;
+    const size_t free_space = ring.size - static_cast<size_t>(written - read);
+    capture._position = written;
+    capture._at_end_of_ring = to_end <= free_space;
+    capture._space = std::min(to_end, free_space);
+    if (capture._space < sizeof(ApiDumpCaptureRecord)) {
+        return false;
+    }
+    char *start = ring.storage.get() + position;
+    capture._record = reinterpret_cast<ApiDumpCaptureRecord *>(start);
+    capture._next = start + sizeof(ApiDumpCaptureRecord);
+    capture._end = start + capture._space;
+    capture._blocks = capture._end;
+    return true;
+}
+
+void ApiDumpCaptureQueue::EndRecord(Ring &ring, ApiDumpCapture &capture, XrGeneratedDispatchTable *gen_dispatch_table) {
+    // Move the list of blocks down to just after the copies.
+    const size_t blocks_size = static_cast<size_t>(capture._end - capture._blocks);
+    char *blocks = AlignUp(capture._next, alignof(ApiDumpCapturedBlock));
+    memmove(blocks, capture._blocks, blocks_size);
+
+    ApiDumpCaptureRecord *record = capture._record;
+    record->gen_dispatch_table = gen_dispatch_table;
+    record->blocks = reinterpret_cast<const ApiDumpCapturedBlock *>(blocks);
+    record->block_count = blocks_size / sizeof(ApiDumpCapturedBlock);
+    record->size = AlignUp(static_cast<size_t>(blocks + blocks_size - reinterpret_cast<char *>(record)), kRecordAlignment);
+    record->thread_id = ApiDumpThreadId();
+    record->sequence = _captured.fetch_add(1, std::memory_order_relaxed);
+    ring.written.store(capture._position + record->size, std::memory_order_release);
+}
+
+bool ApiDumpCaptureQueue::MakeRoom(Ring &ring, const ApiDumpCapture &capture) {
+    if (capture._space == ring.size) {
+        // Not even the whole ring is enough.
+        return false;
+    }
+    if (capture._at_end_of_ring) {
+        // Skip the rest of the ring and start again at its beginning.
+        const size_t position = static_cast<size_t>(capture._position % ring.size);
+        const size_t to_end = ring.size - position;
+        if (to_end >= sizeof(ApiDumpCaptureRecord)) {
+            reinterpret_cast<ApiDumpCaptureRecord *>(ring.storage.get() + position)->format = nullptr;
+        }
+        ring.written.store(capture._position + to_end, std::memory_order_release);
+        return true;
+    }
+
+    // Wait for the formatting thread to read more of the ring.
+    const uint64_t read = ring.read.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wake = true;
+    _wake_formatter.notify_one();
+    while (ring.read.load(std::memory_order_acquire) == read && IsRunning()) {
+        _formatted.wait_for(lock, kFormatInterval);
+    }
+    return IsRunning();
+}
+
+void ApiDumpCaptureQueue::ListRings(std::vector<Ring *> &rings) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    rings.clear();
+    for (auto &ring : _rings) {
+        rings.push_back(ring.get());
+    }
+}
+
+void ApiDumpCaptureQueue::FormatThread() {
+    t_formatting_thread = true;
+    std::vector<Ring *> rings;
+    ApiDumpRecord record;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wake_formatter.wait_for(lock, kFormatInterval, [this] { return _stop || _wake; });
+        _wake = false;
+        const bool stop = _stop;
+        lock.unlock();
+        FormatAvailable(rings, record);
+        lock.lock();
+        _formatted.notify_all();
+        if (stop) {
+            break;
+        }
+    }
+}
+
+// The first record in ring not yet formatted, if any, stepping over the skipped ends of the ring.
+static const ApiDumpCaptureRecord *NextRecord(ApiDumpCaptureQueue::Ring &ring) {
+    const uint64_t written = ring.written.load(std::memory_order_acquire);
+    uint64_t read = ring.read.load(std::memory_order_relaxed);
+    while (read != written) {
+        const size_t position = static_cast<size_t>(read % ring.size);
+        const size_t to_end = ring.size - position;
+        const auto *record = reinterpret_cast<const ApiDumpCaptureRecord *>(ring.storage.get() + position);
+        if (to_end >= sizeof(ApiDumpCaptureRecord) && nullptr != record->format) {
+            return record;
+        }
+        read += to_end;
+        ring.read.store(read, std::memory_order_release);
+    }
+    return nullptr;
+}
+
+void ApiDumpCaptureQueue::FormatAvailable(std::vector<Ring *> &rings, ApiDumpRecord &record) {
+    ListRings(rings);
+    for (;;) {
+        // Records are numbered as they are finished, so the oldest one waiting in any ring is the next to record,
+        // unless another thread is just finishing an older one.
+        Ring *oldest_ring = nullptr;
+        const ApiDumpCaptureRecord *oldest = nullptr;
+        for (Ring *ring : rings) {
+            const ApiDumpCaptureRecord *next = NextRecord(*ring);
+            if (nullptr != next && (nullptr == oldest || next->sequence < oldest->sequence)) {
+                oldest_ring = ring;
+                oldest = next;
+            }
+        }
+        const uint64_t recorded = _recorded.load(std::memory_order_relaxed);
+        if (nullptr == oldest || oldest->sequence != recorded) {
+            if (recorded == _captured.load(std::memory_order_acquire)) {
+                return;
+            }
+            // The next record is still being finished, perhaps in a ring made since the list was taken.
+            std::this_thread::yield();
+            ListRings(rings);
+            continue;
+        }
+
+        record.Clear();
+        t_formatting_record = oldest;
+        try {
+            oldest->format(oldest->gen_dispatch_table, oldest->arguments, record);
+            _record(record, oldest->thread_id);
+        } catch (...) {
+        }
+        t_formatting_record = nullptr;
+        oldest_ring->read.store(oldest_ring->read.load(std::memory_order_relaxed) + oldest->size, std::memory_order_release);
+        _recorded.store(recorded + 1, std::memory_order_release);
+    }
+}
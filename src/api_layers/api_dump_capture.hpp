@@ -0,0 +1,201 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct XrGeneratedDispatchTable;
+class ApiDumpRecord;
+
+// Formats the captured arguments of one command into record, just as the command's wrapper does when it is not
+// deferring.
+typedef void (*ApiDumpFormatFunction)(XrGeneratedDispatchTable *gen_dispatch_table, const void *arguments,
+                                      ApiDumpRecord &record);
+
+// The address pointer had in the application.  While a captured command is being formatted, pointers into the copies
+// made for it are turned back into the addresses they were copied from, so that the dump shows the same pointers
+// whether or not formatting is deferred.  Any other pointer is returned as it is.
+const void *ApiDumpOriginalPointer(const void *pointer);
+
+template <typename T>
+const T *ApiDumpOriginalPointer(const T *pointer) {
+    return static_cast<const T *>(ApiDumpOriginalPointer(static_cast<const void *>(pointer)));
+}
+
+// Thrown while capturing a command whose record has outgrown the space it was given.
+struct ApiDumpCaptureFull {};
+
+// Part of a record holding a copy of memory the application passed in.
+struct ApiDumpCapturedBlock {
+    const char *copy;
+    size_t size;
+    const void *original;
+};
+
+// The start of each record in a capture ring.
+struct ApiDumpCaptureRecord {
+    // nullptr marks the rest of the ring as skipped, with the next record at its start.
+    ApiDumpFormatFunction format;
+    XrGeneratedDispatchTable *gen_dispatch_table;
+    const void *arguments;
+    const ApiDumpCapturedBlock *blocks;
+    size_t block_count;
+    // Bytes from the start of this record to the next one.
+    size_t size;
+    uint64_t sequence;
+    // The thread that called the command, as ApiDumpThreadId() names it.
+    uint32_t thread_id;
+};
+
+// ApiDumpCapture class -
+// Builds one record in a capture ring: the arguments of a command, followed by copies of everything reachable from
+// them that formatting reads, with the list of copied blocks at the end.  Every copy is made with the memory the
+// application passed still valid, so the record can be formatted after the command has returned.
+class ApiDumpCapture {
+   public:
+    // Space for the arguments of the command, which the caller fills in.  Arguments must be trivially copyable.
+    template <typename Arguments>
+    Arguments *BeginArguments(ApiDumpFormatFunction format) {
+        auto *arguments = static_cast<Arguments *>(Reserve(sizeof(Arguments), alignof(Arguments)));
+        _record->format = format;
+        _record->arguments = arguments;
+        return arguments;
+    }
+
+    // A copy of the count objects at source, or nullptr if source is nullptr.
+    template <typename T>
+    T *Copy(const T *source, size_t count = 1) {
+        if (nullptr == source) {
+            return nullptr;
+        }
+        return static_cast<T *>(CopyBlock(source, sizeof(T) * count, alignof(T)));
+    }
+
+    // A copy of a null-terminated string, or nullptr if source is nullptr.
+    const char *CopyString(const char *source);
+
+   private:
+    friend class ApiDumpCaptureQueue;
+
+    void *Reserve(size_t size, size_t alignment);
+    void *CopyBlock(const void *source, size_t size, size_t alignment);
+
+    ApiDumpCaptureRecord *_record = nullptr;
+    // Space is taken upwards from _next, and the blocks are listed downwards from _blocks.
+    char *_next = nullptr;
+    char *_blocks = nullptr;
+    char *_end = nullptr;
+    // Where in its ring the record was started, and whether it could have been any longer there without wrapping.
+    uint64_t _position = 0;
+    size_t _space = 0;
+    bool _at_end_of_ring = false;
+};
+
+// ApiDumpCaptureQueue class -
+// Deferred formatting for the api_dump layer.  Instead of formatting a command on the thread that calls it, the
+// command's wrapper captures its arguments into a ring buffer belonging to that thread, deep-copying the next
+// chains, arrays, structures and strings that formatting reads, and a formatting thread formats and records them
+// later, in the order the commands were called across all threads.
+//
+// Capturing takes no locks and makes no system calls: the formatting thread looks for new records every couple of
+// milliseconds, or as soon as a thread waits on it.  A thread whose ring is full waits for the formatting thread to
+// make room, and a command that does not fit even in an empty ring is left for its caller to format at once.
+class ApiDumpCaptureQueue {
+   public:
+    typedef bool (*RecordFunction)(const ApiDumpRecord &record, uint32_t thread_id);
+
+    // One thread's ring buffer of captured records.
+    struct Ring;
+
+    explicit ApiDumpCaptureQueue(RecordFunction record);
+    ~ApiDumpCaptureQueue();
+
+    // Non-copyable
+    ApiDumpCaptureQueue(const ApiDumpCaptureQueue &) = delete;
+    ApiDumpCaptureQueue &operator=(const ApiDumpCaptureQueue &) = delete;
+
+    // Start the formatting thread if it is not running.  Threads that have not captured before get rings of
+    // ring_size bytes.
+    void Start(size_t ring_size);
+
+    // Record everything captured so far and stop the formatting thread.
+    void Stop();
+
+    bool IsRunning() const { return _running.load(std::memory_order_acquire); }
+
+    // Capture a command into the calling thread's ring, with capture_arguments(ApiDumpCapture&) copying what it
+    // needs into the record; it is called again if the record did not fit.  Returns false if the command has to be
+    // formatted now instead.
+    template <typename CaptureArguments>
+    bool Capture(XrGeneratedDispatchTable *gen_dispatch_table, CaptureArguments &&capture_arguments) {
+        Ring *ring = ThreadRing();
+        if (nullptr == ring) {
+            return false;
+        }
+        for (;;) {
+            ApiDumpCapture capture;
+            if (BeginRecord(*ring, capture)) {
+                try {
+                    capture_arguments(capture);
+                    EndRecord(*ring, capture, gen_dispatch_table);
+                    return true;
+                } catch (const ApiDumpCaptureFull &) {
+                }
+            }
+            if (!MakeRoom(*ring, capture)) {
+                return false;
+            }
+        }
+    }
+
+    // Wait until everything captured before the call has been recorded.  Does nothing on the formatting thread.
+    void Drain();
+
+   private:
+    Ring *ThreadRing();
+    bool BeginRecord(Ring &ring, ApiDumpCapture &capture);
+    void EndRecord(Ring &ring, ApiDumpCapture &capture, XrGeneratedDispatchTable *gen_dispatch_table);
+    bool MakeRoom(Ring &ring, const ApiDumpCapture &capture);
+    void ListRings(std::vector<Ring *> &rings);
+    void FormatThread();
+    void FormatAvailable(std::vector<Ring *> &rings, ApiDumpRecord &record);
+
+    RecordFunction _record;
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+
+    // Guards the members below it.
+    std::mutex _mutex;
+    std::condition_variable _wake_formatter;
+    std::condition_variable _formatted;
+    bool _stop = false;
+    bool _wake = false;
+    size_t _ring_size = 0;
+    std::vector<std::unique_ptr<Ring>> _rings;
+
+    // Sequence numbers handed out to captured records, and how many of them have been recorded.
+    std::atomic<uint64_t> _captured{0};
+    std::atomic<uint64_t> _recorded{0};
+};
@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "api_dump_filter.hpp"
+
+#include "api_dump_output.hpp"
+#include "platform_utils.hpp"
+
+#include <algorithm>
+
+// The names in a list separated by commas, semicolons or whitespace.
+static std::vector<std::string> SplitCommandNames(const std::string &list) {
+    static const char kSeparators[] = ",; \t\r\n";
+    std::vector<std::string> names;
+    std::string::size_type start = list.find_first_not_of(kSeparators);
+    while (start != std::string::npos) {
+        std::string::size_type end = list.find_first_of(kSeparators, start);
+        names.push_back(list.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        start = list.find_first_not_of(kSeparators, end);
+    }
+    return names;
+}
+
+ApiDumpFilter::Settings ApiDumpFilter::SettingsFromEnvironment() {
+    Settings settings;
+    settings.commands = SplitCommandNames(PlatformUtilsGetEnv("XR_API_DUMP_COMMANDS"));
+    settings.skip_commands = SplitCommandNames(PlatformUtilsGetEnv("XR_API_DUMP_SKIP_COMMANDS"));
+    settings.first_frame = ApiDumpGetEnvUnsigned("XR_API_DUMP_FIRST_FRAME", settings.first_frame);
+    settings.last_frame = ApiDumpGetEnvUnsigned("XR_API_DUMP_LAST_FRAME", settings.last_frame);
+    settings.frame_interval = ApiDumpGetEnvUnsigned("XR_API_DUMP_FRAME_INTERVAL", settings.frame_interval);
+    return settings;
+}
+
+void ApiDumpFilter::SetSettings(const Settings &settings, const char *const *command_names, uint32_t command_count) {
+    const auto listed = [command_names](const std::vector<std::string> &names, uint32_t command) {
+        return std::find(names.begin(), names.end(), command_names[command]) != names.end();
+    };
+    _commands.assign(command_count, 1);
+    bool all_commands = true;
+    for (uint32_t command = 0; command < command_count; ++command) {
+        if ((!settings.commands.empty() && !listed(settings.commands, command)) || listed(settings.skip_commands, command)) {
+            _commands[command] = 0;
+            all_commands = false;
+        }
+    }
+    _first_frame = settings.first_frame;
+    _last_frame = settings.last_frame;
+    _frame_interval = std::max<uint64_t>(settings.frame_interval, 1);
+    _filtering = !all_commands || _first_frame != 0 || _last_frame != UINT64_MAX || _frame_interval != 1;
+    _frame.store(0, std::memory_order_relaxed);
+}
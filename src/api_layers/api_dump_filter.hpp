@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ApiDumpFilter class -
+// Decides which calls the api_dump layer dumps, by command name and by frame, so that a call left out goes straight
+// to the next layer without being formatted at all.  Frames are counted from 0 by calls to xrEndFrame, in every
+// session together, and a call belongs to the frame that the next xrEndFrame ends.
+class ApiDumpFilter {
+   public:
+    struct Settings {
+        // Commands to dump, or every command if empty, less the commands to skip.
+        std::vector<std::string> commands;
+        std::vector<std::string> skip_commands;
+        // The first and last frames to dump, and how many frames apart the dumped frames are.
+        uint64_t first_frame = 0;
+        uint64_t last_frame = UINT64_MAX;
+        uint64_t frame_interval = 1;
+    };
+
+    // Settings from XR_API_DUMP_COMMANDS and XR_API_DUMP_SKIP_COMMANDS, which list command names separated by commas,
+    // semicolons or spaces, and from XR_API_DUMP_FIRST_FRAME, XR_API_DUMP_LAST_FRAME and XR_API_DUMP_FRAME_INTERVAL,
+    // with the defaults above for those not set.
+    static Settings SettingsFromEnvironment();
+
+    // Apply settings to the command_count commands named in command_names, which the commands passed to Dump()
+    // index, and start counting frames again.  Names in the settings that are not among them are ignored.
+    void SetSettings(const Settings &settings, const char *const *command_names, uint32_t command_count);
+
+    // Whether to dump a call to command, made now.
+    bool Dump(uint32_t command) const {
+        if (!_filtering) {
+            return true;
+        }
+        if (command >= _commands.size() || 0 == _commands[command]) {
+            return false;
+        }
+        const uint64_t frame = _frame.load(std::memory_order_relaxed);
+        return frame >= _first_frame && frame <= _last_frame && (frame - _first_frame) % _frame_interval == 0;
+    }
+
+    // Count a call to xrEndFrame, once it has been dumped or left out.
+    void EndFrame() { _frame.fetch_add(1, std::memory_order_relaxed); }
+
+   private:
+    bool _filtering = false;
+    // Whether each command is dumped at all.
+    std::vector<uint8_t> _commands;
+    uint64_t _first_frame = 0;
+    uint64_t _last_frame = UINT64_MAX;
+    uint64_t _frame_interval = 1;
+    std::atomic<uint64_t> _frame{0};
+};
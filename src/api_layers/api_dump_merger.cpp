@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "api_dump_merger.hpp"
+
+uint32_t ApiDumpThreadId() {
+    static std::atomic<uint32_t> next_thread_id{0};
+    static thread_local const uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return thread_id;
+}
+
+// Gives up the buffer of a thread when the thread exits.
+struct ApiDumpThreadBuffer {
+    ~ApiDumpThreadBuffer() {
+        if (nullptr != buffer) {
+            buffer->owned.store(false, std::memory_order_release);
+        }
+    }
+    ApiDumpMerger::Buffer *buffer = nullptr;
+};
+
+static thread_local ApiDumpThreadBuffer t_thread_buffer;
+
+ApiDumpMerger::ApiDumpMerger(WriteFunction write) : _write(write) {}
+
+ApiDumpMerger::~ApiDumpMerger() { Flush(); }
+
+ApiDumpMerger::Buffer &ApiDumpMerger::ThreadBuffer() {
+    if (nullptr != t_thread_buffer.buffer) {
+        return *t_thread_buffer.buffer;
+    }
+    std::unique_lock<std::mutex> lock(_buffers_mutex);
+    for (auto &buffer : _buffers) {
+        // Commands left in the buffer of a thread that has exited are still written out in order, before any
+        // the new owner adds.
+        if (!buffer->owned.load(std::memory_order_acquire)) {
+            buffer->owned.store(true, std::memory_order_relaxed);
+            t_thread_buffer.buffer = buffer.get();
+            return *buffer;
+        }
+    }
+    std::unique_ptr<Buffer> buffer(new Buffer);
+    _buffers.push_back(std::move(buffer));
+    t_thread_buffer.buffer = _buffers.back().get();
+    return *t_thread_buffer.buffer;
+}
+
+void ApiDumpMerger::Merge() {
+    // A thread that adds a command while another is writing counts on the writer looking again once it is done.
+    while (_written.load() != _formatted.load()) {
+        std::unique_lock<std::mutex> lock(_write_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        WriteAvailable();
+    }
+}
+
+void ApiDumpMerger::Flush() {
+    const uint64_t formatted = _formatted.load();
+    std::unique_lock<std::mutex> lock(_write_mutex);
+    while (_written.load() < formatted) {
+        WriteAvailable();
+    }
+}
+
+void ApiDumpMerger::WriteAvailable() {
+    {
+        std::unique_lock<std::mutex> lock(_buffers_mutex);
+        _writing.clear();
+        for (auto &buffer : _buffers) {
+            _writing.push_back(buffer.get());
+        }
+    }
+    for (;;) {
+        // Take the commands of every buffer whose last commands taken have all been written out.  A command still to
+        // be written holds back the later ones of its thread, so the next command to write is never left behind.
+        bool took = false;
+        for (Buffer *buffer : _writing) {
+            if (buffer->next_command != buffer->taken_commands.size()) {
+                continue;
+            }
+            buffer->taken_text.clear();
+            buffer->taken_commands.clear();
+            buffer->next_command = 0;
+            std::unique_lock<std::mutex> lock(buffer->mutex);
+            if (!buffer->commands.empty()) {
+                buffer->text.swap(buffer->taken_text);
+                buffer->commands.swap(buffer->taken_commands);
+                took = true;
+            }
+        }
+
+        // Each buffer's commands are in order, so the next one to write is the first of some buffer, unless the thread
+        // numbering it has not finished yet.
+        bool wrote = false;
+        for (;;) {
+            Buffer *oldest = nullptr;
+            for (Buffer *buffer : _writing) {
+                if (buffer->next_command != buffer->taken_commands.size() &&
+                    (nullptr == oldest || buffer->taken_commands[buffer->next_command].sequence <
+                                              oldest->taken_commands[oldest->next_command].sequence)) {
+                    oldest = buffer;
+                }
+            }
+            const uint64_t written = _written.load(std::memory_order_relaxed);
+            if (nullptr == oldest || oldest->taken_commands[oldest->next_command].sequence != written) {
+                break;
+            }
+            const Command &command = oldest->taken_commands[oldest->next_command++];
+            try {
+                _write(oldest->taken_text.data() + command.offset, command.size);
+            } catch (...) {
+            }
+            _written.store(written + 1);
+            wrote = true;
+        }
+        if (!took && !wrote) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The number the dump shows for the calling thread: 0 for the first thread to ask, 1 for the next, and so on.
+uint32_t ApiDumpThreadId();
+
+// ApiDumpMerger class -
+// Puts the commands formatted on every thread into one dump, in the order they were formatted, without the threads
+// waiting on one another.  Each thread formats into a buffer of its own, numbering each command from a counter shared
+// by all threads, and then, unless another thread is already doing so, takes what every thread has formatted and
+// writes it out in order.  A thread that finds another writing leaves its commands for that thread to write.
+class ApiDumpMerger {
+   public:
+    // Writes out the text of one command.  Only one thread writes at a time.
+    typedef void (*WriteFunction)(const char *text, size_t size);
+
+    explicit ApiDumpMerger(WriteFunction write);
+    ~ApiDumpMerger();
+
+    // Non-copyable
+    ApiDumpMerger(const ApiDumpMerger &) = delete;
+    ApiDumpMerger &operator=(const ApiDumpMerger &) = delete;
+
+    // Format a command into the calling thread's buffer with format(std::string&), which appends the command's text,
+    // and write out whatever commands are ready.
+    template <typename Format>
+    void Add(Format &&format) {
+        Buffer &buffer = ThreadBuffer();
+        {
+            std::unique_lock<std::mutex> lock(buffer.mutex);
+            const size_t start = buffer.text.size();
+            try {
+                format(buffer.text);
+                buffer.commands.push_back(Command{0, start, buffer.text.size() - start});
+            } catch (...) {
+                buffer.text.resize(start);
+                throw;
+            }
+            // Numbered only once nothing can fail, so that every number handed out belongs to a command.
+            buffer.commands.back().sequence = _formatted.fetch_add(1);
+        }
+        Merge();
+    }
+
+    // Write out every command formatted before the call, waiting for any other thread writing.
+    void Flush();
+
+   private:
+    struct Command {
+        uint64_t sequence;
+        size_t offset;
+        size_t size;
+    };
+
+    // One thread's commands, formatted but not yet written out.
+    struct Buffer {
+        std::mutex mutex;
+        std::string text;
+        std::vector<Command> commands;
+        // Taken from the above by the writing thread, and written out from next_command on.
+        std::string taken_text;
+        std::vector<Command> taken_commands;
+        size_t next_command = 0;
+        // Cleared when the thread exits, so that another thread can take the buffer over.
+        std::atomic<bool> owned{true};
+    };
+    friend struct ApiDumpThreadBuffer;
+
+    Buffer &ThreadBuffer();
+    void Merge();
+    void WriteAvailable();
+
+    WriteFunction _write;
+
+    // Guards the list of buffers.
+    std::mutex _buffers_mutex;
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+
+    // Held by the thread writing out commands, and guards the members below it.
+    std::mutex _write_mutex;
+    std::vector<Buffer *> _writing;
+
+    // Numbers handed out to formatted commands, and how many of them have been written out.
+    std::atomic<uint64_t> _formatted{0};
+    std::atomic<uint64_t> _written{0};
+};
@@ -0,0 +1,145 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "api_dump_output.hpp"
+
+#include "platform_utils.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else  // !_WIN32
+#include <unistd.h>
+#endif  // _WIN32
+
+uint64_t ApiDumpGetEnvUnsigned(const char *name, uint64_t default_value) {
+    const std::string value = PlatformUtilsGetEnv(name);
+    if (value.empty() || value[0] == '-') {
+        return default_value;
+    }
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || end == value.c_str() || *end != '\0') {
+        return default_value;
+    }
+    return static_cast<uint64_t>(parsed);
+}
+
+static void SyncFile(std::FILE *file) {
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else   // !_WIN32
+    fsync(fileno(file));
+#endif  // _WIN32
+}
+
+ApiDumpOutputFile::Settings ApiDumpOutputFile::SettingsFromEnvironment() {
+    Settings settings;
+    settings.buffer_size = static_cast<size_t>(ApiDumpGetEnvUnsigned("XR_API_DUMP_BUFFER_SIZE", settings.buffer_size));
+    settings.flush_interval = std::chrono::milliseconds(
+        ApiDumpGetEnvUnsigned("XR_API_DUMP_FLUSH_INTERVAL_MS", static_cast<uint64_t>(settings.flush_interval.count())));
+    settings.sync = PlatformUtilsGetEnvSet("XR_API_DUMP_SYNC_INTERVAL_MS");
+    settings.sync_interval = std::chrono::milliseconds(ApiDumpGetEnvUnsigned("XR_API_DUMP_SYNC_INTERVAL_MS", 0));
+    return settings;
+}
+
+ApiDumpOutputFile::~ApiDumpOutputFile() { Close(); }
+
+bool ApiDumpOutputFile::Open(const std::string &file_name, bool append, const Settings &settings) {
+    Close();
+    _file = std::fopen(file_name.c_str(), append ? "ab" : "wb");
+    if (_file == nullptr) {
+        return false;
+    }
+    // Everything goes through our own buffer, so the only writes are the ones made by WriteBuffer.
+    std::setvbuf(_file, nullptr, _IONBF, 0);
+    _file_name = file_name;
+    SetSettings(settings);
+    _last_flush = std::chrono::steady_clock::now();
+    _last_sync = _last_flush;
+    return true;
+}
+
+void ApiDumpOutputFile::SetSettings(const Settings &settings) {
+    _settings = settings;
+    _buffer.reserve(_settings.buffer_size);
+}
+
+void ApiDumpOutputFile::Write(const char *data, size_t size) {
+    if (_file == nullptr) {
+        return;
+    }
+    if (_settings.buffer_size != 0 && _buffer.size() + size > _settings.buffer_size) {
+        WriteBuffer();
+    }
+    _buffer.append(data, size);
+}
+
+ApiDumpOutputFile &ApiDumpOutputFile::operator<<(const char *text) {
+    Write(text, std::strlen(text));
+    return *this;
+}
+
+void ApiDumpOutputFile::EndRecord() {
+    if (_file == nullptr) {
+        return;
+    }
+    if (_settings.buffer_size == 0 || _buffer.size() >= _settings.buffer_size) {
+        Flush(false);
+        return;
+    }
+    if (std::chrono::steady_clock::now() - _last_flush >= _settings.flush_interval) {
+        Flush(false);
+    }
+}
+
+void ApiDumpOutputFile::Flush(bool sync_now) {
+    if (_file == nullptr) {
+        return;
+    }
+    WriteBuffer();
+    const auto now = std::chrono::steady_clock::now();
+    _last_flush = now;
+    if (_settings.sync && (sync_now || now - _last_sync >= _settings.sync_interval)) {
+        SyncFile(_file);
+        _last_sync = now;
+    }
+}
+
+void ApiDumpOutputFile::Close() {
+    if (_file == nullptr) {
+        return;
+    }
+    Flush(true);
+    std::fclose(_file);
+    _file = nullptr;
+    _file_name.clear();
+    _buffer.clear();
+}
+
+void ApiDumpOutputFile::WriteBuffer() {
+    if (!_buffer.empty()) {
+        std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        _buffer.clear();
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// The value of a non-negative integer environment variable, or default_value if it is not set or not a number.
+uint64_t ApiDumpGetEnvUnsigned(const char *name, uint64_t default_value);
+
+// ApiDumpOutputFile class -
+// The file the api_dump layer writes to, kept open while there are instances to dump instead of being opened for
+// every command.  Records are collected in a user-space buffer, which is written out when it is full, when a record
+// ends after the flush interval has passed, and when the file is flushed or closed.  The file is also closed, and
+// so flushed, at process exit.  Optionally, what has been written is synced to disk every so often, so that a crash
+// of the machine loses no more than that interval of the dump.
+class ApiDumpOutputFile {
+   public:
+    struct Settings {
+        // Bytes to collect before writing.  0 writes each record as it ends.
+        size_t buffer_size = 1024 * 1024;
+        // Longest time a finished record waits in the buffer, as long as records keep coming.
+        std::chrono::milliseconds flush_interval{1000};
+        // Whether to sync the file to disk, and at most how often.  Closing the file always syncs it if enabled.
+        bool sync = false;
+        std::chrono::milliseconds sync_interval{0};
+    };
+
+    // Settings from XR_API_DUMP_BUFFER_SIZE, XR_API_DUMP_FLUSH_INTERVAL_MS and XR_API_DUMP_SYNC_INTERVAL_MS, with
+    // the defaults above for those not set.  Syncing is enabled only if XR_API_DUMP_SYNC_INTERVAL_MS is set.
+    static Settings SettingsFromEnvironment();
+
+    ApiDumpOutputFile() = default;
+    ~ApiDumpOutputFile();
+
+    // Non-copyable
+    ApiDumpOutputFile(const ApiDumpOutputFile &) = delete;
+    ApiDumpOutputFile &operator=(const ApiDumpOutputFile &) = delete;
+
+    // Close any open file and open file_name, appending to it or replacing what it holds.
+    bool Open(const std::string &file_name, bool append, const Settings &settings);
+    void SetSettings(const Settings &settings);
+    bool IsOpen() const { return _file != nullptr; }
+    const std::string &FileName() const { return _file_name; }
+
+    void Write(const char *data, size_t size);
+    ApiDumpOutputFile &operator<<(const std::string &text) {
+        Write(text.data(), text.size());
+        return *this;
+    }
+    ApiDumpOutputFile &operator<<(const char *text);
+
+    // Mark the end of a record, writing the buffer out if it is due.
+    void EndRecord();
+
+    // Write out the buffer, syncing the file if syncing is enabled and sync_now is set or the interval has passed.
+    void Flush(bool sync_now);
+
+    // Flush, syncing if enabled, and close the file.
+    void Close();
+
+   private:
+    void WriteBuffer();
+
+    std::FILE *_file = nullptr;
+    std::string _file_name;
+    Settings _settings;
+    std::string _buffer;
+    std::chrono::steady_clock::time_point _last_flush;
+    std::chrono::steady_clock::time_point _last_sync;
+};
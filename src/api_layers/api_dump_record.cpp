@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "api_dump_record.hpp"
+
+struct ApiDumpRecord::Cache {
+    std::vector<Line> lines;
+    std::string arena;
+};
+
+ApiDumpRecord::Cache &ApiDumpRecord::ThreadCache() {
+    static thread_local Cache cache;
+    return cache;
+}
+
+ApiDumpRecord::ApiDumpRecord() {
+    // A record built while another is being built on the same thread, as when formatting a command calls the
+    // runtime, finds the cache empty and starts from nothing.
+    Cache &cache = ThreadCache();
+    _lines.swap(cache.lines);
+    _arena.swap(cache.arena);
+}
+
+ApiDumpRecord::~ApiDumpRecord() {
+    // Keep whichever memory is larger.
+    Cache &cache = ThreadCache();
+    if (_arena.capacity() > cache.arena.capacity()) {
+        _arena.clear();
+        _arena.swap(cache.arena);
+    }
+    if (_lines.capacity() > cache.lines.capacity()) {
+        _lines.clear();
+        _lines.swap(cache.lines);
+    }
+}
+
+void ApiDumpRecord::Add(Part type, Part name) {
+    Line line;
+    line.type = Store(type);
+    line.name = Store(name);
+    line.value = Span{nullptr, _arena.size(), 0};
+    _lines.push_back(line);
+}
+
+ApiDumpRecord::Span ApiDumpRecord::Store(const Part &part) {
+    if (!part._copy) {
+        return Span{part._data, 0, part._size};
+    }
+    Span span{nullptr, _arena.size(), part._size};
+    _arena.append(part._data, part._size);
+    return span;
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ApiDumpRecord class -
+// What the api_dump layer writes for one command: a line for the command itself, then a line for each parameter and
+// each member reached from them, each with a type, a name and a value.  Types and names passed as const char* are
+// kept by pointer, so they must outlive the record, as the string literals the generated code passes do.  Types and
+// names passed as std::string, and all values, are copied into one arena of text held by the record.  Values can also
+// be formatted straight into the arena: the record is a buffer for the Append* functions of format_buffer.h, which
+// append to the value of the last line added.
+//
+// The arena and the list of lines are taken from a cache kept by each thread, and given back to it when the record
+// is destroyed, so once a thread has dumped a few commands, building a record allocates nothing.
+class ApiDumpRecord {
+   public:
+    // Text of part of a line, not null-terminated.  Valid until the record is next changed.
+    struct Text {
+        const char *data;
+        size_t size;
+
+        bool empty() const { return size == 0; }
+        std::string str() const { return std::string(data, size); }
+    };
+
+    // A type or name to add to a record: kept by pointer if given as const char*, and copied if given as std::string.
+    class Part {
+       public:
+        Part(const char *kept) : _data(kept), _size(std::strlen(kept)), _copy(false) {}
+        Part(const std::string &copied) : _data(copied.data()), _size(copied.size()), _copy(true) {}
+
+       private:
+        friend class ApiDumpRecord;
+        const char *_data;
+        size_t _size;
+        bool _copy;
+    };
+
+    ApiDumpRecord();
+    ~ApiDumpRecord();
+
+    // Non-copyable
+    ApiDumpRecord(const ApiDumpRecord &) = delete;
+    ApiDumpRecord &operator=(const ApiDumpRecord &) = delete;
+
+    // Add a line with an empty value, to be appended to.
+    void Add(Part type, Part name);
+
+    // Add a line with a copy of value, which may be nullptr for an empty value.
+    void Add(Part type, Part name, const char *value) {
+        Add(type, name);
+        if (nullptr != value) {
+            Append(value);
+        }
+    }
+    void Add(Part type, Part name, const std::string &value) {
+        Add(type, name);
+        Append(value.data(), value.size());
+    }
+
+    // Append to the value of the last line added.
+    void Append(const char *text, size_t length) {
+        _arena.append(text, length);
+        _lines.back().value.size += length;
+    }
+    void Append(const char *text) { Append(text, std::strlen(text)); }
+
+    // Remove every line, keeping the memory they used.
+    void Clear() {
+        _lines.clear();
+        _arena.clear();
+    }
+
+    size_t LineCount() const { return _lines.size(); }
+    Text Type(size_t line) const { return Resolve(_lines[line].type); }
+    Text Name(size_t line) const { return Resolve(_lines[line].name); }
+    Text Value(size_t line) const { return Resolve(_lines[line].value); }
+
+   private:
+    // Text kept by pointer, or, if pointer is nullptr, at offset in the arena.
+    struct Span {
+        const char *pointer;
+        size_t offset;
+        size_t size;
+    };
+    struct Line {
+        Span type;
+        Span name;
+        Span value;
+    };
+
+    // Memory given back by the records a thread has destroyed.
+    struct Cache;
+    static Cache &ThreadCache();
+
+    Span Store(const Part &part);
+    Text Resolve(const Span &span) const {
+        return Text{nullptr != span.pointer ? span.pointer : _arena.data() + span.offset, span.size};
+    }
+
+    std::vector<Line> _lines;
+    std::string _arena;
+};
@@ -19,8 +19,10 @@
 // Author: Mark Young <marky@lunarg.com>
 //
 
+#include "allocation_callbacks.h"
 #include "api_layer_platform_defines.h"
 #include "extra_algorithms.h"
+#include "format_buffer.h"
 #include "hex_and_handles.h"
 #include "loader_interfaces.h"
 #include "platform_utils.hpp"
@@ -31,6 +33,7 @@
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstring>
 #include <fstream>
@@ -71,6 +74,9 @@ struct CoreValidationRecordInfo {
 static CoreValidationRecordInfo g_record_info = {};
 static std::mutex g_record_mutex = {};
 
+// Gets the application's allocation callbacks from the loader, if the loader gave the layer this function.
+static std::atomic<PFN_openxrLoaderGetAllocationCallbacks> g_get_allocation_callbacks{nullptr};
+
 // HTML utilities
 bool CoreValidationWriteHtmlHeader() {
     try {
@@ -279,6 +285,7 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
             }
         }
 
+        const XrSdkSessionLabelView session_labels = names_and_labels.SessionLabels();
         switch (g_record_info.type) {
             case RECORD_TEXT_COUT: {
                 std::cout << "[" << severity_string << " | " << message_id << " | " << command_name << "]: " << message
@@ -288,16 +295,18 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
                     uint32_t count = 0;
                     for (const auto &object_info : objects_info) {
                         std::string object_type = GenValidUsageXrObjectTypeToString(object_info.type);
-                        std::ostringstream oss_object_handle;
+                        FixedFormatBuffer<XR_HEX_STRING_LENGTH(sizeof(object_info.handle)) + 1> object_handle;
+                        AppendHex(object_handle, object_info.handle);
                         std::cout << "   [" << std::to_string(count++) << "] - " << object_type << " ("
-                                  << Uint64ToHexString(object_info.handle) << ")";
+                                  << object_handle.c_str() << ")";
                         std::cout << std::endl;
                     }
                 }
-                if (!names_and_labels.labels.empty()) {
+                if (session_labels.count != 0) {
                     std::cout << "  Session Labels:" << std::endl;
                     uint32_t count = 0;
-                    for (const auto &session_label : names_and_labels.labels) {
+                    for (uint32_t label = 0; label < session_labels.count; ++label) {
+                        const auto &session_label = session_labels.labels[label];
                         std::cout << "   [" << std::to_string(count++) << "] - " << session_label.labelName << std::endl;
                     }
                 }
@@ -314,15 +323,18 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
                     uint32_t count = 0;
                     for (const auto &object_info : objects_info) {
                         std::string object_type = GenValidUsageXrObjectTypeToString(object_info.type);
+                        FixedFormatBuffer<XR_HEX_STRING_LENGTH(sizeof(object_info.handle)) + 1> object_handle;
+                        AppendHex(object_handle, object_info.handle);
                         text_file << "   [" << std::to_string(count++) << "] - " << object_type << " ("
-                                  << Uint64ToHexString(object_info.handle) << ")";
+                                  << object_handle.c_str() << ")";
                         text_file << std::endl;
                     }
                 }
-                if (!names_and_labels.labels.empty()) {
+                if (session_labels.count != 0) {
                     text_file << "  Session Labels:" << std::endl;
                     uint32_t count = 0;
-                    for (const auto &session_label : names_and_labels.labels) {
+                    for (uint32_t label = 0; label < session_labels.count; ++label) {
+                        const auto &session_label = session_labels.labels[label];
                         text_file << "   [" << std::to_string(count++) << "] - " << session_label.labelName << std::endl;
                     }
                 }
@@ -370,22 +382,25 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
                     uint32_t count = 0;
                     for (const auto &object_info : objects_info) {
                         std::string object_type = GenValidUsageXrObjectTypeToString(object_info.type);
+                        FixedFormatBuffer<XR_HEX_STRING_LENGTH(sizeof(object_info.handle)) + 1> object_handle;
+                        AppendHex(object_handle, object_info.handle);
                         text_file << "         <div class='data'>\n";
                         text_file << "             <div class='var'>[" << count++ << "]</div>\n";
                         text_file << "             <div class='type'>" << object_type << "</div>\n";
-                        text_file << "             <div class='val'>" << Uint64ToHexString(object_info.handle) << "</div>\n";
+                        text_file << "             <div class='val'>" << object_handle.c_str() << "</div>\n";
                         text_file << "         </div>\n";
                     }
                     text_file << "      </details>\n";
                     text_file << std::flush;
                 }
-                if (!names_and_labels.labels.empty()) {
+                if (session_labels.count != 0) {
                     text_file << "      <details class='data'>\n";
                     text_file << "         <summary>\n";
                     text_file << "            <div class='type'>Relevant Session Labels</div>\n";
                     text_file << "         </summary>\n";
                     uint32_t count = 0;
-                    for (const auto &session_label : names_and_labels.labels) {
+                    for (uint32_t label = 0; label < session_labels.count; ++label) {
+                        const auto &session_label = session_labels.labels[label];
                         text_file << "         <div class='data'>\n";
                         text_file << "             <div class='var'>[" << count++ << "]</div>\n";
                         text_file << "             <div class='type'>" << session_label.labelName << "</div>\n";
@@ -458,15 +473,20 @@ XrResult CoreValidationXrCreateInstance(const XrInstanceCreateInfo * /*info*/, X
     return XR_SUCCESS;
 }
 
-GenValidUsageXrInstanceInfo::GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr)
-    : instance(inst), dispatch_table(new XrGeneratedDispatchTable()) {
+GenValidUsageXrInstanceInfo::GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr,
+                                                         const OpenXRLoaderAllocationCallbacks *allocation_callbacks)
+    : instance(inst),
+      dispatch_table(XrSdkNew<XrGeneratedDispatchTable>(allocation_callbacks, OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE)) {
     /// @todo smart pointer here!
+    if (nullptr == dispatch_table) {
+        throw std::bad_alloc();
+    }
 
     // Create the dispatch table to the next levels
     GeneratedXrPopulateDispatchTable(dispatch_table, instance, next_get_instance_proc_addr);
 }
 
-GenValidUsageXrInstanceInfo::~GenValidUsageXrInstanceInfo() { delete dispatch_table; }
+GenValidUsageXrInstanceInfo::~GenValidUsageXrInstanceInfo() { XrSdkDelete(dispatch_table); }
 
 // See if there is a debug utils create structure in the "next" chain
 
@@ -529,8 +549,10 @@ XrResult CoreValidationXrCreateApiLayerInstance(const XrInstanceCreateInfo *info
         *instance = returned_instance;
 
         // Create the instance information
-        std::unique_ptr<GenValidUsageXrInstanceInfo> instance_info(
-            new GenValidUsageXrInstanceInfo(returned_instance, next_get_instance_proc_addr));
+        OpenXRLoaderAllocationCallbacks allocation_callbacks;
+        std::unique_ptr<GenValidUsageXrInstanceInfo> instance_info(new GenValidUsageXrInstanceInfo(
+            returned_instance, next_get_instance_proc_addr,
+            XrSdkGetLayerAllocationCallbacks(g_get_allocation_callbacks.load(), &allocation_callbacks)));
 
         // Save the enabled extensions.
         for (uint32_t extension = 0; extension < info->enabledExtensionCount; ++extension) {
@@ -849,4 +871,10 @@ LAYER_EXPORT XrResult xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoader
     return XR_SUCCESS;
 }
 
+// Function the loader calls, if found, to let the layer allocate through the application's allocation callbacks.
+LAYER_EXPORT void XRAPI_CALL
+openxrLoaderNegotiateApiLayerAllocation(PFN_openxrLoaderGetAllocationCallbacks getAllocationCallbacks) {
+    g_get_allocation_callbacks.store(getAllocationCallbacks);
+}
+
 }  // extern "C"
@@ -0,0 +1,135 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*!
+ * @file
+ *
+ * Allocation through the OpenXRLoaderAllocationCallbacks an application gives the loader, for the loader and the API
+ * layers shipped with it.
+ *
+ * Each block starts with a header recording the free function and user data it was allocated with, so it can be
+ * freed correctly after the application has changed or removed its callbacks.  Without callbacks, blocks come from
+ * malloc.
+ */
+
+#pragma once
+
+#include "loader_interfaces.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <stdint.h>
+
+/// Recorded in front of every block XrSdkAllocate returns.
+struct XrSdkAllocationHeader {
+    void* block;                           // What the allocation function returned
+    PFN_openxrLoaderFreeFunction pfnFree;  // nullptr if block came from malloc
+    void* userData;
+    size_t size;                           // Bytes the caller asked for
+    OpenXRLoaderAllocationSubsystem subsystem;
+};
+
+/// Callbacks the application set, or nullptr if they are missing or not usable.
+inline const OpenXRLoaderAllocationCallbacks* XrSdkValidAllocationCallbacks(const OpenXRLoaderAllocationCallbacks* callbacks) {
+    if (callbacks == nullptr || callbacks->structVersion < 1 || callbacks->structSize < sizeof(OpenXRLoaderAllocationCallbacks) ||
+        callbacks->pfnAllocation == nullptr || callbacks->pfnFree == nullptr) {
+        return nullptr;
+    }
+    return callbacks;
+}
+
+/// Copy into callbacks the allocation callbacks an API layer can get through getAllocationCallbacks, the function
+/// the loader passed to openxrLoaderNegotiateApiLayerAllocation, and return callbacks.  Returns nullptr if
+/// getAllocationCallbacks is nullptr, as it is with loaders that do not call that function, or there are no callbacks.
+inline const OpenXRLoaderAllocationCallbacks* XrSdkGetLayerAllocationCallbacks(
+    PFN_openxrLoaderGetAllocationCallbacks getAllocationCallbacks, OpenXRLoaderAllocationCallbacks* callbacks) {
+    *callbacks = {};
+    callbacks->structVersion = OPENXR_LOADER_ALLOCATION_CALLBACKS_STRUCT_VERSION;
+    callbacks->structSize = sizeof(OpenXRLoaderAllocationCallbacks);
+    if (getAllocationCallbacks == nullptr || !getAllocationCallbacks(callbacks)) {
+        return nullptr;
+    }
+    return XrSdkValidAllocationCallbacks(callbacks);
+}
+
+/// Allocate size bytes aligned to alignment, a power of two, through callbacks or, if that is nullptr, malloc.
+/// Returns nullptr on failure.  Free the memory with XrSdkFree.
+inline void* XrSdkAllocate(const OpenXRLoaderAllocationCallbacks* callbacks, OpenXRLoaderAllocationSubsystem subsystem,
+                           size_t size, size_t alignment) {
+    if (alignment < alignof(XrSdkAllocationHeader)) {
+        alignment = alignof(XrSdkAllocationHeader);
+    }
+    // Room for the header and for moving past it to the next aligned address.
+    const size_t total = size + sizeof(XrSdkAllocationHeader) + alignment - 1;
+    if (total < size) {
+        return nullptr;
+    }
+    void* block = callbacks != nullptr ? callbacks->pfnAllocation(callbacks->userData, total, alignment, subsystem)
+                                       : std::malloc(total);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    const uintptr_t first = reinterpret_cast<uintptr_t>(block) + sizeof(XrSdkAllocationHeader);
+    void* memory = reinterpret_cast<void*>((first + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+    XrSdkAllocationHeader* header = static_cast<XrSdkAllocationHeader*>(memory) - 1;
+    header->block = block;
+    header->pfnFree = callbacks != nullptr ? callbacks->pfnFree : nullptr;
+    header->userData = callbacks != nullptr ? callbacks->userData : nullptr;
+    header->size = size;
+    header->subsystem = subsystem;
+    return memory;
+}
+
+/// The header of memory returned by XrSdkAllocate.
+inline const XrSdkAllocationHeader* XrSdkAllocationHeaderOf(const void* memory) {
+    return static_cast<const XrSdkAllocationHeader*>(memory) - 1;
+}
+
+/// Free memory returned by XrSdkAllocate, through the allocator it came from.  memory may be nullptr.
+inline void XrSdkFree(void* memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    const XrSdkAllocationHeader* header = XrSdkAllocationHeaderOf(memory);
+    if (header->pfnFree != nullptr) {
+        header->pfnFree(header->userData, header->block);
+    } else {
+        std::free(header->block);
+    }
+}
+
+/// Construct a T, whose constructor must not throw, in memory from XrSdkAllocate.  Returns nullptr if the memory
+/// could not be allocated.
+template <typename T, typename... Args>
+inline T* XrSdkNew(const OpenXRLoaderAllocationCallbacks* callbacks, OpenXRLoaderAllocationSubsystem subsystem, Args&&... args) {
+    void* memory = XrSdkAllocate(callbacks, subsystem, sizeof(T), alignof(T));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    return new (memory) T(std::forward<Args>(args)...);
+}
+
+/// Destroy and free an object from XrSdkNew.  object may be nullptr.
+template <typename T>
+inline void XrSdkDelete(T* object) {
+    if (object != nullptr) {
+        object->~T();
+        XrSdkFree(object);
+    }
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*!
+ * @file
+ *
+ * Names of OpenXR enumerants and flag bits, in both directions.
+ *
+ * For each enumeration in openxr.h there is XrSdkEnumName(value), returning the name of a value or nullptr, which
+ * may be used in constant expressions, and XrSdkEnumFromName(name, &value), which parses the name of an enumerant
+ * with a binary search of a constant table built from the sorted lists in openxr_reflection.h.  For each flags type
+ * with any bits there is a table of the names of its bits, flagsType##BitsByName.
+ */
+
+#pragma once
+
+#include <openxr/openxr.h>
+#include <openxr/openxr_reflection.h>
+
+#include <cstring>
+#include <stddef.h>
+
+/// A name and its value, one entry of the tables below.
+template <typename Value>
+struct XrSdkNamedValue {
+    const char* name;
+    Value value;
+};
+
+/// Compare two null-terminated names as strcmp does, in a constant expression.
+constexpr int XrSdkCompareNames(const char* a, const char* b) {
+    while (*a != '\0' && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return static_cast<int>(static_cast<unsigned char>(*a)) - static_cast<int>(static_cast<unsigned char>(*b));
+}
+
+/// Whether a table is sorted by name, so XrSdkFindByName can search it.
+template <typename Value, size_t N>
+constexpr bool XrSdkIsSortedByName(const XrSdkNamedValue<Value> (&table)[N]) {
+    for (size_t i = 1; i < N; ++i) {
+        if (XrSdkCompareNames(table[i - 1].name, table[i].name) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Find the entry for name in a table sorted by name, or nullptr if there is none.  This uses strcmp rather than
+/// XrSdkCompareNames, since the names share long prefixes that strcmp gets past much faster.
+template <typename Value, size_t N>
+inline const XrSdkNamedValue<Value>* XrSdkFindByName(const XrSdkNamedValue<Value> (&table)[N], const char* name) {
+    size_t first = 0;
+    size_t count = N;
+    while (count > 0) {
+        const size_t half = count / 2;
+        if (strcmp(table[first + half].name, name) < 0) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return (first < N && strcmp(table[first].name, name) == 0) ? &table[first] : nullptr;
+}
+
+/// Set value to the value of name in a table sorted by name.  Returns false, leaving value alone, if there is none.
+template <typename Value, size_t N>
+inline bool XrSdkFindValue(const XrSdkNamedValue<Value> (&table)[N], const char* name, Value* value) {
+    const XrSdkNamedValue<Value>* entry = XrSdkFindByName(table, name);
+    if (entry == nullptr) {
+        return false;
+    }
+    *value = entry->value;
+    return true;
+}
+
+// clang-format off
+#define XR_SDK_ENUM_NAME_CASE(name, value) case name: return #name;
+#define XR_SDK_NAMED_ENUM_VALUE(name, value) {#name, name},
+#define XR_SDK_NAMED_FLAG_BIT(name, value) {#name, static_cast<XrFlags64>(value)},
+
+/// Define XrSdkEnumName for enumType, which switches on the value as that is quicker than any table, and
+/// enumType##NamesByName, the names of its values sorted for XrSdkEnumFromName to search.
+#define XR_SDK_DEFINE_ENUM_NAMES(enumType)                                                                           \
+    constexpr const char* XrSdkEnumName(enumType value) {                                                            \
+        switch (value) {                                                                                             \
+            XR_LIST_ENUM_##enumType(XR_SDK_ENUM_NAME_CASE)                                                           \
+            default: return nullptr;                                                                                 \
+        }                                                                                                            \
+    }                                                                                                                \
+    constexpr XrSdkNamedValue<enumType> enumType##NamesByName[] = {                                                  \
+        XR_LIST_ENUM_BY_NAME_##enumType(XR_SDK_NAMED_ENUM_VALUE)};                                                   \
+    static_assert(XrSdkIsSortedByName(enumType##NamesByName), #enumType " names must be sorted by name");            \
+    inline bool XrSdkEnumFromName(const char* name, enumType* value) {                                               \
+        return XrSdkFindValue(enumType##NamesByName, name, value);                                                   \
+    }
+
+/// Define flagsType##BitsByName, the names of the bits of flagsType sorted by name, for XrSdkFindByName and
+/// AppendFlags.  Flags types without any bits have no table.
+#define XR_SDK_DEFINE_FLAG_BIT_NAMES(flagsType)                                                                      \
+    constexpr XrSdkNamedValue<XrFlags64> flagsType##BitsByName[] = {                                                 \
+        XR_LIST_BITS_BY_NAME_##flagsType(XR_SDK_NAMED_FLAG_BIT)};                                                    \
+    static_assert(XrSdkIsSortedByName(flagsType##BitsByName), #flagsType " bit names must be sorted by name");
+// clang-format on
+
+XR_LIST_ENUM_TYPES(XR_SDK_DEFINE_ENUM_NAMES)
+XR_LIST_BITMASK_TYPES(XR_SDK_DEFINE_FLAG_BIT_NAMES)
+
+// Enumerations from openxr_platform.h, when it has been included for their platform.
+#if defined(OPENXR_PLATFORM_H_) && defined(XR_USE_PLATFORM_ANDROID)
+XR_SDK_DEFINE_ENUM_NAMES(XrAndroidThreadTypeKHR)
+#endif
@@ -0,0 +1,263 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*!
+ * @file
+ *
+ * Formatting of handles, pointers, integers, enumerants and flags without a std::string per value, for the loader
+ * and the API layers, which format values on every call they log or dump.
+ *
+ * Values are appended to a buffer: a FixedFormatBuffer, which keeps its characters inline and drops what does not
+ * fit, or a StringFormatBuffer, which appends to a std::string that can be cleared and reused without giving back
+ * its memory.  The Append* functions work with either, or with any class that has Append(const char*, size_t).
+ */
+
+#pragma once
+
+#include "enum_names.h"
+#include "hex_and_handles.h"
+
+#include <openxr/openxr.h>
+#include <openxr/openxr_reflection.h>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <stdint.h>
+
+/// Text appended to storage owned by a derived class, always null-terminated.  Whatever does not fit is dropped,
+/// and the buffer remembers that it was truncated.
+class FormatBuffer {
+   public:
+    FormatBuffer(const FormatBuffer&) = delete;
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+    void Append(const char* text, size_t length) {
+        if (length > capacity_ - 1 - size_) {
+            length = capacity_ - 1 - size_;
+            truncated_ = true;
+        }
+        memcpy(storage_ + size_, text, length);
+        size_ += length;
+        storage_[size_] = '\0';
+    }
+
+    void Append(const char* text) { Append(text, strlen(text)); }
+
+    void Clear() {
+        size_ = 0;
+        truncated_ = false;
+        storage_[0] = '\0';
+    }
+
+    const char* c_str() const { return storage_; }
+    size_t size() const { return size_; }
+    bool Truncated() const { return truncated_; }
+    std::string str() const { return std::string(storage_, size_); }
+
+   protected:
+    // capacity includes the null terminator, so must be at least 1.  The derived class calls Clear() once storage
+    // may be written.
+    FormatBuffer(char* storage, size_t capacity) : storage_(storage), capacity_(capacity) {}
+    ~FormatBuffer() = default;
+
+   private:
+    char* storage_;
+    size_t capacity_;
+    size_t size_ = 0;
+    bool truncated_ = false;
+};
+
+/// A FormatBuffer holding up to N - 1 characters inline, for formatting on the stack.
+template <size_t N>
+class FixedFormatBuffer : public FormatBuffer {
+   public:
+    FixedFormatBuffer() : FormatBuffer(storage_, N) { Clear(); }
+
+   private:
+    char storage_[N];
+};
+
+/// Appends to a caller's std::string.  Clearing the string between uses keeps its capacity, so once it has grown
+/// to the size of the usual output, appending allocates nothing.
+class StringFormatBuffer {
+   public:
+    explicit StringFormatBuffer(std::string& out) : out_(out) {}
+
+    void Append(const char* text, size_t length) { out_.append(text, length); }
+    void Append(const char* text) { out_.append(text); }
+
+   private:
+    std::string& out_;
+};
+
+/// Longest text WriteDecimal writes: a sign and 20 digits.
+#define XR_DECIMAL_STRING_LENGTH 21
+
+/// Two decimal digits for each value from 0 to 99, for formatting two digits at a time.
+static const char kDecimalDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/// Write the decimal digits of value into out, which must have room for XR_DECIMAL_STRING_LENGTH characters.
+/// Returns a pointer past the last character written; the text is not null-terminated.
+inline char* WriteDecimal(char* out, uint64_t value) {
+    char digits[XR_DECIMAL_STRING_LENGTH];
+    char* first = digits + sizeof(digits);
+    while (value >= 100) {
+        const char* pair = &kDecimalDigitPairs[2 * (value % 100)];
+        value /= 100;
+        *--first = pair[1];
+        *--first = pair[0];
+    }
+    if (value >= 10) {
+        const char* pair = &kDecimalDigitPairs[2 * value];
+        *--first = pair[1];
+        *--first = pair[0];
+    } else {
+        *--first = static_cast<char>('0' + value);
+    }
+    const size_t length = static_cast<size_t>(digits + sizeof(digits) - first);
+    memcpy(out, first, length);
+    return out + length;
+}
+
+/// @overload
+inline char* WriteDecimal(char* out, int64_t value) {
+    if (value < 0) {
+        *out++ = '-';
+        // Negate as unsigned, which is also correct for the most negative value.
+        return WriteDecimal(out, 0 - static_cast<uint64_t>(value));
+    }
+    return WriteDecimal(out, static_cast<uint64_t>(value));
+}
+
+/// Write "0x" and the hex digits of value, without leading zeros, into out, which must have room for
+/// XR_HEX_STRING_LENGTH(8) characters.  Returns a pointer past the last character written.
+inline char* WriteHexInteger(char* out, uint64_t value) {
+    char digits[XR_HEX_STRING_LENGTH(8)];
+    char* end = WriteHex(digits, value);
+    char* first = digits + 2;
+    while (first < end - 1 && *first == '0') {
+        ++first;
+    }
+    *out++ = '0';
+    *out++ = 'x';
+    memcpy(out, first, static_cast<size_t>(end - first));
+    return out + (end - first);
+}
+
+/// Append "0x" and every hex digit of an integer or handle value, as to_hex() does.
+template <typename Buffer, typename T>
+inline void AppendHex(Buffer& out, const T& value) {
+    char text[XR_HEX_STRING_LENGTH(sizeof(T))];
+    out.Append(text, static_cast<size_t>(WriteHex(text, value) - text));
+}
+
+/// Append an OpenXR handle, as HandleToHexString() does.
+template <typename Buffer, typename T>
+inline void AppendHandle(Buffer& out, T handle) {
+    AppendHex(out, handle);
+}
+
+/// Append a pointer, as PointerToHexString() does.
+template <typename Buffer>
+inline void AppendPointer(Buffer& out, const void* pointer) {
+    AppendHex(out, pointer);
+}
+
+/// Append "0x" and the hex digits of value, without leading zeros.
+template <typename Buffer>
+inline void AppendHexInteger(Buffer& out, uint64_t value) {
+    char text[XR_HEX_STRING_LENGTH(8)];
+    out.Append(text, static_cast<size_t>(WriteHexInteger(text, value) - text));
+}
+
+/// Append an integer in decimal.
+template <typename Buffer, typename Integer>
+inline void AppendDecimal(Buffer& out, Integer value) {
+    char text[XR_DECIMAL_STRING_LENGTH];
+    char* end = std::is_signed<Integer>::value ? WriteDecimal(text, static_cast<int64_t>(value))
+                                               : WriteDecimal(text, static_cast<uint64_t>(value));
+    out.Append(text, static_cast<size_t>(end - text));
+}
+
+/// Append the name of an enumerant, as XrSdkEnumName() finds it, or its value in decimal if it has no name.
+template <typename Buffer, typename Enum>
+inline void AppendEnum(Buffer& out, Enum value) {
+    const char* name = XrSdkEnumName(value);
+    if (name != nullptr) {
+        out.Append(name);
+    } else {
+        AppendDecimal(out, static_cast<int64_t>(value));
+    }
+}
+
+/// Append the name of a result, or XR_UNKNOWN_SUCCESS_<value> or XR_UNKNOWN_FAILURE_<value>, as xrResultToString
+/// describes results it does not know.
+template <typename Buffer>
+inline void AppendResult(Buffer& out, XrResult value) {
+    const char* name = XrSdkEnumName(value);
+    if (name != nullptr) {
+        out.Append(name);
+        return;
+    }
+    out.Append(XR_SUCCEEDED(value) ? "XR_UNKNOWN_SUCCESS_" : "XR_UNKNOWN_FAILURE_");
+    AppendDecimal(out, static_cast<int64_t>(value));
+}
+
+/// Append the name of a structure type, or XR_UNKNOWN_STRUCTURE_TYPE_<value>, as xrStructureTypeToString
+/// describes structure types it does not know.
+template <typename Buffer>
+inline void AppendStructureType(Buffer& out, XrStructureType value) {
+    const char* name = XrSdkEnumName(value);
+    if (name != nullptr) {
+        out.Append(name);
+        return;
+    }
+    out.Append("XR_UNKNOWN_STRUCTURE_TYPE_");
+    AppendDecimal(out, static_cast<int64_t>(value));
+}
+
+/// Append the names of the bits set in flags, in the order of names, which is flagsType##BitsByName from
+/// enum_names.h, separated by " | ", followed by any bits without a name as one hex value.  No bits set is written
+/// as "0".
+template <typename Buffer, size_t N>
+inline void AppendFlags(Buffer& out, XrFlags64 flags, const XrSdkNamedValue<XrFlags64> (&names)[N]) {
+    if (flags == 0) {
+        out.Append("0", 1);
+        return;
+    }
+    bool first = true;
+    for (const XrSdkNamedValue<XrFlags64>& bit : names) {
+        if ((flags & bit.value) != 0) {
+            if (!first) {
+                out.Append(" | ", 3);
+            }
+            out.Append(bit.name);
+            flags &= ~bit.value;
+            first = false;
+        }
+    }
+    if (flags != 0) {
+        if (!first) {
+            out.Append(" | ", 3);
+        }
+        AppendHexInteger(out, flags);
+    }
+}
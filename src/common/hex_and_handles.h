@@ -33,20 +33,46 @@
 #include <string>
 #include <stdint.h>
 
-inline std::string to_hex(const uint8_t* const data, size_t bytes) {
-    std::string out(2 + bytes * 2, '?');
-    out[0] = '0';
-    out[1] = 'x';
-    static const char* hex = "0123456789abcdef";
-    auto ch = out.end();
-    for (size_t i = 0; i < bytes; ++i) {
-        auto b = data[i];
-        *--ch = hex[(b >> 0) & 0xf];
-        *--ch = hex[(b >> 4) & 0xf];
+/// Number of characters WriteHex writes for a value of the given size: "0x" and two digits per byte.
+#define XR_HEX_STRING_LENGTH(bytes) (2 + 2 * (bytes))
+
+/// Two lowercase hex digits for each byte value, for formatting a byte at a time.
+static const char kHexDigitPairs[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/// Write "0x" followed by two hex digits for each byte at data, last byte first (so an integer on a little-endian
+/// machine reads most significant first), into out, which must have room for XR_HEX_STRING_LENGTH(bytes)
+/// characters.  Returns a pointer past the last character written; the text is not null-terminated.
+inline char* WriteHex(char* out, const uint8_t* const data, size_t bytes) {
+    *out++ = '0';
+    *out++ = 'x';
+    for (size_t i = bytes; i > 0; --i) {
+        const char* pair = &kHexDigitPairs[2 * data[i - 1]];
+        *out++ = pair[0];
+        *out++ = pair[1];
     }
     return out;
 }
 
+/// @overload
+template <typename T>
+inline char* WriteHex(char* out, const T& data) {
+    return WriteHex(out, reinterpret_cast<const uint8_t* const>(&data), sizeof(data));
+}
+
+inline std::string to_hex(const uint8_t* const data, size_t bytes) {
+    std::string out(XR_HEX_STRING_LENGTH(bytes), '?');
+    WriteHex(&out[0], data, bytes);
+    return out;
+}
+
 template <typename T>
 inline std::string to_hex(const T& data) {
     return to_hex(reinterpret_cast<const uint8_t* const>(&data), sizeof(data));
@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+/*!
+ * @file
+ *
+ * Layout of the binary log files written by the loader when XR_LOADER_BINARY_LOG_FILE is set, shared by the
+ * recorder that writes them and the tool that decodes them.
+ *
+ * A file is a BinaryLogFileHeader followed by records.  Every record starts with a BinaryLogRecordHeader and is
+ * padded to a multiple of 8 bytes.  A record with a size of zero marks the end of the log, since the writer
+ * extends the file in zero-filled blocks and trims it only when it is closed.  Values are in the byte order of
+ * the machine that wrote the file.
+ *
+ * Strings are written once each, as string records, and referred to afterward by index.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define XR_LOADER_BINARY_LOG_MAGIC "XRLDBLOG"
+#define XR_LOADER_BINARY_LOG_VERSION 1
+
+// Index of an absent string, such as an object with no name.
+#define XR_LOADER_BINARY_LOG_NO_STRING 0xFFFFFFFFU
+
+struct BinaryLogFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    // When the log was opened, in nanoseconds since the system clock's epoch.  Record timestamps count from here.
+    uint64_t start_time_ns;
+    uint64_t reserved;
+};
+
+enum BinaryLogRecordKind : uint16_t {
+    BINARY_LOG_RECORD_STRING = 1,
+    BINARY_LOG_RECORD_MESSAGE = 2,
+};
+
+struct BinaryLogRecordHeader {
+    // Size of the whole record, including this header and padding.
+    uint32_t size;
+    uint16_t kind;
+    uint16_t reserved;
+};
+
+// Followed by length bytes of the string, which is not null-terminated.  Indices count up from zero.
+struct BinaryLogStringRecord {
+    BinaryLogRecordHeader header;
+    uint32_t index;
+    uint32_t length;
+};
+
+// Followed by object_count BinaryLogObject entries, then session_label_count string indices, then payload_length
+// bytes of the message text.  Message text that repeats is written once as a string and referred to by payload,
+// with payload_length zero.
+struct BinaryLogMessageRecord {
+    BinaryLogRecordHeader header;
+    // Nanoseconds since BinaryLogFileHeader::start_time_ns.
+    uint64_t timestamp_ns;
+    // Small number identifying the logging thread, counting up from 1 in the order threads first logged.
+    uint32_t thread_id;
+    // XR_LOADER_LOG_MESSAGE_SEVERITY_*_BIT and XR_LOADER_LOG_MESSAGE_TYPE_*_BIT values.
+    uint32_t severity;
+    uint32_t type;
+    uint32_t message_id;
+    uint32_t command_name;
+    uint16_t object_count;
+    uint16_t session_label_count;
+    uint32_t payload_length;
+    // Index of the message text, or XR_LOADER_BINARY_LOG_NO_STRING if it follows inline.
+    uint32_t payload;
+};
+
+struct BinaryLogObject {
+    uint64_t handle;
+    // XrObjectType
+    uint32_t type;
+    uint32_t name;
+};
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <openxr/openxr.h>
+#include <openxr/openxr_loader.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -121,6 +122,17 @@ typedef struct XrApiLayerCreateInfo {
     XrApiLayerNextInfo *nextInfo;                                      // Pointer to the next API layer's Info
 } XrApiLayerCreateInfo;
 
+// Function the loader passes to API layers for copying the allocation callbacks the application set with
+// openxrLoaderSetAllocationCallbacks.  The caller sets structVersion and structSize of callbacks.  Returns XR_FALSE,
+// leaving callbacks unchanged, if the application has set none.
+typedef XrBool32(XRAPI_PTR *PFN_openxrLoaderGetAllocationCallbacks)(OpenXRLoaderAllocationCallbacks *callbacks);
+
+// Function an API layer library may expose, found through the same manifest function name mapping as
+// xrNegotiateLoaderApiLayerInterface, and called after a successful negotiation.  The loader gives the library a
+// function for getting the application's allocation callbacks, which stays valid as long as the library is loaded.
+typedef void(XRAPI_PTR *PFN_openxrLoaderNegotiateApiLayerAllocation)(
+    PFN_openxrLoaderGetAllocationCallbacks getAllocationCallbacks);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
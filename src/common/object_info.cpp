@@ -23,7 +23,7 @@
 
 #include "object_info.h"
 
-#include "extra_algorithms.h"
+#include "format_buffer.h"
 #include "hex_and_handles.h"
 
 #include <openxr/openxr.h>
@@ -31,19 +31,22 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
-#include <sstream>
 #include <string>
 #include <vector>
 
 #include "memory.h"
 
 std::string XrSdkLogObjectInfo::ToString() const {
-    std::ostringstream oss;
-    oss << Uint64ToHexString(handle);
+    std::string out;
+    out.reserve(XR_HEX_STRING_LENGTH(sizeof(handle)) + (name.empty() ? 0 : name.size() + 3));
+    StringFormatBuffer buffer(out);
+    AppendHex(buffer, handle);
     if (!name.empty()) {
-        oss << " (" << name << ")";
+        buffer.Append(" (", 2);
+        buffer.Append(name.data(), name.size());
+        buffer.Append(")", 1);
     }
-    return oss.str();
+    return out;
 }
 
 void ObjectInfoCollection::AddObjectName(uint64_t object_handle, XrObjectType object_type, const std::string& object_name) {
@@ -54,39 +57,28 @@ void ObjectInfoCollection::AddObjectName(uint64_t object_handle, XrObjectType ob
     }
 
     // Otherwise, add it or update the name
-    XrSdkLogObjectInfo new_obj = {object_handle, object_type};
-
-    // If it already exists, update the name
-    auto lookup_info = LookUpStoredObjectInfo(new_obj);
-    if (lookup_info != nullptr) {
-        lookup_info->name = object_name;
-        return;
-    }
-
-    // It doesn't exist, so add a new info block
-    new_obj.name = object_name;
-    object_info_.push_back(new_obj);
+    XrSdkLogObjectInfo& stored = object_info_[ObjectKey{object_handle, object_type}];
+    stored.handle = object_handle;
+    stored.type = object_type;
+    stored.name = object_name;
 }
 
 void ObjectInfoCollection::RemoveObject(uint64_t object_handle, XrObjectType object_type) {
-    vector_remove_if_and_erase(
-        object_info_, [=](XrSdkLogObjectInfo const& info) { return info.handle == object_handle && info.type == object_type; });
+    object_info_.erase(ObjectKey{object_handle, object_type});
 }
 
 XrSdkLogObjectInfo const* ObjectInfoCollection::LookUpStoredObjectInfo(XrSdkLogObjectInfo const& info) const {
-    auto e = object_info_.end();
-    auto it = std::find_if(object_info_.begin(), e, [&](XrSdkLogObjectInfo const& stored) { return Equivalent(stored, info); });
-    if (it != e) {
-        return &(*it);
+    auto it = object_info_.find(ObjectKey{info.handle, info.type});
+    if (it != object_info_.end()) {
+        return &it->second;
     }
     return nullptr;
 }
 
 XrSdkLogObjectInfo* ObjectInfoCollection::LookUpStoredObjectInfo(XrSdkLogObjectInfo const& info) {
-    auto e = object_info_.end();
-    auto it = std::find_if(object_info_.begin(), e, [&](XrSdkLogObjectInfo const& stored) { return Equivalent(stored, info); });
-    if (it != e) {
-        return &(*it);
+    auto it = object_info_.find(ObjectKey{info.handle, info.type});
+    if (it != object_info_.end()) {
+        return &it->second;
     }
     return nullptr;
 }
@@ -119,128 +111,211 @@ static std::vector<XrDebugUtilsObjectNameInfoEXT> PopulateObjectNameInfo(std::ve
     return ret;
 }
 
-NamesAndLabels::NamesAndLabels(std::vector<XrSdkLogObjectInfo> obj, std::vector<XrDebugUtilsLabelEXT> lab)
-    : sdk_objects(std::move(obj)), objects(PopulateObjectNameInfo(sdk_objects)), labels(std::move(lab)) {}
+void XrSdkSessionLabelCopy::Append(XrSdkSessionLabelView view) {
+    if (view.count == 0) {
+        return;
+    }
+    const size_t first = labels_.size();
+    labels_.insert(labels_.end(), view.labels, view.labels + view.count);
+    for (size_t label = first; label < labels_.size(); ++label) {
+        const char* name = labels_[label].labelName;
+        names_.insert(names_.end(), name, name + strlen(name) + 1);
+    }
+    // Point every label at its copy of the name, since adding names may have moved the ones copied before.
+    const char* name = names_.data();
+    for (XrDebugUtilsLabelEXT& label : labels_) {
+        label.labelName = name;
+        name += strlen(name) + 1;
+    }
+}
+
+NamesAndLabels::NamesAndLabels(std::vector<XrSdkLogObjectInfo> obj, XrSdkSessionLabelCopy labels)
+    : sdk_objects(std::move(obj)), objects(PopulateObjectNameInfo(sdk_objects)), labels_(std::move(labels)) {}
 
 void NamesAndLabels::PopulateCallbackData(XrDebugUtilsMessengerCallbackDataEXT& callback_data) const {
     callback_data.objects = objects.empty() ? nullptr : const_cast<XrDebugUtilsObjectNameInfoEXT*>(objects.data());
     callback_data.objectCount = static_cast<uint32_t>(objects.size());
-    callback_data.sessionLabels = labels.empty() ? nullptr : const_cast<XrDebugUtilsLabelEXT*>(labels.data());
-    callback_data.sessionLabelCount = static_cast<uint32_t>(labels.size());
+    XrSdkSessionLabelView view = SessionLabels();
+    callback_data.sessionLabels = view.count == 0 ? nullptr : const_cast<XrDebugUtilsLabelEXT*>(view.labels);
+    callback_data.sessionLabelCount = view.count;
 }
 
-void DebugUtilsData::LookUpSessionLabels(XrSession session, std::vector<XrDebugUtilsLabelEXT>& labels) const {
-    auto session_label_iterator = session_labels_.find(session);
-    if (session_label_iterator != session_labels_.end()) {
-        auto& XrSdkSessionLabels = *session_label_iterator->second;
-        // Copy the debug utils labels in reverse order in the the labels vector.
-        std::transform(XrSdkSessionLabels.rbegin(), XrSdkSessionLabels.rend(), std::back_inserter(labels),
-                       [](XrSdkSessionLabelPtr const& label) { return label->debug_utils_label; });
+// Label names that were stored, but are no longer in use, are dropped once this many bytes of names are stored
+// and twice as many as were in use at the last compaction.
+static const size_t kLabelNameCompactBytes = 16 * 1024;
+static const size_t kLabelNameBlockSize = 1024;
+static const size_t kInitialLabelCapacity = 8;
+
+size_t XrSdkSessionLabelStack::NameKeyHash::operator()(NameKey const& key) const {
+    // FNV-1a over eight bytes at a time, since this runs for every label begun or inserted.
+    uint64_t hash = 0xcbf29ce484222325ULL ^ key.length;
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= key.length; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, key.data + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+    for (; offset < key.length; ++offset) {
+        hash = (hash ^ static_cast<unsigned char>(key.data[offset])) * 0x100000001b3ULL;
     }
+    return static_cast<size_t>(hash ^ (hash >> 29));
 }
 
-XrSdkSessionLabel::XrSdkSessionLabel(const XrDebugUtilsLabelEXT& label_info, bool individual)
-    : label_name(label_info.labelName), debug_utils_label(label_info), is_individual_label(individual) {
-    // Update the c string pointer to the one we hold.
-    debug_utils_label.labelName = label_name.c_str();
+const char* XrSdkSessionLabelStack::StoreName(NameKey const& key) {
+    auto it = names_.find(key);
+    if (it != names_.end()) {
+        return it->data;
+    }
+    const size_t size = key.length + 1;
+    if (name_blocks_.empty() || name_block_used_ + size > name_block_size_) {
+        name_block_size_ = (std::max)(kLabelNameBlockSize, size);
+        name_blocks_.emplace_back(new char[name_block_size_]);
+        name_block_used_ = 0;
+    }
+    char* stored = name_blocks_.back().get() + name_block_used_;
+    name_block_used_ += size;
+    memcpy(stored, key.data, key.length);
+    stored[key.length] = '\0';
+    names_.insert(NameKey{stored, key.length});
+    name_bytes_ += size;
+    return stored;
 }
 
-XrSdkSessionLabelPtr XrSdkSessionLabel::make(const XrDebugUtilsLabelEXT& label_info, bool individual) {
-    XrSdkSessionLabelPtr ret(new XrSdkSessionLabel(label_info, individual));
-    return ret;
-}
-void DebugUtilsData::AddObjectName(uint64_t object_handle, XrObjectType object_type, const std::string& object_name) {
-    object_info_.AddObjectName(object_handle, object_type, object_name);
+const char* XrSdkSessionLabelStack::InternName(const char* name) {
+    if (name == nullptr) {
+        name = "";
+    }
+    NameKey key{name, strlen(name)};
+    auto it = names_.find(key);
+    if (it != names_.end()) {
+        return it->data;
+    }
+    if (name_bytes_ >= (std::max)(kLabelNameCompactBytes, compact_name_bytes_)) {
+        CompactNames();
+    }
+    return StoreName(key);
 }
 
-// We always want to remove the old individual label before we do anything else.
-// So, do that in it's own method
-void DebugUtilsData::RemoveIndividualLabel(XrSdkSessionLabelList& label_vec) {
-    if (!label_vec.empty() && label_vec.back()->is_individual_label) {
-        label_vec.pop_back();
+void XrSdkSessionLabelStack::CompactNames() {
+    // Keep the old names until the labels in use have been moved to new blocks.
+    std::vector<std::unique_ptr<char[]>> old_blocks;
+    old_blocks.swap(name_blocks_);
+    names_.clear();
+    name_block_size_ = 0;
+    name_block_used_ = 0;
+    name_bytes_ = 0;
+    for (size_t label = top_; label < labels_.size(); ++label) {
+        const char* name = labels_[label].labelName;
+        labels_[label].labelName = StoreName(NameKey{name, strlen(name)});
     }
+    compact_name_bytes_ = 2 * name_bytes_;
 }
 
-XrSdkSessionLabelList* DebugUtilsData::GetSessionLabelList(XrSession session) {
-    auto session_label_iterator = session_labels_.find(session);
-    if (session_label_iterator == session_labels_.end()) {
-        return nullptr;
+void XrSdkSessionLabelStack::RemoveIndividualLabel() {
+    if (top_is_individual_) {
+        ++top_;
+        top_is_individual_ = false;
     }
-    return session_label_iterator->second.get();
 }
 
-XrSdkSessionLabelList& DebugUtilsData::GetOrCreateSessionLabelList(XrSession session) {
-    XrSdkSessionLabelList* vec_ptr = GetSessionLabelList(session);
-    if (vec_ptr == nullptr) {
-        std::unique_ptr<XrSdkSessionLabelList> vec(new XrSdkSessionLabelList);
-        vec_ptr = vec.get();
-        session_labels_[session] = std::move(vec);
+void XrSdkSessionLabelStack::Push(const XrDebugUtilsLabelEXT& label_info, bool individual) {
+    // Intern first: compacting rewrites the names of the labels already on the stack.
+    const char* name = InternName(label_info.labelName);
+    if (top_ == 0) {
+        const size_t count = labels_.size();
+        std::vector<XrDebugUtilsLabelEXT> grown((std::max)(kInitialLabelCapacity, 2 * count));
+        std::copy(labels_.begin(), labels_.end(), grown.end() - count);
+        top_ = grown.size() - count;
+        labels_.swap(grown);
     }
-    return *vec_ptr;
+    --top_;
+    labels_[top_] = label_info;
+    labels_[top_].labelName = name;
+    top_is_individual_ = individual;
 }
 
-void DebugUtilsData::BeginLabelRegion(XrSession session, const XrDebugUtilsLabelEXT& label_info) {
-    auto& vec = GetOrCreateSessionLabelList(session);
-
+void XrSdkSessionLabelStack::BeginRegion(const XrDebugUtilsLabelEXT& label_info) {
     // Individual labels do not stay around in the transition into a new label region
-    RemoveIndividualLabel(vec);
+    RemoveIndividualLabel();
 
     // Start the new label region
-    vec.emplace_back(XrSdkSessionLabel::make(label_info, false));
+    Push(label_info, false);
 }
 
-void DebugUtilsData::EndLabelRegion(XrSession session) {
-    XrSdkSessionLabelList* vec_ptr = GetSessionLabelList(session);
-    if (vec_ptr == nullptr) {
-        return;
-    }
-
+void XrSdkSessionLabelStack::EndRegion() {
     // Individual labels do not stay around in the transition out of label region
-    RemoveIndividualLabel(*vec_ptr);
+    RemoveIndividualLabel();
 
     // Remove the last label region
-    if (!vec_ptr->empty()) {
-        vec_ptr->pop_back();
+    if (top_ < labels_.size()) {
+        ++top_;
     }
 }
 
-void DebugUtilsData::InsertLabel(XrSession session, const XrDebugUtilsLabelEXT& label_info) {
-    auto& vec = GetOrCreateSessionLabelList(session);
-
+void XrSdkSessionLabelStack::Insert(const XrDebugUtilsLabelEXT& label_info) {
     // Remove any individual layer that might already be there
-    RemoveIndividualLabel(vec);
+    RemoveIndividualLabel();
 
     // Insert a new individual label
-    vec.emplace_back(XrSdkSessionLabel::make(label_info, true));
+    Push(label_info, true);
+}
+
+XrSdkSessionLabelView DebugUtilsData::LookUpSessionLabels(XrSession session) const {
+    auto session_label_iterator = session_labels_.find(session);
+    if (session_label_iterator == session_labels_.end()) {
+        return {nullptr, 0};
+    }
+    return session_label_iterator->second.View();
+}
+
+void DebugUtilsData::LookUpSessionLabels(XrSession session, std::vector<XrDebugUtilsLabelEXT>& labels) const {
+    XrSdkSessionLabelView view = LookUpSessionLabels(session);
+    labels.insert(labels.end(), view.labels, view.labels + view.count);
+}
+
+void DebugUtilsData::AddObjectName(uint64_t object_handle, XrObjectType object_type, const std::string& object_name) {
+    object_info_.AddObjectName(object_handle, object_type, object_name);
+}
+
+void DebugUtilsData::BeginLabelRegion(XrSession session, const XrDebugUtilsLabelEXT& label_info) {
+    session_labels_[session].BeginRegion(label_info);
+}
+
+void DebugUtilsData::EndLabelRegion(XrSession session) {
+    auto session_label_iterator = session_labels_.find(session);
+    if (session_label_iterator != session_labels_.end()) {
+        session_label_iterator->second.EndRegion();
+    }
+}
+
+void DebugUtilsData::InsertLabel(XrSession session, const XrDebugUtilsLabelEXT& label_info) {
+    session_labels_[session].Insert(label_info);
 }
 
 void DebugUtilsData::DeleteObject(uint64_t object_handle, XrObjectType object_type) {
     object_info_.RemoveObject(object_handle, object_type);
 
     if (object_type == XR_OBJECT_TYPE_SESSION) {
-        auto session = TreatIntegerAsHandle<XrSession>(object_handle);
-        XrSdkSessionLabelList* vec_ptr = GetSessionLabelList(session);
-        if (vec_ptr != nullptr) {
-            session_labels_.erase(session);
-        }
+        session_labels_.erase(TreatIntegerAsHandle<XrSession>(object_handle));
     }
 }
 
 void DebugUtilsData::DeleteSessionLabels(XrSession session) { session_labels_.erase(session); }
 
 NamesAndLabels DebugUtilsData::PopulateNamesAndLabels(std::vector<XrSdkLogObjectInfo> objects) const {
-    std::vector<XrDebugUtilsLabelEXT> labels;
+    XrSdkSessionLabelCopy labels;
     for (auto& obj : objects) {
         // Check for any names that have been associated with the objects and set them up here
         object_info_.LookUpObjectName(obj);
         // If this is a session, see if there are any labels associated with it for us to add
         // to the callback content.
         if (XR_OBJECT_TYPE_SESSION == obj.type) {
-            LookUpSessionLabels(obj.GetTypedHandle<XrSession>(), labels);
+            labels.Append(LookUpSessionLabels(obj.GetTypedHandle<XrSession>()));
         }
     }
 
-    return {objects, labels};
+    return {std::move(objects), std::move(labels)};
 }
 
 void DebugUtilsData::WrapCallbackData(AugmentedCallbackData* aug_data,
@@ -260,12 +335,13 @@ void DebugUtilsData::WrapCallbackData(AugmentedCallbackData* aug_data,
         // If this is a session, record any labels associated with it
         if (XR_OBJECT_TYPE_SESSION == current_obj.objectType) {
             XrSession session = TreatIntegerAsHandle<XrSession>(current_obj.objectHandle);
-            LookUpSessionLabels(session, aug_data->labels);
+            aug_data->labels.Append(LookUpSessionLabels(session));
         }
     }
+    const XrSdkSessionLabelView session_labels = aug_data->labels.View();
 
     // If we found nothing to add, return the original data
-    if (!name_found && aug_data->labels.empty()) {
+    if (!name_found && session_labels.count == 0) {
         return;
     }
 
@@ -273,15 +349,21 @@ void DebugUtilsData::WrapCallbackData(AugmentedCallbackData* aug_data,
     memcpy(&aug_data->modified_data, callback_data, sizeof(XrDebugUtilsMessengerCallbackDataEXT));
     aug_data->new_objects.assign(callback_data->objects, callback_data->objects + callback_data->objectCount);
 
-    // Record (overwrite) the names of all incoming objects provided in our internal list
+    // Record (overwrite) the names of all incoming objects provided in our internal list, copied so that they stay
+    // valid however the objects are renamed meanwhile
+    aug_data->object_names.reserve(aug_data->new_objects.size());
     for (auto& obj : aug_data->new_objects) {
-        object_info_.LookUpObjectName(obj);
+        if (object_info_.LookUpObjectName(obj)) {
+            aug_data->object_names.emplace_back(obj.objectName);
+            obj.objectName = aug_data->object_names.back().c_str();
+        }
     }
 
     // Update local copy & point export to it
     aug_data->modified_data.objects = aug_data->new_objects.data();
-    aug_data->modified_data.sessionLabelCount = static_cast<uint32_t>(aug_data->labels.size());
-    aug_data->modified_data.sessionLabels = aug_data->labels.empty() ? nullptr : aug_data->labels.data();
+    aug_data->modified_data.sessionLabelCount = session_labels.count;
+    aug_data->modified_data.sessionLabels =
+        session_labels.count == 0 ? nullptr : const_cast<XrDebugUtilsLabelEXT*>(session_labels.labels);
     aug_data->exported_data = &aug_data->modified_data;
     return;
 }
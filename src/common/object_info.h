@@ -31,9 +31,11 @@
 
 #include <openxr/openxr.h>
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 struct XrSdkGenericObject {
@@ -148,43 +150,145 @@ class ObjectInfoCollection {
     bool Empty() const { return object_info_.empty(); }
 
    private:
-    // Object names that have been set for given objects
-    std::vector<XrSdkLogObjectInfo> object_info_;
+    //! Identity of a named object: its handle value and handle type.
+    struct ObjectKey {
+        uint64_t handle;
+        XrObjectType type;
+
+        bool operator==(ObjectKey const& other) const { return handle == other.handle && type == other.type; }
+    };
+
+    struct ObjectKeyHash {
+        size_t operator()(ObjectKey const& key) const {
+            // Handles are often pointers or counters, so spread their bits before the type is mixed in.
+            return std::hash<uint64_t>()((key.handle * 0x9E3779B97F4A7C15ULL) ^ static_cast<uint64_t>(key.type));
+        }
+    };
+
+    // Object names that have been set for given objects.  The map's nodes do not move, so a pointer returned by
+    // LookUpStoredObjectInfo stays valid until that object is removed.
+    std::unordered_map<ObjectKey, XrSdkLogObjectInfo, ObjectKeyHash> object_info_;
 };
 
-struct XrSdkSessionLabel;
-using XrSdkSessionLabelPtr = std::unique_ptr<XrSdkSessionLabel>;
-using XrSdkSessionLabelList = std::vector<XrSdkSessionLabelPtr>;
+/// A session's labels, innermost first, as handed to a debug messenger callback.
+struct XrSdkSessionLabelView {
+    const XrDebugUtilsLabelEXT* labels;
+    uint32_t count;
+};
+
+/// The label regions and individual label of one session.
+///
+/// Labels are stored innermost first in the back of one array, so the current stack can be copied out in one go, and
+/// label names are copied into blocks owned by the stack, once per distinct name.  Once a session's labels have
+/// reached their usual depth and names, beginning, ending and inserting labels allocates nothing.
+class XrSdkSessionLabelStack {
+   public:
+    XrSdkSessionLabelStack() = default;
+
+    XrSdkSessionLabelStack(const XrSdkSessionLabelStack&) = delete;
+    XrSdkSessionLabelStack& operator=(const XrSdkSessionLabelStack&) = delete;
+
+    void BeginRegion(const XrDebugUtilsLabelEXT& label_info);
+    void EndRegion();
+    void Insert(const XrDebugUtilsLabelEXT& label_info);
+
+    /// The current labels, valid until the stack is next changed.
+    XrSdkSessionLabelView View() const {
+        return {labels_.data() + top_, static_cast<uint32_t>(labels_.size() - top_)};
+    }
+
+   private:
+    //! A label name, in a name block or in the caller's label.
+    struct NameKey {
+        const char* data;
+        size_t length;
+
+        bool operator==(NameKey const& other) const {
+            return length == other.length && memcmp(data, other.data, length) == 0;
+        }
+    };
+
+    struct NameKeyHash {
+        size_t operator()(NameKey const& key) const;
+    };
+
+    // Individual labels do not stay around once another label is begun, ended or inserted.
+    void RemoveIndividualLabel();
+    void Push(const XrDebugUtilsLabelEXT& label_info, bool individual);
+    const char* InternName(const char* name);
+    const char* StoreName(NameKey const& key);
+    void CompactNames();
+
+    // labels_[top_] is the innermost label, and labels_.back() the outermost.  Room is made at the front.
+    std::vector<XrDebugUtilsLabelEXT> labels_;
+    size_t top_ = 0;
+    // Only the innermost label can be an individual one.
+    bool top_is_individual_ = false;
+
+    std::vector<std::unique_ptr<char[]>> name_blocks_;
+    size_t name_block_size_ = 0;
+    size_t name_block_used_ = 0;
+    std::unordered_set<NameKey, NameKeyHash> names_;
+    // Names no longer in use are dropped once the stored names reach this many bytes.
+    size_t name_bytes_ = 0;
+    size_t compact_name_bytes_ = 0;
+};
 
-struct XrSdkSessionLabel {
-    static XrSdkSessionLabelPtr make(const XrDebugUtilsLabelEXT& label_info, bool individual);
+/// Copies of the session labels reported with one message, and of their names, so that the message stays valid
+/// however the sessions' labels change while it is being delivered.
+class XrSdkSessionLabelCopy {
+   public:
+    XrSdkSessionLabelCopy() = default;
+
+    // Movable only: the labels point into names_, which a move leaves in place.
+    XrSdkSessionLabelCopy(XrSdkSessionLabelCopy&&) = default;
+    XrSdkSessionLabelCopy& operator=(XrSdkSessionLabelCopy&&) = default;
+    XrSdkSessionLabelCopy(const XrSdkSessionLabelCopy&) = delete;
+    XrSdkSessionLabelCopy& operator=(const XrSdkSessionLabelCopy&) = delete;
+
+    /// Copy a session's labels, innermost first, after those already copied.
+    void Append(XrSdkSessionLabelView view);
 
-    std::string label_name;
-    XrDebugUtilsLabelEXT debug_utils_label;
-    bool is_individual_label;
+    XrSdkSessionLabelView View() const { return {labels_.data(), static_cast<uint32_t>(labels_.size())}; }
 
    private:
-    XrSdkSessionLabel(const XrDebugUtilsLabelEXT& label_info, bool individual);
+    std::vector<XrDebugUtilsLabelEXT> labels_;
+    // The label names, one after the other in the order of the labels, each followed by a null.
+    std::vector<char> names_;
 };
 
 /// The metadata for a collection of objects. Must persist unmodified during the entire debug messenger call!
 struct NamesAndLabels {
     NamesAndLabels() = default;
-    NamesAndLabels(std::vector<XrSdkLogObjectInfo> obj, std::vector<XrDebugUtilsLabelEXT> lab);
+    NamesAndLabels(std::vector<XrSdkLogObjectInfo> obj, XrSdkSessionLabelCopy labels);
+
+    // Movable only: objects and the session labels point into strings owned by this structure.
+    NamesAndLabels(NamesAndLabels&&) = default;
+    NamesAndLabels& operator=(NamesAndLabels&&) = default;
+    NamesAndLabels(const NamesAndLabels&) = delete;
+    NamesAndLabels& operator=(const NamesAndLabels&) = delete;
+
     /// C++ structure owning the data (strings) backing the objects vector.
     std::vector<XrSdkLogObjectInfo> sdk_objects;
 
     std::vector<XrDebugUtilsObjectNameInfoEXT> objects;
-    std::vector<XrDebugUtilsLabelEXT> labels;
+
+    /// The session labels to report, innermost first for each session.
+    XrSdkSessionLabelView SessionLabels() const { return labels_.View(); }
 
     /// Populate the debug utils callback data structure.
     void PopulateCallbackData(XrDebugUtilsMessengerCallbackDataEXT& data) const;
     // XrDebugUtilsMessengerCallbackDataEXT MakeCallbackData() const;
+
+   private:
+    XrSdkSessionLabelCopy labels_;
 };
 
 struct AugmentedCallbackData {
-    std::vector<XrDebugUtilsLabelEXT> labels;
+    XrSdkSessionLabelCopy labels;
     std::vector<XrDebugUtilsObjectNameInfoEXT> new_objects;
+    // Copies of the names found for new_objects, which point to them.
+    std::vector<std::string> object_names;
     XrDebugUtilsMessengerCallbackDataEXT modified_data;
     const XrDebugUtilsMessengerCallbackDataEXT* exported_data;
 };
@@ -214,6 +318,9 @@ class DebugUtilsData {
     /// Removes all labels associated with a session - call in xrDestroySession and xrDestroyInstance (for all child sessions)
     void DeleteSessionLabels(XrSession session);
 
+    /// Retrieve labels for the given session, if any, innermost first.  Valid until the session's labels next change.
+    XrSdkSessionLabelView LookUpSessionLabels(XrSession session) const;
+
     /// Retrieve labels for the given session, if any, and push them in reverse order on the vector.
     void LookUpSessionLabels(XrSession session, std::vector<XrDebugUtilsLabelEXT>& labels) const;
 
@@ -229,12 +336,8 @@ class DebugUtilsData {
                           const XrDebugUtilsMessengerCallbackDataEXT* provided_callback_data) const;
 
    private:
-    void RemoveIndividualLabel(XrSdkSessionLabelList& label_vec);
-    XrSdkSessionLabelList* GetSessionLabelList(XrSession session);
-    XrSdkSessionLabelList& GetOrCreateSessionLabelList(XrSession session);
-
-    // Session labels: one vector of them per session.
-    std::unordered_map<XrSession, std::unique_ptr<XrSdkSessionLabelList>> session_labels_;
+    // Session labels: one stack of them per session.
+    std::unordered_map<XrSession, XrSdkSessionLabelStack> session_labels_;
 
     // Names for objects.
     ObjectInfoCollection object_info_;
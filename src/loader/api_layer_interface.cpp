@@ -21,9 +21,11 @@
 
 #include "api_layer_interface.hpp"
 
+#include "loader_allocation.hpp"
 #include "loader_interfaces.h"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
 #include "manifest_file.hpp"
 #include "platform_utils.hpp"
 
@@ -202,15 +204,22 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
     std::vector<std::unique_ptr<ApiLayerManifestFile>> layer_manifest_files = {};
 
     // Find any implicit layers which we may need to report information for.
-    XrResult result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_IMPLICIT_API_LAYER, layer_manifest_files);
-    if (XR_SUCCEEDED(result)) {
-        // Find any explicit layers which we may need to report information for.
-        result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_EXPLICIT_API_LAYER, layer_manifest_files);
+    XrResult result;
+    {
+        LoaderTimingScope timing(openxr_command.c_str(), "API layer manifest discovery");
+        result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_IMPLICIT_API_LAYER, layer_manifest_files);
+        if (XR_SUCCEEDED(result)) {
+            // Find any explicit layers which we may need to report information for.
+            result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_EXPLICIT_API_LAYER, layer_manifest_files);
+        }
     }
 
     // Put all the enabled layers into a string vector
     std::vector<std::string> enabled_api_layers = {};
-    AddEnvironmentApiLayers(enabled_api_layers);
+    {
+        LoaderTimingScope timing(openxr_command.c_str(), "Environment parsing");
+        AddEnvironmentApiLayers(enabled_api_layers);
+    }
     if (enabled_api_layer_count > 0) {
         if (nullptr == enabled_api_layer_names) {
             LoaderLogger::LogErrorMessage(
@@ -256,7 +265,11 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
             continue;
         }
 
-        LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+        LoaderPlatformLibraryHandle layer_library;
+        {
+            LoaderTimingScope timing(openxr_command.c_str(), "API layer library load", manifest_file->LibraryPath());
+            layer_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+        }
         if (nullptr == layer_library) {
             if (!any_loaded) {
                 last_error = XR_ERROR_FILE_ACCESS_ERROR;
@@ -302,7 +315,11 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
         api_layer_info.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
         api_layer_info.structSize = sizeof(XrNegotiateApiLayerRequest);
 
-        XrResult res = negotiate(&loader_info, manifest_file->LayerName().c_str(), &api_layer_info);
+        XrResult res;
+        {
+            LoaderTimingScope timing(openxr_command.c_str(), "API layer negotiation", manifest_file->LayerName());
+            res = negotiate(&loader_info, manifest_file->LayerName().c_str(), &api_layer_info);
+        }
         // If we supposedly succeeded, but got a nullptr for getInstanceProcAddr
         // then something still went wrong, so return with an error.
         if (XR_SUCCEEDED(res) && nullptr == api_layer_info.getInstanceProcAddr) {
@@ -324,7 +341,15 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
             continue;
         }
 
-        {
+        // Give the layer the application's allocation callbacks, if it can take them.
+        std::string allocation_function_name = manifest_file->GetFunctionName("openxrLoaderNegotiateApiLayerAllocation");
+        auto negotiate_allocation = reinterpret_cast<PFN_openxrLoaderNegotiateApiLayerAllocation>(
+            LoaderPlatformLibraryGetProcAddr(layer_library, allocation_function_name));
+        if (nullptr != negotiate_allocation) {
+            negotiate_allocation(LoaderAllocation::GetCallbacksForApiLayer);
+        }
+
+        if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
             std::ostringstream oss;
             oss << "ApiLayerInterface::LoadApiLayers succeeded loading layer " << manifest_file->LayerName()
                 << " using interface version " << api_layer_info.layerInterfaceVersion << " and OpenXR API version "
@@ -384,9 +409,11 @@ ApiLayerInterface::ApiLayerInterface(const std::string& layer_name, LoaderPlatfo
       _supported_extensions(supported_extensions) {}
 
 ApiLayerInterface::~ApiLayerInterface() {
-    std::string info_message = "ApiLayerInterface being destroyed for layer ";
-    info_message += _layer_name;
-    LoaderLogger::LogInfoMessage("", info_message);
+    if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+        std::string info_message = "ApiLayerInterface being destroyed for layer ";
+        info_message += _layer_name;
+        LoaderLogger::LogInfoMessage("", info_message);
+    }
     LoaderPlatformLibraryClose(_layer_library);
 }
 
@@ -27,12 +27,13 @@
 
 #include <openxr/openxr.h>
 
+#include "loader_allocation.hpp"
 #include "loader_platform.hpp"
 #include "loader_interfaces.h"
 
 struct XrGeneratedDispatchTable;
 
-class ApiLayerInterface {
+class ApiLayerInterface : public LoaderAllocated<OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE> {
    public:
     // Factory method
     static XrResult LoadApiLayers(const std::string& openxr_command, uint32_t enabled_api_layer_count,
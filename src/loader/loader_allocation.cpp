@@ -0,0 +1,135 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "loader_allocation.hpp"
+
+#ifdef OPENXR_HAVE_COMMON_CONFIG
+#include "common_config.h"
+#endif  // OPENXR_HAVE_COMMON_CONFIG
+
+#include "allocation_callbacks.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace {
+
+struct SubsystemCounters {
+    std::atomic<uint64_t> live_allocations{0};
+    std::atomic<uint64_t> live_bytes{0};
+    std::atomic<uint64_t> total_allocations{0};
+    std::atomic<uint64_t> total_bytes{0};
+};
+
+struct AllocationState {
+    std::mutex mutex;
+    bool have_callbacks = false;
+    OpenXRLoaderAllocationCallbacks callbacks{};
+    SubsystemCounters counters[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT];
+};
+
+AllocationState& GetState() {
+    // Never destroyed, since static objects of the loader free memory during exit.
+    static AllocationState* state = new AllocationState;
+    return *state;
+}
+
+bool IsValidSubsystem(OpenXRLoaderAllocationSubsystem subsystem) {
+    return subsystem >= OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE && subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT;
+}
+
+}  // namespace
+
+namespace LoaderAllocation {
+
+bool SetCallbacks(const OpenXRLoaderAllocationCallbacks* callbacks) {
+    const OpenXRLoaderAllocationCallbacks* valid = XrSdkValidAllocationCallbacks(callbacks);
+    if (callbacks != nullptr && valid == nullptr) {
+        return false;
+    }
+    AllocationState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.have_callbacks = valid != nullptr;
+    state.callbacks = state.have_callbacks ? *valid : OpenXRLoaderAllocationCallbacks{};
+    return true;
+}
+
+bool GetCallbacks(OpenXRLoaderAllocationCallbacks* callbacks) {
+    AllocationState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.have_callbacks) {
+        *callbacks = state.callbacks;
+    }
+    return state.have_callbacks;
+}
+
+XrBool32 XRAPI_CALL GetCallbacksForApiLayer(OpenXRLoaderAllocationCallbacks* callbacks) {
+    if (callbacks == nullptr || callbacks->structVersion < 1 || callbacks->structSize < sizeof(OpenXRLoaderAllocationCallbacks)) {
+        return XR_FALSE;
+    }
+    OpenXRLoaderAllocationCallbacks current;
+    if (!GetCallbacks(&current)) {
+        return XR_FALSE;
+    }
+    // Leave the caller's version and size alone, as they describe the caller's struct.
+    callbacks->userData = current.userData;
+    callbacks->pfnAllocation = current.pfnAllocation;
+    callbacks->pfnFree = current.pfnFree;
+    return XR_TRUE;
+}
+
+void* Allocate(OpenXRLoaderAllocationSubsystem subsystem, size_t size, size_t alignment) {
+    AllocationState& state = GetState();
+    // Call the application's allocator on a copy, without the lock, so that it may itself call into the loader.
+    OpenXRLoaderAllocationCallbacks callbacks;
+    const bool have_callbacks = GetCallbacks(&callbacks);
+    void* memory = XrSdkAllocate(have_callbacks ? &callbacks : nullptr, subsystem, size, alignment);
+    if (memory != nullptr) {
+        SubsystemCounters& counters = state.counters[subsystem];
+        counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.live_bytes.fetch_add(size, std::memory_order_relaxed);
+        counters.total_allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.total_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return memory;
+}
+
+void Free(void* memory) {
+    if (memory == nullptr) {
+        return;
+    }
+    const XrSdkAllocationHeader* header = XrSdkAllocationHeaderOf(memory);
+    SubsystemCounters& counters = GetState().counters[header->subsystem];
+    counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    counters.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    XrSdkFree(memory);
+}
+
+OpenXRLoaderAllocationStatistics GetStatistics(OpenXRLoaderAllocationSubsystem subsystem) {
+    OpenXRLoaderAllocationStatistics statistics{};
+    if (IsValidSubsystem(subsystem)) {
+        const SubsystemCounters& counters = GetState().counters[subsystem];
+        statistics.liveAllocations = counters.live_allocations.load(std::memory_order_relaxed);
+        statistics.liveBytes = counters.live_bytes.load(std::memory_order_relaxed);
+        statistics.totalAllocations = counters.total_allocations.load(std::memory_order_relaxed);
+        statistics.totalBytes = counters.total_bytes.load(std::memory_order_relaxed);
+    }
+    return statistics;
+}
+
+}  // namespace LoaderAllocation
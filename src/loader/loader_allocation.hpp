@@ -0,0 +1,126 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "loader_interfaces.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <utility>
+
+// Allocation of the loader's own objects through the callbacks set with openxrLoaderSetAllocationCallbacks, counted
+// per subsystem for openxrLoaderGetAllocationStatistics.
+namespace LoaderAllocation {
+// Use a copy of callbacks from now on, or malloc if callbacks is nullptr.  Returns false, changing nothing, if
+// callbacks is not nullptr but is not a usable OpenXRLoaderAllocationCallbacks.
+bool SetCallbacks(const OpenXRLoaderAllocationCallbacks* callbacks);
+
+// Copy the current callbacks to callbacks and return true, or return false if there are none.
+bool GetCallbacks(OpenXRLoaderAllocationCallbacks* callbacks);
+
+// The PFN_openxrLoaderGetAllocationCallbacks passed to API layers: copies the current callbacks into a caller's
+// struct of at least the size of OpenXRLoaderAllocationCallbacks and returns XR_TRUE, or returns XR_FALSE if there are none.
+XrBool32 XRAPI_CALL GetCallbacksForApiLayer(OpenXRLoaderAllocationCallbacks* callbacks);
+
+// Allocate size bytes aligned to alignment, a power of two, for a subsystem.  Returns nullptr on failure.
+void* Allocate(OpenXRLoaderAllocationSubsystem subsystem, size_t size, size_t alignment);
+
+// Free memory from Allocate.  memory may be nullptr.
+void Free(void* memory);
+
+// Allocations made for a subsystem so far.
+OpenXRLoaderAllocationStatistics GetStatistics(OpenXRLoaderAllocationSubsystem subsystem);
+}  // namespace LoaderAllocation
+
+// Base class routing new and delete of the derived class through LoaderAllocation.
+template <OpenXRLoaderAllocationSubsystem Subsystem>
+class LoaderAllocated {
+   public:
+    static void* operator new(size_t size) {
+        void* memory = LoaderAllocation::Allocate(Subsystem, size, alignof(std::max_align_t));
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+    static void operator delete(void* memory) { LoaderAllocation::Free(memory); }
+};
+
+// Standard allocator for containers whose elements belong to a subsystem.
+template <typename T, OpenXRLoaderAllocationSubsystem Subsystem>
+class LoaderAllocator {
+   public:
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+        using other = LoaderAllocator<U, Subsystem>;
+    };
+
+    LoaderAllocator() = default;
+    template <typename U>
+    LoaderAllocator(const LoaderAllocator<U, Subsystem>&) {}
+
+    T* allocate(size_t count) {
+        if (count > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        void* memory = LoaderAllocation::Allocate(Subsystem, count * sizeof(T), alignof(T));
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(memory);
+    }
+    void deallocate(T* memory, size_t) { LoaderAllocation::Free(memory); }
+
+    template <typename U>
+    bool operator==(const LoaderAllocator<U, Subsystem>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const LoaderAllocator<U, Subsystem>&) const {
+        return false;
+    }
+};
+
+// Deleter for a std::unique_ptr to an object constructed in memory from LoaderAllocation::Allocate.
+struct LoaderAllocationDeleter {
+    template <typename T>
+    void operator()(T* object) const {
+        object->~T();
+        LoaderAllocation::Free(object);
+    }
+};
+
+// Unordered map whose nodes belong to a subsystem.
+template <typename Key, typename Value, OpenXRLoaderAllocationSubsystem Subsystem, typename Hash = std::hash<Key>>
+using LoaderUnorderedMap =
+    std::unordered_map<Key, Value, Hash, std::equal_to<Key>, LoaderAllocator<std::pair<const Key, Value>, Subsystem>>;
+
+// Construct a T, whose constructor must not throw, for a subsystem, owned by the returned pointer.  Throws
+// std::bad_alloc if the memory could not be allocated.
+template <typename T, typename... Args>
+std::unique_ptr<T, LoaderAllocationDeleter> LoaderAllocateUnique(OpenXRLoaderAllocationSubsystem subsystem, Args&&... args) {
+    void* memory = LoaderAllocation::Allocate(subsystem, sizeof(T), alignof(T));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return std::unique_ptr<T, LoaderAllocationDeleter>(new (memory) T(std::forward<Args>(args)...));
+}
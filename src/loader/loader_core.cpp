@@ -27,10 +27,12 @@
 #include "api_layer_interface.hpp"
 #include "exception_handling.hpp"
 #include "hex_and_handles.h"
+#include "loader_allocation.hpp"
 #include "loader_instance.hpp"
 #include "loader_logger_recorders.hpp"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
 #include "runtime_interface.hpp"
 #include "xr_generated_dispatch_table.h"
 #include "xr_generated_loader.hpp"
@@ -51,12 +53,6 @@ std::mutex &GetLoaderJsonMutex() {
     return loader_json_mutex;
 }
 
-// Global lock to prevent simultaneous instance creation/destruction
-std::mutex &GetInstanceCreateDestroyMutex() {
-    static std::mutex instance_create_destroy_mutex;
-    return instance_create_destroy_mutex;
-}
-
 // Terminal functions needed by xrCreateInstance.
 XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddr(XrInstance, const char *, PFN_xrVoidFunction *);
 XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateInstance(const XrInstanceCreateInfo *, XrInstance *);
@@ -83,15 +79,32 @@ inline bool IsMissingNullTerminator(const char (&str)[max_length]) {
     return true;
 }
 
+// Log the loader's live allocations for each subsystem.
+static void LogAllocationStatistics(const char *command_name) {
+    static const char *const subsystem_names[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT] = {"instance", "manifest", "dispatch table",
+                                                                                      "handle map", "logger"};
+    std::ostringstream oss;
+    oss << "Loader allocations still live:";
+    for (int subsystem = 0; subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT; ++subsystem) {
+        OpenXRLoaderAllocationStatistics statistics =
+            LoaderAllocation::GetStatistics(static_cast<OpenXRLoaderAllocationSubsystem>(subsystem));
+        oss << " " << subsystem_names[subsystem] << " " << statistics.liveAllocations << " (" << statistics.liveBytes
+            << " bytes)" << (subsystem + 1 < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT ? "," : "");
+    }
+    LoaderLogger::LogVerboseMessage(command_name, oss.str());
+}
+
 // ---- Core 1.0 manual loader trampoline functions
 
 LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateApiLayerProperties(uint32_t propertyCapacityInput,
                                                                            uint32_t *propertyCountOutput,
                                                                            XrApiLayerProperties *properties) XRLOADER_ABI_TRY {
+    LoaderTimingScope timing("xrEnumerateApiLayerProperties", "xrEnumerateApiLayerProperties");
     LoaderLogger::LogVerboseMessage("xrEnumerateApiLayerProperties", "Entering loader trampoline");
 
     // Make sure only one thread is attempting to read the JSON files at a time.
     std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
+    RuntimeInterface::ReleaseIfIdle("xrEnumerateApiLayerProperties");
 
     XrResult result = ApiLayerInterface::GetApiLayerProperties("xrEnumerateApiLayerProperties", propertyCapacityInput,
                                                                propertyCountOutput, properties);
@@ -106,6 +119,7 @@ XRLOADER_ABI_CATCH_FALLBACK
 LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL
 xrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t propertyCapacityInput, uint32_t *propertyCountOutput,
                                        XrExtensionProperties *properties) XRLOADER_ABI_TRY {
+    LoaderTimingScope timing("xrEnumerateInstanceExtensionProperties", "xrEnumerateInstanceExtensionProperties");
     bool just_layer_properties = false;
     LoaderLogger::LogVerboseMessage("xrEnumerateInstanceExtensionProperties", "Entering loader trampoline");
 
@@ -126,6 +140,7 @@ xrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t propertyC
     {
         // Make sure only one thread is attempting to read the JSON files at a time.
         std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
+        RuntimeInterface::ReleaseIfIdle("xrEnumerateInstanceExtensionProperties");
 
         // Get the layer extension properties
         result = ApiLayerInterface::GetInstanceExtensionProperties("xrEnumerateInstanceExtensionProperties", layerName,
@@ -216,6 +231,7 @@ XRLOADER_ABI_CATCH_FALLBACK
 
 LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCreateInfo *info,
                                                               XrInstance *instance) XRLOADER_ABI_TRY {
+    LoaderTimingScope timing("xrCreateInstance", "xrCreateInstance");
     bool runtime_loaded = false;
 
     LoaderLogger::LogVerboseMessage("xrCreateInstance", "Entering loader trampoline");
@@ -242,22 +258,10 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCr
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
-    std::unique_lock<std::mutex> instance_lock(GetInstanceCreateDestroyMutex());
-
-    // Check if there is already an XrInstance that is alive. If so, another instance cannot be created.
-    // The loader does not support multiple simultaneous instances because the loader is intended to be
-    // usable by apps using future OpenXR APIs (through xrGetInstanceProcAddr). Because the loader would
-    // not be aware of new handle types, it would not be able to look up the appropriate dispatch table
-    // in some cases.
-    if (ActiveLoaderInstance::IsAvailable()) {  // If there is an XrInstance already alive.
-        LoaderLogger::LogErrorMessage("xrCreateInstance", "Loader does not support simultaneous XrInstances");
-        return XR_ERROR_LIMIT_REACHED;
-    }
-
     std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces;
     XrResult result;
 
-    // Make sure only one thread is attempting to read the JSON files and use the instance.
+    // Make sure only one thread is attempting to read the JSON files and load the runtime.
     {
         std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
         // Load the available runtime
@@ -286,6 +290,7 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCr
 
     LoaderInstance *loader_instance = nullptr;
     {
+        LoaderTimingScope chain_timing("xrCreateInstance", "Layer chain construction");
         std::unique_ptr<LoaderInstance> owned_loader_instance;
         result = LoaderInstance::CreateInstance(LoaderXrTermGetInstanceProcAddr, LoaderXrTermCreateInstance,
                                                 LoaderXrTermCreateApiLayerInstance, std::move(api_layer_interfaces), info,
@@ -318,9 +323,9 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCr
 
     if (XR_SUCCEEDED(result)) {
         *instance = loader_instance->GetInstanceHandle();
-    } else {
-        // Ensure the global loader instance is destroyed if something went wrong.
-        ActiveLoaderInstance::Remove();
+    } else if (loader_instance != nullptr) {
+        // Ensure the loader instance is destroyed if something went wrong.
+        ActiveLoaderInstance::Remove(loader_instance->GetInstanceHandle());
     }
 
     LoaderLogger::LogVerboseMessage("xrCreateInstance", "Completed loader trampoline");
@@ -336,15 +341,18 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrDestroyInstance(XrInstance instan
         return XR_ERROR_HANDLE_INVALID;
     }
 
-    std::unique_lock<std::mutex> loader_instance_lock(GetInstanceCreateDestroyMutex());
-
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrDestroyInstance");
+    XrResult result =
+        ActiveLoaderInstance::Get(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE, &loader_instance, "xrDestroyInstance");
     if (XR_FAILED(result)) {
         return result;
     }
+    if (loader_instance->GetInstanceHandle() != instance) {
+        LoaderLogger::LogErrorMessage("xrDestroyInstance", "Instance handle is not an active XrInstance.");
+        return XR_ERROR_HANDLE_INVALID;
+    }
 
-    const std::unique_ptr<XrGeneratedDispatchTable> &dispatch_table = loader_instance->DispatchTable();
+    XrGeneratedDispatchTable *dispatch_table = loader_instance->DispatchTable();
 
     // If we allocated a default debug utils messenger, free it
     XrDebugUtilsMessengerEXT messenger = loader_instance->DefaultDebugUtilsMessenger();
@@ -357,19 +365,56 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrDestroyInstance(XrInstance instan
         LoaderLogger::LogErrorMessage("xrDestroyInstance", "Unknown error occurred calling down chain");
     }
 
-    // Get rid of the loader instance. This will make it possible to create another instance in the future.
-    ActiveLoaderInstance::Remove();
+    // Get rid of the loader instance, along with every handle the loader recorded for it.
+    ActiveLoaderInstance::Remove(instance);
 
-    // Lock the instance create/destroy mutex
     LoaderLogger::LogVerboseMessage("xrDestroyInstance", "Completed loader trampoline");
 
     // Finally, unload the runtime if necessary
-    RuntimeInterface::UnloadRuntime("xrDestroyInstance");
+    {
+        std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
+        RuntimeInterface::UnloadRuntime("xrDestroyInstance");
+    }
 
+    if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT)) {
+        LogAllocationStatistics("xrDestroyInstance");
+    }
+
+    // Make sure anything logged for this instance has been written out by any asynchronous recorder, and once the
+    // last instance is gone, end the writer threads so none is left running when the loader is unloaded.
+    if (ActiveLoaderInstance::Any()) {
+        LoaderLogger::GetInstance().Flush();
+    } else {
+        LoaderLogger::GetInstance().ReleaseWriters();
+    }
+
+    return XR_SUCCESS;
+}
+XRLOADER_ABI_CATCH_FALLBACK
+
+// ---- Loader allocation entry points
+
+LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL
+openxrLoaderSetAllocationCallbacks(const OpenXRLoaderAllocationCallbacks *callbacks) XRLOADER_ABI_TRY {
+    if (!LoaderAllocation::SetCallbacks(callbacks)) {
+        LoaderLogger::LogErrorMessage("openxrLoaderSetAllocationCallbacks",
+                                      "callbacks is not a valid OpenXRLoaderAllocationCallbacks.");
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
     return XR_SUCCESS;
 }
 XRLOADER_ABI_CATCH_FALLBACK
 
+LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL openxrLoaderGetAllocationStatistics(OpenXRLoaderAllocationSubsystem subsystem,
+                                                                                 OpenXRLoaderAllocationStatistics *statistics) {
+    if (subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE || subsystem >= OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT ||
+        nullptr == statistics) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *statistics = LoaderAllocation::GetStatistics(subsystem);
+    return XR_SUCCESS;
+}
+
 // ---- Core 1.0 manual loader terminator functions
 
 // Validate that the applicationInfo structure in the XrInstanceCreateInfo is valid.
@@ -461,24 +506,35 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddr(XrInstance instan
 
     // NOTE: ActiveLoaderInstance cannot be used in this function because it is called before an instance is made active.
 
-    if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermGetInstanceProcAddr);
-    } else if (0 == strcmp(name, "xrCreateInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateInstance);
-    } else if (0 == strcmp(name, "xrDestroyInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyInstance);
-    } else if (0 == strcmp(name, "xrSetDebugUtilsObjectNameEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSetDebugUtilsObjectNameEXT);
-    } else if (0 == strcmp(name, "xrCreateDebugUtilsMessengerEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateDebugUtilsMessengerEXT);
-    } else if (0 == strcmp(name, "xrDestroyDebugUtilsMessengerEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyDebugUtilsMessengerEXT);
-    } else if (0 == strcmp(name, "xrSubmitDebugUtilsMessageEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSubmitDebugUtilsMessageEXT);
-    } else if (0 == strcmp(name, "xrCreateApiLayerInstance")) {
-        // Special layer version of xrCreateInstance terminator.  If we get called this by a layer,
-        // we simply re-direct the information back into the standard xrCreateInstance terminator.
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateApiLayerInstance);
+    switch (GeneratedLoaderCommandFromName(name)) {
+        case LoaderCommand::GetInstanceProcAddr:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermGetInstanceProcAddr);
+            break;
+        case LoaderCommand::CreateInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateInstance);
+            break;
+        case LoaderCommand::DestroyInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyInstance);
+            break;
+        case LoaderCommand::SetDebugUtilsObjectNameEXT:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSetDebugUtilsObjectNameEXT);
+            break;
+        case LoaderCommand::CreateDebugUtilsMessengerEXT:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateDebugUtilsMessengerEXT);
+            break;
+        case LoaderCommand::DestroyDebugUtilsMessengerEXT:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyDebugUtilsMessengerEXT);
+            break;
+        case LoaderCommand::SubmitDebugUtilsMessageEXT:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSubmitDebugUtilsMessageEXT);
+            break;
+        case LoaderCommand::CreateApiLayerInstance:
+            // Special layer version of xrCreateInstance terminator.  If we get called this by a layer,
+            // we simply re-direct the information back into the standard xrCreateInstance terminator.
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateApiLayerInstance);
+            break;
+        default:
+            break;
     }
 
     if (nullptr != *function) {
@@ -502,12 +558,16 @@ XRAPI_ATTR XrResult XRAPI_CALL xrCreateDebugUtilsMessengerEXT(XrInstance instanc
     }
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrCreateDebugUtilsMessengerEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE, &loader_instance,
+                                                "xrCreateDebugUtilsMessengerEXT");
     if (XR_FAILED(result)) {
         return result;
     }
 
     result = loader_instance->DispatchTable()->CreateDebugUtilsMessengerEXT(instance, createInfo, messenger);
+    if (XR_SUCCEEDED(result)) {
+        ActiveLoaderInstance::AddHandle(MakeHandleGeneric(*messenger), XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, loader_instance);
+    }
     LoaderLogger::LogVerboseMessage("xrCreateDebugUtilsMessengerEXT", "Completed loader trampoline");
     return result;
 }
@@ -525,12 +585,16 @@ XRLOADER_ABI_CATCH_BAD_ALLOC_OOM XRLOADER_ABI_CATCH_FALLBACK
     }
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrDestroyDebugUtilsMessengerEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(messenger), XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT,
+                                                &loader_instance, "xrDestroyDebugUtilsMessengerEXT");
     if (XR_FAILED(result)) {
         return result;
     }
 
     result = loader_instance->DispatchTable()->DestroyDebugUtilsMessengerEXT(messenger);
+    if (XR_SUCCEEDED(result)) {
+        ActiveLoaderInstance::RemoveHandle(MakeHandleGeneric(messenger), XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT);
+    }
     LoaderLogger::LogVerboseMessage("xrDestroyDebugUtilsMessengerEXT", "Completed loader trampoline");
     return result;
 }
@@ -551,12 +615,13 @@ XRAPI_ATTR XrResult XRAPI_CALL xrSessionBeginDebugUtilsLabelRegionEXT(XrSession
     }
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionBeginDebugUtilsLabelRegionEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(session), XR_OBJECT_TYPE_SESSION, &loader_instance,
+                                                "xrSessionBeginDebugUtilsLabelRegionEXT");
     if (XR_FAILED(result)) {
         return result;
     }
     LoaderLogger::GetInstance().BeginLabelRegion(session, labelInfo);
-    const std::unique_ptr<XrGeneratedDispatchTable> &dispatch_table = loader_instance->DispatchTable();
+    XrGeneratedDispatchTable *dispatch_table = loader_instance->DispatchTable();
     if (nullptr != dispatch_table->SessionBeginDebugUtilsLabelRegionEXT) {
         return dispatch_table->SessionBeginDebugUtilsLabelRegionEXT(session, labelInfo);
     }
@@ -571,13 +636,14 @@ XRAPI_ATTR XrResult XRAPI_CALL xrSessionEndDebugUtilsLabelRegionEXT(XrSession se
     }
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionEndDebugUtilsLabelRegionEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(session), XR_OBJECT_TYPE_SESSION, &loader_instance,
+                                                "xrSessionEndDebugUtilsLabelRegionEXT");
     if (XR_FAILED(result)) {
         return result;
     }
 
     LoaderLogger::GetInstance().EndLabelRegion(session);
-    const std::unique_ptr<XrGeneratedDispatchTable> &dispatch_table = loader_instance->DispatchTable();
+    XrGeneratedDispatchTable *dispatch_table = loader_instance->DispatchTable();
     if (nullptr != dispatch_table->SessionEndDebugUtilsLabelRegionEXT) {
         return dispatch_table->SessionEndDebugUtilsLabelRegionEXT(session);
     }
@@ -593,7 +659,8 @@ XRAPI_ATTR XrResult XRAPI_CALL xrSessionInsertDebugUtilsLabelEXT(XrSession sessi
     }
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionInsertDebugUtilsLabelEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(session), XR_OBJECT_TYPE_SESSION, &loader_instance,
+                                                "xrSessionInsertDebugUtilsLabelEXT");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -607,7 +674,7 @@ XRAPI_ATTR XrResult XRAPI_CALL xrSessionInsertDebugUtilsLabelEXT(XrSession sessi
 
     LoaderLogger::GetInstance().InsertLabel(session, labelInfo);
 
-    const std::unique_ptr<XrGeneratedDispatchTable> &dispatch_table = loader_instance->DispatchTable();
+    XrGeneratedDispatchTable *dispatch_table = loader_instance->DispatchTable();
     if (nullptr != dispatch_table->SessionInsertDebugUtilsLabelEXT) {
         return dispatch_table->SessionInsertDebugUtilsLabelEXT(session, labelInfo);
     }
@@ -620,7 +687,8 @@ XRLOADER_ABI_CATCH_FALLBACK
 XRAPI_ATTR XrResult XRAPI_CALL xrSetDebugUtilsObjectNameEXT(XrInstance instance,
                                                             const XrDebugUtilsObjectNameInfoEXT *nameInfo) XRLOADER_ABI_TRY {
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSetDebugUtilsObjectNameEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE, &loader_instance,
+                                                "xrSetDebugUtilsObjectNameEXT");
     if (XR_SUCCEEDED(result)) {
         result = loader_instance->DispatchTable()->SetDebugUtilsObjectNameEXT(instance, nameInfo);
     }
@@ -633,7 +701,8 @@ XRAPI_ATTR XrResult XRAPI_CALL xrSubmitDebugUtilsMessageEXT(
     XrInstance instance, XrDebugUtilsMessageSeverityFlagsEXT messageSeverity, XrDebugUtilsMessageTypeFlagsEXT messageTypes,
     const XrDebugUtilsMessengerCallbackDataEXT *callbackData) XRLOADER_ABI_TRY {
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSubmitDebugUtilsMessageEXT");
+    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE, &loader_instance,
+                                                "xrSubmitDebugUtilsMessageEXT");
     if (XR_SUCCEEDED(result)) {
         result =
             loader_instance->DispatchTable()->SubmitDebugUtilsMessageEXT(instance, messageSeverity, messageTypes, callbackData);
@@ -739,10 +808,12 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance in
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
+    const LoaderCommand command = GeneratedLoaderCommandFromName(name);
+
     if (instance == XR_NULL_HANDLE) {
         // Null instance is allowed for 3 specific API entry points, otherwise return error
-        if (strcmp(name, "xrCreateInstance") != 0 && strcmp(name, "xrEnumerateApiLayerProperties") != 0 &&
-            strcmp(name, "xrEnumerateInstanceExtensionProperties") != 0) {
+        if (command != LoaderCommand::CreateInstance && command != LoaderCommand::EnumerateApiLayerProperties &&
+            command != LoaderCommand::EnumerateInstanceExtensionProperties) {
             std::string error_str = "XR_NULL_HANDLE for instance but query for ";
             error_str += name;
             error_str += " requires a valid instance";
@@ -753,26 +824,30 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance in
     }
 
     // These functions must always go through the loader's implementation (trampoline).
-    if (strcmp(name, "xrGetInstanceProcAddr") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(xrGetInstanceProcAddr);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrEnumerateApiLayerProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(xrEnumerateApiLayerProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrEnumerateInstanceExtensionProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(xrEnumerateInstanceExtensionProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrCreateInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(xrCreateInstance);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrDestroyInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(xrDestroyInstance);
-        return XR_SUCCESS;
+    switch (command) {
+        case LoaderCommand::GetInstanceProcAddr:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(xrGetInstanceProcAddr);
+            return XR_SUCCESS;
+        case LoaderCommand::EnumerateApiLayerProperties:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(xrEnumerateApiLayerProperties);
+            return XR_SUCCESS;
+        case LoaderCommand::EnumerateInstanceExtensionProperties:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(xrEnumerateInstanceExtensionProperties);
+            return XR_SUCCESS;
+        case LoaderCommand::CreateInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(xrCreateInstance);
+            return XR_SUCCESS;
+        case LoaderCommand::DestroyInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(xrDestroyInstance);
+            return XR_SUCCESS;
+        default:
+            break;
     }
 
     // Remainder of the functions require the LoaderInstance.
     LoaderInstance *loader_instance = nullptr;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrGetInstanceProcAddr");
+    XrResult result =
+        ActiveLoaderInstance::Get(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE, &loader_instance, "xrGetInstanceProcAddr");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -780,20 +855,30 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance in
     // XR_EXT_debug_utils is built into the loader and handled partly through the xrGetInstanceProcAddress terminator,
     // but the check to see if the extension is enabled must be done here where ActiveLoaderInstance is safe to use.
     if (*function == nullptr) {
-        if (strcmp(name, "xrCreateDebugUtilsMessengerEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrCreateDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrDestroyDebugUtilsMessengerEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrDestroyDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrSessionBeginDebugUtilsLabelRegionEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionBeginDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionEndDebugUtilsLabelRegionEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionEndDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionInsertDebugUtilsLabelEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionInsertDebugUtilsLabelEXT);
-        } else if (strcmp(name, "xrSetDebugUtilsObjectNameEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSetDebugUtilsObjectNameEXT);
-        } else if (strcmp(name, "xrSubmitDebugUtilsMessageEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSubmitDebugUtilsMessageEXT);
+        switch (command) {
+            case LoaderCommand::CreateDebugUtilsMessengerEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrCreateDebugUtilsMessengerEXT);
+                break;
+            case LoaderCommand::DestroyDebugUtilsMessengerEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrDestroyDebugUtilsMessengerEXT);
+                break;
+            case LoaderCommand::SessionBeginDebugUtilsLabelRegionEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionBeginDebugUtilsLabelRegionEXT);
+                break;
+            case LoaderCommand::SessionEndDebugUtilsLabelRegionEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionEndDebugUtilsLabelRegionEXT);
+                break;
+            case LoaderCommand::SessionInsertDebugUtilsLabelEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionInsertDebugUtilsLabelEXT);
+                break;
+            case LoaderCommand::SetDebugUtilsObjectNameEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrSetDebugUtilsObjectNameEXT);
+                break;
+            case LoaderCommand::SubmitDebugUtilsMessageEXT:
+                *function = reinterpret_cast<PFN_xrVoidFunction>(xrSubmitDebugUtilsMessageEXT);
+                break;
+            default:
+                break;
         }
 
         if (*function != nullptr && !loader_instance->ExtensionIsEnabled("XR_EXT_debug_utils")) {
@@ -809,6 +894,15 @@ LOADER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance in
     }
 
     // If the function is not supported by the loader, call down to the next layer.
-    return loader_instance->GetInstanceProcAddr(name, function);
+    result = loader_instance->GetInstanceProcAddr(name, function);
+    if (XR_SUCCEEDED(result) && *function != nullptr) {
+        // Commands that create or destroy handles must pass through the loader so it can track which
+        // instance each handle belongs to.
+        PFN_xrVoidFunction tracking_function = GeneratedLoaderHandleTrackingFunction(command);
+        if (tracking_function != nullptr) {
+            *function = tracking_function;
+        }
+    }
+    return result;
 }
 XRLOADER_ABI_CATCH_FALLBACK
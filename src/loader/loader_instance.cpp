@@ -28,52 +28,183 @@
 
 #include "api_layer_interface.hpp"
 #include "hex_and_handles.h"
+#include "loader_allocation.hpp"
 #include "loader_interfaces.h"
 #include "loader_logger.hpp"
+#include "loader_timing.hpp"
 #include "runtime_interface.hpp"
 #include "xr_generated_dispatch_table.h"
 #include "xr_generated_loader.hpp"
 
 #include <openxr/openxr.h>
 
+#include <array>
+#include <atomic>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace {
-std::unique_ptr<LoaderInstance>& GetSetCurrentLoaderInstance() {
-    static std::unique_ptr<LoaderInstance> current_loader_instance;
-    return current_loader_instance;
-}
+// Owns every live LoaderInstance, and maps the handles created from each instance back to it.
+// The handle map is split into shards, each behind its own reader/writer lock, so dispatch lookups from many threads
+// rarely contend with each other or with handles being created and destroyed.
+class LoaderInstanceRegistry {
+   public:
+    static LoaderInstanceRegistry& GetInstance() {
+        static LoaderInstanceRegistry registry;
+        return registry;
+    }
+
+    void AddInstance(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name) {
+        LoaderInstance* added = loader_instance.get();
+        {
+            std::lock_guard<std::mutex> lock(_instances_mutex);
+            _instances[added->GetInstanceHandle()] = std::move(loader_instance);
+            UpdateSingleInstance(log_function_name);
+        }
+        AddHandle(MakeHandleGeneric(added->GetInstanceHandle()), XR_OBJECT_TYPE_INSTANCE, added);
+    }
+
+    void RemoveInstance(XrInstance instance) {
+        std::unique_ptr<LoaderInstance> removed;
+        {
+            std::lock_guard<std::mutex> lock(_instances_mutex);
+            auto it = _instances.find(instance);
+            if (it == _instances.end()) {
+                return;
+            }
+            removed = std::move(it->second);
+            _instances.erase(it);
+            UpdateSingleInstance("xrDestroyInstance");
+        }
+        for (auto& shard : _shards) {
+            std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+            map_erase_if(shard.handles, [&](const std::pair<const HandleKey, LoaderInstance*>& entry) {
+                return entry.second == removed.get();
+            });
+        }
+    }
+
+    bool HasInstances() {
+        std::lock_guard<std::mutex> lock(_instances_mutex);
+        return !_instances.empty();
+    }
+
+    LoaderInstance* Find(uint64_t handle, XrObjectType type) {
+        const HandleKey key{handle, type};
+        Shard& shard = GetShard(key);
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+            auto it = shard.handles.find(key);
+            if (it != shard.handles.end()) {
+                return it->second;
+            }
+        }
+        return _single_instance.load(std::memory_order_acquire);
+    }
+
+    void AddHandle(uint64_t handle, XrObjectType type, LoaderInstance* loader_instance) {
+        const HandleKey key{handle, type};
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+        shard.handles[key] = loader_instance;
+    }
+
+    void RemoveHandle(uint64_t handle, XrObjectType type) {
+        const HandleKey key{handle, type};
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+        shard.handles.erase(key);
+    }
+
+   private:
+    static const size_t kShardCount = 16;
+
+    // Handles of different types may share a value, for runtimes that count each type of handle separately.
+    struct HandleKey {
+        uint64_t handle;
+        XrObjectType type;
+
+        bool operator==(HandleKey const& other) const { return handle == other.handle && type == other.type; }
+    };
+
+    struct HandleKeyHash {
+        size_t operator()(HandleKey const& key) const { return static_cast<size_t>(Mix(key)); }
+    };
+
+    struct alignas(64) Shard {
+        std::shared_timed_mutex mutex;
+        LoaderUnorderedMap<HandleKey, LoaderInstance*, OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP, HandleKeyHash> handles;
+    };
+
+    // Runtimes commonly hand out small integers or aligned pointers, so mix the bits before picking a shard.
+    static uint64_t Mix(HandleKey const& key) {
+        return (key.handle ^ (static_cast<uint64_t>(key.type) << 56)) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    Shard& GetShard(HandleKey const& key) { return _shards[Mix(key) >> 60]; }
+
+    // Called with _instances_mutex held whenever the set of instances changes.  Unknown handles can only be attributed
+    // to an instance, and trampolines can only skip the LoaderInstance lookup, while exactly one instance is alive.
+    void UpdateSingleInstance(const char* log_function_name) {
+        using ActiveLoaderInstance::detail::g_direct_dispatch;
+        LoaderInstance* single = (_instances.size() == 1) ? _instances.begin()->second.get() : nullptr;
+        _single_instance.store(single, std::memory_order_release);
+
+        // With no API layers in the chain, the instance dispatch table only points at the runtime (and the loader
+        // terminators), so publish it for the trampolines to call through directly.  The table is never changed after
+        // the instance is created, and outlives any call made with the instance's handles.
+        const XrGeneratedDispatchTable* direct_dispatch = nullptr;
+        if (single != nullptr && single->LayerInterfaces().empty()) {
+            direct_dispatch = single->DispatchTable();
+            LoaderLogger::LogVerboseMessage(log_function_name,
+                                            "Only instance has no API layers, trampolines will dispatch directly to the runtime");
+        }
+        g_direct_dispatch.store(direct_dispatch, std::memory_order_release);
+    }
+
+    std::mutex _instances_mutex;
+    LoaderUnorderedMap<XrInstance, std::unique_ptr<LoaderInstance>, OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP> _instances;
+    std::atomic<LoaderInstance*> _single_instance{nullptr};
+    std::array<Shard, kShardCount> _shards;
+};
 }  // namespace
 
 namespace ActiveLoaderInstance {
-XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name) {
-    if (GetSetCurrentLoaderInstance() != nullptr) {
-        LoaderLogger::LogErrorMessage(log_function_name, "Active XrInstance handle already exists");
-        return XR_ERROR_LIMIT_REACHED;
-    }
+namespace detail {
+std::atomic<const XrGeneratedDispatchTable*> g_direct_dispatch{nullptr};
+}  // namespace detail
 
-    GetSetCurrentLoaderInstance() = std::move(loader_instance);
+XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name) {
+    LoaderInstanceRegistry::GetInstance().AddInstance(std::move(loader_instance), log_function_name);
     return XR_SUCCESS;
 }
 
-XrResult Get(LoaderInstance** loader_instance, const char* log_function_name) {
-    *loader_instance = GetSetCurrentLoaderInstance().get();
+XrResult Get(uint64_t handle, XrObjectType type, LoaderInstance** loader_instance, const char* log_function_name) {
+    *loader_instance = LoaderInstanceRegistry::GetInstance().Find(handle, type);
     if (*loader_instance == nullptr) {
-        LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance handle.");
+        LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance found for handle " + Uint64ToHexString(handle));
         return XR_ERROR_HANDLE_INVALID;
     }
 
     return XR_SUCCESS;
 }
 
-bool IsAvailable() { return GetSetCurrentLoaderInstance() != nullptr; }
+void AddHandle(uint64_t handle, XrObjectType type, LoaderInstance* loader_instance) {
+    LoaderInstanceRegistry::GetInstance().AddHandle(handle, type, loader_instance);
+}
+
+void RemoveHandle(uint64_t handle, XrObjectType type) { LoaderInstanceRegistry::GetInstance().RemoveHandle(handle, type); }
 
-void Remove() { GetSetCurrentLoaderInstance().release(); }
+void Remove(XrInstance instance) { LoaderInstanceRegistry::GetInstance().RemoveInstance(instance); }
+
+bool Any() { return LoaderInstanceRegistry::GetInstance().HasInstances(); }
 }  // namespace ActiveLoaderInstance
 
 // Extensions that are supported by the loader, but may not be supported
@@ -271,12 +402,14 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
     if (XR_SUCCEEDED(last_error)) {
         loader_instance->reset(new LoaderInstance(instance, info, topmost_gipa, std::move(api_layer_interfaces)));
 
-        std::ostringstream oss;
-        oss << "LoaderInstance::CreateInstance succeeded with ";
-        oss << (*loader_instance)->LayerInterfaces().size();
-        oss << " layers enabled and runtime interface - created instance = ";
-        oss << HandleToHexString((*loader_instance)->GetInstanceHandle());
-        LoaderLogger::LogInfoMessage("xrCreateInstance", oss.str());
+        if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+            std::ostringstream oss;
+            oss << "LoaderInstance::CreateInstance succeeded with ";
+            oss << (*loader_instance)->LayerInterfaces().size();
+            oss << " layers enabled and runtime interface - created instance = ";
+            oss << HandleToHexString((*loader_instance)->GetInstanceHandle());
+            LoaderLogger::LogInfoMessage("xrCreateInstance", oss.str());
+        }
     }
 
     return last_error;
@@ -291,19 +424,22 @@ LoaderInstance::LoaderInstance(XrInstance instance, const XrInstanceCreateInfo*
     : _runtime_instance(instance),
       _topmost_gipa(topmost_gipa),
       _api_layer_interfaces(std::move(api_layer_interfaces)),
-      _dispatch_table(new XrGeneratedDispatchTable{}) {
+      _dispatch_table(LoaderAllocateUnique<XrGeneratedDispatchTable>(OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE)) {
     for (uint32_t ext = 0; ext < create_info->enabledExtensionCount; ++ext) {
         _enabled_extensions.push_back(create_info->enabledExtensionNames[ext]);
     }
 
+    LoaderTimingScope timing("xrCreateInstance", "Dispatch population");
     GeneratedXrPopulateDispatchTable(_dispatch_table.get(), instance, topmost_gipa);
 }
 
 LoaderInstance::~LoaderInstance() {
-    std::ostringstream oss;
-    oss << "Destroying LoaderInstance = ";
-    oss << PointerToHexString(this);
-    LoaderLogger::LogInfoMessage("xrDestroyInstance", oss.str());
+    if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+        std::ostringstream oss;
+        oss << "Destroying LoaderInstance = ";
+        oss << PointerToHexString(this);
+        LoaderLogger::LogInfoMessage("xrDestroyInstance", oss.str());
+    }
 }
 
 bool LoaderInstance::ExtensionIsEnabled(const std::string& extension) {
@@ -22,12 +22,16 @@
 #pragma once
 
 #include "extra_algorithms.h"
+#include "loader_allocation.hpp"
 #include "loader_interfaces.h"
+#include "xr_generated_dispatch_table.h"
 
 #include <openxr/openxr.h>
 
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -35,26 +39,43 @@
 #include <vector>
 
 class ApiLayerInterface;
-struct XrGeneratedDispatchTable;
 class LoaderInstance;
 
-// Manage the single loader instance that is available.
+// Manage the loader instances that are alive, and which of them owns each handle the loader has seen.
 namespace ActiveLoaderInstance {
-// Set the active loader instance. This will fail if there is already an active loader instance.
+// Add a loader instance to the set of active instances, and record its XrInstance handle.
 XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name);
 
-// Returns true if there is an active loader instance.
-bool IsAvailable();
+// Get the LoaderInstance that owns the given handle, which is either an XrInstance or a handle created from one.
+// Handles the loader did not see being created are attributed to the only active instance, if there is just one.
+XrResult Get(uint64_t handle, XrObjectType type, LoaderInstance** loader_instance, const char* log_function_name);
 
-// Get the active LoaderInstance.
-XrResult Get(LoaderInstance** loader_instance, const char* log_function_name);
+// Record that a handle of the given type was created from the given loader instance.
+void AddHandle(uint64_t handle, XrObjectType type, LoaderInstance* loader_instance);
 
-// Destroy the currently active LoaderInstance if there is one. This will make the loader able to create a new XrInstance if needed.
-void Remove();
+// Forget a handle that has been destroyed.
+void RemoveHandle(uint64_t handle, XrObjectType type);
+
+// Destroy the LoaderInstance for the given XrInstance, if there is one, and forget every handle recorded for it.
+void Remove(XrInstance instance);
+
+// Whether any loader instance is active.
+bool Any();
+
+namespace detail {
+// Dispatch table of the active instance, published only while it is the only instance and has no API layers enabled.
+extern std::atomic<const XrGeneratedDispatchTable*> g_direct_dispatch;
+}  // namespace detail
+
+// Get the dispatch table of the active instance if it is the only one and has no API layers enabled, otherwise nullptr.
+// Every entry goes straight to the runtime, so the generated trampolines use this to skip looking up the LoaderInstance.
+inline const XrGeneratedDispatchTable* GetDirectDispatchTable() {
+    return detail::g_direct_dispatch.load(std::memory_order_acquire);
+}
 };  // namespace ActiveLoaderInstance
 
 // Manages information needed by the loader for an XrInstance, such as what extensions are available and the dispatch table.
-class LoaderInstance {
+class LoaderInstance : public LoaderAllocated<OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE> {
    public:
     // Factory method
     static XrResult CreateInstance(PFN_xrGetInstanceProcAddr get_instance_proc_addr_term, PFN_xrCreateInstance create_instance_term,
@@ -66,7 +87,7 @@ class LoaderInstance {
     virtual ~LoaderInstance();
 
     XrInstance GetInstanceHandle() { return _runtime_instance; }
-    const std::unique_ptr<XrGeneratedDispatchTable>& DispatchTable() { return _dispatch_table; }
+    XrGeneratedDispatchTable* DispatchTable() { return _dispatch_table.get(); }
     std::vector<std::unique_ptr<ApiLayerInterface>>& LayerInterfaces() { return _api_layer_interfaces; }
     bool ExtensionIsEnabled(const std::string& extension);
     XrDebugUtilsMessengerEXT DefaultDebugUtilsMessenger() { return _messenger; }
@@ -83,7 +104,7 @@ class LoaderInstance {
     std::vector<std::string> _enabled_extensions;
     std::vector<std::unique_ptr<ApiLayerInterface>> _api_layer_interfaces;
 
-    std::unique_ptr<XrGeneratedDispatchTable> _dispatch_table;
+    std::unique_ptr<XrGeneratedDispatchTable, LoaderAllocationDeleter> _dispatch_table;
     // Internal debug messenger created during xrCreateInstance
     XrDebugUtilsMessengerEXT _messenger{XR_NULL_HANDLE};
 };
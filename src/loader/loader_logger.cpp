@@ -24,6 +24,7 @@
 #include "extra_algorithms.h"
 #include "hex_and_handles.h"
 #include "loader_logger_recorders.hpp"
+#include "loader_timing.hpp"
 #include "platform_utils.hpp"
 
 #include <openxr/openxr.h>
@@ -110,14 +111,32 @@ XrDebugUtilsMessageTypeFlagsEXT LoaderLogMessageTypesToDebugUtilsMessageTypes(Xr
     return utils_types;
 }
 
+bool HasLoaderDebugOption(const std::string& debug_string, const char* option) {
+    const std::string option_string(option);
+    size_t start = 0;
+    while (start <= debug_string.size()) {
+        size_t end = debug_string.find(',', start);
+        if (end == std::string::npos) {
+            end = debug_string.size();
+        }
+        if (debug_string.compare(start, end - start, option_string) == 0) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
 LoaderLogger::LoaderLogger() {
     std::string debug_string = PlatformUtilsGetEnv("XR_LOADER_DEBUG");
+    const bool block_when_full = HasLoaderDebugOption(debug_string, OPENXR_LOADER_DEBUG_ASYNC_BLOCK);
+    const bool async = block_when_full || HasLoaderDebugOption(debug_string, OPENXR_LOADER_DEBUG_ASYNC);
 
     // Add an error logger by default so that we at least get errors out to std::cerr.
     // Normally we enable stderr output. But if the XR_LOADER_DEBUG environment variable is
     // present as "none" then we don't.
-    if (debug_string != "none") {
-        AddLogRecorder(MakeStdErrLoaderLogRecorder(nullptr));
+    if (!HasLoaderDebugOption(debug_string, "none")) {
+        AddLogRecorder(async ? MakeAsyncStdErrLoaderLogRecorder(nullptr, block_when_full) : MakeStdErrLoaderLogRecorder(nullptr));
     }
 
 #if _WIN32
@@ -127,74 +146,178 @@ LoaderLogger::LoaderLogger() {
 
     // If the environment variable to enable loader debugging is set, then enable the
     // appropriate logging out to std::cout.
-    if (!debug_string.empty()) {
-        XrLoaderLogMessageSeverityFlags debug_flags = {};
-        if (debug_string == "error") {
-            debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT;
-        } else if (debug_string == "warn") {
-            debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT;
-        } else if (debug_string == "info") {
-            debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
-                          XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT;
-        } else if (debug_string == "all" || debug_string == "verbose") {
-            debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
-                          XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT;
+    XrLoaderLogMessageSeverityFlags debug_flags = {};
+    XrLoaderLogMessageTypeFlags debug_types = XR_LOADER_LOG_MESSAGE_TYPE_DEFAULT_BITS;
+    if (HasLoaderDebugOption(debug_string, "error")) {
+        debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT;
+    } else if (HasLoaderDebugOption(debug_string, "warn")) {
+        debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT;
+    } else if (HasLoaderDebugOption(debug_string, "info")) {
+        debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
+                      XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT;
+    } else if (HasLoaderDebugOption(debug_string, "all") || HasLoaderDebugOption(debug_string, "verbose")) {
+        debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
+                      XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT;
+    } else if (HasLoaderDebugOption(debug_string, OPENXR_LOADER_DEBUG_TIMING)) {
+        // The durations of the loader's startup phases, see LoaderTimingScope, which are performance messages at
+        // info severity, along with any warnings and errors.
+        debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
+                      XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT;
+    }
+
+    // A binary log takes the place of the std::cout text, and takes every message unless a level is given.
+    std::unique_ptr<LoaderLogRecorder> binary_recorder;
+    const std::string binary_log_filename = PlatformUtilsGetEnv(OPENXR_BINARY_LOG_FILE_ENV_VAR);
+    if (!binary_log_filename.empty()) {
+        const XrLoaderLogMessageSeverityFlags binary_flags =
+            debug_flags != 0 ? debug_flags
+                             : XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
+                                   XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT;
+        binary_recorder = MakeBinaryFileLoaderLogRecorder(nullptr, binary_log_filename, binary_flags, debug_types);
+    }
+
+    if (binary_recorder) {
+        AddLogRecorder(std::move(binary_recorder));
+    } else if (!debug_string.empty()) {
+        if (async) {
+            AddLogRecorder(MakeAsyncStdOutLoaderLogRecorder(nullptr, debug_flags, debug_types, block_when_full));
+        } else {
+            AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, debug_flags, debug_types));
+        }
+    }
+}
+
+void LoaderLogger::Flush() {
+    _registry.Read([](const RecorderRegistry& registry) {
+        for (const std::shared_ptr<LoaderLogRecorder>& recorder : registry.recorders) {
+            recorder->Flush();
         }
-        AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, debug_flags));
+    });
+}
+
+void LoaderLogger::ReleaseWriters() {
+    _registry.Read([](const RecorderRegistry& registry) {
+        for (const std::shared_ptr<LoaderLogRecorder>& recorder : registry.recorders) {
+            recorder->ReleaseWriter();
+        }
+    });
+}
+
+void LoaderLogger::UpdateListeningMasks(const RecorderRegistry& registry) {
+    XrLoaderLogMessageSeverityFlags severities = 0;
+    XrLoaderLogMessageTypeFlags types = 0;
+    for (const std::shared_ptr<LoaderLogRecorder>& recorder : registry.recorders) {
+        severities |= recorder->MessageSeverities();
+        types |= recorder->MessageTypes();
     }
+    _any_message_severities.store(severities, std::memory_order_relaxed);
+    _any_message_types.store(types, std::memory_order_relaxed);
 }
 
-void LoaderLogger::AddLogRecorder(std::unique_ptr<LoaderLogRecorder>&& recorder) { _recorders.push_back(std::move(recorder)); }
+void LoaderLogger::AddLogRecorder(std::unique_ptr<LoaderLogRecorder>&& recorder) {
+    std::shared_ptr<LoaderLogRecorder> shared_recorder(std::move(recorder));
+    _registry.Update([&](RecorderRegistry& registry) {
+        registry.recorders.push_back(shared_recorder);
+        UpdateListeningMasks(registry);
+    });
+}
 
 void LoaderLogger::AddLogRecorderForXrInstance(XrInstance instance, std::unique_ptr<LoaderLogRecorder>&& recorder) {
-    _recordersByInstance[instance].insert(recorder->UniqueId());
-    _recorders.emplace_back(std::move(recorder));
+    std::shared_ptr<LoaderLogRecorder> shared_recorder(std::move(recorder));
+    _registry.Update([&](RecorderRegistry& registry) {
+        registry.recorders_by_instance[instance].insert(shared_recorder->UniqueId());
+        registry.recorders.push_back(shared_recorder);
+        UpdateListeningMasks(registry);
+    });
 }
 
 void LoaderLogger::RemoveLogRecorder(uint64_t unique_id) {
-    vector_remove_if_and_erase(
-        _recorders, [=](std::unique_ptr<LoaderLogRecorder> const& recorder) { return recorder->UniqueId() == unique_id; });
-    for (auto& recorders : _recordersByInstance) {
-        auto& messengersForInstance = recorders.second;
-        if (messengersForInstance.count(unique_id) > 0) {
-            messengersForInstance.erase(unique_id);
+    std::vector<std::shared_ptr<LoaderLogRecorder>> removed;
+    _registry.Update([&](RecorderRegistry& registry) {
+        vector_remove_if_and_erase(registry.recorders, [&](std::shared_ptr<LoaderLogRecorder> const& recorder) {
+            if (recorder->UniqueId() != unique_id) {
+                return false;
+            }
+            removed.push_back(recorder);
+            return true;
+        });
+        for (auto& recorders : registry.recorders_by_instance) {
+            auto& messengersForInstance = recorders.second;
+            if (messengersForInstance.count(unique_id) > 0) {
+                messengersForInstance.erase(unique_id);
+            }
         }
+        UpdateListeningMasks(registry);
+    });
+    for (const std::shared_ptr<LoaderLogRecorder>& recorder : removed) {
+        recorder->ReleaseWriter();
     }
 }
 
 void LoaderLogger::RemoveLogRecordersForXrInstance(XrInstance instance) {
-    if (_recordersByInstance.find(instance) != _recordersByInstance.end()) {
-        auto recorders = _recordersByInstance[instance];
-        vector_remove_if_and_erase(_recorders, [=](std::unique_ptr<LoaderLogRecorder> const& recorder) {
-            return recorders.find(recorder->UniqueId()) != recorders.end();
+    const bool has_recorders = _registry.Read([&](const RecorderRegistry& registry) {
+        return registry.recorders_by_instance.find(instance) != registry.recorders_by_instance.end();
+    });
+    if (!has_recorders) {
+        return;
+    }
+    std::vector<std::shared_ptr<LoaderLogRecorder>> removed;
+    _registry.Update([&](RecorderRegistry& registry) {
+        auto found = registry.recorders_by_instance.find(instance);
+        if (found == registry.recorders_by_instance.end()) {
+            return;
+        }
+        const std::unordered_set<uint64_t> recorders = std::move(found->second);
+        registry.recorders_by_instance.erase(found);
+        vector_remove_if_and_erase(registry.recorders, [&](std::shared_ptr<LoaderLogRecorder> const& recorder) {
+            if (recorders.find(recorder->UniqueId()) == recorders.end()) {
+                return false;
+            }
+            removed.push_back(recorder);
+            return true;
         });
-        _recordersByInstance.erase(instance);
+        UpdateListeningMasks(registry);
+    });
+    // End any writer thread here, on an API call, rather than when the last reference goes away.
+    for (const std::shared_ptr<LoaderLogRecorder>& recorder : removed) {
+        recorder->ReleaseWriter();
     }
 }
 
 bool LoaderLogger::LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
-                              const std::string& message_id, const std::string& command_name, const std::string& message,
+                              const char* message_id, const char* command_name, const char* message,
                               const std::vector<XrSdkLogObjectInfo>& objects) {
+    if (!IsLogging(message_severity, message_type)) {
+        return false;
+    }
+
     XrLoaderLogMessengerCallbackData callback_data = {};
-    callback_data.message_id = message_id.c_str();
-    callback_data.command_name = command_name.c_str();
-    callback_data.message = message.c_str();
+    callback_data.message_id = message_id;
+    callback_data.command_name = command_name;
+    callback_data.message = message;
 
-    auto names_and_labels = data_.PopulateNamesAndLabels(objects);
+    NamesAndLabels names_and_labels;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_data_mutex);
+        names_and_labels = data_.PopulateNamesAndLabels(objects);
+    }
     callback_data.objects = names_and_labels.sdk_objects.empty() ? nullptr : names_and_labels.sdk_objects.data();
     callback_data.object_count = static_cast<uint8_t>(names_and_labels.objects.size());
 
-    callback_data.session_labels = names_and_labels.labels.empty() ? nullptr : names_and_labels.labels.data();
-    callback_data.session_labels_count = static_cast<uint8_t>(names_and_labels.labels.size());
+    XrSdkSessionLabelView session_labels = names_and_labels.SessionLabels();
+    callback_data.session_labels = session_labels.count == 0 ? nullptr : const_cast<XrDebugUtilsLabelEXT*>(session_labels.labels);
+    callback_data.session_labels_count = static_cast<uint8_t>(session_labels.count);
 
-    bool exit_app = false;
-    for (std::unique_ptr<LoaderLogRecorder>& recorder : _recorders) {
-        if ((recorder->MessageSeverities() & message_severity) == message_severity &&
-            (recorder->MessageTypes() & message_type) == message_type) {
-            exit_app |= recorder->LogMessage(message_severity, message_type, &callback_data);
+    return _registry.Read([&](const RecorderRegistry& registry) {
+        bool exit_app = false;
+        for (const std::shared_ptr<LoaderLogRecorder>& recorder : registry.recorders) {
+            if ((recorder->MessageSeverities() & message_severity) == message_severity &&
+                (recorder->MessageTypes() & message_type) == message_type) {
+                exit_app |= recorder->LogMessage(message_severity, message_type, &callback_data);
+            }
         }
-    }
-    return exit_app;
+        return exit_app;
+    });
 }
 
 // Extension-specific logging functions
@@ -204,36 +327,53 @@ bool LoaderLogger::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT mess
     bool exit_app = false;
     XrLoaderLogMessageSeverityFlags log_message_severity = DebugUtilsSeveritiesToLoaderLogMessageSeverities(message_severity);
     XrLoaderLogMessageTypeFlags log_message_type = DebugUtilsMessageTypesToLoaderLogMessageTypes(message_type);
+    if (!IsLogging(log_message_severity, log_message_type)) {
+        return exit_app;
+    }
 
     AugmentedCallbackData augmented_data;
-    data_.WrapCallbackData(&augmented_data, callback_data);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_data_mutex);
+        data_.WrapCallbackData(&augmented_data, callback_data);
+    }
 
     // Loop through the recorders
-    for (std::unique_ptr<LoaderLogRecorder>& recorder : _recorders) {
-        // Only send the message if it's a debug utils recorder and of the type the recorder cares about.
-        if (recorder->Type() != XR_LOADER_LOG_DEBUG_UTILS ||
-            (recorder->MessageSeverities() & log_message_severity) != log_message_severity ||
-            (recorder->MessageTypes() & log_message_type) != log_message_type) {
-            continue;
-        }
+    _registry.Read([&](const RecorderRegistry& registry) {
+        for (const std::shared_ptr<LoaderLogRecorder>& recorder : registry.recorders) {
+            // Only send the message if it's a debug utils recorder and of the type the recorder cares about.
+            if (recorder->Type() != XR_LOADER_LOG_DEBUG_UTILS ||
+                (recorder->MessageSeverities() & log_message_severity) != log_message_severity ||
+                (recorder->MessageTypes() & log_message_type) != log_message_type) {
+                continue;
+            }
 
-        exit_app |= recorder->LogDebugUtilsMessage(message_severity, message_type, augmented_data.exported_data);
-    }
+            exit_app |= recorder->LogDebugUtilsMessage(message_severity, message_type, augmented_data.exported_data);
+        }
+    });
     return exit_app;
 }
 
 void LoaderLogger::AddObjectName(uint64_t object_handle, XrObjectType object_type, const std::string& object_name) {
+    std::unique_lock<std::shared_timed_mutex> lock(_data_mutex);
     data_.AddObjectName(object_handle, object_type, object_name);
 }
 
 void LoaderLogger::BeginLabelRegion(XrSession session, const XrDebugUtilsLabelEXT* label_info) {
+    std::unique_lock<std::shared_timed_mutex> lock(_data_mutex);
     data_.BeginLabelRegion(session, *label_info);
 }
 
-void LoaderLogger::EndLabelRegion(XrSession session) { data_.EndLabelRegion(session); }
+void LoaderLogger::EndLabelRegion(XrSession session) {
+    std::unique_lock<std::shared_timed_mutex> lock(_data_mutex);
+    data_.EndLabelRegion(session);
+}
 
 void LoaderLogger::InsertLabel(XrSession session, const XrDebugUtilsLabelEXT* label_info) {
+    std::unique_lock<std::shared_timed_mutex> lock(_data_mutex);
     data_.InsertLabel(session, *label_info);
 }
 
-void LoaderLogger::DeleteSessionLabels(XrSession session) { data_.DeleteSessionLabels(session); }
+void LoaderLogger::DeleteSessionLabels(XrSession session) {
+    std::unique_lock<std::shared_timed_mutex> lock(_data_mutex);
+    data_.DeleteSessionLabels(session);
+}
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -29,11 +30,23 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <shared_mutex>
 
 #include <openxr/openxr.h>
 
 #include "hex_and_handles.h"
+#include "loader_allocation.hpp"
 #include "object_info.h"
+#include "read_mostly.hpp"
+
+// Options that may be added to the XR_LOADER_DEBUG log level, separated by commas, to write the std::cerr and
+// std::cout logs from a background thread.  With "async", messages are dropped while the queue is full; with
+// "async_block", the logging thread waits for room instead.
+#define OPENXR_LOADER_DEBUG_ASYNC "async"
+#define OPENXR_LOADER_DEBUG_ASYNC_BLOCK "async_block"
+
+// Whether the comma-separated XR_LOADER_DEBUG value contains the given level or option.
+bool HasLoaderDebugOption(const std::string& debug_string, const char* option);
 
 // Use internal versions of flags similar to XR_EXT_debug_utils so that
 // we're not tightly coupled to that extension.  This way, if the extension
@@ -69,9 +82,10 @@ enum XrLoaderLogType {
     XR_LOADER_LOG_STDOUT,
     XR_LOADER_LOG_DEBUG_UTILS,
     XR_LOADER_LOG_DEBUGGER,
+    XR_LOADER_LOG_BINARY_FILE,
 };
 
-class LoaderLogRecorder {
+class LoaderLogRecorder : public LoaderAllocated<OPENXR_LOADER_ALLOCATION_SUBSYSTEM_LOGGER> {
    public:
     LoaderLogRecorder(XrLoaderLogType type, void* user_data, XrLoaderLogMessageSeverityFlags message_severities,
                       XrLoaderLogMessageTypeFlags message_types) {
@@ -102,6 +116,12 @@ class LoaderLogRecorder {
 
     virtual void Stop() { _active = false; }
 
+    // Write out anything this recorder has queued but not yet output.  Most recorders output synchronously.
+    virtual void Flush() {}
+
+    // Write out anything queued and end any thread kept for output.  The recorder starts it again if it logs more.
+    virtual void ReleaseWriter() {}
+
     virtual bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
                             const XrLoaderLogMessengerCallbackData* callback_data) = 0;
 
@@ -119,6 +139,19 @@ class LoaderLogRecorder {
     XrLoaderLogMessageTypeFlags _message_types;
 };
 
+// Non-owning reference to a null-terminated string, so the static logging helpers accept string literals and
+// std::strings alike without building a std::string for a message nobody is listening for.
+class LoaderLogString {
+   public:
+    LoaderLogString(const char* str) : _str(str != nullptr ? str : "") {}  // NOLINT(google-explicit-constructor)
+    LoaderLogString(const std::string& str) : _str(str.c_str()) {}       // NOLINT(google-explicit-constructor)
+
+    const char* c_str() const { return _str; }
+
+   private:
+    const char* _str;
+};
+
 class LoaderLogger {
    public:
     static LoaderLogger& GetInstance() {
@@ -139,38 +172,64 @@ class LoaderLogger {
     void InsertLabel(XrSession session, const XrDebugUtilsLabelEXT* label_info);
     void DeleteSessionLabels(XrSession session);
 
+    //! Wait for every recorder to output the messages it has queued.
+    void Flush();
+
+    //! Write out everything queued and end the recorders' background writer threads, for when the loader goes idle.
+    void ReleaseWriters();
+
     bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
                     const std::string& message_id, const std::string& command_name, const std::string& message,
+                    const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogMessage(message_severity, message_type, message_id.c_str(), command_name.c_str(), message.c_str(), objects);
+    }
+    bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                    const char* message_id, const char* command_name, const char* message,
                     const std::vector<XrSdkLogObjectInfo>& objects = {});
-    static bool LogErrorMessage(const std::string& command_name, const std::string& message,
+
+    //! Whether any recorder might take a message of this severity and type.  Callers that build a message
+    //! string can check this first; the logging helpers below already do.
+    static bool IsLogging(XrLoaderLogMessageSeverityFlagBits message_severity,
+                          XrLoaderLogMessageTypeFlags message_type = XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT) {
+        const LoaderLogger& logger = GetInstance();
+        return (logger._any_message_severities.load(std::memory_order_relaxed) & message_severity) == message_severity &&
+               (logger._any_message_types.load(std::memory_order_relaxed) & message_type) == message_type;
+    }
+
+    static bool LogErrorMessage(LoaderLogString command_name, LoaderLogString message,
                                 const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
-                                        "OpenXR-Loader", command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT, "OpenXR-Loader",
+                              command_name, message, objects);
     }
-    static bool LogWarningMessage(const std::string& command_name, const std::string& message,
+    static bool LogWarningMessage(LoaderLogString command_name, LoaderLogString message,
                                   const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
-                                        "OpenXR-Loader", command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT, "OpenXR-Loader",
+                              command_name, message, objects);
     }
-    static bool LogInfoMessage(const std::string& command_name, const std::string& message,
+    static bool LogInfoMessage(LoaderLogString command_name, LoaderLogString message,
                                const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
-                                        "OpenXR-Loader", command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT, "OpenXR-Loader",
+                              command_name, message, objects);
     }
-    static bool LogVerboseMessage(const std::string& command_name, const std::string& message,
+    static bool LogVerboseMessage(LoaderLogString command_name, LoaderLogString message,
                                   const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
-                                        "OpenXR-Loader", command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT, "OpenXR-Loader",
+                              command_name, message, objects);
+    }
+    static bool LogPerformanceMessage(LoaderLogString command_name, LoaderLogString message,
+                                      const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT, "OpenXR-Loader",
+                              command_name, message, objects);
     }
-    static bool LogValidationErrorMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+    static bool LogValidationErrorMessage(LoaderLogString vuid, LoaderLogString command_name, LoaderLogString message,
                                           const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT,
-                                        vuid, command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT, vuid,
+                              command_name, message, objects);
     }
-    static bool LogValidationWarningMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+    static bool LogValidationWarningMessage(LoaderLogString vuid, LoaderLogString command_name, LoaderLogString message,
                                             const std::vector<XrSdkLogObjectInfo>& objects = {}) {
-        return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT,
-                                        vuid, command_name, message, objects);
+        return LogIfListening(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT, vuid,
+                              command_name, message, objects);
     }
 
     // Extension-specific logging functions
@@ -184,13 +243,40 @@ class LoaderLogger {
    private:
     LoaderLogger();
 
-    // List of *all* available recorder objects (including created specifically for an Instance)
-    std::vector<std::unique_ptr<LoaderLogRecorder>> _recorders;
+    static bool LogIfListening(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                               LoaderLogString message_id, LoaderLogString command_name, LoaderLogString message,
+                               const std::vector<XrSdkLogObjectInfo>& objects) {
+        if (!IsLogging(message_severity, message_type)) {
+            return false;
+        }
+        return GetInstance().LogMessage(message_severity, message_type, message_id.c_str(), command_name.c_str(), message.c_str(),
+                                        objects);
+    }
+
+    // Every recorder, and which of them belong to an XrInstance.  Logging threads read this without a lock while
+    // recorders are added and removed, so a recorder must not add or remove recorders from its LogMessage.
+    struct RecorderRegistry {
+        // List of *all* available recorder objects (including created specifically for an Instance)
+        std::vector<std::shared_ptr<LoaderLogRecorder>> recorders;
+
+        // List of recorder objects only created specifically for an XrInstance
+        std::unordered_map<XrInstance, std::unordered_set<uint64_t>> recorders_by_instance;
+    };
 
-    // List of recorder objects only created specifically for an XrInstance
-    std::unordered_map<XrInstance, std::unordered_set<uint64_t>> _recordersByInstance;
+    // Recompute the severities and types any recorder takes, while publishing a changed registry.
+    void UpdateListeningMasks(const RecorderRegistry& registry);
 
+    ReadMostly<RecorderRegistry> _registry;
+
+    // Guards data_, which the debug utils commands change while messages are logged on other threads.  Messages copy
+    // what they need from data_, so the lock is not held while recorders run.
+    std::shared_timed_mutex _data_mutex;
     DebugUtilsData data_;
+
+    // Union of the severities, and of the message types, of all recorders.  A message outside either mask is
+    // dropped before any of its arguments are formatted.
+    std::atomic<XrLoaderLogMessageSeverityFlags> _any_message_severities{0};
+    std::atomic<XrLoaderLogMessageTypeFlags> _any_message_types{0};
 };
 
 // Utility functions for converting to/from XR_EXT_debug_utils values
@@ -21,13 +21,25 @@
 
 #include "loader_logger_recorders.hpp"
 
+#include "format_buffer.h"
 #include "hex_and_handles.h"
+#include "loader_binary_log.h"
 #include "loader_logger.hpp"
 
 #include <openxr/openxr.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -36,6 +48,14 @@
 #include <Windows.h>
 #endif
 
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
 // Anonymous namespace to keep these types private
 namespace {
 void OutputMessageToStream(std::ostream& os, XrLoaderLogMessageSeverityFlagBits message_severity,
@@ -67,7 +87,13 @@ void OutputMessageToStream(std::ostream& os, XrLoaderLogMessageSeverityFlagBits
        << std::endl;
 
     for (uint32_t obj = 0; obj < callback_data->object_count; ++obj) {
-        os << "    Object[" << obj << "] = " << callback_data->objects[obj].ToString();
+        const XrSdkLogObjectInfo& object = callback_data->objects[obj];
+        FixedFormatBuffer<XR_HEX_STRING_LENGTH(sizeof(object.handle)) + 1> handle;
+        AppendHex(handle, object.handle);
+        os << "    Object[" << obj << "] = " << handle.c_str();
+        if (!object.name.empty()) {
+            os << " (" << object.name << ")";
+        }
         os << std::endl;
     }
     for (uint32_t label = 0; label < callback_data->session_labels_count; ++label) {
@@ -80,7 +106,8 @@ void OutputMessageToStream(std::ostream& os, XrLoaderLogMessageSeverityFlagBits
 // With std::cout: Standard Output logger used with XR_LOADER_DEBUG
 class OstreamLoaderLogRecorder : public LoaderLogRecorder {
    public:
-    OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags);
+    OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                             XrLoaderLogMessageTypeFlags types = XR_LOADER_LOG_MESSAGE_TYPE_DEFAULT_BITS);
 
     bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
                     const XrLoaderLogMessengerCallbackData* callback_data) override;
@@ -89,6 +116,133 @@ class OstreamLoaderLogRecorder : public LoaderLogRecorder {
     std::ostream& os_;
 };
 
+// Bounded queue of formatted messages with any number of producers and one consumer, after Dmitry Vyukov's
+// bounded MPMC queue.  Each cell carries a sequence number saying whether it is free for the producer that
+// claimed its position or holds a message for the consumer, so neither side takes a lock.  Messages are swapped
+// in and out, so the strings' buffers are reused rather than reallocated.
+class LogMessageRing {
+   public:
+    explicit LogMessageRing(size_t capacity) : _cells(new Cell[capacity]), _mask(capacity - 1) {
+        for (size_t index = 0; index < capacity; ++index) {
+            _cells[index].sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    // On success, message is left holding an empty string.
+    bool TryPush(std::string& message) {
+        size_t position = _enqueue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[position & _mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.message.swap(message);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The consumer has not freed this cell yet: the queue is full.
+                return false;
+            } else {
+                position = _enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only one thread at a time may pop.
+    bool TryPop(std::string& message) {
+        Cell& cell = _cells[_dequeue_position & _mask];
+        if (cell.sequence.load(std::memory_order_acquire) != _dequeue_position + 1) {
+            return false;
+        }
+        message.clear();
+        message.swap(cell.message);
+        cell.sequence.store(_dequeue_position + _mask + 1, std::memory_order_release);
+        ++_dequeue_position;
+        return true;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::string message;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    const size_t _mask;
+    std::atomic<size_t> _enqueue_position{0};
+    size_t _dequeue_position = 0;
+};
+
+// Queue of formatted messages behind AsyncOstreamLoaderLogRecorder, and the thread that writes them out.  The
+// writer starts with the first message and sleeps until a producer or Flush wakes it.  It holds its own reference to
+// the queue, so a writer that is still running when the recorder is destroyed never touches freed memory.
+class AsyncLogQueue : public std::enable_shared_from_this<AsyncLogQueue> {
+   public:
+    AsyncLogQueue(std::ostream& os, bool block_when_full) : os_(os), _block_when_full(block_when_full), _ring(kCapacity) {}
+
+    // Queue a message, starting or waking the writer.  When the queue is full the message is dropped, or with
+    // block_when_full the caller waits for the writer to make room.
+    void Push(std::string& message);
+
+    // Wait until everything pushed before the call has been written.
+    void Flush();
+
+    // Write out everything queued and end the writer thread.  The next Push starts a new one.
+    void StopWriter();
+
+    // Tell a running writer to write what is queued and exit, without waiting for it.
+    void DetachWriter();
+
+   private:
+    // Must be a power of two.
+    static const size_t kCapacity = 4096;
+
+    void StartWriterLocked();
+    void WriteQueued(std::string& batch);
+    void WriterThread();
+
+    std::ostream& os_;
+    const bool _block_when_full;
+    LogMessageRing _ring;
+    // Messages pushed, and messages written, so Flush can tell when everything logged before it is out.
+    std::atomic<uint64_t> _pushed{0};
+    std::atomic<uint64_t> _written{0};
+    std::atomic<uint64_t> _dropped{0};
+    uint64_t _reported_dropped = 0;
+    // Set by the writer, under _mutex, while it sleeps, so producers only take the lock when it needs waking.
+    std::atomic<bool> _writer_waiting{false};
+    // Changed only under _mutex.
+    std::atomic<bool> _writer_running{false};
+    std::mutex _mutex;
+    std::condition_variable _wake_writer;
+    std::condition_variable _written_changed;
+    bool _flush_requested = false;
+    bool _stopping = false;
+    std::thread _writer;
+};
+
+// std::cerr or std::cout logger that formats messages on the logging thread and writes them from a background
+// thread, so that logging never waits on the stream.  The loader ends the thread through ReleaseWriter when the
+// last instance is destroyed or the recorder is removed, rather than joining it during static destruction.
+class AsyncOstreamLoaderLogRecorder : public LoaderLogRecorder {
+   public:
+    AsyncOstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                  XrLoaderLogMessageTypeFlags types, bool block_when_full);
+    ~AsyncOstreamLoaderLogRecorder() override;
+
+    bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                    const XrLoaderLogMessengerCallbackData* callback_data) override;
+
+    void Stop() override;
+    void Flush() override;
+    void ReleaseWriter() override;
+
+   private:
+    std::shared_ptr<AsyncLogQueue> _queue;
+};
+
 // Debug Utils logger used with XR_EXT_debug_utils
 class DebugUtilsLogRecorder : public LoaderLogRecorder {
    public:
@@ -105,6 +259,51 @@ class DebugUtilsLogRecorder : public LoaderLogRecorder {
     PFN_xrDebugUtilsMessengerCallbackEXT _user_callback;
 };
 
+// Writes each message as a fixed-layout binary record, see loader_binary_log.h, to a file that is mapped into
+// memory where the platform allows.  Much smaller and cheaper to write than formatted text, for long captures.
+class BinaryFileLoaderLogRecorder : public LoaderLogRecorder {
+   public:
+    BinaryFileLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags, XrLoaderLogMessageTypeFlags types);
+    ~BinaryFileLoaderLogRecorder() override;
+
+    bool Open(const std::string& filename);
+
+    bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                    const XrLoaderLogMessengerCallbackData* callback_data) override;
+
+    void Flush() override;
+
+   private:
+    // The file is extended, and remapped, this many bytes at a time.
+    static const size_t kGrowthSize = 4 * 1024 * 1024;
+    // Bound on the addresses remembered for interned strings, which grows with every temporary string logged.
+    static const size_t kMaxStringAddresses = 4096;
+
+    // These are called with _mutex held.
+    uint32_t Intern(const char* str);
+    uint32_t InternIfRepeated(const char* str);
+    void AppendRecord(const std::vector<uint8_t>& record);
+
+    std::mutex _mutex;
+    std::chrono::steady_clock::time_point _start;
+    // Interned strings, looked up by address first since most are literals, then by contents.
+    std::unordered_map<const char*, uint32_t> _string_indices_by_address;
+    std::unordered_map<std::string, uint32_t> _string_indices;
+    std::vector<const std::string*> _string_values;
+    // Message text seen once, by address, which is interned if it shows up again at the same address.
+    std::unordered_map<const char*, std::string> _repeat_candidates;
+    std::vector<uint8_t> _record;
+    bool _failed = true;
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    int _fd = -1;
+    uint8_t* _mapping = nullptr;
+    size_t _mapping_size = 0;
+    size_t _used = 0;
+#else
+    std::ofstream _stream;
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+};
+
 #ifdef _WIN32
 // Output to debugger
 class DebuggerLoaderLogRecorder : public LoaderLogRecorder {
@@ -117,8 +316,9 @@ class DebuggerLoaderLogRecorder : public LoaderLogRecorder {
 #endif
 
 // Unified stdout/stderr logger
-OstreamLoaderLogRecorder::OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags)
-    : LoaderLogRecorder(XR_LOADER_LOG_STDOUT, user_data, flags, 0xFFFFFFFFUL), os_(os) {
+OstreamLoaderLogRecorder::OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                   XrLoaderLogMessageTypeFlags types)
+    : LoaderLogRecorder(XR_LOADER_LOG_STDOUT, user_data, flags, types), os_(os) {
     // Automatically start
     Start();
 }
@@ -135,6 +335,171 @@ bool OstreamLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits mes
     return false;
 }
 
+void AsyncLogQueue::Push(std::string& message) {
+    if (!_writer_running.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        StartWriterLocked();
+    }
+    bool pushed = _ring.TryPush(message);
+    if (!pushed && _block_when_full) {
+        // Have the writer empty the queue now, and wait until it makes room.
+        std::unique_lock<std::mutex> lock(_mutex);
+        StartWriterLocked();
+        _flush_requested = true;
+        _wake_writer.notify_one();
+        _written_changed.wait(lock, [&] { return (pushed = _ring.TryPush(message)) || _stopping; });
+    }
+    if (!pushed) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // The writer announces that it is going to sleep before it last checks _pushed, and this reads that after
+    // counting the message, so either the writer sees the message or this sees it waiting.  Taking the lock then
+    // makes sure the writer is already waiting on the condition variable when it is notified.
+    _pushed.fetch_add(1);
+    if (_writer_waiting.load()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake_writer.notify_one();
+    }
+}
+
+void AsyncLogQueue::Flush() {
+    const uint64_t target = _pushed.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_stopping) {
+        return;
+    }
+    if (!_writer_running.load(std::memory_order_relaxed)) {
+        // Nobody else pops while the lock keeps a writer from starting.
+        std::string batch;
+        WriteQueued(batch);
+        return;
+    }
+    _flush_requested = true;
+    _wake_writer.notify_one();
+    _written_changed.wait(lock, [&] { return _stopping || _written.load(std::memory_order_acquire) >= target; });
+}
+
+void AsyncLogQueue::StopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_writer_running.load(std::memory_order_relaxed) || _stopping) {
+            return;
+        }
+        _stopping = true;
+    }
+    _wake_writer.notify_one();
+    // While _stopping is set nothing else starts, stops or detaches the writer, so _writer can be joined unlocked.
+    _writer.join();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Whatever was pushed while the writer was finishing.
+    std::string batch;
+    WriteQueued(batch);
+    _stopping = false;
+    _writer_running.store(false, std::memory_order_release);
+}
+
+void AsyncLogQueue::DetachWriter() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_writer_running.load(std::memory_order_relaxed)) {
+        std::string batch;
+        WriteQueued(batch);
+        return;
+    }
+    _stopping = true;
+    _wake_writer.notify_one();
+    _writer.detach();
+}
+
+void AsyncLogQueue::StartWriterLocked() {
+    if (_writer_running.load(std::memory_order_relaxed) || _stopping) {
+        return;
+    }
+    _writer = std::thread(&AsyncLogQueue::WriterThread, shared_from_this());
+    _writer_running.store(true, std::memory_order_release);
+}
+
+void AsyncLogQueue::WriteQueued(std::string& batch) {
+    uint64_t popped = 0;
+    std::string message;
+    while (_ring.TryPop(message)) {
+        batch += message;
+        ++popped;
+    }
+    const uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reported_dropped) {
+        batch += "Warning [GENERAL | OpenXR-Loader | OpenXR-Loader] : " + std::to_string(dropped - _reported_dropped) +
+                 " log messages were dropped because the asynchronous log queue was full\n";
+        _reported_dropped = dropped;
+    }
+    if (!batch.empty()) {
+        os_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        os_.flush();
+        batch.clear();
+    }
+    if (popped != 0) {
+        _written.fetch_add(popped, std::memory_order_release);
+    }
+}
+
+void AsyncLogQueue::WriterThread() {
+    std::string batch;
+    for (;;) {
+        WriteQueued(batch);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _written_changed.notify_all();
+        if (_stopping) {
+            return;
+        }
+        if (!_flush_requested) {
+            _writer_waiting.store(true);
+            _wake_writer.wait(lock, [&] { return _stopping || _flush_requested || _pushed.load() > _written.load(); });
+            _writer_waiting.store(false, std::memory_order_relaxed);
+        }
+        _flush_requested = false;
+    }
+}
+
+AsyncOstreamLoaderLogRecorder::AsyncOstreamLoaderLogRecorder(std::ostream& os, void* user_data,
+                                                             XrLoaderLogMessageSeverityFlags flags,
+                                                             XrLoaderLogMessageTypeFlags types, bool block_when_full)
+    : LoaderLogRecorder(XR_LOADER_LOG_STDOUT, user_data, flags, types),
+      _queue(std::make_shared<AsyncLogQueue>(os, block_when_full)) {
+    // Automatically start
+    Start();
+}
+
+AsyncOstreamLoaderLogRecorder::~AsyncOstreamLoaderLogRecorder() {
+    // Normally ReleaseWriter has already ended the writer.  If not, for instance during static destruction at exit,
+    // joining it here could deadlock, so leave it to finish on its own.
+    _queue->DetachWriter();
+}
+
+bool AsyncOstreamLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity,
+                                               XrLoaderLogMessageTypeFlags message_type,
+                                               const XrLoaderLogMessengerCallbackData* callback_data) {
+    if (_active && 0 != (_message_severities & message_severity) && 0 != (_message_types & message_type)) {
+        std::ostringstream oss;
+        OutputMessageToStream(oss, message_severity, message_type, callback_data);
+        std::string message = oss.str();
+        _queue->Push(message);
+    }
+
+    // Return of "true" means that we should exit the application after the logged message.  We
+    // don't want to do that for our internal logging.  Only let a user return true.
+    return false;
+}
+
+void AsyncOstreamLoaderLogRecorder::Stop() {
+    LoaderLogRecorder::Stop();
+    _queue->StopWriter();
+}
+
+void AsyncOstreamLoaderLogRecorder::Flush() { _queue->Flush(); }
+
+void AsyncOstreamLoaderLogRecorder::ReleaseWriter() { _queue->StopWriter(); }
+
 // A logger associated with the XR_EXT_debug_utils extension
 
 DebugUtilsLogRecorder::DebugUtilsLogRecorder(const XrDebugUtilsMessengerCreateInfoEXT* create_info,
@@ -193,6 +558,274 @@ bool DebugUtilsLogRecorder::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlag
     return (_user_callback(message_severity, message_type, callback_data, _user_data) == XR_TRUE);
 }
 
+// Small, stable numbers for threads in the binary log.
+uint32_t CurrentBinaryLogThreadId() {
+    static std::atomic<uint32_t> next_thread_id(1);
+    static thread_local uint32_t thread_id = next_thread_id++;
+    return thread_id;
+}
+
+size_t PaddedBinaryLogRecordSize(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+static_assert(sizeof(BinaryLogFileHeader) == 32, "Binary log file header layout changed");
+static_assert(sizeof(BinaryLogRecordHeader) == 8, "Binary log record header layout changed");
+static_assert(sizeof(BinaryLogStringRecord) == 16, "Binary log string record layout changed");
+static_assert(sizeof(BinaryLogMessageRecord) == 48, "Binary log message record layout changed");
+static_assert(sizeof(BinaryLogObject) == 16, "Binary log object layout changed");
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+// Extend the file from old_size to new_size with blocks actually allocated on disk, so that a full disk fails here
+// instead of raising SIGBUS when the mapping is written.
+static bool ReserveBinaryLogFile(int fd, size_t old_size, size_t new_size) {
+#if defined(XR_OS_LINUX)
+    return posix_fallocate(fd, static_cast<off_t>(old_size), static_cast<off_t>(new_size - old_size)) == 0;
+#else
+    static const char zeros[64 * 1024] = {};
+    while (old_size < new_size) {
+        const size_t chunk = std::min(sizeof(zeros), new_size - old_size);
+        const ssize_t written = pwrite(fd, zeros, chunk, static_cast<off_t>(old_size));
+        if (written <= 0) {
+            return false;
+        }
+        old_size += static_cast<size_t>(written);
+    }
+    return true;
+#endif  // defined(XR_OS_LINUX)
+}
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+BinaryFileLoaderLogRecorder::BinaryFileLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                         XrLoaderLogMessageTypeFlags types)
+    : LoaderLogRecorder(XR_LOADER_LOG_BINARY_FILE, user_data, flags, types) {}
+
+BinaryFileLoaderLogRecorder::~BinaryFileLoaderLogRecorder() {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    if (_mapping != nullptr) {
+        munmap(_mapping, _mapping_size);
+    }
+    if (_fd >= 0) {
+        // Drop the zero-filled tail of the last block.
+        if (ftruncate(_fd, static_cast<off_t>(_used)) != 0) {
+            // The end-of-log marker is still in place, so the file remains readable.
+        }
+        close(_fd);
+    }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+}
+
+bool BinaryFileLoaderLogRecorder::Open(const std::string& filename) {
+    BinaryLogFileHeader header = {};
+    memcpy(header.magic, XR_LOADER_BINARY_LOG_MAGIC, sizeof(header.magic));
+    header.version = XR_LOADER_BINARY_LOG_VERSION;
+    header.header_size = sizeof(header);
+    header.start_time_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    _start = std::chrono::steady_clock::now();
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    _fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (_fd < 0) {
+        return false;
+    }
+    if (!ReserveBinaryLogFile(_fd, 0, kGrowthSize)) {
+        return false;
+    }
+    void* mapping = mmap(nullptr, kGrowthSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    _mapping = static_cast<uint8_t*>(mapping);
+    _mapping_size = kGrowthSize;
+    memcpy(_mapping, &header, sizeof(header));
+    _used = sizeof(header);
+#else
+    _stream.open(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!_stream.is_open()) {
+        return false;
+    }
+    _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+    _failed = false;
+    // Automatically start
+    Start();
+    return true;
+}
+
+void BinaryFileLoaderLogRecorder::AppendRecord(const std::vector<uint8_t>& record) {
+    if (_failed) {
+        return;
+    }
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    // Keep room for the zero size that marks the end of the log.
+    const size_t needed = _used + record.size() + sizeof(BinaryLogRecordHeader);
+    if (needed > _mapping_size) {
+        size_t new_size = _mapping_size;
+        while (new_size < needed) {
+            new_size += kGrowthSize;
+        }
+        munmap(_mapping, _mapping_size);
+        _mapping = nullptr;
+        void* mapping = MAP_FAILED;
+        if (ReserveBinaryLogFile(_fd, _mapping_size, new_size)) {
+            mapping = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        }
+        if (mapping == MAP_FAILED) {
+            _failed = true;
+            return;
+        }
+        _mapping = static_cast<uint8_t*>(mapping);
+        _mapping_size = new_size;
+    }
+    // Write the size last, so a record cut short by a crash reads as the end of the log.
+    uint8_t* destination = _mapping + _used;
+    memcpy(destination + sizeof(uint32_t), record.data() + sizeof(uint32_t), record.size() - sizeof(uint32_t));
+    memcpy(destination, record.data(), sizeof(uint32_t));
+    _used += record.size();
+#else
+    _stream.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+    _failed = !_stream.good();
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+}
+
+uint32_t BinaryFileLoaderLogRecorder::Intern(const char* str) {
+    if (_failed || str == nullptr) {
+        return XR_LOADER_BINARY_LOG_NO_STRING;
+    }
+    // The same address may hold a different string by now, if it belonged to a temporary.
+    auto by_address = _string_indices_by_address.find(str);
+    if (by_address != _string_indices_by_address.end() && strcmp(_string_values[by_address->second]->c_str(), str) == 0) {
+        return by_address->second;
+    }
+    if (_string_indices_by_address.size() >= kMaxStringAddresses) {
+        _string_indices_by_address.clear();
+    }
+
+    std::string value(str);
+    auto existing = _string_indices.find(value);
+    if (existing != _string_indices.end()) {
+        _string_indices_by_address[str] = existing->second;
+        return existing->second;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(_string_values.size());
+    BinaryLogStringRecord string_record = {};
+    string_record.header.size = static_cast<uint32_t>(PaddedBinaryLogRecordSize(sizeof(string_record) + value.size()));
+    string_record.header.kind = BINARY_LOG_RECORD_STRING;
+    string_record.index = index;
+    string_record.length = static_cast<uint32_t>(value.size());
+    _record.assign(string_record.header.size, 0);
+    memcpy(_record.data(), &string_record, sizeof(string_record));
+    memcpy(_record.data() + sizeof(string_record), value.data(), value.size());
+    AppendRecord(_record);
+
+    auto inserted = _string_indices.emplace(std::move(value), index).first;
+    _string_values.push_back(&inserted->first);
+    _string_indices_by_address[str] = index;
+    return index;
+}
+
+uint32_t BinaryFileLoaderLogRecorder::InternIfRepeated(const char* str) {
+    auto by_address = _string_indices_by_address.find(str);
+    if (by_address != _string_indices_by_address.end() && strcmp(_string_values[by_address->second]->c_str(), str) == 0) {
+        return by_address->second;
+    }
+    auto candidate = _repeat_candidates.find(str);
+    if (candidate != _repeat_candidates.end()) {
+        if (candidate->second == str) {
+            _repeat_candidates.erase(candidate);
+            return Intern(str);
+        }
+        candidate->second = str;
+        return XR_LOADER_BINARY_LOG_NO_STRING;
+    }
+    if (_repeat_candidates.size() >= kMaxStringAddresses) {
+        _repeat_candidates.clear();
+    }
+    _repeat_candidates.emplace(str, str);
+    return XR_LOADER_BINARY_LOG_NO_STRING;
+}
+
+bool BinaryFileLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity,
+                                             XrLoaderLogMessageTypeFlags message_type,
+                                             const XrLoaderLogMessengerCallbackData* callback_data) {
+    if (_active && 0 != (_message_severities & message_severity) && 0 != (_message_types & message_type)) {
+        const auto now = std::chrono::steady_clock::now();
+        const uint32_t thread_id = CurrentBinaryLogThreadId();
+        const char* const payload = callback_data->message != nullptr ? callback_data->message : "";
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_failed) {
+            return false;
+        }
+
+        // Intern everything first, since that may append string records.
+        BinaryLogMessageRecord message_record = {};
+        message_record.payload = InternIfRepeated(payload);
+        const size_t payload_length = message_record.payload == XR_LOADER_BINARY_LOG_NO_STRING ? strlen(payload) : 0;
+        message_record.message_id = Intern(callback_data->message_id);
+        message_record.command_name = Intern(callback_data->command_name);
+        std::vector<BinaryLogObject> objects(callback_data->object_count);
+        for (uint8_t object = 0; object < callback_data->object_count; ++object) {
+            const XrSdkLogObjectInfo& info = callback_data->objects[object];
+            objects[object].handle = info.handle;
+            objects[object].type = static_cast<uint32_t>(info.type);
+            objects[object].name = info.name.empty() ? XR_LOADER_BINARY_LOG_NO_STRING : Intern(info.name.c_str());
+        }
+        std::vector<uint32_t> labels(callback_data->session_labels_count);
+        for (uint8_t label = 0; label < callback_data->session_labels_count; ++label) {
+            labels[label] = Intern(callback_data->session_labels[label].labelName);
+        }
+        // A string record that could not be written leaves nothing to append the message to.
+        if (_failed) {
+            return false;
+        }
+
+        const size_t objects_size = objects.size() * sizeof(BinaryLogObject);
+        const size_t labels_size = labels.size() * sizeof(uint32_t);
+        const size_t size = sizeof(message_record) + objects_size + labels_size + payload_length;
+        message_record.header.size = static_cast<uint32_t>(PaddedBinaryLogRecordSize(size));
+        message_record.header.kind = BINARY_LOG_RECORD_MESSAGE;
+        message_record.timestamp_ns =
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start).count());
+        message_record.thread_id = thread_id;
+        message_record.severity = static_cast<uint32_t>(message_severity);
+        message_record.type = static_cast<uint32_t>(message_type);
+        message_record.object_count = static_cast<uint16_t>(objects.size());
+        message_record.session_label_count = static_cast<uint16_t>(labels.size());
+        message_record.payload_length = static_cast<uint32_t>(payload_length);
+
+        _record.assign(message_record.header.size, 0);
+        uint8_t* out = _record.data();
+        memcpy(out, &message_record, sizeof(message_record));
+        out += sizeof(message_record);
+        if (objects_size != 0) {
+            memcpy(out, objects.data(), objects_size);
+            out += objects_size;
+        }
+        if (labels_size != 0) {
+            memcpy(out, labels.data(), labels_size);
+            out += labels_size;
+        }
+        if (payload_length != 0) {
+            memcpy(out, payload, payload_length);
+        }
+        AppendRecord(_record);
+    }
+
+    // Return of "true" means that we should exit the application after the logged message.  We
+    // don't want to do that for our internal logging.  Only let a user return true.
+    return false;
+}
+
+void BinaryFileLoaderLogRecorder::Flush() {
+#if !defined(XR_OS_LINUX) && !defined(XR_OS_APPLE)
+    // A mapped file is already in the page cache, where other processes and the decoder can see it.
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stream.flush();
+#endif  // !defined(XR_OS_LINUX) && !defined(XR_OS_APPLE)
+}
+
 #ifdef _WIN32
 // Unified stdout/stderr logger
 DebuggerLoaderLogRecorder::DebuggerLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags)
@@ -218,8 +851,9 @@ bool DebuggerLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits me
 #endif
 }  // namespace
 
-std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags) {
-    std::unique_ptr<LoaderLogRecorder> recorder(new OstreamLoaderLogRecorder(std::cout, user_data, flags));
+std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                               XrLoaderLogMessageTypeFlags types) {
+    std::unique_ptr<LoaderLogRecorder> recorder(new OstreamLoaderLogRecorder(std::cout, user_data, flags, types));
     return recorder;
 }
 
@@ -229,6 +863,29 @@ std::unique_ptr<LoaderLogRecorder> MakeStdErrLoaderLogRecorder(void* user_data)
     return recorder;
 }
 
+std::unique_ptr<LoaderLogRecorder> MakeAsyncStdErrLoaderLogRecorder(void* user_data, bool block_when_full) {
+    std::unique_ptr<LoaderLogRecorder> recorder(new AsyncOstreamLoaderLogRecorder(
+        std::cerr, user_data, XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_DEFAULT_BITS, block_when_full));
+    return recorder;
+}
+
+std::unique_ptr<LoaderLogRecorder> MakeAsyncStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                                    XrLoaderLogMessageTypeFlags types, bool block_when_full) {
+    std::unique_ptr<LoaderLogRecorder> recorder(
+        new AsyncOstreamLoaderLogRecorder(std::cout, user_data, flags, types, block_when_full));
+    return recorder;
+}
+
+std::unique_ptr<LoaderLogRecorder> MakeBinaryFileLoaderLogRecorder(void* user_data, const std::string& filename,
+                                                                   XrLoaderLogMessageSeverityFlags flags,
+                                                                   XrLoaderLogMessageTypeFlags types) {
+    std::unique_ptr<BinaryFileLoaderLogRecorder> recorder(new BinaryFileLoaderLogRecorder(user_data, flags, types));
+    if (!recorder->Open(filename)) {
+        return nullptr;
+    }
+    return std::unique_ptr<LoaderLogRecorder>(recorder.release());
+}
+
 std::unique_ptr<LoaderLogRecorder> MakeDebugUtilsLoaderLogRecorder(const XrDebugUtilsMessengerCreateInfoEXT* create_info,
                                                                    XrDebugUtilsMessengerEXT debug_messenger) {
     std::unique_ptr<LoaderLogRecorder> recorder(new DebugUtilsLogRecorder(create_info, debug_messenger));
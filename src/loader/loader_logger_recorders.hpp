@@ -26,12 +26,31 @@
 #include <openxr/openxr.h>
 
 #include <memory>
+#include <string>
+
+// Environment variable naming a file to receive the log in binary form, see loader_binary_log.h, instead of as
+// text on std::cout.
+#define OPENXR_BINARY_LOG_FILE_ENV_VAR "XR_LOADER_BINARY_LOG_FILE"
 
 //! Standard Error logger, on by default. Disabled with environment variable XR_LOADER_DEBUG = "none".
 std::unique_ptr<LoaderLogRecorder> MakeStdErrLoaderLogRecorder(void* user_data);
 
 //! Standard Output logger used with XR_LOADER_DEBUG environment variable.
-std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags);
+std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                               XrLoaderLogMessageTypeFlags types);
+
+//! Standard Error logger that writes from a background thread, used with the XR_LOADER_DEBUG "async" options.
+//! If block_when_full is false, messages logged while its queue is full are dropped and counted.
+std::unique_ptr<LoaderLogRecorder> MakeAsyncStdErrLoaderLogRecorder(void* user_data, bool block_when_full);
+
+//! Standard Output logger that writes from a background thread, used with the XR_LOADER_DEBUG "async" options.
+std::unique_ptr<LoaderLogRecorder> MakeAsyncStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                                    XrLoaderLogMessageTypeFlags types, bool block_when_full);
+
+//! Binary file logger used with XR_LOADER_BINARY_LOG_FILE.  Returns nullptr if the file cannot be created.
+std::unique_ptr<LoaderLogRecorder> MakeBinaryFileLoaderLogRecorder(void* user_data, const std::string& filename,
+                                                                   XrLoaderLogMessageSeverityFlags flags,
+                                                                   XrLoaderLogMessageTypeFlags types);
 
 // Debug Utils logger used with XR_EXT_debug_utils
 std::unique_ptr<LoaderLogRecorder> MakeDebugUtilsLoaderLogRecorder(const XrDebugUtilsMessengerCreateInfoEXT* create_info,
@@ -43,5 +62,4 @@ std::unique_ptr<LoaderLogRecorder> MakeDebuggerLoaderLogRecorder(void* user_data
 #endif
 
 // TODO: Add other Derived classes:
-//  - FileLoaderLogRecorder     - During/after xrCreateInstance
 //  - PipeLoaderLogRecorder?    - During/after xrCreateInstance
@@ -0,0 +1,229 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "loader_timing.hpp"
+
+#ifdef OPENXR_HAVE_COMMON_CONFIG
+#include "common_config.h"
+#endif  // OPENXR_HAVE_COMMON_CONFIG
+
+#include "loader_logger.hpp"
+#include "platform_utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif  // _WIN32
+
+namespace {
+
+struct TimingSpan {
+    std::string command_name;
+    std::string phase_name;
+    std::string detail;
+    uint32_t thread_id;
+    // Microseconds since the first span started, and how long the span took.
+    double start_us;
+    double duration_us;
+};
+
+// Spans recorded so far, written out as a Chrome trace event file.  Spans are kept only until they are appended to the
+// file, each time a span that is not nested in another one on the same thread finishes.  The file is kept open, and
+// the closing brackets are written after the last span each time and then written over, so that the file always
+// holds a complete trace of every span recorded so far.
+class TimingTrace {
+   public:
+    static TimingTrace& GetInstance() {
+        static TimingTrace instance;
+        return instance;
+    }
+
+    std::chrono::steady_clock::time_point Origin() const { return _origin; }
+
+    void AddSpan(TimingSpan&& span, bool write_file) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending_spans.push_back(std::move(span));
+        if (write_file) {
+            Write();
+        }
+    }
+
+   private:
+    TimingTrace() : _origin(std::chrono::steady_clock::now()) {}
+
+    static void AppendJsonString(std::ostringstream& out, const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            switch (c) {
+                case '"':
+                    out << "\\\"";
+                    break;
+                case '\\':
+                    out << "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                    } else {
+                        out << c;
+                    }
+                    break;
+            }
+        }
+        out << '"';
+    }
+
+    static uint64_t ProcessId() {
+#ifdef _WIN32
+        return static_cast<uint64_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint64_t>(getpid());
+#endif  // _WIN32
+    }
+
+    // Called with _mutex held.
+    void Write() {
+        if (!_opened) {
+            _opened = true;
+            _filename = PlatformUtilsGetEnv(OPENXR_TIMING_FILE_ENV_VAR);
+            if (_filename.empty()) {
+                _filename = OPENXR_DEFAULT_TIMING_FILE;
+            }
+            _trace_stream.open(_filename, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+            _trace_stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+            _end_of_spans = _trace_stream.tellp();
+        }
+        if (!_trace_stream.good()) {
+            if (!_reported_write_failure) {
+                _reported_write_failure = true;
+                LoaderLogger::LogWarningMessage("", "LoaderTimingScope failed to write timing trace file " + _filename);
+            }
+            _pending_spans.clear();
+            return;
+        }
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        const uint64_t process_id = ProcessId();
+        for (const TimingSpan& span : _pending_spans) {
+            out << (_wrote_span ? ",\n" : "") << "{\"name\": ";
+            _wrote_span = true;
+            AppendJsonString(out, span.phase_name);
+            out << ", \"cat\": \"loader\", \"ph\": \"X\", \"ts\": " << span.start_us << ", \"dur\": " << span.duration_us
+                << ", \"pid\": " << process_id << ", \"tid\": " << span.thread_id << ", \"args\": {\"command\": ";
+            AppendJsonString(out, span.command_name);
+            if (!span.detail.empty()) {
+                out << ", \"detail\": ";
+                AppendJsonString(out, span.detail);
+            }
+            out << "}}";
+        }
+        _pending_spans.clear();
+
+        // Write the new spans over the closing brackets, and close the trace again after them.
+        _trace_stream.seekp(_end_of_spans);
+        _trace_stream << out.str();
+        _end_of_spans = _trace_stream.tellp();
+        _trace_stream << "\n]}\n";
+        _trace_stream.flush();
+    }
+
+    std::mutex _mutex;
+    const std::chrono::steady_clock::time_point _origin;
+    // Spans finished since the trace file was last written.
+    std::vector<TimingSpan> _pending_spans;
+    bool _opened = false;
+    bool _wrote_span = false;
+    bool _reported_write_failure = false;
+    std::string _filename;
+    std::ofstream _trace_stream;
+    std::ofstream::pos_type _end_of_spans;
+};
+
+// Small, stable numbers for threads in the trace.
+uint32_t CurrentTimingThreadId() {
+    static std::atomic<uint32_t> next_thread_id(1);
+    static thread_local uint32_t thread_id = next_thread_id++;
+    return thread_id;
+}
+
+// Spans currently open on this thread; only the outermost one writes the trace file when it finishes.
+thread_local uint32_t g_open_span_depth = 0;
+
+}  // namespace
+
+LoaderTimingScope::LoaderTimingScope(const char* command_name, const char* phase_name)
+    : _enabled(Enabled()), _command_name(command_name), _phase_name(phase_name) {
+    if (_enabled) {
+        ++g_open_span_depth;
+        // Make sure the trace's time origin is no later than the first span.
+        TimingTrace::GetInstance();
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+LoaderTimingScope::LoaderTimingScope(const char* command_name, const char* phase_name, const std::string& detail)
+    : LoaderTimingScope(command_name, phase_name) {
+    if (_enabled) {
+        _detail = detail;
+    }
+}
+
+LoaderTimingScope::~LoaderTimingScope() {
+    if (!_enabled) {
+        return;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const bool outermost = --g_open_span_depth == 0;
+    TimingTrace& trace = TimingTrace::GetInstance();
+
+    TimingSpan span;
+    span.command_name = _command_name;
+    span.phase_name = _phase_name;
+    span.detail = std::move(_detail);
+    span.thread_id = CurrentTimingThreadId();
+    span.start_us = std::chrono::duration<double, std::micro>(_start - trace.Origin()).count();
+    span.duration_us = std::chrono::duration<double, std::micro>(end - _start).count();
+
+    std::ostringstream message;
+    message << span.phase_name;
+    if (!span.detail.empty()) {
+        message << " (" << span.detail << ")";
+    }
+    message << " took " << std::fixed << std::setprecision(3) << span.duration_us / 1000.0 << " ms";
+    LoaderLogger::LogPerformanceMessage(span.command_name, message.str());
+
+    trace.AddSpan(std::move(span), outermost);
+}
+
+bool LoaderTimingScope::Enabled() {
+    static const bool enabled = HasLoaderDebugOption(PlatformUtilsGetEnv("XR_LOADER_DEBUG"), OPENXR_LOADER_DEBUG_TIMING);
+    return enabled;
+}
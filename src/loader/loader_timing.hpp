@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Value of XR_LOADER_DEBUG that turns on timing of the loader's startup phases.
+#define OPENXR_LOADER_DEBUG_TIMING "timing"
+
+// Environment variable naming the Chrome trace event file written in timing mode.
+#define OPENXR_TIMING_FILE_ENV_VAR "XR_LOADER_TIMING_FILE"
+
+// Default trace event file, in the current directory.
+#define OPENXR_DEFAULT_TIMING_FILE "openxr_loader_trace.json"
+
+// Times one phase of loader work, such as manifest discovery or loading a library, from construction until
+// destruction.  This does nothing unless XR_LOADER_DEBUG is set to "timing".  In that mode, each finished span
+// is logged as a performance message and added to a Chrome trace event file, which can be opened in
+// chrome://tracing or Perfetto.  Spans are appended to the file each time a span that is not nested in another one
+// on the same thread finishes, so it always holds every span recorded so far.
+class LoaderTimingScope {
+   public:
+    LoaderTimingScope(const char* command_name, const char* phase_name);
+    LoaderTimingScope(const char* command_name, const char* phase_name, const std::string& detail);
+    ~LoaderTimingScope();
+
+    // Whether XR_LOADER_DEBUG asked for timing when it was first checked.  Like the rest of the loader's logging
+    // settings, it is read once per process.
+    static bool Enabled();
+
+    // Non-copyable
+    LoaderTimingScope(const LoaderTimingScope&) = delete;
+    LoaderTimingScope& operator=(const LoaderTimingScope&) = delete;
+
+   private:
+    bool _enabled;
+    const char* _command_name;
+    const char* _phase_name;
+    std::string _detail;
+    std::chrono::steady_clock::time_point _start;
+};
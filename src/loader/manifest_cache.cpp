@@ -0,0 +1,485 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "manifest_cache.hpp"
+
+#ifdef OPENXR_HAVE_COMMON_CONFIG
+#include "common_config.h"
+#endif  // OPENXR_HAVE_COMMON_CONFIG
+
+#include "loader_logger.hpp"
+#include "manifest_parser.hpp"
+#include "platform_utils.hpp"
+
+#include <json/json.h>
+#include <openxr/openxr.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#ifdef XR_OS_LINUX
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif  // XR_OS_LINUX
+
+ManifestCache &ManifestCache::GetInstance() {
+    static ManifestCache instance;
+    return instance;
+}
+
+#ifdef XR_OS_LINUX
+
+// Bump this whenever the layout of the cache file changes, so older caches are ignored.
+static const uint32_t kManifestCacheFormatVersion = 1;
+static const char kManifestCacheMagic[4] = {'X', 'R', 'M', 'C'};
+// Deeper nesting than this is treated as a corrupt cache rather than recursed into.
+static const uint32_t kMaxEncodedDepth = 256;
+
+enum EncodedValueType : uint8_t {
+    ENCODED_NULL = 0,
+    ENCODED_INT,
+    ENCODED_UINT,
+    ENCODED_REAL,
+    ENCODED_STRING,
+    ENCODED_BOOLEAN,
+    ENCODED_ARRAY,
+    ENCODED_OBJECT,
+};
+
+template <typename T>
+static void AppendRaw(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void AppendString(std::string &out, const std::string &value) {
+    AppendRaw(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+static void EncodeValue(const Json::Value &value, std::string &out) {
+    switch (value.type()) {
+        case Json::intValue:
+            AppendRaw(out, ENCODED_INT);
+            AppendRaw(out, static_cast<int64_t>(value.asLargestInt()));
+            break;
+        case Json::uintValue:
+            AppendRaw(out, ENCODED_UINT);
+            AppendRaw(out, static_cast<uint64_t>(value.asLargestUInt()));
+            break;
+        case Json::realValue:
+            AppendRaw(out, ENCODED_REAL);
+            AppendRaw(out, value.asDouble());
+            break;
+        case Json::stringValue:
+            AppendRaw(out, ENCODED_STRING);
+            AppendString(out, value.asString());
+            break;
+        case Json::booleanValue:
+            AppendRaw(out, ENCODED_BOOLEAN);
+            AppendRaw(out, static_cast<uint8_t>(value.asBool() ? 1 : 0));
+            break;
+        case Json::arrayValue:
+            AppendRaw(out, ENCODED_ARRAY);
+            AppendRaw(out, static_cast<uint32_t>(value.size()));
+            for (const Json::Value &element : value) {
+                EncodeValue(element, out);
+            }
+            break;
+        case Json::objectValue:
+            AppendRaw(out, ENCODED_OBJECT);
+            AppendRaw(out, static_cast<uint32_t>(value.size()));
+            for (Json::ValueConstIterator it = value.begin(); it != value.end(); ++it) {
+                AppendString(out, it.name());
+                EncodeValue(*it, out);
+            }
+            break;
+        case Json::nullValue:
+        default:
+            AppendRaw(out, ENCODED_NULL);
+            break;
+    }
+}
+
+// Bounds-checked reader over the contents of the cache file.  Any out of range read marks the whole
+// reader as failed, and the cache is then discarded.
+class CacheReader {
+   public:
+    CacheReader(const char *data, size_t size) : _cur(data), _end(data + size) {}
+
+    bool Ok() const { return _ok; }
+    bool AtEnd() const { return _cur == _end; }
+
+    template <typename T>
+    T ReadRaw() {
+        T value{};
+        if (!_ok || static_cast<size_t>(_end - _cur) < sizeof(T)) {
+            _ok = false;
+            return value;
+        }
+        memcpy(&value, _cur, sizeof(T));
+        _cur += sizeof(T);
+        return value;
+    }
+
+    std::string ReadString() {
+        const uint32_t length = ReadRaw<uint32_t>();
+        if (!_ok || static_cast<size_t>(_end - _cur) < length) {
+            _ok = false;
+            return {};
+        }
+        std::string value(_cur, length);
+        _cur += length;
+        return value;
+    }
+
+    // Return the encoded bytes of the next value without decoding it.
+    std::string SkipValue() {
+        const char *start = _cur;
+        DecodeValue(nullptr, 0);
+        return _ok ? std::string(start, _cur) : std::string();
+    }
+
+    // Decode the next value into out, or just step over it if out is null.
+    void DecodeValue(Json::Value *out, uint32_t depth) {
+        if (depth > kMaxEncodedDepth) {
+            _ok = false;
+            return;
+        }
+        const uint8_t type = ReadRaw<uint8_t>();
+        if (!_ok) {
+            return;
+        }
+        switch (type) {
+            case ENCODED_NULL:
+                if (out != nullptr) {
+                    *out = Json::nullValue;
+                }
+                break;
+            case ENCODED_INT: {
+                const int64_t value = ReadRaw<int64_t>();
+                if (out != nullptr) {
+                    *out = Json::Value(static_cast<Json::LargestInt>(value));
+                }
+                break;
+            }
+            case ENCODED_UINT: {
+                const uint64_t value = ReadRaw<uint64_t>();
+                if (out != nullptr) {
+                    *out = Json::Value(static_cast<Json::LargestUInt>(value));
+                }
+                break;
+            }
+            case ENCODED_REAL: {
+                const double value = ReadRaw<double>();
+                if (out != nullptr) {
+                    *out = Json::Value(value);
+                }
+                break;
+            }
+            case ENCODED_STRING: {
+                std::string value = ReadString();
+                if (out != nullptr) {
+                    *out = Json::Value(value);
+                }
+                break;
+            }
+            case ENCODED_BOOLEAN: {
+                const uint8_t value = ReadRaw<uint8_t>();
+                if (out != nullptr) {
+                    *out = Json::Value(value != 0);
+                }
+                break;
+            }
+            case ENCODED_ARRAY: {
+                const uint32_t count = ReadRaw<uint32_t>();
+                if (out != nullptr) {
+                    *out = Json::Value(Json::arrayValue);
+                }
+                for (uint32_t index = 0; index < count && _ok; ++index) {
+                    DecodeValue(out != nullptr ? &out->append(Json::nullValue) : nullptr, depth + 1);
+                }
+                break;
+            }
+            case ENCODED_OBJECT: {
+                const uint32_t count = ReadRaw<uint32_t>();
+                if (out != nullptr) {
+                    *out = Json::Value(Json::objectValue);
+                }
+                for (uint32_t index = 0; index < count && _ok; ++index) {
+                    std::string key = ReadString();
+                    DecodeValue(out != nullptr ? &(*out)[key] : nullptr, depth + 1);
+                }
+                break;
+            }
+            default:
+                _ok = false;
+                break;
+        }
+    }
+
+   private:
+    const char *_cur;
+    const char *_end;
+    bool _ok = true;
+};
+
+// Get the modification time and size of a file, or zeros if it does not exist.
+static void GetFileStamp(const std::string &filename, uint64_t &modification_time, uint64_t &size) {
+    struct stat file_stat = {};
+    if (stat(filename.c_str(), &file_stat) != 0) {
+        modification_time = 0;
+        size = 0;
+        return;
+    }
+    modification_time = static_cast<uint64_t>(file_stat.st_mtim.tv_sec) * 1000000000ULL +
+                        static_cast<uint64_t>(file_stat.st_mtim.tv_nsec);
+    size = static_cast<uint64_t>(file_stat.st_size);
+}
+
+// Resolve the canonical path of a file along with the modification time and size it is cached under.
+static bool GetCacheKey(const std::string &filename, std::string &canonical_path, uint64_t &modification_time,
+                        uint64_t &size) {
+    char resolved[PATH_MAX];
+    if (realpath(filename.c_str(), resolved) == nullptr) {
+        return false;
+    }
+    struct stat file_stat = {};
+    if (stat(resolved, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        return false;
+    }
+    canonical_path = resolved;
+    modification_time = static_cast<uint64_t>(file_stat.st_mtim.tv_sec) * 1000000000ULL +
+                        static_cast<uint64_t>(file_stat.st_mtim.tv_nsec);
+    size = static_cast<uint64_t>(file_stat.st_size);
+    return true;
+}
+
+// Determine where the cache file lives, following the XDG base directory specification.
+static std::string GetCacheFilename() {
+    std::string cache_home = PlatformUtilsGetSecureEnv("XDG_CACHE_HOME");
+    if (cache_home.empty()) {
+        cache_home = PlatformUtilsGetSecureEnv("HOME");
+        if (cache_home.empty()) {
+            return {};
+        }
+        cache_home += "/.cache";
+    }
+    return cache_home + "/" + OPENXR_RELATIVE_PATH + std::to_string(XR_VERSION_MAJOR(XR_CURRENT_API_VERSION)) +
+           "/loader_manifest_cache.bin";
+}
+
+// Create every missing directory leading up to the given file.
+static bool CreateParentDirectories(const std::string &filename) {
+    size_t separator = filename.find('/', 1);
+    while (separator != std::string::npos) {
+        const std::string directory = filename.substr(0, separator);
+        if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+            return false;
+        }
+        separator = filename.find('/', separator + 1);
+    }
+    return true;
+}
+
+void ManifestCache::BeginDiscovery() {
+    const bool enabled = !PlatformUtilsGetEnvSet(OPENXR_DISABLE_MANIFEST_CACHE_ENV_VAR);
+    _enabled.store(enabled);
+    if (enabled) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Load();
+    }
+}
+
+void ManifestCache::Load() {
+    std::string cache_filename = GetCacheFilename();
+    uint64_t modification_time = 0;
+    uint64_t size = 0;
+    if (!cache_filename.empty()) {
+        GetFileStamp(cache_filename, modification_time, size);
+    }
+    if (_loaded && cache_filename == _cache_filename && modification_time == _cache_file_modification_time &&
+        size == _cache_file_size) {
+        return;
+    }
+    _loaded = true;
+    _dirty = false;
+    _entries.clear();
+    _cache_filename = std::move(cache_filename);
+    _cache_file_modification_time = modification_time;
+    _cache_file_size = size;
+    if (_cache_filename.empty()) {
+        return;
+    }
+
+    std::ifstream cache_stream(_cache_filename, std::ifstream::in | std::ifstream::binary);
+    if (!cache_stream.is_open()) {
+        return;
+    }
+    const std::string contents((std::istreambuf_iterator<char>(cache_stream)), std::istreambuf_iterator<char>());
+
+    CacheReader reader(contents.data(), contents.size());
+    char magic[sizeof(kManifestCacheMagic)];
+    for (char &magic_char : magic) {
+        magic_char = reader.ReadRaw<char>();
+    }
+    const uint32_t version = reader.ReadRaw<uint32_t>();
+    const uint32_t count = reader.ReadRaw<uint32_t>();
+    if (!reader.Ok() || memcmp(magic, kManifestCacheMagic, sizeof(magic)) != 0 || version != kManifestCacheFormatVersion) {
+        LoaderLogger::LogInfoMessage("", "ManifestCache::Load - ignoring out of date manifest cache " + _cache_filename);
+        return;
+    }
+    for (uint32_t index = 0; index < count && reader.Ok(); ++index) {
+        std::string path = reader.ReadString();
+        Entry entry = {};
+        entry.modification_time = reader.ReadRaw<uint64_t>();
+        entry.size = reader.ReadRaw<uint64_t>();
+        entry.encoded_root = std::make_shared<const std::string>(reader.SkipValue());
+        entry.used = false;
+        _entries[std::move(path)] = std::move(entry);
+    }
+    if (!reader.Ok() || !reader.AtEnd()) {
+        LoaderLogger::LogWarningMessage("", "ManifestCache::Load - discarding corrupt manifest cache " + _cache_filename);
+        _entries.clear();
+        // Rewrite the cache on the next save, even if nothing new is added.
+        _dirty = true;
+    }
+}
+
+ManifestReadResult ManifestCache::ReadManifest(const std::string &filename, Json::Value &root_node, std::string &errors) {
+    std::string canonical_path;
+    uint64_t modification_time = 0;
+    uint64_t size = 0;
+    if (!_enabled.load() || !GetCacheKey(filename, canonical_path, modification_time, size)) {
+        return ReadManifestFile(filename, root_node, errors);
+    }
+
+    std::shared_ptr<const std::string> encoded_root;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _entries.find(canonical_path);
+        if (found != _entries.end() && found->second.modification_time == modification_time && found->second.size == size) {
+            found->second.used = true;
+            encoded_root = found->second.encoded_root;
+        }
+    }
+    if (encoded_root) {
+        CacheReader reader(encoded_root->data(), encoded_root->size());
+        reader.DecodeValue(&root_node, 0);
+        if (reader.Ok() && reader.AtEnd()) {
+            return MANIFEST_READ_SUCCESS;
+        }
+        root_node = Json::nullValue;
+    }
+
+    // Parse outside of the lock, and only cache manifests that parsed successfully.  This also replaces an entry
+    // that failed to decode.
+    ManifestReadResult result = ReadManifestFile(filename, root_node, errors);
+    if (result == MANIFEST_READ_SUCCESS) {
+        std::string encoded;
+        EncodeValue(root_node, encoded);
+        Entry entry = {};
+        entry.modification_time = modification_time;
+        entry.size = size;
+        entry.encoded_root = std::make_shared<const std::string>(std::move(encoded));
+        entry.used = true;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries[canonical_path] = std::move(entry);
+        _dirty = true;
+    }
+    return result;
+}
+
+void ManifestCache::Save() {
+    if (!_enabled.load()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_dirty || _cache_filename.empty()) {
+        return;
+    }
+    _dirty = false;
+
+    std::string contents;
+    contents.append(kManifestCacheMagic, sizeof(kManifestCacheMagic));
+    AppendRaw(contents, kManifestCacheFormatVersion);
+    const size_t count_offset = contents.size();
+    AppendRaw(contents, static_cast<uint32_t>(0));
+
+    uint32_t count = 0;
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        // Drop entries for manifests that have since been removed, so the cache does not grow without bound.
+        struct stat file_stat = {};
+        if (!it->second.used && stat(it->first.c_str(), &file_stat) != 0) {
+            it = _entries.erase(it);
+            continue;
+        }
+        AppendString(contents, it->first);
+        AppendRaw(contents, it->second.modification_time);
+        AppendRaw(contents, it->second.size);
+        contents.append(*it->second.encoded_root);
+        ++count;
+        ++it;
+    }
+    memcpy(&contents[count_offset], &count, sizeof(count));
+
+    // Write a temporary file and rename it over the cache, so other processes never see a partial cache.
+    if (!CreateParentDirectories(_cache_filename)) {
+        LoaderLogger::LogInfoMessage("", "ManifestCache::Save - unable to create directory for " + _cache_filename);
+        return;
+    }
+    const std::string temp_filename = _cache_filename + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream cache_stream(temp_filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        cache_stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!cache_stream.good()) {
+            cache_stream.close();
+            remove(temp_filename.c_str());
+            LoaderLogger::LogInfoMessage("", "ManifestCache::Save - unable to write " + temp_filename);
+            return;
+        }
+    }
+    if (rename(temp_filename.c_str(), _cache_filename.c_str()) != 0) {
+        remove(temp_filename.c_str());
+        LoaderLogger::LogInfoMessage("", "ManifestCache::Save - unable to replace " + _cache_filename);
+        return;
+    }
+    GetFileStamp(_cache_filename, _cache_file_modification_time, _cache_file_size);
+}
+
+#else  // !XR_OS_LINUX
+
+void ManifestCache::BeginDiscovery() {}
+
+ManifestReadResult ManifestCache::ReadManifest(const std::string &filename, Json::Value &root_node, std::string &errors) {
+    return ReadManifestFile(filename, root_node, errors);
+}
+
+void ManifestCache::Save() {}
+
+#endif  // XR_OS_LINUX
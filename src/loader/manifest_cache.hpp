@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Json {
+class Value;
+}
+
+// Environment variable that turns off the manifest cache when set.
+#define OPENXR_DISABLE_MANIFEST_CACHE_ENV_VAR "XR_LOADER_DISABLE_MANIFEST_CACHE"
+
+enum ManifestReadResult {
+    MANIFEST_READ_SUCCESS = 0,
+    MANIFEST_READ_OPEN_FAILED,
+    MANIFEST_READ_PARSE_FAILED,
+};
+
+// ManifestCache class -
+// Keeps the parsed contents of manifest files, keyed by canonical path, modification time and size, in a
+// file under $XDG_CACHE_HOME.  Manifests that have not changed since they were cached are neither read
+// nor parsed again, which matters on systems with many installed API layers.
+//
+// The cache is only kept on Linux; elsewhere every manifest is read and parsed as before.
+class ManifestCache {
+   public:
+    static ManifestCache &GetInstance();
+
+    // Check whether the cache is turned on and whether the cache file changed on disk, reloading it if so.  Called
+    // once at the start of each search for manifest files, before any of them are read.
+    void BeginDiscovery();
+
+    // Get the parsed JSON contents of a manifest file.  On a parse failure, errors holds jsoncpp's message.  Safe to
+    // call from several threads at once: the cache is only locked to look up and add entries, not to decode or parse.
+    ManifestReadResult ReadManifest(const std::string &filename, Json::Value &root_node, std::string &errors);
+
+    // Write the cache back to disk if anything was added to it since it was loaded.
+    void Save();
+
+    // Non-copyable
+    ManifestCache(const ManifestCache &) = delete;
+    ManifestCache &operator=(const ManifestCache &) = delete;
+
+   private:
+    struct Entry {
+        uint64_t modification_time;
+        uint64_t size;
+        // Manifest contents in the cache's binary encoding of a Json::Value.  Shared, so that it can be decoded
+        // without holding the lock while another thread reloads the cache.
+        std::shared_ptr<const std::string> encoded_root;
+        // Whether this entry was looked up or added by this process.
+        bool used;
+    };
+
+    ManifestCache() = default;
+    void Load();
+
+    // Set by BeginDiscovery from the environment.
+    std::atomic<bool> _enabled{false};
+    std::mutex _mutex;
+    bool _loaded = false;
+    bool _dirty = false;
+    std::string _cache_filename;
+    // Modification time and size of the cache file when it was last loaded or saved, to notice other processes updating it.
+    uint64_t _cache_file_modification_time = 0;
+    uint64_t _cache_file_size = 0;
+    std::unordered_map<std::string, Entry> _entries;
+};
@@ -0,0 +1,182 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "manifest_directory_scanner.hpp"
+
+#ifdef OPENXR_HAVE_COMMON_CONFIG
+#include "common_config.h"
+#endif  // OPENXR_HAVE_COMMON_CONFIG
+
+#include "filesystem_utils.hpp"
+
+#include <openxr/openxr.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef XR_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#endif  // XR_OS_LINUX
+
+ManifestDirectoryScanner &ManifestDirectoryScanner::GetInstance() {
+    static ManifestDirectoryScanner instance;
+    return instance;
+}
+
+static bool NameEndsWith(const char *name, size_t name_length, const std::string &suffix) {
+    return name_length >= suffix.size() && memcmp(name + name_length - suffix.size(), suffix.data(), suffix.size()) == 0;
+}
+
+static void AddFoundFile(std::string path, std::unordered_set<std::string> &found, std::vector<std::string> &files) {
+    if (found.insert(path).second) {
+        files.push_back(std::move(path));
+    }
+}
+
+#ifdef XR_OS_LINUX
+
+// Nanoseconds since the epoch.
+static uint64_t ToNanoseconds(const struct timespec &time) {
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + static_cast<uint64_t>(time.tv_nsec);
+}
+
+// A directory changed this recently may change again without its modification time moving on, on file systems with
+// coarse timestamps, so its listing is not kept.
+static const uint64_t kUnsettledNanoseconds = 2000000000ULL;
+
+void ManifestDirectoryScanner::FindFiles(const std::string &directory, const std::string &suffix,
+                                         std::unordered_set<std::string> &found, std::vector<std::string> &files) {
+    char resolved[PATH_MAX];
+    if (realpath(directory.c_str(), resolved) == nullptr) {
+        return;
+    }
+    const int directory_fd = open(resolved, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory_fd < 0) {
+        return;
+    }
+    struct stat directory_stat = {};
+    if (fstat(directory_fd, &directory_stat) != 0) {
+        close(directory_fd);
+        return;
+    }
+
+    Listing listing;
+    listing.device = static_cast<uint64_t>(directory_stat.st_dev);
+    listing.inode = static_cast<uint64_t>(directory_stat.st_ino);
+    listing.modification_time = ToNanoseconds(directory_stat.st_mtim);
+    listing.suffix = suffix;
+    const std::string canonical_directory = resolved;
+
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _listings.find(canonical_directory);
+        if (it != _listings.end() && it->second.device == listing.device && it->second.inode == listing.inode &&
+            it->second.modification_time == listing.modification_time && it->second.suffix == suffix) {
+            listing = it->second;
+            cached = true;
+        }
+    }
+
+    if (cached) {
+        close(directory_fd);
+    } else {
+        DIR *dir = fdopendir(directory_fd);
+        if (dir == nullptr) {
+            close(directory_fd);
+            return;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            const size_t name_length = strlen(entry->d_name);
+            if (!NameEndsWith(entry->d_name, name_length, suffix)) {
+                continue;
+            }
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                // Not every file system fills in d_type.
+                struct stat entry_stat = {};
+                if (fstatat(dirfd(dir), entry->d_name, &entry_stat, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                type = S_ISREG(entry_stat.st_mode) ? DT_REG : (S_ISLNK(entry_stat.st_mode) ? DT_LNK : DT_UNKNOWN);
+            }
+            if (type == DT_REG) {
+                listing.regular_files.emplace_back(entry->d_name, name_length);
+            } else if (type == DT_LNK) {
+                listing.links.emplace_back(entry->d_name, name_length);
+            }
+        }
+        closedir(dir);
+
+        struct timespec now = {};
+        clock_gettime(CLOCK_REALTIME, &now);
+        if (listing.modification_time + kUnsettledNanoseconds < ToNanoseconds(now)) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _listings[canonical_directory] = listing;
+        }
+    }
+
+    std::string prefix = canonical_directory;
+    if (prefix.back() != '/') {
+        prefix += '/';
+    }
+    for (const std::string &name : listing.regular_files) {
+        AddFoundFile(prefix + name, found, files);
+    }
+    for (const std::string &name : listing.links) {
+        char target[PATH_MAX];
+        struct stat target_stat = {};
+        if (realpath((prefix + name).c_str(), target) != nullptr && stat(target, &target_stat) == 0 &&
+            S_ISREG(target_stat.st_mode)) {
+            AddFoundFile(target, found, files);
+        }
+    }
+}
+
+#else  // !XR_OS_LINUX
+
+void ManifestDirectoryScanner::FindFiles(const std::string &directory, const std::string &suffix,
+                                         std::unordered_set<std::string> &found, std::vector<std::string> &files) {
+    std::vector<std::string> names;
+    if (!FileSysUtilsFindFilesInPath(directory, names)) {
+        return;
+    }
+    for (const std::string &name : names) {
+        std::string relative_path;
+        std::string absolute_path;
+        if (!NameEndsWith(name.c_str(), name.size(), suffix) || !FileSysUtilsCombinePaths(directory, name, relative_path) ||
+            !FileSysUtilsGetAbsolutePath(relative_path, absolute_path)) {
+            continue;
+        }
+        AddFoundFile(std::move(absolute_path), found, files);
+    }
+}
+
+#endif  // XR_OS_LINUX
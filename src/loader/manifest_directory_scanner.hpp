@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ManifestDirectoryScanner class -
+// Lists the manifest files in the directories of the manifest search paths.  On Linux each directory is read
+// through a single file descriptor: entries are filtered by name and d_type, only symbolic links and entries of
+// unknown type are stat'ed, relative to that descriptor, and paths are built from the directory's canonical path
+// rather than resolved one file at a time.  The names found are kept with the directory's modification time, so
+// a directory that has not changed since it was last read is not read again by this process.
+//
+// Elsewhere every directory is listed and the absolute path of each file looked up, as before.
+class ManifestDirectoryScanner {
+   public:
+    static ManifestDirectoryScanner &GetInstance();
+
+    // Append the canonical path of each regular file in directory whose name ends with suffix to files, unless
+    // that path is already in found.  Paths appended are added to found.
+    void FindFiles(const std::string &directory, const std::string &suffix, std::unordered_set<std::string> &found,
+                   std::vector<std::string> &files);
+
+    // Non-copyable
+    ManifestDirectoryScanner(const ManifestDirectoryScanner &) = delete;
+    ManifestDirectoryScanner &operator=(const ManifestDirectoryScanner &) = delete;
+
+   private:
+    struct Listing {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t modification_time;
+        std::string suffix;
+        // Names of the matching regular files, and of the symbolic links, which are resolved on every scan since
+        // what they point to can change without the directory changing.
+        std::vector<std::string> regular_files;
+        std::vector<std::string> links;
+    };
+
+    ManifestDirectoryScanner() = default;
+
+    std::mutex _mutex;
+    // Keyed by the canonical path of the directory.
+    std::unordered_map<std::string, Listing> _listings;
+};
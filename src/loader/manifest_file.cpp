@@ -34,20 +34,25 @@
 #include "loader_platform.hpp"
 #include "platform_utils.hpp"
 #include "loader_logger.hpp"
+#include "manifest_cache.hpp"
+#include "manifest_directory_scanner.hpp"
 
 #include <json/json.h>
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
-#include <fstream>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -79,40 +84,21 @@ static inline bool StringEndsWith(const std::string &value, const std::string &e
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
 }
 
-// If the file found is a manifest file name, add it to the out_files manifest list.
-static void AddIfJson(const std::string &full_file, std::vector<std::string> &manifest_files) {
-    if (full_file.empty() || !StringEndsWith(full_file, ".json")) {
-        return;
-    }
-    manifest_files.push_back(full_file);
-}
-
 // Check the current path for any manifest files.  If the provided search_path is a directory, look for
 // all included JSON files in that directory.  Otherwise, just check the provided search_path which should
-// be a single filename.
-static void CheckAllFilesInThePath(const std::string &search_path, bool is_directory_list,
+// be a single filename.  Files already in found, the canonical paths of those found so far, are skipped.
+static void CheckAllFilesInThePath(const std::string &search_path, bool is_directory_list, std::unordered_set<std::string> &found,
                                    std::vector<std::string> &manifest_files) {
-    if (FileSysUtilsPathExists(search_path)) {
-        std::string absolute_path;
-        if (!is_directory_list) {
-            // If the file exists, try to add it
-            if (FileSysUtilsIsRegularFile(search_path)) {
-                FileSysUtilsGetAbsolutePath(search_path, absolute_path);
-                AddIfJson(absolute_path, manifest_files);
-            }
-        } else {
-            std::vector<std::string> files;
-            if (FileSysUtilsFindFilesInPath(search_path, files)) {
-                for (std::string &cur_file : files) {
-                    std::string relative_path;
-                    FileSysUtilsCombinePaths(search_path, cur_file, relative_path);
-                    if (!FileSysUtilsGetAbsolutePath(relative_path, absolute_path)) {
-                        continue;
-                    }
-                    AddIfJson(absolute_path, manifest_files);
-                }
-            }
-        }
+    if (is_directory_list) {
+        ManifestDirectoryScanner::GetInstance().FindFiles(search_path, ".json", found, manifest_files);
+        return;
+    }
+    // If the file exists, try to add it
+    std::string absolute_path;
+    if (FileSysUtilsPathExists(search_path) && FileSysUtilsIsRegularFile(search_path) &&
+        FileSysUtilsGetAbsolutePath(search_path, absolute_path) && StringEndsWith(absolute_path, ".json") &&
+        found.insert(absolute_path).second) {
+        manifest_files.push_back(absolute_path);
     }
 }
 
@@ -120,6 +106,8 @@ static void CheckAllFilesInThePath(const std::string &search_path, bool is_direc
 // is made up of directory listings (versus direct manifest file names) search each path for
 // any manifest files.
 static void AddFilesInPath(const std::string &search_path, bool is_directory_list, std::vector<std::string> &manifest_files) {
+    // The same manifest may be reached through more than one search path, or through links.
+    std::unordered_set<std::string> found_files(manifest_files.begin(), manifest_files.end());
     std::size_t last_found = 0;
     std::size_t found = search_path.find_first_of(PATH_SEPARATOR);
     std::string cur_search;
@@ -130,7 +118,7 @@ static void AddFilesInPath(const std::string &search_path, bool is_directory_lis
         std::size_t length = found - last_found;
         cur_search = search_path.substr(last_found, length);
 
-        CheckAllFilesInThePath(cur_search, is_directory_list, manifest_files);
+        CheckAllFilesInThePath(cur_search, is_directory_list, found_files, manifest_files);
 
         // This works around issue if multiple path separator follow each other directly.
         last_found = found;
@@ -143,7 +131,7 @@ static void AddFilesInPath(const std::string &search_path, bool is_directory_lis
     // If there's something remaining in the string, copy it over
     if (last_found < search_path.size()) {
         cur_search = search_path.substr(last_found);
-        CheckAllFilesInThePath(cur_search, is_directory_list, manifest_files);
+        CheckAllFilesInThePath(cur_search, is_directory_list, found_files, manifest_files);
     }
 }
 
@@ -533,18 +521,16 @@ void ManifestFile::ParseCommon(Json::Value const &root_node) {
 
 void RuntimeManifestFile::CreateIfValid(std::string const &filename,
                                         std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files) {
-    std::ifstream json_stream(filename, std::ifstream::in);
-
     std::ostringstream error_ss("RuntimeManifestFile::CreateIfValid ");
-    if (!json_stream.is_open()) {
+    std::string errors;
+    Json::Value root_node = Json::nullValue;
+    const ManifestReadResult read_result = ManifestCache::GetInstance().ReadManifest(filename, root_node, errors);
+    if (read_result == MANIFEST_READ_OPEN_FAILED) {
         error_ss << "failed to open " << filename << ".  Does it exist?";
         LoaderLogger::LogErrorMessage("", error_ss.str());
         return;
     }
-    Json::CharReaderBuilder builder;
-    std::string errors;
-    Json::Value root_node = Json::nullValue;
-    if (!Json::parseFromStream(builder, json_stream, &root_node, &errors) || root_node.isNull()) {
+    if (read_result != MANIFEST_READ_SUCCESS) {
         error_ss << "failed to parse " << filename << ".";
         if (!errors.empty()) {
             error_ss << " (Error message: " << errors << ")";
@@ -613,8 +599,10 @@ XrResult RuntimeManifestFile::FindManifestFiles(ManifestFileType type,
     }
     std::string filename = PlatformUtilsGetSecureEnv(OPENXR_RUNTIME_JSON_ENV_VAR);
     if (!filename.empty()) {
-        LoaderLogger::LogInfoMessage(
-            "", "RuntimeManifestFile::FindManifestFiles - using environment variable override runtime file " + filename);
+        if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+            LoaderLogger::LogInfoMessage(
+                "", "RuntimeManifestFile::FindManifestFiles - using environment variable override runtime file " + filename);
+        }
     } else {
 #ifdef XR_OS_WINDOWS
         std::vector<std::string> filenames;
@@ -644,11 +632,15 @@ XrResult RuntimeManifestFile::FindManifestFiles(ManifestFileType type,
             return XR_ERROR_FILE_ACCESS_ERROR;
         }
 #endif
-        std::string info_message = "RuntimeManifestFile::FindManifestFiles - using global runtime file ";
-        info_message += filename;
-        LoaderLogger::LogInfoMessage("", info_message);
+        if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+            std::string info_message = "RuntimeManifestFile::FindManifestFiles - using global runtime file ";
+            info_message += filename;
+            LoaderLogger::LogInfoMessage("", info_message);
+        }
     }
+    ManifestCache::GetInstance().BeginDiscovery();
     RuntimeManifestFile::CreateIfValid(filename, manifest_files);
+    ManifestCache::GetInstance().Save();
     return result;
 }
 
@@ -661,24 +653,19 @@ ApiLayerManifestFile::ApiLayerManifestFile(ManifestFileType type, const std::str
       _description(description),
       _implementation_version(implementation_version) {}
 
-void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::string &filename,
+void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::string &filename, ManifestReadResult read_result,
+                                         const Json::Value &root_node, const std::string &read_errors,
                                          std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files) {
-    std::ifstream json_stream(filename, std::ifstream::in);
-
     std::ostringstream error_ss("ApiLayerManifestFile::CreateIfValid ");
-    if (!json_stream.is_open()) {
+    if (read_result == MANIFEST_READ_OPEN_FAILED) {
         error_ss << "failed to open " << filename << ".  Does it exist?";
         LoaderLogger::LogErrorMessage("", error_ss.str());
         return;
     }
-
-    Json::CharReaderBuilder builder;
-    std::string errors;
-    Json::Value root_node = Json::nullValue;
-    if (!Json::parseFromStream(builder, json_stream, &root_node, &errors) || root_node.isNull()) {
+    if (read_result != MANIFEST_READ_SUCCESS) {
         error_ss << "failed to parse " << filename << ".";
-        if (!errors.empty()) {
-            error_ss << " (Error message: " << errors << ")";
+        if (!read_errors.empty()) {
+            error_ss << " (Error message: " << read_errors << ")";
         }
         error_ss << " Is it a valid layer manifest file?";
         LoaderLogger::LogErrorMessage("", error_ss.str());
@@ -728,8 +715,10 @@ void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::strin
 
         // Not enabled, so pretend like it isn't even there.
         if (!enabled) {
-            error_ss << "Implicit layer " << filename << " is disabled";
-            LoaderLogger::LogInfoMessage("", error_ss.str());
+            if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+                error_ss << "Implicit layer " << filename << " is disabled";
+                LoaderLogger::LogInfoMessage("", error_ss.str());
+            }
             return;
         }
     }
@@ -786,6 +775,66 @@ void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::strin
     manifest_files.back()->ParseCommon(layer_root_node);
 }
 
+// Don't bother starting a worker thread for fewer manifest files than this.
+static const size_t kMinManifestFilesPerThread = 8;
+// Upper bound on the worker threads used to read manifest files, unless overridden by the environment.
+static const uint32_t kDefaultMaxManifestThreads = 4;
+
+// Determine how many threads to read the given number of manifest files with.
+static uint32_t GetManifestReadThreadCount(size_t file_count) {
+    uint32_t max_threads = std::min(std::max(std::thread::hardware_concurrency(), 1U), kDefaultMaxManifestThreads);
+    const std::string thread_count_string = PlatformUtilsGetEnv("XR_LOADER_MANIFEST_THREADS");
+    if (!thread_count_string.empty()) {
+        max_threads = static_cast<uint32_t>(std::max(atoi(thread_count_string.c_str()), 1));
+    }
+    const size_t useful_threads = std::max(file_count / kMinManifestFilesPerThread, static_cast<size_t>(1));
+    return static_cast<uint32_t>(std::min(static_cast<size_t>(max_threads), useful_threads));
+}
+
+// Read and parse every manifest file, storing the results at the same index as the filename.
+static void ReadManifestFiles(const std::vector<std::string> &filenames, std::vector<ManifestReadResult> &read_results,
+                              std::vector<Json::Value> &root_nodes, std::vector<std::string> &read_errors) {
+    read_results.assign(filenames.size(), MANIFEST_READ_OPEN_FAILED);
+    root_nodes.assign(filenames.size(), Json::Value());
+    read_errors.assign(filenames.size(), std::string());
+
+    std::atomic<size_t> next_index(0);
+    auto read_files = [&]() {
+        for (size_t index = next_index++; index < filenames.size(); index = next_index++) {
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+                read_results[index] =
+                    ManifestCache::GetInstance().ReadManifest(filenames[index], root_nodes[index], read_errors[index]);
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            } catch (const std::exception &e) {
+                read_results[index] = MANIFEST_READ_PARSE_FAILED;
+                read_errors[index] = e.what();
+            }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+        }
+    };
+
+    // This thread reads files too, so only start the extra threads.
+    std::vector<std::thread> workers;
+    const uint32_t thread_count = GetManifestReadThreadCount(filenames.size());
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+        for (uint32_t thread = 1; thread < thread_count; ++thread) {
+            workers.emplace_back(read_files);
+        }
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    } catch (const std::system_error &) {
+        // Could not start another thread, so just use the ones that did start.
+    }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+    read_files();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
 void ApiLayerManifestFile::PopulateApiLayerProperties(XrApiLayerProperties &props) const {
     props.layerVersion = _implementation_version;
     props.specVersion = XR_MAKE_VERSION(_api_version.major, _api_version.minor, _api_version.patch);
@@ -842,16 +891,18 @@ XrResult ApiLayerManifestFile::FindManifestFiles(ManifestFileType type,
     }
 #endif
 
-    switch (type) {
-        case MANIFEST_TYPE_IMPLICIT_API_LAYER:
-        case MANIFEST_TYPE_EXPLICIT_API_LAYER:
-            for (std::string &cur_file : filenames) {
-                ApiLayerManifestFile::CreateIfValid(type, cur_file, manifest_files);
-            }
-            break;
-        default:
-            break;
-    }
+    // Reading and parsing the files is independent per file, so it is spread across worker threads.  Validation
+    // and logging happen afterwards in discovery order, so the resulting list is the same as reading them serially.
+    std::vector<ManifestReadResult> read_results;
+    std::vector<Json::Value> root_nodes;
+    std::vector<std::string> read_errors;
+    ManifestCache::GetInstance().BeginDiscovery();
+    ReadManifestFiles(filenames, read_results, root_nodes, read_errors);
+    for (size_t index = 0; index < filenames.size(); ++index) {
+        ApiLayerManifestFile::CreateIfValid(type, filenames[index], read_results[index], root_nodes[index], read_errors[index],
+                                            manifest_files);
+    }
+    ManifestCache::GetInstance().Save();
 
     return XR_SUCCESS;
 }
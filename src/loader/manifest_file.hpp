@@ -21,6 +21,9 @@
 
 #pragma once
 
+#include "loader_allocation.hpp"
+#include "manifest_cache.hpp"
+
 #include <openxr/openxr.h>
 
 #include <memory>
@@ -53,7 +56,7 @@ struct ExtensionListing {
 
 // ManifestFile class -
 // Base class responsible for finding and parsing manifest files.
-class ManifestFile {
+class ManifestFile : public LoaderAllocated<OPENXR_LOADER_ALLOCATION_SUBSYSTEM_MANIFEST> {
    public:
     // Non-copyable
     ManifestFile(const ManifestFile &) = delete;
@@ -106,7 +109,8 @@ class ApiLayerManifestFile : public ManifestFile {
     ApiLayerManifestFile(ManifestFileType type, const std::string &filename, const std::string &layer_name,
                          const std::string &description, const JsonVersion &api_version, const uint32_t &implementation_version,
                          const std::string &library_path);
-    static void CreateIfValid(ManifestFileType type, const std::string &filename,
+    static void CreateIfValid(ManifestFileType type, const std::string &filename, ManifestReadResult read_result,
+                              const Json::Value &root_node, const std::string &read_errors,
                               std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files);
 
     JsonVersion _api_version;
@@ -0,0 +1,519 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "manifest_parser.hpp"
+
+#ifdef OPENXR_HAVE_COMMON_CONFIG
+#include "common_config.h"
+#endif  // OPENXR_HAVE_COMMON_CONFIG
+
+#include "platform_utils.hpp"
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+namespace {
+
+// Members of the manifest's top level that the loader reads.
+const char *const kTopLevelMembers[] = {"file_format_version", "runtime", "api_layer"};
+
+// Members of the "runtime" or "api_layer" object that the loader reads.
+const char *const kManifestObjectMembers[] = {
+    "name",      "library_path",        "api_version",       "implementation_version", "description",
+    "functions", "instance_extensions", "device_extensions", "disable_environment",    "enable_environment",
+};
+
+// Documents nested deeper than this are left to jsoncpp.
+const uint32_t kMaxManifestDepth = 64;
+
+// Which members of an object are stored.
+enum ManifestMemberFilter {
+    MANIFEST_MEMBERS_TOP_LEVEL = 0,
+    MANIFEST_MEMBERS_MANIFEST_OBJECT,
+    MANIFEST_MEMBERS_ALL,
+};
+
+template <size_t N>
+bool IsOneOf(const std::string &name, const char *const (&names)[N]) {
+    for (const char *candidate : names) {
+        if (name == candidate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decide whether an object member is stored, and which of its own members are.
+bool KeepMember(ManifestMemberFilter filter, const std::string &name, ManifestMemberFilter &member_filter) {
+    member_filter = MANIFEST_MEMBERS_ALL;
+    switch (filter) {
+        case MANIFEST_MEMBERS_TOP_LEVEL:
+            if (name == "runtime" || name == "api_layer") {
+                member_filter = MANIFEST_MEMBERS_MANIFEST_OBJECT;
+            }
+            return IsOneOf(name, kTopLevelMembers);
+        case MANIFEST_MEMBERS_MANIFEST_OBJECT:
+            return IsOneOf(name, kManifestObjectMembers);
+        default:
+            return true;
+    }
+}
+
+void AppendUtf8(uint32_t code_point, std::string &out) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+// Recursive descent parser for strict JSON, storing values in the same Json::Value types jsoncpp would.
+// A null value pointer means the value is only checked for syntax.
+class ManifestJsonParser {
+   public:
+    ManifestJsonParser(const char *data, size_t size) : _cur(data), _end(data + size) {}
+
+    bool Parse(Json::Value &root_node) {
+        SkipWhitespace();
+        if (!ParseValue(&root_node, 0, MANIFEST_MEMBERS_TOP_LEVEL)) {
+            return false;
+        }
+        SkipWhitespace();
+        return _cur == _end;
+    }
+
+   private:
+    void SkipWhitespace() {
+        while (_cur != _end && (*_cur == ' ' || *_cur == '\t' || *_cur == '\n' || *_cur == '\r')) {
+            ++_cur;
+        }
+    }
+
+    bool Consume(char c) {
+        if (_cur != _end && *_cur == c) {
+            ++_cur;
+            return true;
+        }
+        return false;
+    }
+
+    bool ConsumeLiteral(const char *literal) {
+        const size_t length = strlen(literal);
+        if (static_cast<size_t>(_end - _cur) < length || memcmp(_cur, literal, length) != 0) {
+            return false;
+        }
+        _cur += length;
+        return true;
+    }
+
+    bool ParseValue(Json::Value *value, uint32_t depth, ManifestMemberFilter filter) {
+        if (_cur == _end || depth > kMaxManifestDepth) {
+            return false;
+        }
+        switch (*_cur) {
+            case '{':
+                return ParseObject(value, depth, filter);
+            case '[':
+                return ParseArray(value, depth);
+            case '"':
+                if (value == nullptr) {
+                    return ParseString(nullptr);
+                } else {
+                    std::string string_value;
+                    if (!ParseString(&string_value)) {
+                        return false;
+                    }
+                    *value = Json::Value(string_value);
+                    return true;
+                }
+            case 't':
+                return ParseLiteral(value, "true", Json::Value(true));
+            case 'f':
+                return ParseLiteral(value, "false", Json::Value(false));
+            case 'n':
+                return ParseLiteral(value, "null", Json::Value());
+            default:
+                return ParseNumber(value);
+        }
+    }
+
+    bool ParseLiteral(Json::Value *value, const char *literal, Json::Value literal_value) {
+        if (!ConsumeLiteral(literal)) {
+            return false;
+        }
+        if (value != nullptr) {
+            *value = std::move(literal_value);
+        }
+        return true;
+    }
+
+    bool ParseObject(Json::Value *value, uint32_t depth, ManifestMemberFilter filter) {
+        ++_cur;
+        if (value != nullptr) {
+            *value = Json::Value(Json::objectValue);
+        }
+        SkipWhitespace();
+        if (Consume('}')) {
+            return true;
+        }
+        std::string name;
+        for (;;) {
+            SkipWhitespace();
+            if (_cur == _end || *_cur != '"' || !ParseString(&name)) {
+                return false;
+            }
+            SkipWhitespace();
+            if (!Consume(':')) {
+                return false;
+            }
+            SkipWhitespace();
+            ManifestMemberFilter member_filter = MANIFEST_MEMBERS_ALL;
+            Json::Value *member = nullptr;
+            if (value != nullptr && KeepMember(filter, name, member_filter)) {
+                member = &(*value)[name];
+            }
+            if (!ParseValue(member, depth + 1, member_filter)) {
+                return false;
+            }
+            SkipWhitespace();
+            if (Consume('}')) {
+                return true;
+            }
+            if (!Consume(',')) {
+                return false;
+            }
+        }
+    }
+
+    bool ParseArray(Json::Value *value, uint32_t depth) {
+        ++_cur;
+        if (value != nullptr) {
+            *value = Json::Value(Json::arrayValue);
+        }
+        SkipWhitespace();
+        if (Consume(']')) {
+            return true;
+        }
+        for (Json::ArrayIndex index = 0;; ++index) {
+            SkipWhitespace();
+            if (!ParseValue(value != nullptr ? &(*value)[index] : nullptr, depth + 1, MANIFEST_MEMBERS_ALL)) {
+                return false;
+            }
+            SkipWhitespace();
+            if (Consume(']')) {
+                return true;
+            }
+            if (!Consume(',')) {
+                return false;
+            }
+        }
+    }
+
+    // Copies unescaped runs straight out of the input; out may be null to only check syntax.
+    bool ParseString(std::string *out) {
+        ++_cur;
+        if (out != nullptr) {
+            out->clear();
+        }
+        for (;;) {
+            const char *run_start = _cur;
+            while (_cur != _end && *_cur != '"' && *_cur != '\\' && static_cast<unsigned char>(*_cur) >= 0x20) {
+                ++_cur;
+            }
+            if (out != nullptr) {
+                out->append(run_start, _cur);
+            }
+            if (_cur == _end || static_cast<unsigned char>(*_cur) < 0x20) {
+                return false;
+            }
+            if (*_cur++ == '"') {
+                return true;
+            }
+            if (_cur == _end) {
+                return false;
+            }
+            char unescaped;
+            switch (*_cur++) {
+                case '"':
+                    unescaped = '"';
+                    break;
+                case '\\':
+                    unescaped = '\\';
+                    break;
+                case '/':
+                    unescaped = '/';
+                    break;
+                case 'b':
+                    unescaped = '\b';
+                    break;
+                case 'f':
+                    unescaped = '\f';
+                    break;
+                case 'n':
+                    unescaped = '\n';
+                    break;
+                case 'r':
+                    unescaped = '\r';
+                    break;
+                case 't':
+                    unescaped = '\t';
+                    break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!ParseUnicodeEscape(code_point)) {
+                        return false;
+                    }
+                    if (out != nullptr) {
+                        AppendUtf8(code_point, *out);
+                    }
+                    continue;
+                }
+                default:
+                    return false;
+            }
+            if (out != nullptr) {
+                *out += unescaped;
+            }
+        }
+    }
+
+    bool ParseHex4(uint32_t &code_unit) {
+        if (_end - _cur < 4) {
+            return false;
+        }
+        code_unit = 0;
+        for (int digit = 0; digit < 4; ++digit) {
+            const char c = *_cur++;
+            code_unit <<= 4;
+            if (c >= '0' && c <= '9') {
+                code_unit |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code_unit |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code_unit |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Parse the digits of a \u escape, and the second half of a surrogate pair.  Unpaired surrogates are left to jsoncpp.
+    bool ParseUnicodeEscape(uint32_t &code_point) {
+        if (!ParseHex4(code_point)) {
+            return false;
+        }
+        if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+            return false;
+        }
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+            uint32_t low_surrogate = 0;
+            if (!ConsumeLiteral("\\u") || !ParseHex4(low_surrogate) || low_surrogate < 0xDC00 || low_surrogate > 0xDFFF) {
+                return false;
+            }
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+        }
+        return true;
+    }
+
+    bool SkipDigits() {
+        if (_cur == _end || *_cur < '0' || *_cur > '9') {
+            return false;
+        }
+        while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+            ++_cur;
+        }
+        return true;
+    }
+
+    // Fractions and exponents in values that are stored, and integers that do not fit in 64 bits, are left to
+    // jsoncpp, which converts them independently of the current locale.  Skipped values only need their syntax checked.
+    bool ParseNumber(Json::Value *value) {
+        const bool negative = Consume('-');
+        if (_cur == _end || *_cur < '0' || *_cur > '9') {
+            return false;
+        }
+        if (*_cur == '0' && _cur + 1 != _end && _cur[1] >= '0' && _cur[1] <= '9') {
+            return false;
+        }
+        uint64_t magnitude = 0;
+        while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+            const uint64_t digit = static_cast<uint64_t>(*_cur++ - '0');
+            if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        if (value == nullptr) {
+            if (Consume('.') && !SkipDigits()) {
+                return false;
+            }
+            if (Consume('e') || Consume('E')) {
+                if (!Consume('+')) {
+                    Consume('-');
+                }
+                return SkipDigits();
+            }
+            return true;
+        }
+        if (_cur != _end && (*_cur == '.' || *_cur == 'e' || *_cur == 'E')) {
+            return false;
+        }
+
+        const uint64_t max_int64 = static_cast<uint64_t>(std::numeric_limits<Json::Int64>::max());
+        if (!negative) {
+            // Like jsoncpp, anything that fits is stored as a signed integer.
+            *value = magnitude <= max_int64 ? Json::Value(static_cast<Json::Int64>(magnitude))
+                                            : Json::Value(static_cast<Json::UInt64>(magnitude));
+        } else if (magnitude <= max_int64) {
+            *value = Json::Value(-static_cast<Json::Int64>(magnitude));
+        } else if (magnitude == max_int64 + 1) {
+            *value = Json::Value(std::numeric_limits<Json::Int64>::min());
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char *_cur;
+    const char *_end;
+};
+
+// The bytes of a manifest file, mapped into memory where the platform allows and read into a buffer otherwise.
+class ManifestFileContents {
+   public:
+    ManifestFileContents() = default;
+    ~ManifestFileContents() {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        if (_mapping != nullptr) {
+            munmap(_mapping, _mapping_size);
+        }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    }
+
+    // Non-copyable
+    ManifestFileContents(const ManifestFileContents &) = delete;
+    ManifestFileContents &operator=(const ManifestFileContents &) = delete;
+
+    bool Open(const std::string &filename) {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        // Only non-empty regular files are mapped; anything else is read below.
+        const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat file_stat = {};
+        if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            void *mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                _mapping = mapping;
+                _mapping_size = static_cast<size_t>(file_stat.st_size);
+                close(fd);
+                return true;
+            }
+        }
+        close(fd);
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+        std::ifstream file_stream(filename, std::ifstream::in | std::ifstream::binary);
+        if (!file_stream.is_open()) {
+            return false;
+        }
+        _buffer.assign(std::istreambuf_iterator<char>(file_stream), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    const char *Data() const {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        if (_mapping != nullptr) {
+            return static_cast<const char *>(_mapping);
+        }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        return _buffer.data();
+    }
+
+    size_t Size() const {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        if (_mapping != nullptr) {
+            return _mapping_size;
+        }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        return _buffer.size();
+    }
+
+   private:
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    void *_mapping = nullptr;
+    size_t _mapping_size = 0;
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    std::string _buffer;
+};
+
+}  // namespace
+
+bool ParseManifestJson(const char *data, size_t size, Json::Value &root_node) {
+    ManifestJsonParser parser(data, size);
+    return parser.Parse(root_node);
+}
+
+ManifestReadResult ReadManifestFile(const std::string &filename, Json::Value &root_node, std::string &errors) {
+    ManifestFileContents contents;
+    if (!contents.Open(filename)) {
+        return MANIFEST_READ_OPEN_FAILED;
+    }
+
+    root_node = Json::nullValue;
+    if (!PlatformUtilsGetEnvSet(OPENXR_DISABLE_MANIFEST_PARSER_ENV_VAR) &&
+        ParseManifestJson(contents.Data(), contents.Size(), root_node) && !root_node.isNull()) {
+        return MANIFEST_READ_SUCCESS;
+    }
+
+    // jsoncpp accepts more than strict JSON, such as comments, and is what reports the errors in a broken manifest.
+    root_node = Json::nullValue;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    if (!reader->parse(contents.Data(), contents.Data() + contents.Size(), &root_node, &errors) || root_node.isNull()) {
+        return MANIFEST_READ_PARSE_FAILED;
+    }
+    return MANIFEST_READ_SUCCESS;
+}
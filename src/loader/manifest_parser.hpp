@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "manifest_cache.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace Json {
+class Value;
+}
+
+// Environment variable that makes every manifest file parse with jsoncpp, skipping the manifest parser.
+#define OPENXR_DISABLE_MANIFEST_PARSER_ENV_VAR "XR_LOADER_DISABLE_MANIFEST_PARSER"
+
+// Parse the contents of a runtime or API layer manifest into root_node, in one pass over the given bytes.
+// Only the members the loader reads are stored: at the top level and in the "runtime" or "api_layer" object,
+// anything else is checked for syntax and skipped.  Returns false for anything other than strict JSON, such as
+// comments or fractional numbers, leaving it to jsoncpp to accept or report.
+bool ParseManifestJson(const char *data, size_t size, Json::Value &root_node);
+
+// Read and parse a manifest file, mapping it into memory where the platform allows.  Uses ParseManifestJson and
+// falls back to jsoncpp for anything it does not accept.  On a parse failure, errors holds jsoncpp's message.
+ManifestReadResult ReadManifestFile(const std::string &filename, Json::Value &root_node, std::string &errors);
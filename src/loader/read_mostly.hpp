@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Holds a value that is read far more often than it is changed, such as a handle to dispatch table map.
+//
+// Readers see an immutable snapshot of the value and never take a lock.  Writers copy the current
+// snapshot, modify the copy, and publish it in place of the old one.  The old snapshot is deleted once
+// no reader can still be looking at it: readers announce themselves in one of two counters selected by
+// the current epoch, and a writer flips the epoch and waits for the previous epoch's readers to drain.
+//
+// Writers are serialized and may briefly wait for readers, so Update must never be called from inside
+// a Read callback.
+template <typename T>
+class ReadMostly {
+   public:
+    ReadMostly() : _current(new T()) {}
+    ~ReadMostly() { delete _current.load(); }
+
+    // Non-copyable
+    ReadMostly(const ReadMostly&) = delete;
+    ReadMostly& operator=(const ReadMostly&) = delete;
+
+    // Call reader with the current snapshot and return its result.  The reader must not keep any
+    // reference into the snapshot after returning.
+    template <typename Reader>
+    auto Read(Reader&& reader) const -> decltype(reader(std::declval<const T&>())) {
+        ReadGuard guard(*this);
+        return reader(*_current.load());
+    }
+
+    // Call updater with a modifiable copy of the current snapshot, then publish that copy.
+    template <typename Updater>
+    void Update(Updater&& updater) {
+        std::lock_guard<std::mutex> lock(_update_mutex);
+        std::unique_ptr<T> updated(new T(*_current.load()));
+        updater(*updated);
+        std::unique_ptr<const T> retired(_current.exchange(updated.release()));
+
+        // Readers that entered before the flip may still hold the retired snapshot; later ones see the new one.
+        const uint32_t retired_epoch = _epoch.fetch_add(1);
+        while (_readers[retired_epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+   private:
+    class ReadGuard {
+       public:
+        explicit ReadGuard(const ReadMostly& owner) : _owner(owner) {
+            // Retry if the epoch flipped between choosing a counter and registering in it, since the
+            // writer that flipped it may already have stopped waiting on that counter.
+            for (;;) {
+                const uint32_t epoch = _owner._epoch.load();
+                _counter = &_owner._readers[epoch & 1];
+                _counter->fetch_add(1);
+                if (_owner._epoch.load() == epoch) {
+                    break;
+                }
+                _counter->fetch_sub(1);
+            }
+        }
+        ~ReadGuard() { _counter->fetch_sub(1); }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+       private:
+        const ReadMostly& _owner;
+        std::atomic<uint32_t>* _counter = nullptr;
+    };
+
+    std::atomic<const T*> _current;
+    mutable std::atomic<uint32_t> _epoch{0};
+    mutable std::atomic<uint32_t> _readers[2] = {{0}, {0}};
+    std::mutex _update_mutex;
+};
@@ -25,10 +25,13 @@
 #include "loader_interfaces.h"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
+#include "platform_utils.hpp"
 #include "xr_generated_dispatch_table.h"
 
 #include <openxr/openxr.h>
 
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <mutex>
@@ -37,26 +40,80 @@
 #include <utility>
 #include <vector>
 
+// Global lock to prevent reading JSON manifest files at the same time, defined in loader_core.cpp.  It also guards
+// loading and unloading the runtime.
+std::mutex& GetLoaderJsonMutex();
+
 uint32_t RuntimeInterface::_single_runtime_count = 0;
+bool RuntimeInterface::_resident = false;
+std::chrono::steady_clock::time_point RuntimeInterface::_idle_deadline;
+std::string RuntimeInterface::_loaded_runtime_json;
+
+bool RuntimeInterface::KeepResident() {
+    const std::string resident_string = PlatformUtilsGetEnv(OPENXR_RESIDENT_RUNTIME_ENV_VAR);
+    return !resident_string.empty() && resident_string != "0";
+}
+
+// Decide whether a runtime that was kept loaded after its last user went away may be handed out again.
+bool RuntimeInterface::ResidentRuntimeStillUsable(const std::string& openxr_command) {
+    if (!KeepResident()) {
+        LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface unloading resident runtime, resident mode is off");
+        return false;
+    }
+    if (PlatformUtilsGetSecureEnv("XR_RUNTIME_JSON") != _loaded_runtime_json) {
+        LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface unloading resident runtime, XR_RUNTIME_JSON changed");
+        return false;
+    }
+    if (std::chrono::steady_clock::now() >= _idle_deadline) {
+        LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface unloading resident runtime, idle timeout passed");
+        return false;
+    }
+    return true;
+}
+
+void RuntimeInterface::ReleaseIfIdle(const std::string& openxr_command) {
+    if (_resident && std::chrono::steady_clock::now() >= _idle_deadline) {
+        _resident = false;
+        LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface unloading resident runtime, idle timeout passed");
+        GetInstance().reset();
+    }
+}
 
 XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
+    if (_resident) {
+        _resident = false;
+        if (!ResidentRuntimeStillUsable(openxr_command)) {
+            GetInstance().reset();
+        }
+    }
+
     // If something's already loaded, we're done here.
     if (GetInstance() != nullptr) {
         _single_runtime_count++;
         return XR_SUCCESS;
     }
 
+    _loaded_runtime_json = PlatformUtilsGetSecureEnv("XR_RUNTIME_JSON");
+
     std::vector<std::unique_ptr<RuntimeManifestFile>> runtime_manifest_files = {};
     bool any_loaded = false;
 
     // Find the available runtimes which we may need to report information for.
-    XrResult last_error = RuntimeManifestFile::FindManifestFiles(MANIFEST_TYPE_RUNTIME, runtime_manifest_files);
+    XrResult last_error;
+    {
+        LoaderTimingScope timing(openxr_command.c_str(), "Runtime manifest discovery");
+        last_error = RuntimeManifestFile::FindManifestFiles(MANIFEST_TYPE_RUNTIME, runtime_manifest_files);
+    }
     if (XR_FAILED(last_error)) {
         LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - unknown error");
         last_error = XR_ERROR_FILE_ACCESS_ERROR;
     } else {
         for (std::unique_ptr<RuntimeManifestFile>& manifest_file : runtime_manifest_files) {
-            LoaderPlatformLibraryHandle runtime_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+            LoaderPlatformLibraryHandle runtime_library;
+            {
+                LoaderTimingScope timing(openxr_command.c_str(), "Runtime library load", manifest_file->LibraryPath());
+                runtime_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+            }
             if (nullptr == runtime_library) {
                 if (!any_loaded) {
                     last_error = XR_ERROR_INSTANCE_LOST;
@@ -96,6 +153,7 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
             // could not get loaded
             XrResult res = XR_ERROR_RUNTIME_FAILURE;
             if (nullptr != negotiate) {
+                LoaderTimingScope timing(openxr_command.c_str(), "Runtime negotiation", manifest_file->LibraryPath());
                 res = negotiate(&loader_info, &runtime_info);
             }
             // If we supposedly succeeded, but got a nullptr for GetInstanceProcAddr
@@ -138,15 +196,17 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
                 continue;
             }
 
-            std::string info_message = "RuntimeInterface::LoadRuntime succeeded loading runtime defined in manifest file ";
-            info_message += manifest_file->Filename();
-            info_message += " using interface version ";
-            info_message += std::to_string(runtime_info.runtimeInterfaceVersion);
-            info_message += " and OpenXR API version ";
-            info_message += std::to_string(XR_VERSION_MAJOR(runtime_info.runtimeApiVersion));
-            info_message += ".";
-            info_message += std::to_string(XR_VERSION_MINOR(runtime_info.runtimeApiVersion));
-            LoaderLogger::LogInfoMessage(openxr_command, info_message);
+            if (LoaderLogger::IsLogging(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT)) {
+                std::string info_message = "RuntimeInterface::LoadRuntime succeeded loading runtime defined in manifest file ";
+                info_message += manifest_file->Filename();
+                info_message += " using interface version ";
+                info_message += std::to_string(runtime_info.runtimeInterfaceVersion);
+                info_message += " and OpenXR API version ";
+                info_message += std::to_string(XR_VERSION_MAJOR(runtime_info.runtimeApiVersion));
+                info_message += ".";
+                info_message += std::to_string(XR_VERSION_MINOR(runtime_info.runtimeApiVersion));
+                LoaderLogger::LogInfoMessage(openxr_command, info_message);
+            }
 
             // Use this runtime
             GetInstance().reset(new RuntimeInterface(runtime_library, runtime_info.getInstanceProcAddr));
@@ -185,6 +245,20 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
 void RuntimeInterface::UnloadRuntime(const std::string& openxr_command) {
     if (_single_runtime_count == 1) {
         _single_runtime_count = 0;
+        if (KeepResident()) {
+            // Keep the library and its negotiated entry points around for the next enumerate or create call.  The loader
+            // starts no thread of its own to unload them, so an idle timeout is checked by the next loader call.
+            _resident = true;
+            const std::string idle_ms_string = PlatformUtilsGetEnv(OPENXR_RESIDENT_RUNTIME_IDLE_MS_ENV_VAR);
+            const long idle_ms = idle_ms_string.empty() ? 0 : atol(idle_ms_string.c_str());
+            if (idle_ms > 0) {
+                _idle_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(idle_ms);
+            } else {
+                _idle_deadline = std::chrono::steady_clock::time_point::max();
+            }
+            LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface staying resident with no users.");
+            return;
+        }
         GetInstance().reset();
     } else if (_single_runtime_count > 0) {
         --_single_runtime_count;
@@ -197,24 +271,17 @@ XrResult RuntimeInterface::GetInstanceProcAddr(XrInstance instance, const char*
 }
 
 const XrGeneratedDispatchTable* RuntimeInterface::GetDispatchTable(XrInstance instance) {
-    XrGeneratedDispatchTable* table = nullptr;
-    std::lock_guard<std::mutex> mlock(GetInstance()->_dispatch_table_mutex);
-    auto it = GetInstance()->_dispatch_table_map.find(instance);
-    if (it != GetInstance()->_dispatch_table_map.end()) {
-        table = it->second.get();
-    }
-    return table;
+    return GetInstance()->_dispatch_table_map.Read([instance](const DispatchTableMap& dispatch_table_map) {
+        auto it = dispatch_table_map.find(instance);
+        return (it != dispatch_table_map.end()) ? it->second.get() : nullptr;
+    });
 }
 
 const XrGeneratedDispatchTable* RuntimeInterface::GetDebugUtilsMessengerDispatchTable(XrDebugUtilsMessengerEXT messenger) {
-    XrInstance runtime_instance = XR_NULL_HANDLE;
-    {
-        std::lock_guard<std::mutex> mlock(GetInstance()->_messenger_to_instance_mutex);
-        auto it = GetInstance()->_messenger_to_instance_map.find(messenger);
-        if (it != GetInstance()->_messenger_to_instance_map.end()) {
-            runtime_instance = it->second;
-        }
-    }
+    XrInstance runtime_instance = GetInstance()->_messenger_to_instance_map.Read([messenger](const MessengerMap& map) {
+        auto it = map.find(messenger);
+        return (it != map.end()) ? it->second : XR_NULL_HANDLE;
+    });
     return GetDispatchTable(runtime_instance);
 }
 
@@ -222,12 +289,8 @@ RuntimeInterface::RuntimeInterface(LoaderPlatformLibraryHandle runtime_library,
     : _runtime_library(runtime_library), _get_instance_proc_addr(get_instance_proc_addr) {}
 
 RuntimeInterface::~RuntimeInterface() {
-    std::string info_message = "RuntimeInterface being destroyed.";
-    LoaderLogger::LogInfoMessage("", info_message);
-    {
-        std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-        _dispatch_table_map.clear();
-    }
+    LoaderLogger::LogInfoMessage("", "RuntimeInterface being destroyed.");
+    _dispatch_table_map.Update([](DispatchTableMap& dispatch_table_map) { dispatch_table_map.clear(); });
     LoaderPlatformLibraryClose(_runtime_library);
 }
 
@@ -274,13 +337,22 @@ XrResult RuntimeInterface::CreateInstance(const XrInstanceCreateInfo* info, XrIn
     bool create_succeeded = false;
     PFN_xrCreateInstance rt_xrCreateInstance;
     _get_instance_proc_addr(XR_NULL_HANDLE, "xrCreateInstance", reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrCreateInstance));
-    res = rt_xrCreateInstance(info, instance);
+    {
+        LoaderTimingScope timing("xrCreateInstance", "Runtime xrCreateInstance");
+        res = rt_xrCreateInstance(info, instance);
+    }
     if (XR_SUCCEEDED(res)) {
         create_succeeded = true;
-        std::unique_ptr<XrGeneratedDispatchTable> dispatch_table(new XrGeneratedDispatchTable());
-        GeneratedXrPopulateDispatchTable(dispatch_table.get(), *instance, _get_instance_proc_addr);
-        std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-        _dispatch_table_map[*instance] = std::move(dispatch_table);
+        std::shared_ptr<XrGeneratedDispatchTable> dispatch_table = std::allocate_shared<XrGeneratedDispatchTable>(
+            LoaderAllocator<XrGeneratedDispatchTable, OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE>());
+        {
+            LoaderTimingScope timing("xrCreateInstance", "Runtime dispatch population");
+            GeneratedXrPopulateDispatchTable(dispatch_table.get(), *instance, _get_instance_proc_addr);
+        }
+        XrInstance created_instance = *instance;
+        _dispatch_table_map.Update([created_instance, &dispatch_table](DispatchTableMap& dispatch_table_map) {
+            dispatch_table_map[created_instance] = std::move(dispatch_table);
+        });
     }
 
     // If the failure occurred during the populate, clean up the instance we had picked up from the runtime
@@ -297,13 +369,7 @@ XrResult RuntimeInterface::CreateInstance(const XrInstanceCreateInfo* info, XrIn
 XrResult RuntimeInterface::DestroyInstance(XrInstance instance) {
     if (XR_NULL_HANDLE != instance) {
         // Destroy the dispatch table for this instance first
-        {
-            std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-            auto map_iter = _dispatch_table_map.find(instance);
-            if (map_iter != _dispatch_table_map.end()) {
-                _dispatch_table_map.erase(map_iter);
-            }
-        }
+        _dispatch_table_map.Update([instance](DispatchTableMap& dispatch_table_map) { dispatch_table_map.erase(instance); });
         // Now delete the instance
         PFN_xrDestroyInstance rt_xrDestroyInstance;
         _get_instance_proc_addr(instance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrDestroyInstance));
@@ -313,15 +379,13 @@ XrResult RuntimeInterface::DestroyInstance(XrInstance instance) {
 }
 
 bool RuntimeInterface::TrackDebugMessenger(XrInstance instance, XrDebugUtilsMessengerEXT messenger) {
-    std::lock_guard<std::mutex> mlock(_messenger_to_instance_mutex);
-    _messenger_to_instance_map[messenger] = instance;
+    _messenger_to_instance_map.Update([instance, messenger](MessengerMap& map) { map[messenger] = instance; });
     return true;
 }
 
 void RuntimeInterface::ForgetDebugMessenger(XrDebugUtilsMessengerEXT messenger) {
     if (XR_NULL_HANDLE != messenger) {
-        std::lock_guard<std::mutex> mlock(_messenger_to_instance_mutex);
-        _messenger_to_instance_map.erase(messenger);
+        _messenger_to_instance_map.Update([messenger](MessengerMap& map) { map.erase(messenger); });
     }
 }
 
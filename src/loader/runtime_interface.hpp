@@ -21,25 +21,37 @@
 
 #pragma once
 
+#include "loader_allocation.hpp"
 #include "loader_platform.hpp"
+#include "read_mostly.hpp"
 
 #include <openxr/openxr.h>
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <mutex>
 #include <memory>
 
 struct XrGeneratedDispatchTable;
 
-class RuntimeInterface {
+// Environment variable that keeps the runtime loaded after its last user is done with it, so that enumerate and
+// create calls do not each load and negotiate with the runtime again.
+#define OPENXR_RESIDENT_RUNTIME_ENV_VAR "XR_LOADER_RESIDENT_RUNTIME"
+// Optional number of milliseconds a resident runtime may sit unused before the next enumerate or create call unloads
+// it.  Zero or unset keeps it until the process exits.
+#define OPENXR_RESIDENT_RUNTIME_IDLE_MS_ENV_VAR "XR_LOADER_RESIDENT_RUNTIME_IDLE_MS"
+
+class RuntimeInterface : public LoaderAllocated<OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE> {
    public:
     virtual ~RuntimeInterface();
 
     // Helper functions for loading and unloading the runtime (but only when necessary)
     static XrResult LoadRuntime(const std::string& openxr_command);
     static void UnloadRuntime(const std::string& openxr_command);
+    // Unload a resident runtime whose idle timeout has passed.  Called with the loader's JSON mutex held by the loader
+    // entry points that may be called with no instance.
+    static void ReleaseIfIdle(const std::string& openxr_command);
     static RuntimeInterface& GetRuntime() { return *(GetInstance().get()); }
     static XrResult GetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
 
@@ -62,6 +74,10 @@ class RuntimeInterface {
     RuntimeInterface& operator=(const RuntimeInterface&) = delete;
 
    private:
+    using DispatchTableMap = LoaderUnorderedMap<XrInstance, std::shared_ptr<const XrGeneratedDispatchTable>,
+                                                OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP>;
+    using MessengerMap = LoaderUnorderedMap<XrDebugUtilsMessengerEXT, XrInstance, OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP>;
+
     RuntimeInterface(LoaderPlatformLibraryHandle runtime_library, PFN_xrGetInstanceProcAddr get_instance_proc_addr);
     void SetSupportedExtensions(std::vector<std::string>& supported_extensions);
 
@@ -70,12 +86,21 @@ class RuntimeInterface {
         return instance;
     }
 
+    static bool KeepResident();
+    static bool ResidentRuntimeStillUsable(const std::string& openxr_command);
+
+    // These are guarded by the loader's JSON mutex.
     static uint32_t _single_runtime_count;
+    // Set while a runtime with no users is being kept loaded.
+    static bool _resident;
+    // When a resident runtime is unloaded if it is still unused, or the maximum time point if it is kept until exit.
+    static std::chrono::steady_clock::time_point _idle_deadline;
+    // Value of XR_RUNTIME_JSON when the runtime was loaded, so a resident runtime is not used once it changes.
+    static std::string _loaded_runtime_json;
     LoaderPlatformLibraryHandle _runtime_library;
     PFN_xrGetInstanceProcAddr _get_instance_proc_addr;
-    std::unordered_map<XrInstance, std::unique_ptr<XrGeneratedDispatchTable>> _dispatch_table_map;
-    std::mutex _dispatch_table_mutex;
-    std::unordered_map<XrDebugUtilsMessengerEXT, XrInstance> _messenger_to_instance_map;
-    std::mutex _messenger_to_instance_mutex;
+    // Looked up by every terminator call but only changed at create and destroy, so lookups never lock.
+    ReadMostly<DispatchTableMap> _dispatch_table_map;
+    ReadMostly<MessengerMap> _messenger_to_instance_map;
     std::vector<std::string> _supported_extensions;
 };
@@ -24,6 +24,8 @@
 #               automatic_source_generator.py class to produce the
 #               generated source code for the API Dump layer.
 
+import re
+
 from automatic_source_generator import (AutomaticSourceOutputGenerator,
                                         undecorate)
 from generator import write
@@ -63,17 +65,22 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             preamble += '#include <openxr/openxr_platform.h>\n\n'
             preamble += '#include <mutex>\n'
             preamble += '#include <string>\n'
-            preamble += '#include <tuple>\n'
             preamble += '#include <unordered_map>\n'
             preamble += '#include <vector>\n\n'
-            preamble += 'struct XrGeneratedDispatchTable;\n\n'
+            preamble += 'struct XrGeneratedDispatchTable;\n'
+            preamble += 'class ApiDumpCaptureQueue;\n'
+            preamble += 'class ApiDumpRecord;\n\n'
         elif self.genOpts.filename == 'xr_generated_api_dump.cpp':
             preamble += '#include "xr_generated_api_dump.hpp"\n'
             preamble += '#include "xr_generated_dispatch_table.h"\n'
+            preamble += '#include "api_dump_capture.hpp"\n'
+            preamble += '#include "api_dump_record.hpp"\n'
+            preamble += '#include "format_buffer.h"\n'
             preamble += '#include "hex_and_handles.h"\n\n'
             preamble += '#include <cstring>\n'
             preamble += '#include <mutex>\n'
             preamble += '#include <sstream>\n'
+            preamble += '#include <stdexcept>\n'
             preamble += '#include <iomanip>\n'
             preamble += '#include <unordered_map>\n\n'
         write(preamble, file=self.outFile)
@@ -85,11 +92,14 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         file_data = ''
         if self.genOpts.filename == 'xr_generated_api_dump.hpp':
             file_data += self.outputLayerHeaderPrototypes()
+            file_data += self.outputApiDumpCommandList()
             file_data += self.outputApiDumpExterns()
 
         elif self.genOpts.filename == 'xr_generated_api_dump.cpp':
             file_data += self.outputApiDumpMapMutexItems()
             file_data += self.writeApiDumpUnionStructFuncs()
+            file_data += self.writeApiDumpCaptureFuncs()
+            file_data += self.outputApiDumpCommandNames()
             file_data += self.outputLayerCommands()
 
         write(file_data, file=self.outFile)
@@ -97,6 +107,35 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         # Finish processing in superclass
         AutomaticSourceOutputGenerator.endFile(self)
 
+    # The name of the enumerant for a command in ApiDumpCommand, such as API_DUMP_COMMAND_LOCATE_SPACE for xrLocateSpace.
+    #   self            the ApiDumpOutputGenerator object
+    #   command_name    the name of the command
+    def commandEnumName(self, command_name):
+        return 'API_DUMP_COMMAND_' + re.sub('([a-z0-9])([A-Z])', r'\1_\2', command_name[2:]).upper()
+
+    # Output the enumeration of every command, which the command filter is indexed by.  Commands of every platform
+    # are listed, so that the values are the same whichever are built.
+    #   self            the ApiDumpOutputGenerator object
+    def outputApiDumpCommandList(self):
+        command_list = '\n// Every command the layer dumps, for filtering them by name\n'
+        command_list += 'enum ApiDumpCommand {\n'
+        for cur_cmd in self.core_commands + self.ext_commands:
+            command_list += '    %s,\n' % self.commandEnumName(cur_cmd.name)
+        command_list += '    API_DUMP_COMMAND_COUNT\n'
+        command_list += '};\n\n'
+        command_list += '// The names of the commands, indexed by ApiDumpCommand\n'
+        command_list += 'extern const char* const g_api_dump_command_names[API_DUMP_COMMAND_COUNT];\n'
+        return command_list
+
+    # Output the names of the commands in ApiDumpCommand.
+    #   self            the ApiDumpOutputGenerator object
+    def outputApiDumpCommandNames(self):
+        command_names = '\nconst char* const g_api_dump_command_names[API_DUMP_COMMAND_COUNT] = {\n'
+        for cur_cmd in self.core_commands + self.ext_commands:
+            command_names += '    "%s",\n' % cur_cmd.name
+        command_names += '};\n'
+        return command_names
+
     # Output the externs required by the manual code to work with the API Dump
     # gnerated code.
     #   self            the ApiDumpOutputGenerator object
@@ -122,7 +161,12 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_prototypes += 'XrResult ApiDumpLayerXrGetInstanceProcAddr(XrInstance instance,\n'
         generated_prototypes += '                                          const char* name, PFN_xrVoidFunction* function);\n\n'
         generated_prototypes += '// Api Dump Log Command\n'
-        generated_prototypes += 'bool ApiDumpLayerRecordContent(std::vector<std::tuple<std::string, std::string, std::string>> contents);\n\n'
+        generated_prototypes += 'bool ApiDumpLayerRecordContent(const ApiDumpRecord &record);\n\n'
+        generated_prototypes += '// Api Dump filtering: whether to dump a call to a command now, and counting frames\n'
+        generated_prototypes += 'bool ApiDumpLayerDumpCommand(uint32_t command);\n'
+        generated_prototypes += 'void ApiDumpLayerEndFrame();\n\n'
+        generated_prototypes += '// Api Dump deferred formatting, or nullptr if commands are formatted as they are called\n'
+        generated_prototypes += 'ApiDumpCaptureQueue* ApiDumpLayerCaptureQueue();\n\n'
         generated_prototypes += '// Api Dump Manual Functions\n'
         generated_prototypes += 'XrInstance FindInstanceFromDispatchTable(XrGeneratedDispatchTable* dispatch_table);\n'
         generated_prototypes += 'XrResult ApiDumpLayerXrCreateInstance(const XrInstanceCreateInfo *info,\n'
@@ -130,14 +174,14 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_prototypes += 'XrResult ApiDumpLayerXrDestroyInstance(XrInstance instance);\n'
         generated_prototypes += '\n//Dump utility functions\n'
         generated_prototypes += 'bool ApiDumpDecodeNextChain(XrGeneratedDispatchTable* gen_dispatch_table, const void* value, std::string prefix,\n'
-        generated_prototypes += '                            std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+        generated_prototypes += '                            ApiDumpRecord &record);\n'
         generated_prototypes += '\n// Union/Structure Output Helper function prototypes\n'
         for xr_union in self.api_unions:
             if xr_union.protect_value:
                 generated_prototypes += '#if %s\n' % xr_union.protect_string
             generated_prototypes += 'bool ApiDumpOutputXrUnion(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_union.name
             generated_prototypes += '                          std::string prefix, std::string type_string, bool is_pointer,\n'
-            generated_prototypes += '                          std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+            generated_prototypes += '                          ApiDumpRecord &record);\n'
             if xr_union.protect_value:
                 generated_prototypes += '#endif // %s\n' % xr_union.protect_string
         for xr_struct in self.api_structures:
@@ -145,7 +189,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 generated_prototypes += '#if %s\n' % xr_struct.protect_string
             generated_prototypes += 'bool ApiDumpOutputXrStruct(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_struct.name
             generated_prototypes += '                           std::string prefix, std::string type_string, bool is_pointer,\n'
-            generated_prototypes += '                           std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+            generated_prototypes += '                           ApiDumpRecord &record);\n'
             if xr_struct.protect_value:
                 generated_prototypes += '#endif // %s\n' % xr_struct.protect_string
         return generated_prototypes
@@ -248,6 +292,13 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             return True
         return False
 
+    # Is this an enumeration that common/enum_names.h has names for?  Those from a platform header are left out.
+    def isNamedEnumType(self, name):
+        for enum_tuple in self.api_enums:
+            if enum_tuple.name == name:
+                return not enum_tuple.protect_value
+        return False
+
     # Output a single entry's C++ output code.  This will generate the final resulting
     # entry in the Api Dump content vector which is used to record the data to a file.
     #   self            the ApiDumpOutputGenerator object
@@ -368,7 +419,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             write_string += self.writeIndent(indent)
             write_string += 'oss_%s << std::nouppercase;\n' % int_short_param_name
             write_string += self.writeIndent(indent)
-            write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
+            write_string += 'record.Add("%s", %s' % (full_type, description)
             write_string += ', oss_%s.str());\n' % int_short_param_name
             indent = indent - 1
             write_string += self.writeIndent(indent)
@@ -390,7 +441,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             write_string += self.writeIndent(indent)
             write_string += 'oss_%s << std::nouppercase;\n' % int_short_param_name
             write_string += self.writeIndent(indent)
-            write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
+            write_string += 'record.Add("%s", %s' % (full_type, description)
             write_string += ', oss_%s.str());\n' % int_short_param_name
             indent = indent - 1
             write_string += self.writeIndent(indent)
@@ -406,7 +457,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 write_string += '*' * pointer_count
             write_string += '%s).QuadPart );\n' % full_name
             write_string += self.writeIndent(indent)
-            write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
+            write_string += 'record.Add("%s", %s' % (full_type, description)
             write_string += ', oss_%s.str());\n' % int_short_param_name
         elif base_type == 'timespec':
             # Unbeknownst to XR, this is actually a struct.
@@ -427,13 +478,20 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             write_string += '%s).tv_nsec << "s";\n' % full_name
 
             write_string += self.writeIndent(indent)
-            write_string += 'contents.emplace_back("%s", %s' % (
+            write_string += 'record.Add("%s", %s' % (
                 full_type, description)
             write_string += ', oss_%s.str());\n' % int_short_param_name
         else:
             if base_type == 'XrResult':
+                # Known values are named here; only values newer than this layer are left to the runtime.
+                write_string += self.writeIndent(indent)
+                write_string += 'const char* %s_name = XrSdkEnumName(%s);\n' % (int_short_param_name, full_name)
+                write_string += self.writeIndent(indent)
+                write_string += 'if (nullptr != %s_name) {\n' % int_short_param_name
+                write_string += self.writeIndent(indent + 1)
+                write_string += 'record.Add("%s", %s, %s_name);\n' % (full_type, description, int_short_param_name)
                 write_string += self.writeIndent(indent)
-                write_string += 'if (nullptr != gen_dispatch_table) {\n'
+                write_string += '} else if (nullptr != gen_dispatch_table) {\n'
                 indent = indent + 1
                 write_string += self.writeIndent(indent)
                 write_string += 'char %s_string[XR_MAX_RESULT_STRING_SIZE];\n' % int_short_param_name
@@ -442,13 +500,20 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 write_string += self.writeIndent(indent)
                 write_string += '                                   %s, %s_string);\n' % (full_name, int_short_param_name)
                 write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s, %s_string);\n' % (full_type, description, int_short_param_name)
+                write_string += 'record.Add("%s", %s, %s_string);\n' % (full_type, description, int_short_param_name)
                 write_string += self.writeIndent(indent - 1)
                 write_string += '} else {\n'
                 write_string += self.writeIndent(indent)
             elif base_type == 'XrStructureType':
+                # Known values are named here; only values newer than this layer are left to the runtime.
                 write_string += self.writeIndent(indent)
-                write_string += 'if (nullptr != gen_dispatch_table) {\n'
+                write_string += 'const char* %s_name = XrSdkEnumName(%s);\n' % (int_short_param_name, full_name)
+                write_string += self.writeIndent(indent)
+                write_string += 'if (nullptr != %s_name) {\n' % int_short_param_name
+                write_string += self.writeIndent(indent + 1)
+                write_string += 'record.Add("%s", %s, %s_name);\n' % (full_type, description, int_short_param_name)
+                write_string += self.writeIndent(indent)
+                write_string += '} else if (nullptr != gen_dispatch_table) {\n'
                 indent = indent + 1
                 write_string += self.writeIndent(indent)
                 write_string += 'char %s_string[XR_MAX_STRUCTURE_NAME_SIZE];\n' % int_short_param_name
@@ -457,14 +522,41 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 write_string += self.writeIndent(indent)
                 write_string += '                                          %s, %s_string);\n' % (full_name, int_short_param_name)
                 write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s, %s_string);\n' % (full_type, description, int_short_param_name)
+                write_string += 'record.Add("%s", %s, %s_string);\n' % (full_type, description, int_short_param_name)
                 write_string += self.writeIndent(indent - 1)
                 write_string += '} else {\n'
                 write_string += self.writeIndent(indent)
 
             # If we're outputting using a string stream, determine the type of information
             # we're generating and format it appropriately.
-            if use_stream:
+            # Plain integers and pointers are formatted in hex straight into the record, which is much cheaper than a
+            # string stream.  Floating point values, and integers behind pointers or in arrays, still use a stream.
+            use_format_buffer = use_stream and (not is_standard_type or is_char or
+                                                ('float' not in base_type and 'double' not in base_type and
+                                                 member_param.pointer_count == 0 and not is_array))
+            # Pointers, unlike handles, may point into a capture record when formatting is deferred, so they are
+            # shown as the application's pointers they were copied from.
+            translate_pointer = not self.isHandle(base_type) and not is_external
+            if use_format_buffer:
+                write_string += self.writeIndent(indent)
+                write_string += 'record.Add("%s", %s);\n' % (full_type, description)
+                write_string += self.writeIndent(indent)
+                if is_standard_type and not is_char:
+                    write_string += 'AppendHexInteger(record, '
+                else:
+                    write_string += 'AppendPointer(record, '
+                    if translate_pointer:
+                        write_string += 'ApiDumpOriginalPointer('
+                    write_string += 'reinterpret_cast<const void*>('
+                if can_dereference and pointer_count > 0:
+                    write_string += '*' * pointer_count
+                write_string += full_name
+                if not is_standard_type or is_char:
+                    write_string += ')'
+                    if translate_pointer:
+                        write_string += ')'
+                write_string += ');\n'
+            elif use_stream:
                 write_string += self.writeIndent(indent)
                 write_string += 'std::ostringstream oss_%s;\n' % int_short_param_name
                 write_string += self.writeIndent(indent)
@@ -487,24 +579,46 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                         write_string += 'std::hex << ('
                 else:
                     write_string += 'oss_%s << ' % int_short_param_name
-                    write_string += 'std::hex << reinterpret_cast<const void*>('
+                    write_string += 'std::hex << '
+                    if translate_pointer:
+                        write_string += 'ApiDumpOriginalPointer('
+                    write_string += 'reinterpret_cast<const void*>('
                 if can_dereference and pointer_count > 0:
                     write_string += '*' * pointer_count
-                write_string += '%s);\n' % full_name
+                write_string += full_name
+                if (not is_standard_type or is_char) and translate_pointer:
+                    write_string += ')'
+                write_string += ');\n'
                 write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
+                write_string += 'record.Add("%s", %s' % (full_type, description)
                 write_string += ', oss_%s.str());\n' % int_short_param_name
 
+            elif (base_type not in ('XrResult', 'XrStructureType') and self.isNamedEnumType(base_type) and
+                  (can_dereference or pointer_count == 0)):
+                # Other enumerations are named from the tables in enum_names.h, falling back to the value.
+                deref_name = '*' * pointer_count + full_name
+                write_string += self.writeIndent(indent)
+                write_string += 'record.Add("%s", %s);\n' % (full_type, description)
+                write_string += self.writeIndent(indent)
+                write_string += 'AppendEnum(record, %s);\n' % deref_name
+            elif is_char:
+                write_string += self.writeIndent(indent)
+                write_string += 'record.Add("%s", %s, ' % (full_type, description)
+                if can_dereference:
+                    write_string += '*' * pointer_count
+                write_string += '%s);\n' % full_name
             else:
+                # Integers are written in decimal straight into the record, with enumerants as signed values.
                 write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s, ' % (full_type, description)
-                if not is_char:
-                    write_string += 'std::to_string('
+                write_string += 'record.Add("%s", %s);\n' % (full_type, description)
+                write_string += self.writeIndent(indent)
+                write_string += 'AppendDecimal(record, '
+                if self.isEnumType(base_type):
+                    write_string += 'static_cast<int64_t>('
                 if can_dereference:
                     write_string += '*' * pointer_count
-                write_string += '%s' % full_name
-                # Close std::to_string
-                if not is_char:
+                write_string += full_name
+                if self.isEnumType(base_type):
                     write_string += ')'
                 write_string += ');\n'
 
@@ -559,7 +673,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             member_string += self.writeIndent(indent)
             member_string += '// Decode the next chain if it exists\n'
             member_string += self.writeIndent(indent)
-            member_string += 'if (!ApiDumpDecodeNextChain(gen_dispatch_table, %s%s, %s, contents)) {\n' % (derefernce_str,
+            member_string += 'if (!ApiDumpDecodeNextChain(gen_dispatch_table, %s%s, %s, record)) {\n' % (derefernce_str,
                                                                                                            member_param_name,
                                                                                                            member_param_prefix)
             member_string += self.writeIndent(indent + 1)
@@ -586,7 +700,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 member_string += 'if (!ApiDumpOutputXrStruct(gen_dispatch_table, '
             else:
                 member_string += 'if (!ApiDumpOutputXrUnion(gen_dispatch_table, '
-            member_string += '%s%s, %s, "%s", %s, contents)) {\n' % (derefernce_str,
+            member_string += '%s%s, %s, "%s", %s, record)) {\n' % (derefernce_str,
                                                                      member_param_name,
                                                                      member_param_prefix,
                                                                      full_type,
@@ -882,13 +996,15 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += '#if %s\n' % xr_union.protect_string
             struct_union_check += 'bool ApiDumpOutputXrUnion(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_union.name
             struct_union_check += '                          std::string prefix, std::string type_string, bool is_pointer,\n'
-            struct_union_check += '                          std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+            struct_union_check += '                          ApiDumpRecord &record) {\n'
             struct_union_check += self.writeIndent(1)
             struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
             struct_union_check += self.writeIndent(1)
             struct_union_check += 'try {\n'
             struct_union_check += self.writeIndent(2)
-            struct_union_check += 'contents.emplace_back(type_string, prefix, PointerToHexString(value));\n'
+            struct_union_check += 'record.Add(type_string, prefix);\n'
+            struct_union_check += self.writeIndent(2)
+            struct_union_check += 'AppendPointer(record, ApiDumpOriginalPointer(value));\n'
             struct_union_check += self.writeIndent(2)
             struct_union_check += 'if (is_pointer) {\n'
             struct_union_check += self.writeIndent(3)
@@ -916,7 +1032,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += '#if %s\n' % xr_struct.protect_string
             struct_union_check += 'bool ApiDumpOutputXrStruct(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_struct.name
             struct_union_check += '                           std::string prefix, std::string type_string, bool is_pointer,\n'
-            struct_union_check += '                           std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+            struct_union_check += '                           ApiDumpRecord &record) {\n'
             indent = 1
             struct_union_check += self.writeIndent(indent)
             struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
@@ -945,7 +1061,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     struct_union_check += 'const %s* new_value = reinterpret_cast<const %s*>(value);\n' % (
                         child, child)
                     struct_union_check += self.writeIndent(indent + 1)
-                    struct_union_check += 'return ApiDumpOutputXrStruct(gen_dispatch_table, new_value, prefix, type_string, is_pointer, contents);\n'
+                    struct_union_check += 'return ApiDumpOutputXrStruct(gen_dispatch_table, new_value, prefix, type_string, is_pointer, record);\n'
                     struct_union_check += self.writeIndent(indent)
                     struct_union_check += '}\n'
                     if child_struct.protect_value:
@@ -953,7 +1069,9 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += self.writeIndent(indent)
                 struct_union_check += '// Fallback path - Just output generic information about the base struct\n'
             struct_union_check += self.writeIndent(indent)
-            struct_union_check += 'contents.emplace_back(type_string, prefix, PointerToHexString(value));\n'
+            struct_union_check += 'record.Add(type_string, prefix);\n'
+            struct_union_check += self.writeIndent(2)
+            struct_union_check += 'AppendPointer(record, ApiDumpOriginalPointer(value));\n'
             struct_union_check += self.writeIndent(indent)
             struct_union_check += 'if (is_pointer) {\n'
             struct_union_check += self.writeIndent(indent + 1)
@@ -980,11 +1098,12 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += '#endif // %s\n' % xr_struct.protect_string
             struct_union_check += '\n'
         struct_union_check += 'bool ApiDumpDecodeNextChain(XrGeneratedDispatchTable* gen_dispatch_table, const void* value, std::string prefix,\n'
-        struct_union_check += '                            std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+        struct_union_check += '                            ApiDumpRecord &record) {\n'
         struct_union_check += self.writeIndent(1)
         struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
         struct_union_check += '    try {\n'
-        struct_union_check += '        contents.emplace_back("const void *", prefix, PointerToHexString(value));\n'
+        struct_union_check += '        record.Add("const void *", prefix);\n'
+        struct_union_check += '        AppendPointer(record, ApiDumpOriginalPointer(value));\n'
         struct_union_check += '        if (nullptr == value) {\n'
         struct_union_check += '            return true;\n'
         struct_union_check += '        }\n'
@@ -1007,7 +1126,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                         struct_union_check += self.writeIndent(3)
                         struct_union_check += 'case %s:\n' % cur_value.name
                         struct_union_check += self.writeIndent(4)
-                        struct_union_check += 'if (!ApiDumpOutputXrStruct(gen_dispatch_table, reinterpret_cast<const %s*>(value), prefix, "const %s*", true, contents)) {\n' % (
+                        struct_union_check += 'if (!ApiDumpOutputXrStruct(gen_dispatch_table, reinterpret_cast<const %s*>(value), prefix, "const %s*", true, record)) {\n' % (
                             struct_define_name, struct_define_name)
                         struct_union_check += self.writeIndent(5)
                         struct_union_check += 'return false;\n'
@@ -1031,6 +1150,411 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         struct_union_check += '}\n\n'
         return struct_union_check
 
+    # Decide what capturing a structure or union member for deferred formatting has to do beyond copying the
+    # member's bytes along with its parent, by following what ApiDumpOutputXrStruct reads through it.
+    #   self            the ApiDumpOutputGenerator object
+    #   member          the structure from automatic_source_generator for the member
+    # Returns None if copying the bytes is enough, or one of:
+    #   'next'                  a next chain, copied structure by structure
+    #   'string'                a const char* string
+    #   'value'                 a single value pointed to
+    #   'array'                 an array of values pointed to, pointer_count_var long
+    #   'struct'                a structure pointed to
+    #   'struct_array'          an array of structures pointed to, pointer_count_var long
+    #   'string_array'          an array of strings, pointer_count_var long
+    #   'struct_pointer_array'  an array of pointers to structures, pointer_count_var long
+    #   'struct_value'          a structure held by value that has pointers of its own to follow
+    #   'struct_static_array'   a static array of such structures
+    def captureMemberAction(self, member):
+        base_type = self.getRawType(member.type)
+        member_struct = self.getStruct(member.type)
+        if member.name == 'next':
+            return 'next'
+        if member.pointer_count == 0:
+            if member_struct and not member_struct.returned_only and self.captureFollowsPointers(member_struct):
+                if member.is_static_array:
+                    if member.array_dimen == 1:
+                        return 'struct_static_array'
+                    return None
+                return 'struct_value'
+            return None
+        if not member.is_const or base_type == 'void' or self.isExternalGraphicsApiHandle(base_type):
+            return None
+        if base_type == 'char':
+            if member.pointer_count == 1:
+                return 'string'
+            if member.pointer_count == 2 and member.pointer_count_var:
+                return 'string_array'
+            return None
+        if member.pointer_count_var:
+            if member.pointer_count == 1:
+                if member_struct:
+                    return 'struct_array'
+                if self.getUnion(member.type):
+                    return None
+                return 'array'
+            if member.pointer_count == 2 and member_struct:
+                return 'struct_pointer_array'
+            return None
+        if member.pointer_count == 1:
+            if member_struct:
+                if member_struct.returned_only:
+                    return None
+                return 'struct'
+            if self.getUnion(member.type):
+                return None
+            return 'value'
+        return None
+
+    # Whether capturing a structure has to follow any of its pointers, rather than just copying its bytes.
+    #   self            the ApiDumpOutputGenerator object
+    #   xr_struct       the structure from automatic_source_generator for the structure
+    def captureFollowsPointers(self, xr_struct):
+        if xr_struct.name not in self.capture_follows_pointers:
+            self.capture_follows_pointers[xr_struct.name] = any(
+                self.captureMemberAction(member) is not None for member in xr_struct.members)
+        return self.capture_follows_pointers[xr_struct.name]
+
+    # Decide how a command's wrapper captures a parameter for deferred formatting, mirroring what the command's
+    # formatting reads through it.  Returns None for a parameter that cannot be captured, in which case the command
+    # is always formatted as it is called.
+    #   self            the ApiDumpOutputGenerator object
+    #   param           the structure from automatic_source_generator for the parameter
+    # Returns one of:
+    #   'value'         the parameter itself, which is all that is read
+    #   'struct'        a structure pointed to
+    #   'struct_value'  a structure passed by value, with pointers to follow
+    #   'string'        a const char* string
+    #   'copy'          a single value pointed to
+    def captureParamAction(self, param):
+        base_type = self.getRawType(param.type)
+        param_struct = self.getStruct(param.type)
+        if param.is_static_array:
+            return None
+        if param.pointer_count == 0:
+            if param_struct and self.captureFollowsPointers(param_struct):
+                return 'struct_value'
+            return 'value'
+        if param.pointer_count > 1:
+            return None
+        if base_type in ('LARGE_INTEGER', 'timespec'):
+            # These are read even through a non-const pointer.
+            return 'copy'
+        if not param.is_const:
+            # Only the address is shown, except for strings which are read.
+            if base_type == 'char':
+                return None
+            return 'value'
+        if base_type == 'char':
+            return 'string'
+        if param_struct:
+            return 'struct'
+        return None
+
+    # The structures that the generated ApiDumpCaptureXrStruct is written for: those in next chains, and those
+    # pointed to by members and parameters that are captured.
+    #   self            the ApiDumpOutputGenerator object
+    def captureStructNames(self):
+        names = set()
+        for enum_tuple in self.api_enums:
+            if enum_tuple.name == 'XrStructureType':
+                for cur_value in enum_tuple.values:
+                    struct_define_name = self.genXrStructureName(cur_value.name)
+                    if struct_define_name:
+                        names.add(struct_define_name)
+        for xr_struct in self.api_structures:
+            for member in xr_struct.members:
+                if self.captureMemberAction(member) in ('struct', 'struct_pointer_array'):
+                    names.add(member.type)
+        for cur_cmd in self.core_commands + self.ext_commands:
+            for param in cur_cmd.params:
+                if self.captureParamAction(param) == 'struct':
+                    names.add(param.type)
+        return names
+
+    # The relation group a structure is the base of, if any.
+    #   self            the ApiDumpOutputGenerator object
+    #   struct_name     the name of the structure
+    def getRelationGroup(self, struct_name):
+        for cur_rel_group in self.struct_relation_groups:
+            if cur_rel_group.generic_struct_name == struct_name:
+                return cur_rel_group
+        return None
+
+    # Write the C++ that makes a captured copy of a member follow what it points to.
+    #   self            the ApiDumpOutputGenerator object
+    #   member          the structure from automatic_source_generator for the member
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCaptureMember(self, member, indent):
+        action = self.captureMemberAction(member)
+        if action is None:
+            return ''
+        name = 'copy->%s' % member.name
+        count = ''
+        if member.pointer_count_var:
+            if self.isAllNumbers(member.pointer_count_var) or self.isAllUpperCase(member.pointer_count_var):
+                count = member.pointer_count_var
+            else:
+                count = 'copy->%s' % member.pointer_count_var
+        copy_name = '%s_copy' % member.name
+        loop_name = '%s_index' % member.name
+        capture_string = ''
+        if action == 'next':
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = static_cast<decltype(%s)>(ApiDumpCaptureNextChain(capture, %s));\n' % (name, name, name)
+        elif action == 'string':
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = capture.CopyString(%s);\n' % (name, name)
+        elif action == 'value':
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = capture.Copy(%s);\n' % (name, name)
+        elif action == 'array':
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = capture.Copy(%s, %s);\n' % (name, name, count)
+        elif action == 'struct':
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = ApiDumpCaptureXrStruct(capture, %s);\n' % (name, name)
+        elif action == 'struct_value':
+            capture_string += self.writeIndent(indent)
+            capture_string += 'ApiDumpCaptureMembers(capture, &%s);\n' % name
+        elif action == 'struct_static_array':
+            capture_string += self.writeIndent(indent)
+            capture_string += 'for (uint32_t %s = 0; %s < %s; ++%s) {\n' % (loop_name, loop_name,
+                                                                            member.static_array_sizes[0], loop_name)
+            capture_string += self.writeIndent(indent + 1)
+            capture_string += 'ApiDumpCaptureMembers(capture, &%s[%s]);\n' % (name, loop_name)
+            capture_string += self.writeIndent(indent)
+            capture_string += '}\n'
+        elif action == 'string_array':
+            capture_string += self.writeIndent(indent)
+            capture_string += 'const char** %s = capture.Copy(%s, %s);\n' % (copy_name, name, count)
+            capture_string += self.writeIndent(indent)
+            capture_string += 'for (uint32_t %s = 0; nullptr != %s && %s < %s; ++%s) {\n' % (loop_name, copy_name, loop_name,
+                                                                                           count, loop_name)
+            capture_string += self.writeIndent(indent + 1)
+            capture_string += '%s[%s] = capture.CopyString(%s[%s]);\n' % (copy_name, loop_name, copy_name, loop_name)
+            capture_string += self.writeIndent(indent)
+            capture_string += '}\n'
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = %s;\n' % (name, copy_name)
+        elif action == 'struct_pointer_array':
+            capture_string += self.writeIndent(indent)
+            capture_string += 'const %s** %s = capture.Copy(%s, %s);\n' % (member.type, copy_name, name, count)
+            capture_string += self.writeIndent(indent)
+            capture_string += 'for (uint32_t %s = 0; nullptr != %s && %s < %s; ++%s) {\n' % (loop_name, copy_name, loop_name,
+                                                                                           count, loop_name)
+            capture_string += self.writeIndent(indent + 1)
+            capture_string += '%s[%s] = ApiDumpCaptureXrStruct(capture, %s[%s]);\n' % (copy_name, loop_name, copy_name,
+                                                                                      loop_name)
+            capture_string += self.writeIndent(indent)
+            capture_string += '}\n'
+            capture_string += self.writeIndent(indent)
+            capture_string += '%s = %s;\n' % (name, copy_name)
+        elif action == 'struct_array':
+            # Like the formatting, take an array of the base of a relation group to be an array of whichever
+            # structure its first element says.
+            element_types = []
+            relation_group = self.getRelationGroup(member.type)
+            if relation_group:
+                element_types = [self.getStruct(child) for child in relation_group.child_struct_names]
+            element_types.append(self.getStruct(member.type))
+            if relation_group:
+                capture_string += self.writeIndent(indent)
+                capture_string += 'bool %s_decoded = false;\n' % member.name.lower()
+            for element_struct in element_types:
+                is_child = element_struct.name != member.type
+                element_indent = indent + 1
+                if element_struct.protect_value and is_child:
+                    capture_string += '#if %s\n' % element_struct.protect_string
+                capture_string += self.writeIndent(indent)
+                if is_child:
+                    capture_string += 'if (!%s_decoded && nullptr != %s && %s[0].type == %s) {\n' % (
+                        member.name.lower(), name, name, self.genXrStructureType(element_struct.name))
+                elif relation_group:
+                    capture_string += 'if (!%s_decoded) {\n' % member.name.lower()
+                else:
+                    capture_string += '{\n'
+                source_name = name
+                if is_child:
+                    source_name = 'reinterpret_cast<const %s*>(%s)' % (element_struct.name, name)
+                capture_string += self.writeIndent(element_indent)
+                capture_string += '%s* %s = capture.Copy(%s, %s);\n' % (element_struct.name, copy_name, source_name, count)
+                if self.captureFollowsPointers(element_struct):
+                    capture_string += self.writeIndent(element_indent)
+                    capture_string += 'for (uint32_t %s = 0; nullptr != %s && %s < %s; ++%s) {\n' % (
+                        loop_name, copy_name, loop_name, count, loop_name)
+                    capture_string += self.writeIndent(element_indent + 1)
+                    capture_string += 'ApiDumpCaptureMembers(capture, &%s[%s]);\n' % (copy_name, loop_name)
+                    capture_string += self.writeIndent(element_indent)
+                    capture_string += '}\n'
+                capture_string += self.writeIndent(element_indent)
+                if is_child:
+                    capture_string += '%s = reinterpret_cast<const %s*>(%s);\n' % (name, member.type, copy_name)
+                else:
+                    capture_string += '%s = %s;\n' % (name, copy_name)
+                if is_child:
+                    capture_string += self.writeIndent(element_indent)
+                    capture_string += '%s_decoded = true;\n' % member.name.lower()
+                capture_string += self.writeIndent(indent)
+                capture_string += '}\n'
+                if element_struct.protect_value and is_child:
+                    capture_string += '#endif // %s\n' % element_struct.protect_string
+        return capture_string
+
+    # Write the C++ functions deep-copying structures into a capture record for deferred formatting, following
+    # exactly the pointers that the ApiDumpOutputXrStruct functions read through.
+    #   self            the ApiDumpOutputGenerator object
+    def writeApiDumpCaptureFuncs(self):
+        self.capture_follows_pointers = {}
+        capture_struct_names = self.captureStructNames()
+        follow_structs = [xr_struct for xr_struct in self.api_structures if self.captureFollowsPointers(xr_struct)]
+        capture_structs = [xr_struct for xr_struct in self.api_structures if xr_struct.name in capture_struct_names]
+
+        capture_funcs = '\n// Structure Capture Helper function prototypes\n'
+        capture_funcs += 'static void* ApiDumpCaptureNextChain(ApiDumpCapture& capture, const void* value);\n'
+        for xr_struct in follow_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += 'static void ApiDumpCaptureMembers(ApiDumpCapture& capture, %s* copy);\n' % xr_struct.name
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+        for xr_struct in capture_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += 'static %s* ApiDumpCaptureXrStruct(ApiDumpCapture& capture, const %s* value);\n' % (
+                xr_struct.name, xr_struct.name)
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+
+        capture_funcs += '\n// Structure Capture Helper functions\n'
+        for xr_struct in follow_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += '// Copy what the members of a copied %s point to, and point them at the copies.\n' % xr_struct.name
+            capture_funcs += 'static void ApiDumpCaptureMembers(ApiDumpCapture& capture, %s* copy) {\n' % xr_struct.name
+            for member in xr_struct.members:
+                capture_funcs += self.writeCaptureMember(member, 1)
+            capture_funcs += '}\n'
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+            capture_funcs += '\n'
+        for xr_struct in capture_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += 'static %s* ApiDumpCaptureXrStruct(ApiDumpCapture& capture, const %s* value) {\n' % (
+                xr_struct.name, xr_struct.name)
+            relation_group = self.getRelationGroup(xr_struct.name)
+            if relation_group:
+                # Copy the whole of the structure the base is really the header of, as the formatting reads it.
+                for child in relation_group.child_struct_names:
+                    child_struct = self.getStruct(child)
+                    if child_struct.protect_value:
+                        capture_funcs += '#if %s\n' % child_struct.protect_string
+                    capture_funcs += '    if (nullptr != value && value->type == %s) {\n' % self.genXrStructureType(child)
+                    capture_funcs += '        return reinterpret_cast<%s*>(ApiDumpCaptureXrStruct(capture, reinterpret_cast<const %s*>(value)));\n' % (
+                        xr_struct.name, child)
+                    capture_funcs += '    }\n'
+                    if child_struct.protect_value:
+                        capture_funcs += '#endif // %s\n' % child_struct.protect_string
+            capture_funcs += '    %s* copy = capture.Copy(value);\n' % xr_struct.name
+            if self.captureFollowsPointers(xr_struct):
+                capture_funcs += '    if (nullptr != copy) {\n'
+                capture_funcs += '        ApiDumpCaptureMembers(capture, copy);\n'
+                capture_funcs += '    }\n'
+            capture_funcs += '    return copy;\n'
+            capture_funcs += '}\n'
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+            capture_funcs += '\n'
+
+        capture_funcs += '// Copy a next chain, throwing for the same structures ApiDumpDecodeNextChain fails on.\n'
+        capture_funcs += 'static void* ApiDumpCaptureNextChain(ApiDumpCapture& capture, const void* value) {\n'
+        capture_funcs += '    if (nullptr == value) {\n'
+        capture_funcs += '        return nullptr;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '    switch (reinterpret_cast<const XrBaseInStructure*>(value)->type) {\n'
+        for enum_tuple in self.api_enums:
+            if enum_tuple.name == 'XrStructureType':
+                if enum_tuple.protect_value:
+                    capture_funcs += '#if %s\n' % enum_tuple.protect_string
+                for cur_value in enum_tuple.values:
+                    struct_define_name = self.genXrStructureName(cur_value.name)
+                    if struct_define_name:
+                        cur_struct = self.getStruct(struct_define_name)
+                        if cur_struct.protect_value:
+                            capture_funcs += '#if %s\n' % cur_struct.protect_string
+                        capture_funcs += '        case %s:\n' % cur_value.name
+                        capture_funcs += '            return ApiDumpCaptureXrStruct(capture, reinterpret_cast<const %s*>(value));\n' % (
+                            struct_define_name)
+                        if cur_struct.protect_value:
+                            capture_funcs += '#endif // %s\n' % cur_struct.protect_string
+                if enum_tuple.protect_value:
+                    capture_funcs += '#endif // %s\n' % enum_tuple.protect_string
+        capture_funcs += '        default:\n'
+        capture_funcs += '            throw std::invalid_argument("Invalid Operation");\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '}\n\n'
+        return capture_funcs
+
+    # Write the C++ function formatting a command's parameters, and if they can all be captured, the ones that
+    # capture them into a record and format the record on the formatting thread.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the structure from automatic_source_generator for the command
+    #   has_return      Boolean indicating whether the command returns a value
+    def writeCommandFormatFuncs(self, cur_cmd, has_return):
+        base_name = cur_cmd.name[2:]
+        param_decls = [' '.join(param.cdecl.split()) for param in cur_cmd.params]
+        format_funcs = 'static void ApiDumpFormat%s(XrGeneratedDispatchTable* gen_dispatch_table, %s,\n' % (
+            base_name, ', '.join(param_decls))
+        format_funcs += '    ApiDumpRecord &record) {\n'
+        format_funcs += '    (void)gen_dispatch_table;  // silence warning\n'
+        # Print out a line for the header
+        if has_return:
+            format_funcs += '    record.Add("%s", "%s");\n' % (cur_cmd.return_type.text, cur_cmd.name)
+        else:
+            format_funcs += '    record.Add("void", "%s");\n' % cur_cmd.name
+        # Print out information for each parameter
+        for param in cur_cmd.params:
+            can_expand = False
+            # TODO handle array of handles here?
+            if ((self.isStruct(param.type) or self.isUnion(param.type)) and
+                    (param.is_const or param.pointer_count == 0)):
+                can_expand = True
+            format_funcs += self.writeParamMember(param, False, can_expand, 1)
+        format_funcs += '}\n\n'
+
+        if not all(self.captureParamAction(param) is not None for param in cur_cmd.params):
+            return format_funcs
+
+        arguments_name = 'ApiDump%sArguments' % base_name
+        format_funcs += 'struct %s {\n' % arguments_name
+        for param_decl in param_decls:
+            format_funcs += '    %s;\n' % param_decl
+        format_funcs += '};\n\n'
+        format_funcs += 'static void ApiDumpFormatCaptured%s(XrGeneratedDispatchTable* gen_dispatch_table, const void* arguments,\n' % base_name
+        format_funcs += '    ApiDumpRecord &record) {\n'
+        format_funcs += '    const auto* captured = static_cast<const %s*>(arguments);\n' % arguments_name
+        format_funcs += '    ApiDumpFormat%s(gen_dispatch_table, %s, record);\n' % (
+            base_name, ', '.join('captured->%s' % param.name for param in cur_cmd.params))
+        format_funcs += '}\n\n'
+        format_funcs += 'static void ApiDumpCapture%s(ApiDumpCapture& capture, %s) {\n' % (base_name, ', '.join(param_decls))
+        format_funcs += '    auto* captured = capture.BeginArguments<%s>(ApiDumpFormatCaptured%s);\n' % (arguments_name, base_name)
+        for param in cur_cmd.params:
+            action = self.captureParamAction(param)
+            format_funcs += '    captured->%s = ' % param.name
+            if action == 'struct':
+                format_funcs += 'ApiDumpCaptureXrStruct(capture, %s);\n' % param.name
+            elif action == 'string':
+                format_funcs += 'capture.CopyString(%s);\n' % param.name
+            elif action == 'copy':
+                format_funcs += 'capture.Copy(%s);\n' % param.name
+            else:
+                format_funcs += '%s;\n' % param.name
+            if action == 'struct_value':
+                format_funcs += '    ApiDumpCaptureMembers(capture, &captured->%s);\n' % param.name
+        format_funcs += '}\n\n'
+        return format_funcs
+
     # Write the C++ Api Dump function for every command we know about
     #   self            the ApiDumpOutputGenerator object
     def outputLayerCommands(self):
@@ -1076,6 +1600,10 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 if cur_cmd.protect_value:
                     generated_commands += '#if %s\n' % cur_cmd.protect_string
 
+                generated_commands += self.writeCommandFormatFuncs(cur_cmd, has_return)
+                can_capture = all(self.captureParamAction(param) is not None for param in cur_cmd.params)
+                param_names = ', '.join(param.name for param in cur_cmd.params)
+
                 prototype = cur_cmd.cdecl.replace(" xr", " ApiDumpLayerXr")
                 prototype = prototype.replace(self.genOpts.apicall, "").replace(self.genOpts.apientry, "")
                 prototype = prototype.replace(";", " {\n")
@@ -1092,8 +1620,6 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     generated_commands += return_prefix
 
                 generated_commands += '    try {\n'
-                generated_commands += '        // Generate output for this command\n'
-                generated_commands += '        std::vector<std::tuple<std::string, std::string, std::string>> contents;\n'
 
                 # Next, we have to call down to the next implementation of this command in the call chain.
                 # Before we can do that, we have to figure out what the dispatch table is
@@ -1110,24 +1636,30 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     generated_commands += self.printCodeGenErrorMessage(
                         'Command %s does not have an OpenXR Object handle as the first parameter.' % cur_cmd.name)
 
-                # Print out a tuple for the header
-                if has_return:
-                    generated_commands += '        contents.emplace_back("%s", "%s", "");\n' % (
-                        cur_cmd.return_type.text, cur_cmd.name)
-                else:
-                    generated_commands += '        contents.emplace_back("void", "%s", "");\n' % cur_cmd.name
-                # Print out information for each parameter
-                for param in cur_cmd.params:
-                    can_expand = False
-                    # TODO handle array of handles here?
-                    if ((self.isStruct(param.type) or self.isUnion(param.type)) and
-                            (param.is_const or param.pointer_count == 0)):
-                        can_expand = True
-                    generated_commands += self.writeParamMember(
-                        param, False, can_expand, 2)
-
-                # Now record the information
-                generated_commands += '        ApiDumpLayerRecordContent(contents);\n\n'
+                # Generate output for this command, or capture it to be generated on the formatting thread, unless
+                # the command is filtered out.
+                generated_commands += '\n        // Generate output for this command\n'
+                generated_commands += '        if (ApiDumpLayerDumpCommand(%s)) {\n' % self.commandEnumName(cur_cmd.name)
+                indent = 3
+                if can_capture:
+                    generated_commands += '            ApiDumpCaptureQueue* capture_queue = ApiDumpLayerCaptureQueue();\n'
+                    generated_commands += '            if (nullptr == capture_queue || !capture_queue->Capture(gen_dispatch_table, [&](ApiDumpCapture& capture) {\n'
+                    generated_commands += '                    ApiDumpCapture%s(capture, %s);\n' % (base_name, param_names)
+                    generated_commands += '                })) {\n'
+                    indent = 4
+                generated_commands += self.writeIndent(indent)
+                generated_commands += 'ApiDumpRecord record;\n'
+                generated_commands += self.writeIndent(indent)
+                generated_commands += 'ApiDumpFormat%s(gen_dispatch_table, %s, record);\n' % (base_name, param_names)
+                generated_commands += self.writeIndent(indent)
+                generated_commands += 'ApiDumpLayerRecordContent(record);\n'
+                if can_capture:
+                    generated_commands += '            }\n'
+                generated_commands += '        }\n'
+                # The frame ends once its xrEndFrame has been dumped.
+                if cur_cmd.name == 'xrEndFrame':
+                    generated_commands += '        ApiDumpLayerEndFrame();\n'
+                generated_commands += '\n'
 
                 # Call down, looking for the returned result if required.
                 generated_commands += '        '
@@ -1192,13 +1724,17 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_commands += '    try {\n'
         generated_commands += '        std::string func_name = name;\n\n'
         generated_commands += '        // Generate output for this command\n'
-        generated_commands += '        std::vector<std::tuple<std::string, std::string, std::string>> contents;\n'
-        generated_commands += '        contents.emplace_back("XrResult", "xrGetInstanceProcAddr", "");\n'
-        generated_commands += '        contents.emplace_back("XrInstance", "instance", HandleToHexString(instance));\n'
-        generated_commands += '        contents.emplace_back("const char*", "name", name);\n'
-        generated_commands += '        contents.emplace_back("PFN_xrVoidFunction*", "function", PointerToHexString(reinterpret_cast<const void*>(function)));\n'
-        generated_commands += '        ApiDumpLayerRecordContent(contents);\n'
-        
+        generated_commands += '        if (ApiDumpLayerDumpCommand(%s)) {\n' % self.commandEnumName('xrGetInstanceProcAddr')
+        generated_commands += '            ApiDumpRecord record;\n'
+        generated_commands += '            record.Add("XrResult", "xrGetInstanceProcAddr");\n'
+        generated_commands += '            record.Add("XrInstance", "instance");\n'
+        generated_commands += '            AppendHandle(record, instance);\n'
+        generated_commands += '            record.Add("const char*", "name", name);\n'
+        generated_commands += '            record.Add("PFN_xrVoidFunction*", "function");\n'
+        generated_commands += '            AppendPointer(record, reinterpret_cast<const void*>(function));\n'
+        generated_commands += '            ApiDumpLayerRecordContent(record);\n'
+        generated_commands += '        }\n'
+
         generated_commands += '        // Set the function pointer to NULL so that the fall-through below actually works:\n'
         generated_commands += '        *function = nullptr;\n\n'
 
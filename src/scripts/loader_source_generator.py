@@ -51,6 +51,65 @@ EXTENSIONS_LOADER_IMPLEMENTS = [
     'XR_EXT_debug_utils'
 ]
 
+# Commands the loader has to resolve by name that are not part of the registry,
+# because they belong to the loader <-> API layer interface.
+LOADER_INTERFACE_FUNCS = [
+    'xrCreateApiLayerInstance',
+]
+
+# Constants used by the generated command name perfect hash.  These must match
+# the values written into GeneratedLoaderCommandFromName below.
+FNV1A_OFFSET_BASIS = 0x811c9dc5
+FNV1A_PRIME = 0x01000193
+HASH_MIX_MULTIPLIER = 0x9e3779b1
+
+
+def fnv1aHash(name):
+    value = FNV1A_OFFSET_BASIS
+    for c in name.encode('utf-8'):
+        value = ((value ^ c) * FNV1A_PRIME) & 0xffffffff
+    return value
+
+
+def mixHashIndex(value, seed, table_bits):
+    return (((value ^ seed) * HASH_MIX_MULTIPLIER) & 0xffffffff) >> (32 - table_bits)
+
+
+# Build a two level (hash and displace) perfect hash for the given names.
+# Each name is hashed once with FNV-1a.  The hash picks a bucket, and each
+# bucket stores a seed which, mixed with the hash, places every name of that
+# bucket into a unique slot of the final table.
+# Returns (seeds, table, table_bits) where table holds a name or None per slot.
+def buildPerfectHash(names):
+    table_bits = 1
+    while (1 << table_bits) < len(names) * 3 // 2:
+        table_bits += 1
+    table_size = 1 << table_bits
+    bucket_count = max(1, len(names) // 2)
+
+    hashes = dict((name, fnv1aHash(name)) for name in names)
+    buckets = [[] for _ in range(bucket_count)]
+    for name in names:
+        buckets[hashes[name] % bucket_count].append(name)
+
+    seeds = [0] * bucket_count
+    table = [None] * table_size
+    # Place the most crowded buckets first, while the table is still empty.
+    for bucket_index in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+        bucket = buckets[bucket_index]
+        if not bucket:
+            continue
+        for seed in range(0x10000):
+            slots = [mixHashIndex(hashes[name], seed, table_bits) for name in bucket]
+            if len(set(slots)) == len(slots) and all(table[slot] is None for slot in slots):
+                break
+        else:
+            raise RuntimeError('Unable to build a perfect hash for the loader command names')
+        seeds[bucket_index] = seed
+        for name, slot in zip(bucket, slots):
+            table[slot] = name
+    return seeds, table, table_bits
+
 
 def generateErrorMessage(indent_level, vuid, cur_cmd, message, object_info):
     lines = []
@@ -101,6 +160,7 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
 
         if self.genOpts.filename == 'xr_generated_loader.hpp':
             preamble += '#pragma once\n'
+            preamble += '#include <cstdint>\n'
             preamble += '#include <unordered_map>\n'
             preamble += '#include <thread>\n'
             preamble += '#include <mutex>\n\n'
@@ -148,8 +208,10 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             file_data += '#ifdef __cplusplus\n'
             file_data += '} // extern "C"\n'
             file_data += '#endif\n'
+            file_data += self.outputLoaderCommandEnum()
 
         elif self.genOpts.filename == 'xr_generated_loader.cpp':
+            file_data += self.outputLoaderCommandHashTable()
             file_data += self.outputLoaderGeneratedFuncs()
 
         write(file_data, file=self.outFile)
@@ -179,6 +241,78 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
 
         return manual_funcs
 
+    # Every command name the loader can be asked to resolve, in registry order.
+    #   self            the LoaderSourceOutputGenerator object
+    def getLoaderCommandNames(self):
+        names = [cur_cmd.name for cur_cmd in self.core_commands]
+        names += [cur_cmd.name for cur_cmd in self.ext_commands]
+        names += LOADER_INTERFACE_FUNCS
+        return names
+
+    # Output an enum naming each command the loader knows about, along with the
+    # prototype for the function used to look those commands up by name.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandEnum(self):
+        command_enum = '\n// Identifies a command by name without repeated string comparisons\n'
+        command_enum += 'enum class LoaderCommand : uint32_t {\n'
+        command_enum += '    Unknown = 0,\n'
+        for name in self.getLoaderCommandNames():
+            # Remove 'xr' from the name
+            command_enum += '    %s,\n' % name[2:]
+        command_enum += '};\n\n'
+        command_enum += '// Look up the LoaderCommand for a command name using a generated perfect hash.\n'
+        command_enum += '// Returns LoaderCommand::Unknown if the name is not a command the loader knows about.\n'
+        command_enum += 'LoaderCommand GeneratedLoaderCommandFromName(const char* name);\n\n'
+        command_enum += '// Get the loader function that tracks the handles created or destroyed by a command, for\n'
+        command_enum += '// xrGetInstanceProcAddr to return in place of the one found down the call chain.\n'
+        command_enum += '// Returns nullptr for commands that neither create nor destroy handles.\n'
+        command_enum += 'PFN_xrVoidFunction GeneratedLoaderHandleTrackingFunction(LoaderCommand command);\n'
+        return command_enum
+
+    # Output the perfect hash tables and the lookup function that uses them.  The
+    # lookup hashes the name once, and performs at most one string comparison.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandHashTable(self):
+        names = self.getLoaderCommandNames()
+        seeds, table, table_bits = buildPerfectHash(names)
+
+        hash_table = '\n// Generated perfect hash used to map command names to LoaderCommand values\n'
+        hash_table += 'namespace {\n'
+        hash_table += 'struct LoaderCommandHashEntry {\n'
+        hash_table += '    const char* name;\n'
+        hash_table += '    LoaderCommand command;\n'
+        hash_table += '};\n\n'
+        hash_table += 'const uint32_t kLoaderCommandHashTableBits = %d;\n' % table_bits
+        hash_table += 'const uint32_t kLoaderCommandHashBucketCount = %d;\n\n' % len(seeds)
+        hash_table += 'const uint16_t kLoaderCommandHashSeeds[kLoaderCommandHashBucketCount] = {\n'
+        for index in range(0, len(seeds), 16):
+            hash_table += '    %s,\n' % ', '.join(str(seed) for seed in seeds[index:index + 16])
+        hash_table += '};\n\n'
+        hash_table += 'const LoaderCommandHashEntry kLoaderCommandHashTable[1 << kLoaderCommandHashTableBits] = {\n'
+        for name in table:
+            if name is None:
+                hash_table += '    {nullptr, LoaderCommand::Unknown},\n'
+            else:
+                hash_table += '    {"%s", LoaderCommand::%s},\n' % (name, name[2:])
+        hash_table += '};\n'
+        hash_table += '}  // namespace\n\n'
+
+        hash_table += 'LoaderCommand GeneratedLoaderCommandFromName(const char* name) {\n'
+        hash_table += '    // FNV-1a\n'
+        hash_table += '    uint32_t hash = 0x%08xU;\n' % FNV1A_OFFSET_BASIS
+        hash_table += '    for (const char* cur = name; *cur != \'\\0\'; ++cur) {\n'
+        hash_table += '        hash = (hash ^ static_cast<uint8_t>(*cur)) * 0x%08xU;\n' % FNV1A_PRIME
+        hash_table += '    }\n'
+        hash_table += '    const uint32_t seed = kLoaderCommandHashSeeds[hash % kLoaderCommandHashBucketCount];\n'
+        hash_table += '    const uint32_t index = ((hash ^ seed) * 0x%08xU) >> (32 - kLoaderCommandHashTableBits);\n' % HASH_MIX_MULTIPLIER
+        hash_table += '    const LoaderCommandHashEntry& entry = kLoaderCommandHashTable[index];\n'
+        hash_table += '    if (entry.name != nullptr && strcmp(entry.name, name) == 0) {\n'
+        hash_table += '        return entry.command;\n'
+        hash_table += '    }\n'
+        hash_table += '    return LoaderCommand::Unknown;\n'
+        hash_table += '}\n'
+        return hash_table
+
    # Output loader generated functions.  This has special cases for create and destroy commands
     # since we have to associate the created objects with the original instance during the create,
     # and then remove that association in the delete.
@@ -191,107 +325,123 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             if cur_cmd.name in MANUAL_LOADER_FUNCS:
                 continue
 
-            # Remove 'xr' from proto name
-            base_name = cur_cmd.name[2:]
-
-            has_return = False
-
-            if cur_cmd.is_create_connect or cur_cmd.is_destroy_disconnect:
-                has_return = True
-            elif cur_cmd.return_type is not None:
-                has_return = True
-
-            tramp_variable_defines = ''
-            tramp_param_replace = []
-            base_handle_name = ''
-
-            for count, param in enumerate(cur_cmd.params):
-                param_cdecl = param.cdecl
-                is_const = False
-                const_check = param_cdecl.strip()
-                if const_check[:5].lower() == "const":
-                    is_const = True
-                pointer_count = self.paramPointerCount(
-                    param.cdecl, param.type, param.name)
-                array_dimen = self.paramArrayDimension(
-                    param.cdecl, param.type, param.name)
-
-                static_array_sizes = []
-                if param.is_static_array:
-                    static_array_sizes = param.static_array_sizes
-
-                cmd_tramp_param_name = param.name
-                cmd_tramp_is_handle = param.is_handle
-                if count == 0:
-                    if param.is_handle:
-                        base_handle_name = undecorate(param.type)
-                        first_handle_name = self.getFirstHandleName(param)
-
-                        tramp_variable_defines += '    LoaderInstance* loader_instance;\n'
-                        tramp_variable_defines += '    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "%s");\n' % (cur_cmd.name)
-                        tramp_variable_defines += '    if (XR_SUCCEEDED(result)) {\n'
-
-                        # These should be mutually exclusive - verify it.
-                        assert((not cur_cmd.is_destroy_disconnect) or
-                                (pointer_count == 0))
-                    else:
-                        tramp_variable_defines += self.printCodeGenErrorMessage(
-                            'Command %s does not have an OpenXR Object handle as the first parameter.' % cur_cmd.name)
-
-                tramp_param_replace.append(
-                    self.MemberOrParam(type=param.type,
-                                        name=cmd_tramp_param_name,
-                                        is_const=is_const,
-                                        is_handle=cmd_tramp_is_handle,
-                                        is_bool=param.is_bool,
-                                        is_optional=param.is_optional,
-                                        no_auto_validity=param.no_auto_validity,
-                                        is_array=param.is_array,
-                                        is_static_array=param.is_static_array,
-                                        static_array_sizes=static_array_sizes,
-                                        array_dimen=array_dimen,
-                                        array_count_var=param.array_count_var,
-                                        array_length_for=param.array_length_for,
-                                        pointer_count=pointer_count,
-                                        pointer_count_var=param.pointer_count_var,
-                                        is_null_terminated=param.is_null_terminated,
-                                        valid_extension_structs=None,
-                                        cdecl=param.cdecl,
-                                        values=param.values))
-                count = count + 1
-
             if cur_cmd.protect_value:
                 generated_funcs += '#if %s\n' % cur_cmd.protect_string
-            decl = self.getProto(cur_cmd).replace(";", " XRLOADER_ABI_TRY {\n")
+            generated_funcs += self.getProto(cur_cmd).replace(";", " XRLOADER_ABI_TRY {\n")
+            generated_funcs += self.genTrampolineBody(cur_cmd)
+            generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
+            if cur_cmd.protect_value:
+                generated_funcs += '#endif // %s\n' % cur_cmd.protect_string
+            generated_funcs += '\n'
 
-            generated_funcs += decl
-            generated_funcs += tramp_variable_defines
+        generated_funcs += self.outputHandleTrackingFuncs()
+        return generated_funcs
 
-            if has_return:
-                generated_funcs += '        result = '
-            else:
-                generated_funcs += '        '
+    # Returns True if the command creates a handle, which is returned through its last parameter.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cur_cmd         the command to check
+    def createsHandle(self, cur_cmd):
+        return cur_cmd.is_create_connect and cur_cmd.params[-1].is_handle
 
-            generated_funcs += 'loader_instance->DispatchTable()->'
-            generated_funcs += base_name
-            generated_funcs += '('
-            count = 0
-            for param in tramp_param_replace:
-                if count > 0:
-                    generated_funcs += ', '
-                generated_funcs += param.name
-                count = count + 1
-            generated_funcs += ');\n'
+    # Returns True if the command destroys the handle passed as its first parameter.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cur_cmd         the command to check
+    def destroysHandle(self, cur_cmd):
+        return cur_cmd.is_destroy_disconnect and cur_cmd.params[0].is_handle
 
-            generated_funcs += '    }\n'
+    # Generate the body of a trampoline: find the LoaderInstance owning the first handle
+    # parameter, call down its dispatch table, and record or forget any handle created or
+    # destroyed by the command so later calls using it find the same instance.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cur_cmd         the command to generate the body for
+    def genTrampolineBody(self, cur_cmd):
+        # Remove 'xr' from proto name
+        base_name = cur_cmd.name[2:]
+        has_return = cur_cmd.return_type is not None
+        first_param = cur_cmd.params[0]
+        if not first_param.is_handle:
+            return self.printCodeGenErrorMessage(
+                'Command %s does not have an OpenXR Object handle as the first parameter.' % cur_cmd.name)
+        call = 'loader_instance->DispatchTable()->%s(%s)' % (base_name, ', '.join(param.name for param in cur_cmd.params))
+        creates_handle = self.createsHandle(cur_cmd)
+        destroys_handle = self.destroysHandle(cur_cmd)
+
+        body = ''
+        if not creates_handle and not destroys_handle:
+            # Skip the LoaderInstance lookup entirely when there is a single instance with no API layers.
+            body += '    const XrGeneratedDispatchTable* direct_dispatch = ActiveLoaderInstance::GetDirectDispatchTable();\n'
+            body += '    if (direct_dispatch != nullptr) {\n'
+            body += '        %sdirect_dispatch->%s(%s);\n' % (
+                'return ' if has_return else '', base_name, ', '.join(param.name for param in cur_cmd.params))
+            if not has_return:
+                body += '        return;\n'
+            body += '    }\n'
+        body += '    LoaderInstance* loader_instance;\n'
+        body += '    XrResult result = ActiveLoaderInstance::Get(MakeHandleGeneric(%s), %s, &loader_instance, "%s");\n' % (
+            first_param.name, self.genXrObjectType(first_param.type), cur_cmd.name)
+        body += '    if (XR_SUCCEEDED(result)) {\n'
+        if has_return:
+            body += '        result = %s;\n' % call
+        else:
+            body += '        %s;\n' % call
+        if creates_handle:
+            body += '        if (XR_SUCCEEDED(result)) {\n'
+            body += '            ActiveLoaderInstance::AddHandle(MakeHandleGeneric(*%s), %s, loader_instance);\n' % (
+                cur_cmd.params[-1].name, self.genXrObjectType(cur_cmd.params[-1].type))
+            body += '        }\n'
+        elif destroys_handle:
+            body += '        if (XR_SUCCEEDED(result)) {\n'
+            body += '            ActiveLoaderInstance::RemoveHandle(MakeHandleGeneric(%s), %s);\n' % (
+                first_param.name, self.genXrObjectType(first_param.type))
+            body += '        }\n'
+        body += '    }\n'
+        if has_return:
+            body += '    return result;\n'
+        return body
+
+    # Output wrappers for the extension commands that create or destroy handles, and a function
+    # that returns the wrapper (or core trampoline) to hand out from xrGetInstanceProcAddr for a
+    # command.  This lets the loader track every handle the application creates, so it can find
+    # the owning instance when several instances are alive.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputHandleTrackingFuncs(self):
+        wrappers = '// Wrappers that track the handles created and destroyed by extension commands\n'
+        lookup = '\nPFN_xrVoidFunction GeneratedLoaderHandleTrackingFunction(LoaderCommand command) {\n'
+        lookup += '    switch (command) {\n'
 
+        for cur_cmd in self.core_commands + self.ext_commands:
+            if cur_cmd.name in MANUAL_LOADER_FUNCS:
+                continue
+            if not self.createsHandle(cur_cmd) and not self.destroysHandle(cur_cmd):
+                continue
 
-            if has_return:
-                generated_funcs += '    return result;\n'
+            base_name = cur_cmd.name[2:]
+            if cur_cmd in self.core_commands:
+                function_name = cur_cmd.name
+            else:
+                function_name = 'LoaderXrTracked%s' % base_name
 
-            generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
+            if cur_cmd.protect_value:
+                lookup += '#if %s\n' % cur_cmd.protect_string
+                if function_name != cur_cmd.name:
+                    wrappers += '#if %s\n' % cur_cmd.protect_string
+
+            if function_name != cur_cmd.name:
+                wrappers += 'static ' + cur_cmd.cdecl.replace(' %s(' % cur_cmd.name, ' %s(' % function_name).replace(
+                    ';', ' XRLOADER_ABI_TRY {\n')
+                wrappers += self.genTrampolineBody(cur_cmd)
+                wrappers += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
+                if cur_cmd.protect_value:
+                    wrappers += '#endif // %s\n' % cur_cmd.protect_string
+                wrappers += '\n'
 
+            lookup += '        case LoaderCommand::%s:\n' % base_name
+            lookup += '            return reinterpret_cast<PFN_xrVoidFunction>(%s);\n' % function_name
             if cur_cmd.protect_value:
-                generated_funcs += '#endif // %s\n' % cur_cmd.protect_string
-            generated_funcs += '\n'
-        return generated_funcs
+                lookup += '#endif // %s\n' % cur_cmd.protect_string
+
+        lookup += '        default:\n'
+        lookup += '            return nullptr;\n'
+        lookup += '    }\n'
+        lookup += '}\n'
+        return wrappers + lookup
@@ -0,0 +1,477 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem_utils.hpp"
+#include "loader_test_utils.hpp"
+
+#include "xr_dependencies.h"
+#include <openxr/openxr.h>
+
+// Add some judicious char savers
+using std::cout;
+using std::endl;
+
+// Filter out the loader's messages to std::cerr if this is defined to 1.  This allows a
+// clean output for the test.
+#define FILTER_OUT_LOADER_ERRORS 1
+
+// Count the lines in a file starting with prefix, or return -1 if it cannot be read.
+static int64_t CountLinesStartingWith(const std::string& filename, const std::string& prefix) {
+    std::ifstream file(filename);
+    if (!file) {
+        return -1;
+    }
+    int64_t count = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Use the test runtime, and write a manifest for the API dump layer into its own directory, which it then finds
+// through XR_API_LAYER_PATH.  The manifest built with the layer names just the library, to be found on the library
+// path once installed, so this one names the library in the build tree instead.
+static bool UseApiDumpLayerManifest(std::string& manifest_filename) {
+    std::string current_path;
+    std::string layer_path;
+    if (!UseTestRuntime() || !FileSysUtilsGetCurrentPath(current_path) ||
+        !FileSysUtilsCombinePaths(current_path, "api_dump_layer", layer_path) || !LoaderTestCreateDirectory(layer_path) ||
+        !FileSysUtilsCombinePaths(layer_path, "XrApiLayer_api_dump.json", manifest_filename)) {
+        return false;
+    }
+    std::ofstream manifest(manifest_filename, std::ofstream::out | std::ofstream::trunc);
+    manifest << "{\n"
+             << "    \"file_format_version\": \"1.0.0\",\n"
+             << "    \"api_layer\": {\n"
+             << "        \"name\": \"XR_APILAYER_LUNARG_api_dump\",\n"
+             << "        \"library_path\": \"" << API_DUMP_LAYER_PATH << "\",\n"
+             << "        \"api_version\": \"1.0\",\n"
+             << "        \"implementation_version\": \"1\",\n"
+             << "        \"description\": \"API Layer to record api calls as they occur\"\n"
+             << "    }\n"
+             << "}\n";
+    if (!manifest.good()) {
+        return false;
+    }
+    LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+    return true;
+}
+
+// Check that the API dump layer writes every command it records to its text file by the time the instance is
+// destroyed, both collecting its output in memory and writing each command out as it is recorded, and time
+// xrLocateSpace through the layer both ways.  For comparison, also time opening the file, appending one command's
+// worth of output and closing it again, which the layer used to do for every command.
+DEFINE_TEST(TestApiDumpOutput) {
+    INIT_TEST(TestApiDumpOutput)
+
+    try {
+        const uint32_t locate_count = 2000;
+        const std::string dump_filename = "api_dump_buffered.txt";
+
+        std::string manifest_filename;
+        if (!UseApiDumpLayerManifest(manifest_filename)) {
+            TEST_FAIL("Unable to set test runtime and API dump layer paths")
+            TEST_REPORT(TestApiDumpOutput)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", dump_filename);
+
+        std::streamoff dump_size = 0;
+        double undumped_ns = 0.0;
+        for (uint32_t test = 0; test < 4; ++test) {
+            std::string subtest_name;
+            if (test == 0) {
+                // The runtime and loader alone, to tell how much of each call is spent dumping it.
+                subtest_name = "without API dump";
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+            } else if (test == 1) {
+                subtest_name = "buffering output";
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_LUNARG_api_dump");
+                LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_BUFFER_SIZE");
+            } else if (test == 2) {
+                subtest_name = "writing each command";
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_BUFFER_SIZE", "0");
+            } else {
+                // A small capture buffer, so that capturing has to wait for the formatting thread.
+                subtest_name = "deferring formatting";
+                LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_BUFFER_SIZE");
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_DEFER_FORMATTING", "1");
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_CAPTURE_BUFFER_SIZE", "16384");
+            }
+            remove(dump_filename.c_str());
+
+            LoaderTestSession test_session;
+            XrResult create_result = LoaderTestCreateSession(test_session);
+            TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance, session and space " + subtest_name)
+            if (XR_FAILED(create_result)) {
+                continue;
+            }
+
+            bool located = true;
+            const double locate_ns = LoaderTestTimeCalls("xrLocateSpace " + subtest_name, locate_count, [&](uint32_t locate) {
+                XrSpaceLocation location = {XR_TYPE_SPACE_LOCATION, nullptr};
+                located = XR_SUCCEEDED(xrLocateSpace(test_session.space, test_session.space, 1 + locate, &location)) && located;
+            });
+            if (test == 0) {
+                undumped_ns = locate_ns;
+            } else {
+                cout << "        Of which dumping: " << locate_ns - undumped_ns << " ns" << endl;
+            }
+            TEST_EQUAL(located, true, "Locating spaces " + subtest_name)
+
+            TEST_EQUAL(LoaderTestDestroySession(test_session), XR_SUCCESS,
+                       "Destroying space, session and instance " + subtest_name)
+            if (test == 0) {
+                continue;
+            }
+
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrLocateSpace"), static_cast<int64_t>(locate_count),
+                       "Every xrLocateSpace is written by xrDestroyInstance " + subtest_name)
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrDestroyInstance"), static_cast<int64_t>(1),
+                       "xrDestroyInstance is written " + subtest_name)
+            if (test == 1) {
+                std::ifstream dump_file(dump_filename, std::ios::binary | std::ios::ate);
+                dump_size = dump_file.tellg();
+            } else if (test == 3) {
+                // Deferred commands are still written in the order they were called.
+                std::ifstream dump_file(dump_filename);
+                std::string line;
+                std::string last_command;
+                uint32_t in_order = 0;
+                while (std::getline(dump_file, line)) {
+                    if (line.compare(0, 9, "XrResult ") == 0) {
+                        last_command = line;
+                    } else if (line == "    XrTime time = " + std::to_string(1 + in_order)) {
+                        ++in_order;
+                    }
+                }
+                TEST_EQUAL(in_order, locate_count, "xrLocateSpace is written in order " + subtest_name)
+                TEST_EQUAL(last_command, std::string("XrResult xrDestroyInstance"),
+                           "xrDestroyInstance is written last " + subtest_name)
+            }
+        }
+
+        // One xrLocateSpace's share of the dump, appended the way the layer used to.
+        if (dump_size > 0) {
+            const std::string record(static_cast<size_t>(dump_size) / (locate_count + 10), 'x');
+            const std::string reopened_filename = "api_dump_reopened.txt";
+            LoaderTestTimeCalls("Opening, appending " + std::to_string(record.size()) + " bytes and closing, as before",
+                                locate_count, [&](uint32_t) {
+                                    std::ofstream text_file;
+                                    text_file.open(reopened_filename, std::ios::out | std::ios::app);
+                                    text_file << record;
+                                    text_file.close();
+                                });
+            remove(reopened_filename.c_str());
+        }
+        remove(dump_filename.c_str());
+        remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_BUFFER_SIZE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_DEFER_FORMATTING");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_CAPTURE_BUFFER_SIZE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpOutput)
+}
+
+// Check that the commands and frames chosen by the API dump settings are the ones dumped.
+DEFINE_TEST(TestApiDumpFilter) {
+    INIT_TEST(TestApiDumpFilter)
+
+    try {
+        const uint32_t frame_count = 10;
+        const std::string dump_filename = "api_dump_filtered.txt";
+
+        std::string manifest_filename;
+        if (!UseApiDumpLayerManifest(manifest_filename)) {
+            TEST_FAIL("Unable to set test runtime and API dump layer paths")
+            TEST_REPORT(TestApiDumpFilter)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_LUNARG_api_dump");
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", dump_filename);
+
+        struct Subtest {
+            const char* name;
+            const char* commands;
+            const char* skip_commands;
+            const char* first_frame;
+            const char* last_frame;
+            const char* frame_interval;
+            // Lines expected for xrCreateInstance, xrWaitFrame, xrLocateSpace and xrEndFrame.
+            int64_t create_instance_lines;
+            int64_t wait_frame_lines;
+            int64_t locate_space_lines;
+            int64_t end_frame_lines;
+        };
+        const Subtest subtests[] = {
+            {"dumping every call", nullptr, nullptr, nullptr, nullptr, nullptr, 1, frame_count, frame_count, frame_count},
+            {"skipping commands", nullptr, "xrWaitFrame, xrBeginFrame", nullptr, nullptr, nullptr, 1, 0, frame_count,
+             frame_count},
+            // Frames 2, 4 and 6.
+            {"dumping a sample of frames", "xrLocateSpace xrEndFrame", nullptr, "2", "7", "2", 0, 0, 3, 3},
+            {"dumping no frames", "xrEndFrame", nullptr, "100", nullptr, nullptr, 0, 0, 0, 0},
+        };
+        for (const Subtest& subtest : subtests) {
+            const std::string subtest_name = subtest.name;
+            const auto set_or_unset = [](const char* name, const char* value) {
+                if (nullptr != value) {
+                    LoaderTestSetEnvironmentVariable(name, value);
+                } else {
+                    LoaderTestUnsetEnvironmentVariable(name);
+                }
+            };
+            set_or_unset("XR_API_DUMP_COMMANDS", subtest.commands);
+            set_or_unset("XR_API_DUMP_SKIP_COMMANDS", subtest.skip_commands);
+            set_or_unset("XR_API_DUMP_FIRST_FRAME", subtest.first_frame);
+            set_or_unset("XR_API_DUMP_LAST_FRAME", subtest.last_frame);
+            set_or_unset("XR_API_DUMP_FRAME_INTERVAL", subtest.frame_interval);
+            remove(dump_filename.c_str());
+
+            LoaderTestSession test_session;
+            XrResult create_result = LoaderTestCreateSession(test_session);
+            TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance, session and space " + subtest_name)
+            if (XR_FAILED(create_result)) {
+                continue;
+            }
+
+            bool frames_succeeded = true;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frames_succeeded = LoaderTestRunFrame(test_session) && frames_succeeded;
+            }
+            LoaderTestReportTime("Frame through API dump " + subtest_name, std::chrono::steady_clock::now() - start,
+                                 frame_count, "frame");
+            TEST_EQUAL(frames_succeeded, true, "Running frames " + subtest_name)
+
+            TEST_EQUAL(LoaderTestDestroySession(test_session), XR_SUCCESS,
+                       "Destroying space, session and instance " + subtest_name)
+
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrCreateInstance"), subtest.create_instance_lines,
+                       "xrCreateInstance lines " + subtest_name)
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrWaitFrame"), subtest.wait_frame_lines,
+                       "xrWaitFrame lines " + subtest_name)
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrLocateSpace"), subtest.locate_space_lines,
+                       "xrLocateSpace lines " + subtest_name)
+            TEST_EQUAL(CountLinesStartingWith(dump_filename, "XrResult xrEndFrame"), subtest.end_frame_lines,
+                       "xrEndFrame lines " + subtest_name)
+        }
+        remove(dump_filename.c_str());
+        remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_COMMANDS");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_SKIP_COMMANDS");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FIRST_FRAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_LAST_FRAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FRAME_INTERVAL");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpFilter)
+}
+
+// Dump from several threads at once, and check that every call is written out whole, with the thread that made it,
+// and that each thread's calls are in the order it made them.
+DEFINE_TEST(TestApiDumpThreads) {
+    INIT_TEST(TestApiDumpThreads)
+
+    try {
+        const uint32_t locate_count = 1000;
+        const uint32_t max_thread_count = 8;
+        // Each thread locates at times of its own: thread_index * kThreadTimes plus the call's number.
+        const XrTime kThreadTimes = 1000000;
+        const std::string dump_filename = "api_dump_threads.txt";
+
+        std::string manifest_filename;
+        if (!UseApiDumpLayerManifest(manifest_filename)) {
+            TEST_FAIL("Unable to set test runtime and API dump layer paths")
+            TEST_REPORT(TestApiDumpThreads)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_LUNARG_api_dump");
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", dump_filename);
+
+        for (uint32_t defer = 0; defer < 2; ++defer) {
+            if (defer != 0) {
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_DEFER_FORMATTING", "1");
+            }
+            for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+                const std::string subtest_name = std::to_string(thread_count) + " threads" +
+                                                 (defer != 0 ? " deferring formatting" : " formatting as called");
+                remove(dump_filename.c_str());
+
+                LoaderTestSession test_session;
+                XrResult create_result = LoaderTestCreateSession(test_session);
+                TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance, session and space " + subtest_name)
+                if (XR_FAILED(create_result)) {
+                    continue;
+                }
+
+                std::atomic<uint32_t> locate_failures(0);
+                std::vector<std::thread> threads;
+                auto start = std::chrono::steady_clock::now();
+                for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+                    threads.emplace_back([&, thread_index]() {
+                        for (uint32_t locate = 0; locate < locate_count; ++locate) {
+                            XrSpaceLocation location = {XR_TYPE_SPACE_LOCATION, nullptr};
+                            if (XR_FAILED(xrLocateSpace(test_session.space, test_session.space,
+                                                        thread_index * kThreadTimes + locate + 1, &location))) {
+                                locate_failures++;
+                            }
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+                LoaderTestReportTime("xrLocateSpace through API dump from " + subtest_name,
+                                     std::chrono::steady_clock::now() - start, locate_count, "call per thread");
+                TEST_EQUAL(locate_failures.load(), 0u, "Locating spaces from " + subtest_name)
+
+                TEST_EQUAL(LoaderTestDestroySession(test_session), XR_SUCCESS,
+                           "Destroying space, session and instance " + subtest_name)
+
+                // Every call starts with the thread that made it, and each thread's locations are numbered in order
+                // under the same thread, which is not that of any other locating thread.
+                std::ifstream dump_file(dump_filename);
+                std::string line;
+                std::string previous_line;
+                std::string thread_line;
+                std::vector<std::string> thread_names(thread_count);
+                std::vector<uint32_t> in_order(thread_count, 0);
+                uint32_t calls_without_thread = 0;
+                uint32_t out_of_place = 0;
+                const std::string time_prefix = "    XrTime time = ";
+                while (std::getline(dump_file, line)) {
+                    if (line.compare(0, 7, "Thread ") == 0) {
+                        thread_line = line;
+                    } else if (line.compare(0, 9, "XrResult ") == 0) {
+                        if (previous_line.compare(0, 7, "Thread ") != 0) {
+                            ++calls_without_thread;
+                        }
+                    } else if (line.compare(0, time_prefix.size(), time_prefix) == 0) {
+                        const XrTime time = std::stoll(line.substr(time_prefix.size()));
+                        const uint64_t thread_index = static_cast<uint64_t>(time / kThreadTimes);
+                        if (thread_index >= thread_count ||
+                            static_cast<uint32_t>(time % kThreadTimes) != 1 + in_order[thread_index]) {
+                            ++out_of_place;
+                            continue;
+                        }
+                        if (thread_names[thread_index].empty()) {
+                            thread_names[thread_index] = thread_line;
+                        } else if (thread_names[thread_index] != thread_line) {
+                            ++out_of_place;
+                        }
+                        ++in_order[thread_index];
+                    }
+                    previous_line = line;
+                }
+                TEST_EQUAL(calls_without_thread, 0u, "Every call shows its thread " + subtest_name)
+                TEST_EQUAL(out_of_place, 0u, "Each thread's calls are written in order " + subtest_name)
+                TEST_EQUAL(std::count(in_order.begin(), in_order.end(), locate_count), static_cast<std::ptrdiff_t>(thread_count),
+                           "Every call is written " + subtest_name)
+                std::sort(thread_names.begin(), thread_names.end());
+                TEST_EQUAL(std::unique(thread_names.begin(), thread_names.end()) - thread_names.begin(),
+                           static_cast<std::ptrdiff_t>(thread_count), "Each thread is shown apart " + subtest_name)
+            }
+        }
+        remove(dump_filename.c_str());
+        remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_DEFER_FORMATTING");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpThreads)
+}
+
+int main(int /*argc*/, char* /*argv*/[]) {
+    uint32_t total_tests = 0;
+    uint32_t total_passed = 0;
+    uint32_t total_skipped = 0;
+    uint32_t total_failed = 0;
+
+#if FILTER_OUT_LOADER_ERRORS == 1
+    // Re-direct std::cerr to a string since we're intentionally causing errors and we don't
+    // want it polluting the output stream.
+    std::stringstream buffer;
+    std::streambuf* original_cerr = nullptr;
+    original_cerr = std::cerr.rdbuf(buffer.rdbuf());
+#endif
+
+    cout << "Starting api_dump_test" << endl << "----------------------" << endl;
+
+    TestApiDumpOutput(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpFilter(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpThreads(total_tests, total_passed, total_skipped, total_failed);
+
+#if FILTER_OUT_LOADER_ERRORS == 1
+    // Restore std::cerr to the original buffer
+    std::cerr.rdbuf(original_cerr);
+#endif
+
+    cout << "    Results:" << endl << "    ------------------------------" << endl;
+    cout << "        Total Tests:    " << std::to_string(total_tests) << endl;
+    cout << "        Tests Passed:   " << std::to_string(total_passed) << endl;
+    cout << "        Tests Skipped:  " << std::to_string(total_skipped) << endl;
+    cout << "        Tests Failed:   " << std::to_string(total_failed) << endl;
+    cout << "        Overall Result: ";
+    if (total_failed > 0) {
+        cout << "Failed" << endl;
+        return -1;
+    }
+    cout << "Passed" << endl;
+    return 0;
+}
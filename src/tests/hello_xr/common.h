@@ -6,17 +6,12 @@
 #include <stdarg.h>
 #include <stddef.h>
 
-// Macro to generate stringify functions for OpenXR enumerations based data provided in openxr_reflection.h
-// clang-format off
-#define ENUM_CASE_STR(name, val) case name: return #name;
-#define MAKE_TO_STRING_FUNC(enumType)                  \
-    inline const char* to_string(enumType e) {         \
-        switch (e) {                                   \
-            XR_LIST_ENUM_##enumType(ENUM_CASE_STR)     \
-            default: return "Unknown " #enumType;      \
-        }                                              \
+// Macro to generate stringify functions for OpenXR enumerations from the name tables in common/enum_names.h
+#define MAKE_TO_STRING_FUNC(enumType)                         \
+    inline const char* to_string(enumType e) {                \
+        const char* name = XrSdkEnumName(e);                  \
+        return name != nullptr ? name : "Unknown " #enumType; \
     }
-// clang-format on
 
 MAKE_TO_STRING_FUNC(XrReferenceSpaceType);
 MAKE_TO_STRING_FUNC(XrViewConfigurationType);
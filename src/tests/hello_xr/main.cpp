@@ -36,6 +36,7 @@ void ShowHelp() {
     Log::Write(Log::Level::Info, "Form factors:             Hmd, Handheld");
     Log::Write(Log::Level::Info, "View configurations:      Mono, Stereo");
     Log::Write(Log::Level::Info, "Environment blend modes:  Opaque, Additive, AlphaBlend");
+    Log::Write(Log::Level::Info, "                          (or the name of any enumerant, e.g. XR_FORM_FACTOR_HANDHELD_DISPLAY)");
     Log::Write(Log::Level::Info, "Spaces:                   View, Local, Stage");
 }
 
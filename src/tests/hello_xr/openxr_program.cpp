@@ -31,6 +31,11 @@ inline XrFormFactor GetXrFormFactor(const std::string& formFactorStr) {
     if (EqualsIgnoreCase(formFactorStr, "Handheld")) {
         return XR_FORM_FACTOR_HANDHELD_DISPLAY;
     }
+    // Also accept the name of any enumerant, such as the ones to_string() prints.
+    XrFormFactor formFactor;
+    if (XrSdkEnumFromName(formFactorStr.c_str(), &formFactor)) {
+        return formFactor;
+    }
     throw std::invalid_argument(Fmt("Unknown form factor '%s'", formFactorStr.c_str()));
 }
 
@@ -41,6 +46,11 @@ inline XrViewConfigurationType GetXrViewConfigurationType(const std::string& vie
     if (EqualsIgnoreCase(viewConfigurationStr, "Stereo")) {
         return XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
     }
+    // Also accept the name of any enumerant, such as the ones to_string() prints.
+    XrViewConfigurationType viewConfigurationType;
+    if (XrSdkEnumFromName(viewConfigurationStr.c_str(), &viewConfigurationType)) {
+        return viewConfigurationType;
+    }
     throw std::invalid_argument(Fmt("Unknown view configuration '%s'", viewConfigurationStr.c_str()));
 }
 
@@ -54,6 +64,11 @@ inline XrEnvironmentBlendMode GetXrEnvironmentBlendMode(const std::string& envir
     if (EqualsIgnoreCase(environmentBlendModeStr, "AlphaBlend")) {
         return XR_ENVIRONMENT_BLEND_MODE_ALPHA_BLEND;
     }
+    // Also accept the name of any enumerant, such as the ones to_string() prints.
+    XrEnvironmentBlendMode environmentBlendMode;
+    if (XrSdkEnumFromName(environmentBlendModeStr.c_str(), &environmentBlendMode)) {
+        return environmentBlendMode;
+    }
     throw std::invalid_argument(Fmt("Unknown environment blend mode '%s'", environmentBlendModeStr.c_str()));
 }
 
@@ -20,24 +20,46 @@
 // Author: Dave Houlton <daveh@lunarg.com>
 //
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <cstring>
+#include <thread>
 #include <vector>
 
 #include "filesystem_utils.hpp"
 #include "loader_test_utils.hpp"
 
+#include "enum_names.h"
+#include "format_buffer.h"
 #include "hex_and_handles.h"
+#include "loader_binary_log.h"
+#include "loader_interfaces.h"
 
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
+#include <openxr/openxr_loader.h>
 #include <openxr/openxr_platform.h>
 
 #ifdef XR_USE_GRAPHICS_API_D3D11
 #include "d3d11.h"
 #endif
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif  // !_WIN32
+
+#ifdef XR_OS_LINUX
+#include <link.h>
+#endif  // XR_OS_LINUX
+
 #include <type_traits>
 static_assert(sizeof(XrStructureType) == 4, "This should be a 32-bit enum");
 
@@ -53,12 +75,25 @@ enum LoaderTestGraphicsApiToUse { GRAPHICS_API_UNKONWN = 0, GRAPHICS_API_OPENGL,
 LoaderTestGraphicsApiToUse g_graphics_api_to_use = GRAPHICS_API_UNKONWN;
 bool g_debug_utils_exists = false;
 bool g_has_installed_runtime = false;
-
-void CleanupEnvironmentVariables() {
-    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
-    LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
-    LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+// Path this test was started with, to start it again in a new process.
+std::string g_loader_test_path;
+
+// Argument that makes loader_test create an instance in timing mode instead of running the tests, since the loader
+// only reads XR_LOADER_DEBUG once per process.
+static const char* const kStartupTimingChildArg = "--startup-timing-child";
+// Argument, followed by a file name, that makes loader_test log errors to a binary log instead of running the tests,
+// since the loader only reads XR_LOADER_BINARY_LOG_FILE once per process.
+static const char* const kBinaryLogChildArg = "--binary-log-child";
+
+#ifdef XR_OS_LINUX
+// Whether a library whose path contains the given name is loaded into this process.
+static bool IsLibraryLoaded(const char* name) {
+    auto find = [](struct dl_phdr_info* info, size_t, void* data) -> int {
+        return (nullptr != info->dlpi_name && nullptr != strstr(info->dlpi_name, static_cast<const char*>(data))) ? 1 : 0;
+    };
+    return 0 != dl_iterate_phdr(find, const_cast<char*>(name));
 }
+#endif  // XR_OS_LINUX
 
 bool DetectInstalledRuntime() {
     bool runtime_found = false;
@@ -498,55 +533,499 @@ void TestEnumInstanceExtensions(uint32_t& total, uint32_t& passed, uint32_t& ski
     skipped += local_skipped;
 }
 
-#define DEFINE_TEST(test_name) void test_name(uint32_t& total, uint32_t& passed, uint32_t& skipped, uint32_t& failed)
-
-#define INIT_TEST(test_name)    \
-    uint32_t local_total = 0;   \
-    uint32_t local_passed = 0;  \
-    uint32_t local_skipped = 0; \
-    uint32_t local_failed = 0;  \
-    cout << "    Starting " << #test_name << endl;
-
-#define TEST_REPORT(test_name)                                                                                             \
-    cout << "    Finished " << #test_name << ": ";                                                                         \
-    if (local_failed > 0) {                                                                                                \
-        cout << "Failed (Local - Passed: " << std::to_string(local_passed) << ", Failed: " << std::to_string(local_failed) \
-             << ", Skipped: " << std::to_string(local_skipped) << ")" << endl                                              \
-             << endl;                                                                                                      \
-    } else {                                                                                                               \
-        cout << "Passed (Local - Passed: " << std::to_string(local_passed) << ", Failed: " << std::to_string(local_failed) \
-             << ", Skipped: " << std::to_string(local_skipped) << ")" << endl                                              \
-             << endl;                                                                                                      \
-    }                                                                                                                      \
-    total += local_total;                                                                                                  \
-    passed += local_passed;                                                                                                \
-    failed += local_failed;                                                                                                \
-    skipped += local_skipped;
+// Write a minimal explicit API layer manifest, whose library is never loaded by the enumeration tests.
+static bool WriteTestLayerManifest(const std::string& filename, const std::string& layer_name, const std::string& description) {
+    std::ofstream manifest(filename, std::ofstream::out | std::ofstream::trunc);
+    manifest << "{\n"
+             << "    \"file_format_version\": \"1.0.0\",\n"
+             << "    \"api_layer\": {\n"
+             << "        \"name\": \"" << layer_name << "\",\n"
+             << "        \"library_path\": \"libXrApiLayer_manifest_test.so\",\n"
+             << "        \"api_version\": \"1.0\",\n"
+             << "        \"implementation_version\": \"1\",\n"
+             << "        \"description\": \"" << description << "\"\n"
+             << "    }\n"
+             << "}\n";
+    return manifest.good();
+}
+
+// Find the description of the manifest cache test layer among the available API layers.
+static std::string GetTestLayerDescription() {
+    uint32_t layer_count = 0;
+    if (XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr))) {
+        return {};
+    }
+    std::vector<XrApiLayerProperties> layer_props(layer_count, {XR_TYPE_API_LAYER_PROPERTIES, nullptr, {0, 0}});
+    if (XR_FAILED(xrEnumerateApiLayerProperties(layer_count, &layer_count, layer_props.data()))) {
+        return {};
+    }
+    for (const XrApiLayerProperties& prop : layer_props) {
+        if (strcmp(prop.layerName, "XR_APILAYER_manifest_cache_test") == 0) {
+            return prop.description;
+        }
+    }
+    return {};
+}
+
+// Test that the on-disk manifest cache is written, picks up changed manifests, survives a corrupt cache
+// file, and report how much it saves when enumerating API layers.
+DEFINE_TEST(TestManifestCache) {
+    INIT_TEST(TestManifestCache)
+
+    try {
+        const uint32_t enumerate_iterations = 200;
+
+        std::string current_path;
+        std::string cache_home;
+        std::string manifest_dir;
+        std::string manifest_filename;
+        std::string layer_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "manifest_cache", cache_home) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/layers", manifest_dir) ||
+            !FileSysUtilsCombinePaths(current_path, "manifest_cache_layer.json", manifest_filename) ||
+            !FileSysUtilsCombinePaths(current_path, "../../api_layers", layer_path)) {
+            TEST_FAIL("Unable to set up manifest cache paths")
+            TEST_REPORT(TestManifestCache)
+            return;
+        }
+        const std::string cache_filename = cache_home + "/openxr/1/loader_manifest_cache.bin";
+        remove(cache_filename.c_str());
+        LoaderTestSetEnvironmentVariable("XDG_CACHE_HOME", cache_home);
+        // The test layer manifest is written to the current directory, which holds no other manifests.
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", manifest_dir + TEST_PATH_SEPARATOR + layer_path +
+                                                                  TEST_PATH_SEPARATOR + current_path);
+
+        const std::string layer_name = "XR_APILAYER_manifest_cache_test";
+        TEST_EQUAL(WriteTestLayerManifest(manifest_filename, layer_name, "First description"), true, "Writing test layer manifest")
+        TEST_EQUAL(GetTestLayerDescription(), std::string("First description"), "Reading a manifest through an empty cache")
+        TEST_EQUAL(FileSysUtilsPathExists(cache_filename), true, "Manifest cache file written")
+        TEST_EQUAL(GetTestLayerDescription(), std::string("First description"), "Reading an unchanged manifest from the cache")
+
+        TEST_EQUAL(WriteTestLayerManifest(manifest_filename, layer_name, "Second, longer description"), true,
+                   "Rewriting test layer manifest")
+        TEST_EQUAL(GetTestLayerDescription(), std::string("Second, longer description"), "Reading a changed manifest")
+
+        {
+            std::ofstream corrupt_cache(cache_filename, std::ofstream::out | std::ofstream::trunc);
+            corrupt_cache << "XRMC this is not a manifest cache";
+        }
+        TEST_EQUAL(GetTestLayerDescription(), std::string("Second, longer description"), "Reading past a corrupt cache")
+
+        uint32_t expected_count = 0;
+        TEST_EQUAL(xrEnumerateApiLayerProperties(0, &expected_count, nullptr), XR_SUCCESS, "Enumerating API layers")
+        for (uint32_t test = 0; test < 2; ++test) {
+            const bool cached = (test == 1);
+            const std::string subtest_name = cached ? "cached manifests" : "manifest cache disabled";
+            if (cached) {
+                LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE", "1");
+            }
+            bool count_matches = true;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < enumerate_iterations; ++iteration) {
+                uint32_t layer_count = 0;
+                xrEnumerateApiLayerProperties(0, &layer_count, nullptr);
+                count_matches = count_matches && (layer_count == expected_count);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(count_matches, true, "Enumerating API layers with " + subtest_name)
+            cout << "        xrEnumerateApiLayerProperties of " << expected_count << " layers with " << subtest_name << ": "
+                 << NanosecondsPerIteration(elapsed, enumerate_iterations) / 1000.0 << " us per call" << endl;
+        }
+        remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+    LoaderTestUnsetEnvironmentVariable("XDG_CACHE_HOME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestCache)
+}
+
+// Time API layer discovery over 1,000 synthetic manifests as more threads read them, both parsing every manifest
+// and reading them from the manifest cache, and check that the layers are reported in the same order either way.
+DEFINE_TEST(TestManifestDiscoveryScaling) {
+    INIT_TEST(TestManifestDiscoveryScaling)
+
+    try {
+        const uint32_t manifest_count = 1000;
+        const uint32_t discovery_iterations = 5;
+        const uint32_t max_thread_count = 8;
+
+        std::string current_path;
+        std::string manifest_dir;
+        std::string cache_home;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "synthetic_layers", manifest_dir) || !LoaderTestCreateDirectory(manifest_dir) ||
+            !FileSysUtilsCombinePaths(manifest_dir, "cache", cache_home)) {
+            TEST_FAIL("Unable to create synthetic manifest directory")
+            TEST_REPORT(TestManifestDiscoveryScaling)
+            return;
+        }
+        bool wrote_manifests = true;
+        for (uint32_t index = 0; index < manifest_count && wrote_manifests; ++index) {
+            const std::string layer_name = "XR_APILAYER_synthetic_" + std::to_string(index);
+            std::string manifest_filename;
+            wrote_manifests = FileSysUtilsCombinePaths(manifest_dir, layer_name + ".json", manifest_filename) &&
+                              WriteTestLayerManifest(manifest_filename, layer_name, "Synthetic layer " + std::to_string(index));
+        }
+        TEST_EQUAL(wrote_manifests, true, "Writing " + std::to_string(manifest_count) + " synthetic layer manifests")
+
+        // The cache is kept with the manifests, so that it starts empty and is removed along with them.
+        LoaderTestSetEnvironmentVariable("XDG_CACHE_HOME", cache_home);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", manifest_dir);
+
+        std::vector<std::string> serial_layer_names;
+        for (uint32_t test = 0; test < 2; ++test) {
+            const bool cached = (test == 1);
+            if (cached) {
+                LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+                // Fill the cache, so that every timed discovery reads from it.
+                uint32_t layer_count = 0;
+                xrEnumerateApiLayerProperties(0, &layer_count, nullptr);
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE", "1");
+            }
+            for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_MANIFEST_THREADS", std::to_string(thread_count));
+                const std::string subtest_name =
+                    std::to_string(thread_count) + " threads" + (cached ? " and cached manifests" : " and the cache disabled");
+
+                std::vector<std::string> layer_names;
+                bool enumerate_failed = false;
+                auto start = std::chrono::steady_clock::now();
+                for (uint32_t iteration = 0; iteration < discovery_iterations && !enumerate_failed; ++iteration) {
+                    uint32_t layer_count = 0;
+                    enumerate_failed = XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr));
+                    if (iteration == 0 && !enumerate_failed) {
+                        std::vector<XrApiLayerProperties> layer_props(layer_count, {XR_TYPE_API_LAYER_PROPERTIES, nullptr, {0, 0}});
+                        enumerate_failed = XR_FAILED(xrEnumerateApiLayerProperties(layer_count, &layer_count, layer_props.data()));
+                        for (const XrApiLayerProperties& prop : layer_props) {
+                            layer_names.emplace_back(prop.layerName);
+                        }
+                    }
+                }
+                auto elapsed = std::chrono::steady_clock::now() - start;
+
+                TEST_EQUAL(enumerate_failed, false, "Enumerating synthetic layers with " + subtest_name)
+                TEST_EQUAL(static_cast<uint32_t>(layer_names.size()), manifest_count, "Synthetic layer count with " + subtest_name)
+                if (serial_layer_names.empty()) {
+                    serial_layer_names = layer_names;
+                } else {
+                    TEST_EQUAL(layer_names == serial_layer_names, true, "Synthetic layer order with " + subtest_name)
+                }
+                cout << "        Discovering " << manifest_count << " layer manifests with " << subtest_name << ": "
+                     << NanosecondsPerIteration(elapsed, discovery_iterations) / 1000000.0 << " ms" << endl;
+            }
+        }
+
+        for (uint32_t index = 0; index < manifest_count; ++index) {
+            std::string manifest_filename;
+            FileSysUtilsCombinePaths(manifest_dir, "XR_APILAYER_synthetic_" + std::to_string(index) + ".json", manifest_filename);
+            remove(manifest_filename.c_str());
+        }
+        remove((cache_home + "/openxr/1/loader_manifest_cache.bin").c_str());
+        LoaderTestRemoveDirectory(cache_home + "/openxr/1");
+        LoaderTestRemoveDirectory(cache_home + "/openxr");
+        LoaderTestRemoveDirectory(cache_home);
+        TEST_EQUAL(LoaderTestRemoveDirectory(manifest_dir), true, "Removing synthetic manifest directory")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_MANIFEST_THREADS");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+    LoaderTestUnsetEnvironmentVariable("XDG_CACHE_HOME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestDiscoveryScaling)
+}
+
+// Count the API layers the loader finds, or return -1 on failure.
+static int64_t CountApiLayers() {
+    uint32_t layer_count = 0;
+    return XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr)) ? -1 : static_cast<int64_t>(layer_count);
+}
+
+// Check that API layer discovery finds each manifest once however many search paths, or links, reach it, skips
+// anything that is not a regular file, and notices manifests added after a directory was scanned.  Also time
+// discovery against listing the directory and resolving the path of every file in it, as discovery used to.
+DEFINE_TEST(TestManifestDirectoryScan) {
+    INIT_TEST(TestManifestDirectoryScan)
+
+    try {
+        const uint32_t manifest_count = 2000;
+        const uint32_t iterations = 5;
+
+        std::string current_path;
+        std::string manifest_dir;
+        std::string subdirectory;
+        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "scanned_layers", manifest_dir) ||
+            !LoaderTestCreateDirectory(manifest_dir) || !FileSysUtilsCombinePaths(manifest_dir, "directory.json", subdirectory) ||
+            !LoaderTestCreateDirectory(subdirectory)) {
+            TEST_FAIL("Unable to create scanned manifest directory")
+            TEST_REPORT(TestManifestDirectoryScan)
+            return;
+        }
+        std::vector<std::string> manifest_filenames;
+        bool wrote_manifests = true;
+        for (uint32_t index = 0; index <= manifest_count && wrote_manifests; ++index) {
+            const std::string layer_name = "XR_APILAYER_scanned_" + std::to_string(index);
+            std::string manifest_filename;
+            wrote_manifests = FileSysUtilsCombinePaths(manifest_dir, layer_name + ".json", manifest_filename);
+            manifest_filenames.push_back(manifest_filename);
+            // The last manifest is only written once the directory has been scanned.
+            if (index < manifest_count) {
+                wrote_manifests = wrote_manifests && WriteTestLayerManifest(manifest_filename, layer_name, "Scanned layer");
+            }
+        }
+        std::string notes_filename;
+        FileSysUtilsCombinePaths(manifest_dir, "notes.txt", notes_filename);
+        std::ofstream(notes_filename) << "Not a manifest\n";
+        TEST_EQUAL(wrote_manifests, true, "Writing " + std::to_string(manifest_count) + " layer manifests")
+
+        std::string link_filename;
+#ifndef _WIN32
+        FileSysUtilsCombinePaths(manifest_dir, "link_to_first.json", link_filename);
+        remove(link_filename.c_str());
+        TEST_EQUAL(symlink(manifest_filenames[0].c_str(), link_filename.c_str()), 0, "Linking to a manifest")
+#endif  // !_WIN32
+
+        // Measure listing the directories, not reading manifests from the manifest cache.
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE", "1");
+        // The same directory three times: as is, through ".", and relative to the current directory.
+        const std::string search_path = manifest_dir + TEST_PATH_SEPARATOR + manifest_dir + TEST_DIRECTORY_SYMBOL + "." +
+                                        TEST_PATH_SEPARATOR + "scanned_layers";
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", search_path);
+        TEST_EQUAL(CountApiLayers(), static_cast<int64_t>(manifest_count), "Each manifest is found once")
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            CountApiLayers();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        Discovering " << manifest_count << " layer manifests in 3 search paths: "
+             << NanosecondsPerIteration(elapsed, iterations) / 1000000.0 << " ms" << endl;
+
+        size_t listed = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            for (uint32_t path = 0; path < 3; ++path) {
+                std::vector<std::string> files;
+                FileSysUtilsFindFilesInPath(manifest_dir, files);
+                for (const std::string& file : files) {
+                    std::string relative_path;
+                    std::string absolute_path;
+                    FileSysUtilsCombinePaths(manifest_dir, file, relative_path);
+                    listed += FileSysUtilsGetAbsolutePath(relative_path, absolute_path) ? 1 : 0;
+                }
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        Only listing 3 search paths and resolving each file, as before: "
+             << NanosecondsPerIteration(elapsed, iterations) / 1000000.0 << " ms (" << listed / iterations << " files)" << endl;
+
+        TEST_EQUAL(WriteTestLayerManifest(manifest_filenames[manifest_count], "XR_APILAYER_scanned_added", "Scanned layer"), true,
+                   "Adding a manifest")
+        TEST_EQUAL(CountApiLayers(), static_cast<int64_t>(manifest_count + 1), "A manifest added later is found")
+
+        for (const std::string& manifest_filename : manifest_filenames) {
+            remove(manifest_filename.c_str());
+        }
+        remove(notes_filename.c_str());
+        if (!link_filename.empty()) {
+            remove(link_filename.c_str());
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestDirectoryScan)
+}
 
-#define TEST_EQUAL(test, expected, cout_string)                  \
-    local_total++;                                               \
-    if (expected != (test)) {                                    \
-        cout << "        " << cout_string << ": Failed" << endl; \
-        local_failed++;                                          \
-    } else {                                                     \
-        cout << "        " << cout_string << ": Passed" << endl; \
-        local_passed++;                                          \
+// Write an explicit API layer manifest listing the given number of instance extensions, followed by a vendor
+// section that the loader never reads.
+static bool WriteLargeLayerManifest(const std::string& filename, const std::string& layer_name, uint32_t extension_count,
+                                    uint32_t vendor_entry_count) {
+    std::ofstream manifest(filename, std::ofstream::out | std::ofstream::trunc);
+    manifest << "{\n"
+             << "    \"file_format_version\": \"1.0.0\",\n"
+             << "    \"api_layer\": {\n"
+             << "        \"name\": \"" << layer_name << "\",\n"
+             << "        \"library_path\": \"libXrApiLayer_manifest_test.so\",\n"
+             << "        \"api_version\": \"1.0\",\n"
+             << "        \"implementation_version\": \"1\",\n"
+             << "        \"description\": \"Layer with a large manifest\",\n"
+             << "        \"instance_extensions\": [\n";
+    for (uint32_t index = 0; index < extension_count; ++index) {
+        manifest << "            {\"name\": \"XR_TEST_large_manifest_" << index << "\", \"extension_version\": " << index + 1
+                 << ", \"entrypoints\": [\"xrTestFunctionA" << index << "\", \"xrTestFunctionB" << index << "\"]}"
+                 << (index + 1 < extension_count ? ",\n" : "\n");
     }
+    manifest << "        ],\n"
+             << "        \"x_vendor_data\": [\n";
+    for (uint32_t index = 0; index < vendor_entry_count; ++index) {
+        manifest << "            {\"key\": \"vendor\\u00e9 " << index << "\", \"values\": [1, 2.5, true, null]}"
+                 << (index + 1 < vendor_entry_count ? ",\n" : "\n");
+    }
+    manifest << "        ]\n"
+             << "    }\n"
+             << "}\n";
+    return manifest.good();
+}
+
+// Compare the loader's manifest parser against parsing with jsoncpp alone, on many small layer manifests and on
+// one large one, and check that both give the same results.
+DEFINE_TEST(TestManifestParserTiming) {
+    INIT_TEST(TestManifestParserTiming)
+
+    try {
+        const uint32_t manifest_count = 1000;
+        const uint32_t large_extension_count = 200;
+        const uint32_t large_vendor_entry_count = 20000;
+        const uint32_t many_file_iterations = 5;
+        const uint32_t large_file_iterations = 20;
+        const char* const parser_names[] = {"jsoncpp", "manifest parser"};
 
-#define TEST_NOT_EQUAL(test, expected, cout_string)              \
-    local_total++;                                               \
-    if (expected == (test)) {                                    \
-        cout << "        " << cout_string << ": Failed" << endl; \
-        local_failed++;                                          \
-    } else {                                                     \
-        cout << "        " << cout_string << ": Passed" << endl; \
-        local_passed++;                                          \
+        std::string current_path;
+        std::string many_dir;
+        std::string large_dir;
+        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "synthetic_layers", many_dir) ||
+            !FileSysUtilsCombinePaths(current_path, "large_layer", large_dir) || !LoaderTestCreateDirectory(many_dir) ||
+            !LoaderTestCreateDirectory(large_dir)) {
+            TEST_FAIL("Unable to create synthetic manifest directories")
+            TEST_REPORT(TestManifestParserTiming)
+            return;
+        }
+        bool wrote_manifests = true;
+        for (uint32_t index = 0; index < manifest_count && wrote_manifests; ++index) {
+            const std::string layer_name = "XR_APILAYER_synthetic_" + std::to_string(index);
+            std::string manifest_filename;
+            const std::string description = "Synthetic layer \\u00e9 " + std::to_string(index);
+            wrote_manifests = FileSysUtilsCombinePaths(many_dir, layer_name + ".json", manifest_filename) &&
+                              WriteTestLayerManifest(manifest_filename, layer_name, description);
+        }
+        std::string large_filename;
+        wrote_manifests = wrote_manifests && FileSysUtilsCombinePaths(large_dir, "large_layer.json", large_filename) &&
+                          WriteLargeLayerManifest(large_filename, "XR_APILAYER_large_manifest", large_extension_count,
+                                                  large_vendor_entry_count);
+        TEST_EQUAL(wrote_manifests, true, "Writing synthetic layer manifests")
+
+        // Measure the reading and parsing, not the manifest cache.
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE", "1");
+        LoaderTestSetEnvironmentVariable("XR_LOADER_MANIFEST_THREADS", "1");
+
+        std::vector<std::string> layer_descriptions[2];
+        uint32_t extension_versions[2] = {};
+        for (uint32_t parser = 0; parser < 2; ++parser) {
+            if (parser == 0) {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_PARSER", "1");
+            } else {
+                LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_PARSER");
+            }
+            const std::string subtest_name = std::string(" with ") + parser_names[parser];
+
+            LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", many_dir);
+            bool enumerate_failed = false;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < many_file_iterations && !enumerate_failed; ++iteration) {
+                uint32_t layer_count = 0;
+                enumerate_failed = XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr));
+                if (iteration == 0 && !enumerate_failed) {
+                    std::vector<XrApiLayerProperties> layer_props(layer_count, {XR_TYPE_API_LAYER_PROPERTIES, nullptr, {0, 0}});
+                    enumerate_failed = XR_FAILED(xrEnumerateApiLayerProperties(layer_count, &layer_count, layer_props.data()));
+                    for (const XrApiLayerProperties& prop : layer_props) {
+                        layer_descriptions[parser].emplace_back(std::string(prop.layerName) + ": " + prop.description);
+                    }
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(enumerate_failed, false, "Enumerating synthetic layers" + subtest_name)
+            TEST_EQUAL(static_cast<uint32_t>(layer_descriptions[parser].size()), manifest_count,
+                       "Synthetic layer count" + subtest_name)
+            cout << "        Discovering " << manifest_count << " layer manifests" << subtest_name << ": "
+                 << NanosecondsPerIteration(elapsed, many_file_iterations) / 1000000.0 << " ms" << endl;
+
+            LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", large_dir);
+            std::vector<XrExtensionProperties> extension_props;
+            enumerate_failed = false;
+            start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < large_file_iterations && !enumerate_failed; ++iteration) {
+                uint32_t extension_count = 0;
+                enumerate_failed = XR_FAILED(
+                    xrEnumerateInstanceExtensionProperties("XR_APILAYER_large_manifest", 0, &extension_count, nullptr));
+                if (iteration == 0 && !enumerate_failed) {
+                    extension_props.resize(extension_count, {XR_TYPE_EXTENSION_PROPERTIES, nullptr, {0}, 0});
+                    enumerate_failed = XR_FAILED(xrEnumerateInstanceExtensionProperties(
+                        "XR_APILAYER_large_manifest", extension_count, &extension_count, extension_props.data()));
+                }
+            }
+            elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(enumerate_failed, false, "Enumerating large layer manifest extensions" + subtest_name)
+            TEST_EQUAL(static_cast<uint32_t>(extension_props.size()), large_extension_count,
+                       "Large layer manifest extension count" + subtest_name)
+            for (const XrExtensionProperties& prop : extension_props) {
+                extension_versions[parser] += prop.extensionVersion;
+            }
+            cout << "        Reading a layer manifest with " << large_extension_count << " extensions and "
+                 << large_vendor_entry_count << " vendor entries" << subtest_name << ": "
+                 << NanosecondsPerIteration(elapsed, large_file_iterations) / 1000.0 << " us" << endl;
+        }
+        TEST_EQUAL(layer_descriptions[1] == layer_descriptions[0], true, "Synthetic layers match between parsers")
+        TEST_EQUAL(extension_versions[1], extension_versions[0], "Large layer manifest extensions match between parsers")
+        TEST_EQUAL(std::count(layer_descriptions[1].begin(), layer_descriptions[1].end(),
+                              "XR_APILAYER_synthetic_0: Synthetic layer \xc3\xa9 0"),
+                   1, "Unicode escape in a layer description")
+
+        // jsoncpp allows comments, so manifests with them must still be accepted.
+        std::ofstream commented_manifest(large_filename, std::ofstream::out | std::ofstream::trunc);
+        commented_manifest << "{\n"
+                           << "    // A comment\n"
+                           << "    \"file_format_version\": \"1.0.0\",\n"
+                           << "    \"api_layer\": {\n"
+                           << "        \"name\": \"XR_APILAYER_manifest_cache_test\",\n"
+                           << "        \"library_path\": \"libXrApiLayer_manifest_test.so\",\n"
+                           << "        \"api_version\": \"1.0\",\n"
+                           << "        \"implementation_version\": \"1\",\n"
+                           << "        \"description\": \"Commented\"\n"
+                           << "    }\n"
+                           << "}\n";
+        commented_manifest.close();
+        TEST_EQUAL(GetTestLayerDescription(), "Commented", "Layer manifest with a comment")
+
+        for (uint32_t index = 0; index < manifest_count; ++index) {
+            std::string manifest_filename;
+            FileSysUtilsCombinePaths(many_dir, "XR_APILAYER_synthetic_" + std::to_string(index) + ".json", manifest_filename);
+            remove(manifest_filename.c_str());
+        }
+        remove(large_filename.c_str());
+        TEST_EQUAL(LoaderTestRemoveDirectory(many_dir) && LoaderTestRemoveDirectory(large_dir), true,
+                   "Removing synthetic manifest directories")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
     }
 
-#define TEST_FAIL(cout_string) \
-    local_total++;             \
-    local_failed++;            \
-    cout << "        " << cout_string << ": Failed" << endl;
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_MANIFEST_THREADS");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_CACHE");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DISABLE_MANIFEST_PARSER");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestParserTiming)
+}
 
 // Test creating and destroying an OpenXR instance through the loader.
 DEFINE_TEST(TestCreateDestroyInstance) {
@@ -2074,15 +2553,1663 @@ DEFINE_TEST(TestDebugUtils) {
     TEST_REPORT(TestDebugUtils)
 }
 
-int main(int argc, char* argv[]) {
-    uint32_t total_tests = 0;
-    uint32_t total_passed = 0;
-    uint32_t total_skipped = 0;
-    uint32_t total_failed = 0;
+// Measure the cost of resolving commands through xrGetInstanceProcAddr and of creating an instance, using the test
+// runtime so that the numbers mostly reflect the work done by the loader itself.
+DEFINE_TEST(TestGetInstanceProcAddrTiming) {
+    INIT_TEST(TestGetInstanceProcAddrTiming)
+
+    try {
+        const uint32_t lookup_iterations = 2000;
+        const uint32_t create_iterations = 100;
+        const char* const command_names[] = {
+            "xrGetInstanceProcAddr", "xrDestroyInstance",    "xrGetInstanceProperties", "xrPollEvent",
+            "xrResultToString",      "xrStringToPath",       "xrGetSystem",             "xrGetSystemProperties",
+            "xrCreateSession",       "xrDestroySession",     "xrCreateReferenceSpace",  "xrLocateSpace",
+            "xrCreateSwapchain",     "xrWaitSwapchainImage", "xrWaitFrame",             "xrBeginFrame",
+            "xrEndFrame",            "xrLocateViews",        "xrCreateActionSet",       "xrSyncActions",
+            "xrGetActionStatePose",  "xrApplyHapticFeedback", "xrStopHapticFeedback",   "xrNotARealCommandName",
+        };
+        const uint32_t command_count = static_cast<uint32_t>(sizeof(command_names) / sizeof(command_names[0]));
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestGetInstanceProcAddrTiming)
+            return;
+        }
+
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance with test runtime")
+        if (XR_SUCCEEDED(create_result)) {
+            PFN_xrVoidFunction function = nullptr;
+            TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystem", &function), XR_SUCCESS, "Resolving xrGetSystem")
+            TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrNotARealCommandName", &function), XR_ERROR_FUNCTION_UNSUPPORTED,
+                       "Resolving an unknown command")
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < lookup_iterations; ++iteration) {
+                for (uint32_t command = 0; command < command_count; ++command) {
+                    xrGetInstanceProcAddr(instance, command_names[command], &function);
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            cout << "        xrGetInstanceProcAddr: " << NanosecondsPerIteration(elapsed, lookup_iterations * command_count)
+                 << " ns per lookup" << endl;
+
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+        }
+
+        bool create_failed = false;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < create_iterations && !create_failed; ++iteration) {
+            instance = XR_NULL_HANDLE;
+            create_failed = XR_FAILED(xrCreateInstance(&instance_create_info, &instance)) || XR_FAILED(xrDestroyInstance(instance));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        TEST_EQUAL(create_failed, false, "Repeated instance create/destroy")
+        cout << "        xrCreateInstance + xrDestroyInstance: " << NanosecondsPerIteration(elapsed, create_iterations) / 1000.0
+             << " us per instance" << endl;
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestGetInstanceProcAddrTiming)
+}
+
+// Measure the per-call cost of a generated trampoline, both with no API layers enabled (where the loader can dispatch
+// straight to the runtime) and with the test API layer enabled, relative to calling the runtime function directly.
+DEFINE_TEST(TestTrampolineTiming) {
+    INIT_TEST(TestTrampolineTiming)
+
+    try {
+        const uint32_t call_iterations = 1000000;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestTrampolineTiming)
+            return;
+        }
+
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name;
+            if (test == 0) {
+                subtest_name = "with no API layers";
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                subtest_name = "with the test API layer";
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            XrInstance instance = XR_NULL_HANDLE;
+            XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+            TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance " + subtest_name)
+            if (XR_FAILED(create_result)) {
+                continue;
+            }
+
+            PFN_xrGetSystemProperties get_system_properties = nullptr;
+            TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystemProperties",
+                                             reinterpret_cast<PFN_xrVoidFunction*>(&get_system_properties)),
+                       XR_SUCCESS, "Resolving xrGetSystemProperties " + subtest_name)
+
+            XrSystemProperties properties = {};
+            properties.type = XR_TYPE_SYSTEM_PROPERTIES;
+            TEST_EQUAL(xrGetSystemProperties(instance, 1, &properties), XR_SUCCESS,
+                       "Calling xrGetSystemProperties trampoline " + subtest_name)
+
+            if (get_system_properties != nullptr) {
+                LoaderTestTimeCalls("xrGetSystemProperties via xrGetInstanceProcAddr " + subtest_name, call_iterations,
+                                    [&](uint32_t) { get_system_properties(instance, 1, &properties); });
+            }
+
+            LoaderTestTimeCalls("xrGetSystemProperties trampoline " + subtest_name, call_iterations,
+                                [&](uint32_t) { xrGetSystemProperties(instance, 1, &properties); });
+
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance " + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestTrampolineTiming)
+}
+
+// Test that several instances can be alive at once, and that instances can be created and destroyed
+// from several threads at the same time.
+DEFINE_TEST(TestMultiInstanceStress) {
+    INIT_TEST(TestMultiInstanceStress)
+
+    try {
+        const uint32_t instance_count = 4;
+        const uint32_t thread_count = 8;
+        const uint32_t create_iterations = 100;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestMultiInstanceStress)
+            return;
+        }
+
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        XrSystemGetInfo system_get_info = {};
+        system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
+        system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+
+        // Every live instance must keep working, and only live instances can be destroyed.
+        std::vector<XrInstance> instances;
+        for (uint32_t index = 0; index < instance_count; ++index) {
+            XrInstance instance = XR_NULL_HANDLE;
+            XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+            TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance " + std::to_string(index) + " while others are alive")
+            if (XR_SUCCEEDED(create_result)) {
+                instances.push_back(instance);
+            }
+        }
+        for (XrInstance instance : instances) {
+            XrSystemId system_id = XR_NULL_SYSTEM_ID;
+            TEST_EQUAL(xrGetSystem(instance, &system_get_info, &system_id), XR_SUCCESS,
+                       "xrGetSystem on instance " + std::to_string(MakeHandleGeneric(instance)))
+        }
+        if (!instances.empty()) {
+            XrInstance destroyed_instance = instances.back();
+            instances.pop_back();
+            TEST_EQUAL(xrDestroyInstance(destroyed_instance), XR_SUCCESS, "Destroying one of several instances")
+            TEST_EQUAL(xrDestroyInstance(destroyed_instance), XR_ERROR_HANDLE_INVALID,
+                       "Destroying an instance that was already destroyed")
+        }
+        for (XrInstance instance : instances) {
+            XrSystemId system_id = XR_NULL_SYSTEM_ID;
+            TEST_EQUAL(xrGetSystem(instance, &system_get_info, &system_id), XR_SUCCESS,
+                       "xrGetSystem on remaining instance " + std::to_string(MakeHandleGeneric(instance)))
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying remaining instance")
+        }
+
+        // A session of one instance and a space of another can share a value, as the test runtime counts each type of
+        // handle separately.  Destroying the space must not lose track of the session.
+        XrInstance instance_a = XR_NULL_HANDLE;
+        XrInstance instance_b = XR_NULL_HANDLE;
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance_a), XR_SUCCESS, "Creating first of two instances")
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance_b), XR_SUCCESS, "Creating second of two instances")
+        if (XR_NULL_HANDLE != instance_a && XR_NULL_HANDLE != instance_b) {
+            XrSessionCreateInfo session_create_info = {};
+            session_create_info.type = XR_TYPE_SESSION_CREATE_INFO;
+            session_create_info.systemId = 1;
+            XrReferenceSpaceCreateInfo space_create_info = {};
+            space_create_info.type = XR_TYPE_REFERENCE_SPACE_CREATE_INFO;
+            space_create_info.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+            space_create_info.poseInReferenceSpace.orientation.w = 1.0f;
+            XrSession session_a = XR_NULL_HANDLE;
+            XrSession session_b = XR_NULL_HANDLE;
+            XrSpace space_b = XR_NULL_HANDLE;
+            TEST_EQUAL(xrCreateSession(instance_a, &session_create_info, &session_a), XR_SUCCESS,
+                       "Creating session on first instance")
+            TEST_EQUAL(xrCreateSession(instance_b, &session_create_info, &session_b), XR_SUCCESS,
+                       "Creating session on second instance")
+            TEST_EQUAL(xrCreateReferenceSpace(session_b, &space_create_info, &space_b), XR_SUCCESS,
+                       "Creating space on second instance")
+
+            // Create handles of whichever type is behind until the two values meet.
+            const uint32_t max_attempts = 100000;
+            for (uint32_t attempt = 0; attempt < max_attempts && MakeHandleGeneric(space_b) != MakeHandleGeneric(session_a);
+                 ++attempt) {
+                if (MakeHandleGeneric(space_b) < MakeHandleGeneric(session_a)) {
+                    xrDestroySpace(space_b);
+                    xrCreateReferenceSpace(session_b, &space_create_info, &space_b);
+                } else {
+                    xrDestroySession(session_a);
+                    xrCreateSession(instance_a, &session_create_info, &session_a);
+                }
+            }
+            TEST_EQUAL(MakeHandleGeneric(space_b), MakeHandleGeneric(session_a), "Session and space sharing a value")
+
+            XrFrameWaitInfo wait_info = {XR_TYPE_FRAME_WAIT_INFO, nullptr};
+            XrFrameState frame_state = {XR_TYPE_FRAME_STATE, nullptr};
+            XrSpaceLocation location = {XR_TYPE_SPACE_LOCATION, nullptr};
+            TEST_EQUAL(xrLocateSpace(space_b, space_b, 0, &location), XR_SUCCESS, "xrLocateSpace on the shared value")
+            TEST_EQUAL(xrWaitFrame(session_a, &wait_info, &frame_state), XR_SUCCESS, "xrWaitFrame on the shared value")
+            TEST_EQUAL(xrDestroySpace(space_b), XR_SUCCESS, "Destroying the space sharing a value")
+            TEST_EQUAL(xrWaitFrame(session_a, &wait_info, &frame_state), XR_SUCCESS,
+                       "xrWaitFrame on a session after destroying a space sharing its value")
+            TEST_EQUAL(xrDestroySession(session_a), XR_SUCCESS, "Destroying the session sharing a value")
+            TEST_EQUAL(xrDestroySession(session_b), XR_SUCCESS, "Destroying session on second instance")
+        }
+        if (XR_NULL_HANDLE != instance_a) {
+            TEST_EQUAL(xrDestroyInstance(instance_a), XR_SUCCESS, "Destroying first of two instances")
+        }
+        if (XR_NULL_HANDLE != instance_b) {
+            TEST_EQUAL(xrDestroyInstance(instance_b), XR_SUCCESS, "Destroying second of two instances")
+        }
+
+        // Hammer instance creation and destruction from several threads at once.
+        std::vector<std::thread> threads;
+        std::vector<uint32_t> thread_failures(thread_count, 0);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+            threads.emplace_back([&, thread_index]() {
+                for (uint32_t iteration = 0; iteration < create_iterations; ++iteration) {
+                    XrInstance instance = XR_NULL_HANDLE;
+                    XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                    if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+                        thread_failures[thread_index]++;
+                        continue;
+                    }
+                    if (XR_FAILED(xrGetSystem(instance, &system_get_info, &system_id))) {
+                        thread_failures[thread_index]++;
+                    }
+                    if (XR_FAILED(xrDestroyInstance(instance))) {
+                        thread_failures[thread_index]++;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        uint32_t total_failures = 0;
+        for (uint32_t failures : thread_failures) {
+            total_failures += failures;
+        }
+        TEST_EQUAL(total_failures, 0u, "Creating and destroying instances from " + std::to_string(thread_count) + " threads")
+        cout << "        xrCreateInstance + xrGetSystem + xrDestroyInstance from " << thread_count
+             << " threads: " << NanosecondsPerIteration(elapsed, thread_count * create_iterations) / 1000.0
+             << " us per instance" << endl;
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestMultiInstanceStress)
+}
+
+// Time the XR_EXT_debug_utils terminators, which look up the runtime dispatch table on every call, from
+// several threads at once while another thread keeps creating and destroying instances.
+DEFINE_TEST(TestDebugUtilsContentionTiming) {
+    INIT_TEST(TestDebugUtilsContentionTiming)
+
+    try {
+        const uint32_t submit_iterations = 20000;
+        const uint32_t max_thread_count = 8;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestDebugUtilsContentionTiming)
+            return;
+        }
+
+        const char* debug_utils_name = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = &debug_utils_name;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance with XR_EXT_debug_utils")
+        if (XR_FAILED(create_result)) {
+            CleanupEnvironmentVariables();
+            TEST_REPORT(TestDebugUtilsContentionTiming)
+            return;
+        }
 
-    // Unused for now.
-    (void)argc;
-    (void)argv;
+        PFN_xrSubmitDebugUtilsMessageEXT pfn_submit_dmsg = nullptr;
+        PFN_xrCreateDebugUtilsMessengerEXT pfn_create_messenger = nullptr;
+        PFN_xrDestroyDebugUtilsMessengerEXT pfn_destroy_messenger = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_submit_dmsg)),
+                   XR_SUCCESS, "Get xrSubmitDebugUtilsMessageEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_create_messenger)),
+                   XR_SUCCESS, "Get xrCreateDebugUtilsMessengerEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_destroy_messenger)),
+                   XR_SUCCESS, "Get xrDestroyDebugUtilsMessengerEXT function pointer")
+
+        if (pfn_submit_dmsg != nullptr && pfn_create_messenger != nullptr && pfn_destroy_messenger != nullptr) {
+            // The messenger terminators find their dispatch table through the messenger to instance map.
+            XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+            messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+            messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+            messenger_create_info.userCallback = TestDebugUtilsCallback;
+            XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+            TEST_EQUAL(pfn_create_messenger(instance, &messenger_create_info, &messenger), XR_SUCCESS,
+                       "Creating a debug utils messenger")
+            TEST_EQUAL(pfn_destroy_messenger(messenger), XR_SUCCESS, "Destroying a debug utils messenger")
+
+            XrDebugUtilsMessengerCallbackDataEXT callback_data = {};
+            callback_data.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callback_data.messageId = "Contention";
+            callback_data.functionName = "TestDebugUtilsContentionTiming";
+            callback_data.message = "Message nobody is listening for";
+
+            for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+                std::atomic<bool> submitting(true);
+                std::atomic<uint32_t> submit_failures(0);
+                std::atomic<uint32_t> churn_failures(0);
+
+                // Keep changing the runtime's instance map while the terminators read it.
+                std::thread churn_thread([&]() {
+                    while (submitting.load()) {
+                        XrInstanceCreateInfo churn_create_info = instance_create_info;
+                        churn_create_info.enabledExtensionCount = 0;
+                        churn_create_info.enabledExtensionNames = nullptr;
+                        XrInstance churn_instance = XR_NULL_HANDLE;
+                        if (XR_FAILED(xrCreateInstance(&churn_create_info, &churn_instance)) ||
+                            XR_FAILED(xrDestroyInstance(churn_instance))) {
+                            churn_failures++;
+                        }
+                    }
+                });
+
+                std::vector<std::thread> threads;
+                auto start = std::chrono::steady_clock::now();
+                for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+                    threads.emplace_back([&]() {
+                        for (uint32_t iteration = 0; iteration < submit_iterations; ++iteration) {
+                            if (XR_FAILED(pfn_submit_dmsg(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT,
+                                                          XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data))) {
+                                submit_failures++;
+                            }
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                submitting.store(false);
+                churn_thread.join();
+
+                const std::string subtest_name = std::to_string(thread_count) + " threads";
+                TEST_EQUAL(submit_failures.load(), 0u, "xrSubmitDebugUtilsMessageEXT from " + subtest_name)
+                TEST_EQUAL(churn_failures.load(), 0u, "Creating and destroying instances alongside " + subtest_name)
+                cout << "        xrSubmitDebugUtilsMessageEXT from " << subtest_name << ": "
+                     << NanosecondsPerIteration(elapsed, submit_iterations) << " ns per call per thread" << endl;
+            }
+        }
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance with XR_EXT_debug_utils")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestDebugUtilsContentionTiming)
+}
+
+// Compare repeated extension enumeration and instance creation with the runtime loaded and negotiated on every
+// call against keeping it resident, and check that a resident runtime is dropped when XR_RUNTIME_JSON changes or
+// once it has been idle for longer than the timeout.
+DEFINE_TEST(TestResidentRuntimeTiming) {
+    INIT_TEST(TestResidentRuntimeTiming)
+
+    try {
+        const uint32_t iterations = 200;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestResidentRuntimeTiming)
+            return;
+        }
+
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        const char* const modes[] = {"0", "1"};
+        uint32_t extension_counts[2] = {};
+        for (uint32_t mode = 0; mode < 2; ++mode) {
+            LoaderTestSetEnvironmentVariable("XR_LOADER_RESIDENT_RUNTIME", modes[mode]);
+            const std::string mode_name = mode == 0 ? "unloaded between calls" : "resident";
+
+            bool call_failed = false;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < iterations && !call_failed; ++iteration) {
+                call_failed = XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_counts[mode], nullptr));
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(call_failed, false, "Repeated extension enumeration, runtime " + mode_name)
+            cout << "        xrEnumerateInstanceExtensionProperties, runtime " << mode_name << ": "
+                 << NanosecondsPerIteration(elapsed, iterations) / 1000.0 << " us per call" << endl;
+
+            call_failed = false;
+            start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < iterations && !call_failed; ++iteration) {
+                XrInstance instance = XR_NULL_HANDLE;
+                call_failed = XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_counts[mode], nullptr)) ||
+                              XR_FAILED(xrCreateInstance(&instance_create_info, &instance)) ||
+                              XR_FAILED(xrDestroyInstance(instance));
+            }
+            elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(call_failed, false, "Repeated enumerate, create and destroy, runtime " + mode_name)
+            cout << "        Enumerate + xrCreateInstance + xrDestroyInstance, runtime " << mode_name << ": "
+                 << NanosecondsPerIteration(elapsed, iterations) / 1000.0 << " us per instance" << endl;
+        }
+        TEST_EQUAL(extension_counts[1], extension_counts[0], "Resident runtime reports the same extensions")
+
+        // The resident runtime must not be used once the application points the loader at a different runtime.
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", "resources/runtimes/not_a_runtime.json");
+        uint32_t extension_count = 0;
+        TEST_NOT_EQUAL(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr), XR_SUCCESS,
+                       "Enumerating after XR_RUNTIME_JSON changed to a missing runtime")
+
+        // A resident runtime that has been idle for longer than the timeout is unloaded by the next loader call, even one
+        // that does not need the runtime, and loaded again by the next call that does.
+        UseTestRuntime();
+        LoaderTestSetEnvironmentVariable("XR_LOADER_RESIDENT_RUNTIME_IDLE_MS", "1");
+        TEST_EQUAL(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr), XR_SUCCESS,
+                   "Enumerating with an idle timeout")
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+#ifdef XR_OS_LINUX
+        TEST_EQUAL(IsLibraryLoaded("libtest_runtime"), true, "Idle resident runtime kept until the next loader call")
+#endif  // XR_OS_LINUX
+        uint32_t layer_count = 0;
+        TEST_EQUAL(xrEnumerateApiLayerProperties(0, &layer_count, nullptr), XR_SUCCESS,
+                   "Enumerating API layers after the idle timeout passed")
+#ifdef XR_OS_LINUX
+        TEST_EQUAL(IsLibraryLoaded("libtest_runtime"), false, "Idle resident runtime unloaded by the next loader call")
+#endif  // XR_OS_LINUX
+        TEST_EQUAL(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr), XR_SUCCESS,
+                   "Enumerating after the idle timeout passed")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestResidentRuntimeTiming)
+}
+
+// Run by TestStartupTimingTrace in a new process, with the environment it set up: fail to create an instance with a
+// missing API layer, so that an error is logged, then create and destroy one.
+static int RunStartupTimingChild() {
+    XrInstanceCreateInfo instance_create_info = {};
+    instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+    const char* const missing_layer = "XR_APILAYER_missing";
+    instance_create_info.enabledApiLayerCount = 1;
+    instance_create_info.enabledApiLayerNames = &missing_layer;
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_SUCCEEDED(xrCreateInstance(&instance_create_info, &instance))) {
+        xrDestroyInstance(instance);
+        return 1;
+    }
+
+    instance_create_info.enabledApiLayerCount = 0;
+    instance_create_info.enabledApiLayerNames = nullptr;
+    if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+        return 2;
+    }
+    return XR_SUCCEEDED(xrDestroyInstance(instance)) ? 0 : 3;
+}
+
+// Check that XR_LOADER_DEBUG=timing records the phases of instance creation in a Chrome trace event file, and logs
+// them along with any errors.
+DEFINE_TEST(TestStartupTimingTrace) {
+    INIT_TEST(TestStartupTimingTrace)
+
+    try {
+        const char* const trace_filename = "loader_timing_trace.json";
+        const char* const output_filename = "loader_timing_output.txt";
+        const char* const expected_phases[] = {
+            "\"xrCreateInstance\"",      "\"Runtime manifest discovery\"", "\"Runtime library load\"",
+            "\"Runtime negotiation\"",   "\"API layer manifest discovery\"", "\"Environment parsing\"",
+            "\"API layer library load\"", "\"API layer negotiation\"",       "\"Layer chain construction\"",
+            "\"Runtime xrCreateInstance\"", "\"Runtime dispatch population\"", "\"Dispatch population\"",
+        };
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestStartupTimingTrace)
+            return;
+        }
+        remove(trace_filename);
+        remove(output_filename);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "timing");
+        LoaderTestSetEnvironmentVariable("XR_LOADER_TIMING_FILE", trace_filename);
+        // Errors also go to stderr whatever the level, so only keep what the loader writes to stdout.
+#ifdef _WIN32
+        const std::string discard_stderr = " 2>NUL";
+#else
+        const std::string discard_stderr = " 2>/dev/null";
+#endif  // _WIN32
+        const std::string child_command =
+            "\"" + g_loader_test_path + "\" " + kStartupTimingChildArg + " >" + output_filename + discard_stderr;
+        TEST_EQUAL(system(child_command.c_str()), 0, "Creating instance in timing mode in a new process")
+        LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+
+        std::ifstream output_stream(output_filename);
+        std::stringstream output;
+        output << output_stream.rdbuf();
+        const std::string output_contents = output.str();
+        TEST_NOT_EQUAL(output_contents.find("Info [PERF | xrCreateInstance"), std::string::npos,
+                       "Phase durations logged to stdout")
+        TEST_NOT_EQUAL(output_contents.find("Error [GENERAL | xrCreateInstance"), std::string::npos,
+                       "Errors logged to stdout along with the phase durations")
+        output_stream.close();
+        remove(output_filename);
+
+        std::ifstream trace_stream(trace_filename);
+        std::stringstream trace;
+        trace << trace_stream.rdbuf();
+        const std::string trace_contents = trace.str();
+        TEST_EQUAL(trace_contents.compare(0, 19, "{\"displayTimeUnit\":"), 0, "Trace file is a trace event object")
+        for (const char* phase : expected_phases) {
+            TEST_NOT_EQUAL(trace_contents.find(std::string("{\"name\": ") + phase), std::string::npos,
+                           std::string("Trace has a ") + phase + " span")
+        }
+        trace_stream.close();
+        remove(trace_filename);
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_TIMING_FILE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestStartupTimingTrace)
+}
+
+// Writes each error logged by RunBinaryLogChild as the decoder prints it, from the command name on; userData is the
+// std::ostream to write to.
+static XrBool32 XRAPI_PTR BinaryLogRoundTripCallback(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                                     XrDebugUtilsMessageTypeFlagsEXT /*messageType*/,
+                                                     const XrDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+    std::ostream& out = *static_cast<std::ostream*>(userData);
+    out << callbackData->functionName << " | " << callbackData->messageId << "] : " << callbackData->message << "\n";
+    for (uint32_t object = 0; object < callbackData->objectCount; ++object) {
+        const XrDebugUtilsObjectNameInfoEXT& info = callbackData->objects[object];
+        out << "    Object[" << object << "] = 0x" << std::hex << std::setw(16) << std::setfill('0') << info.objectHandle
+            << std::dec;
+        if (info.objectName != nullptr && info.objectName[0] != '\0') {
+            out << " (" << info.objectName << ")";
+        }
+        out << "\n";
+    }
+    for (uint32_t label = 0; label < callbackData->sessionLabelCount; ++label) {
+        out << "    SessionLabel[" << label << "] = " << callbackData->sessionLabels[label].labelName << "\n";
+    }
+    return XR_FALSE;
+}
+
+// Run by TestBinaryLogRoundTrip in a new process, with XR_LOADER_BINARY_LOG_FILE set: log errors about a named and
+// labelled session, some more than once, and write them to the file named by expected_filename as well.
+static int RunBinaryLogChild(const char* expected_filename) {
+    std::ofstream expected(expected_filename, std::ofstream::out | std::ofstream::trunc);
+
+    const char* debug_utils_name = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+    XrInstanceCreateInfo instance_create_info = {};
+    instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    instance_create_info.enabledExtensionCount = 1;
+    instance_create_info.enabledExtensionNames = &debug_utils_name;
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+        return 1;
+    }
+
+    PFN_xrCreateDebugUtilsMessengerEXT pfn_create_messenger = nullptr;
+    PFN_xrDestroyDebugUtilsMessengerEXT pfn_destroy_messenger = nullptr;
+    PFN_xrSetDebugUtilsObjectNameEXT pfn_set_name = nullptr;
+    PFN_xrSessionBeginDebugUtilsLabelRegionEXT pfn_begin_region = nullptr;
+    PFN_xrSessionEndDebugUtilsLabelRegionEXT pfn_end_region = nullptr;
+    PFN_xrSessionInsertDebugUtilsLabelEXT pfn_insert_label = nullptr;
+    xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_create_messenger));
+    xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                          reinterpret_cast<PFN_xrVoidFunction*>(&pfn_destroy_messenger));
+    xrGetInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_set_name));
+    xrGetInstanceProcAddr(instance, "xrSessionBeginDebugUtilsLabelRegionEXT",
+                          reinterpret_cast<PFN_xrVoidFunction*>(&pfn_begin_region));
+    xrGetInstanceProcAddr(instance, "xrSessionEndDebugUtilsLabelRegionEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_end_region));
+    xrGetInstanceProcAddr(instance, "xrSessionInsertDebugUtilsLabelEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_insert_label));
+    if (pfn_create_messenger == nullptr || pfn_destroy_messenger == nullptr || pfn_set_name == nullptr ||
+        pfn_begin_region == nullptr || pfn_end_region == nullptr || pfn_insert_label == nullptr) {
+        xrDestroyInstance(instance);
+        return 2;
+    }
+
+    XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+    messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                                         XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                                         XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    messenger_create_info.userCallback = BinaryLogRoundTripCallback;
+    messenger_create_info.userData = static_cast<std::ostream*>(&expected);
+    XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+    XrSessionCreateInfo session_create_info = {};
+    session_create_info.type = XR_TYPE_SESSION_CREATE_INFO;
+    session_create_info.systemId = 1;
+    XrSession session = XR_NULL_HANDLE;
+    if (XR_FAILED(pfn_create_messenger(instance, &messenger_create_info, &messenger)) ||
+        XR_FAILED(xrCreateSession(instance, &session_create_info, &session))) {
+        xrDestroyInstance(instance);
+        return 3;
+    }
+
+    // Each call below logs an error: one with no objects, then several about the session, with and without labels.
+    XrDebugUtilsObjectNameInfoEXT name_info = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, XR_OBJECT_TYPE_SESSION,
+                                               MakeHandleGeneric(session), "round trip session"};
+    XrDebugUtilsLabelEXT outer_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, "outer label"};
+    XrDebugUtilsLabelEXT inner_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, "inner label"};
+    pfn_end_region(XR_NULL_HANDLE);
+    pfn_insert_label(session, nullptr);
+    pfn_set_name(instance, &name_info);
+    pfn_insert_label(session, nullptr);
+    pfn_begin_region(session, &outer_label);
+    pfn_insert_label(session, &inner_label);
+    pfn_insert_label(session, nullptr);
+    pfn_begin_region(session, nullptr);
+    pfn_end_region(session);
+    pfn_insert_label(session, nullptr);
+
+    pfn_destroy_messenger(messenger);
+    xrDestroySession(session);
+    xrDestroyInstance(instance);
+    return expected.good() ? 0 : 4;
+}
+
+static std::string ReadTestFile(const std::string& filename) {
+    std::ifstream stream(filename, std::ifstream::in | std::ifstream::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+// The error messages in the text the decoder printed, each from the command name on, as BinaryLogRoundTripCallback
+// writes them.
+static std::string DecodedBinaryLogErrors(const std::string& decoded) {
+    std::istringstream lines(decoded);
+    std::string line;
+    std::string errors;
+    bool in_error = false;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 4, "    ") == 0) {
+            if (in_error) {
+                errors += line + "\n";
+            }
+            continue;
+        }
+        const size_t severity = line.find("] Error [");
+        in_error = severity != std::string::npos && line.find(" | ", severity) != std::string::npos;
+        if (in_error) {
+            errors += line.substr(line.find(" | ", severity) + 3) + "\n";
+        }
+    }
+    return errors;
+}
+
+// Write a binary log through the loader in a new process, and check that the decoder gives back the messages that
+// went into it, each string was written once, and a log cut off in the middle of a record decodes up to that record.
+DEFINE_TEST(TestBinaryLogRoundTrip) {
+    INIT_TEST(TestBinaryLogRoundTrip)
+
+    try {
+        const std::string log_filename = "loader_binary_log.bin";
+        const std::string truncated_filename = "loader_binary_log_truncated.bin";
+        const std::string expected_filename = "loader_binary_log_expected.txt";
+        const std::string decoded_filename = "loader_binary_log_decoded.txt";
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestBinaryLogRoundTrip)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_LOADER_BINARY_LOG_FILE", log_filename.c_str());
+#ifdef _WIN32
+        const std::string discard_output = " >NUL 2>NUL";
+        const std::string discard_stderr = " 2>NUL";
+#else
+        const std::string discard_output = " >/dev/null 2>/dev/null";
+        const std::string discard_stderr = " 2>/dev/null";
+#endif  // _WIN32
+        const std::string child_command =
+            "\"" + g_loader_test_path + "\" " + kBinaryLogChildArg + " " + expected_filename + discard_output;
+        TEST_EQUAL(system(child_command.c_str()), 0, "Logging errors to a binary log in a new process")
+        LoaderTestUnsetEnvironmentVariable("XR_LOADER_BINARY_LOG_FILE");
+
+        const std::string log = ReadTestFile(log_filename);
+        const std::string expected = ReadTestFile(expected_filename);
+        TEST_NOT_EQUAL(expected.find("    SessionLabel[1] = outer label"), std::string::npos,
+                       "The errors logged include a named and labelled session")
+
+        // Walk the records, counting how often each string is written and how many messages share one.
+        std::map<std::string, uint32_t> string_counts;
+        uint32_t command_index = XR_LOADER_BINARY_LOG_NO_STRING;
+        uint32_t command_messages = 0;
+        uint32_t interned_payloads = 0;
+        size_t offset = sizeof(BinaryLogFileHeader);
+        while (offset + sizeof(BinaryLogRecordHeader) <= log.size()) {
+            BinaryLogRecordHeader record_header = {};
+            memcpy(&record_header, log.data() + offset, sizeof(record_header));
+            if (record_header.size < sizeof(record_header) || record_header.size > log.size() - offset) {
+                break;
+            }
+            if (record_header.kind == BINARY_LOG_RECORD_STRING) {
+                BinaryLogStringRecord string_record = {};
+                memcpy(&string_record, log.data() + offset, sizeof(string_record));
+                const std::string value(log.data() + offset + sizeof(string_record), string_record.length);
+                if (++string_counts[value] == 1 && value == "xrSessionInsertDebugUtilsLabelEXT") {
+                    command_index = string_record.index;
+                }
+            } else if (record_header.kind == BINARY_LOG_RECORD_MESSAGE) {
+                BinaryLogMessageRecord message_record = {};
+                memcpy(&message_record, log.data() + offset, sizeof(message_record));
+                command_messages += message_record.command_name == command_index ? 1 : 0;
+                interned_payloads += message_record.payload != XR_LOADER_BINARY_LOG_NO_STRING ? 1 : 0;
+            }
+            offset += record_header.size;
+        }
+        TEST_EQUAL(offset, log.size(), "Every record of the log is complete")
+        TEST_EQUAL(std::all_of(string_counts.begin(), string_counts.end(),
+                               [](const std::pair<const std::string, uint32_t>& count) { return count.second == 1; }),
+                   true, "Each string is written to the log once")
+        TEST_EQUAL(command_messages >= 4, true, "Messages from the same command share its interned name")
+        TEST_EQUAL(interned_payloads > 0, true, "Repeated message text is interned")
+
+        const std::string decode_command = "\"" LOADER_LOG_DECODE_PATH "\" " + log_filename + " >" + decoded_filename;
+        TEST_EQUAL(system((decode_command + discard_stderr).c_str()), 0, "Decoding the binary log")
+        const std::string decoded = ReadTestFile(decoded_filename);
+        TEST_EQUAL(DecodedBinaryLogErrors(decoded), expected, "The decoded errors match those logged")
+
+        // Cut the last record short, as if the file were copied while it was being written.
+        {
+            std::ofstream truncated(truncated_filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+            truncated.write(log.data(), static_cast<std::streamsize>(log.size() - sizeof(uint32_t)));
+        }
+        const std::string decode_truncated_command =
+            "\"" LOADER_LOG_DECODE_PATH "\" " + truncated_filename + " >" + decoded_filename;
+        TEST_NOT_EQUAL(system((decode_truncated_command + discard_stderr).c_str()), 0, "Decoding a truncated binary log fails")
+        size_t last_message = 0;
+        size_t line = 0;
+        while (line < decoded.size()) {
+            if (decoded.compare(line, 4, "    ") != 0) {
+                last_message = line;
+            }
+            const size_t line_end = decoded.find('\n', line);
+            line = line_end == std::string::npos ? decoded.size() : line_end + 1;
+        }
+        TEST_EQUAL(ReadTestFile(decoded_filename), decoded.substr(0, last_message),
+                   "A truncated binary log decodes up to the record cut short")
+
+        remove(log_filename.c_str());
+        remove(truncated_filename.c_str());
+        remove(expected_filename.c_str());
+        remove(decoded_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_BINARY_LOG_FILE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestBinaryLogRoundTrip)
+}
+
+// Counts the stress test's messages delivered to a messenger whose object names and session labels, if any, are
+// ones the test gave; userData is the counter.
+XrBool32 XRAPI_PTR CountingDebugUtilsCallback(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                              XrDebugUtilsMessageTypeFlagsEXT /*messageType*/,
+                                              const XrDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+    if (callbackData->messageId == nullptr || strcmp(callbackData->messageId, "LoggingStress") != 0) {
+        return XR_FALSE;
+    }
+    for (uint32_t object = 0; object < callbackData->objectCount; ++object) {
+        const char* name = callbackData->objects[object].objectName;
+        if (name != nullptr && strncmp(name, "stress session ", 15) != 0) {
+            return XR_FALSE;
+        }
+    }
+    for (uint32_t label = 0; label < callbackData->sessionLabelCount; ++label) {
+        const char* name = callbackData->sessionLabels[label].labelName;
+        if (name == nullptr || strncmp(name, "stress label ", 13) != 0) {
+            return XR_FALSE;
+        }
+    }
+    static_cast<std::atomic<uint32_t>*>(userData)->fetch_add(1);
+    return XR_FALSE;
+}
+
+// Log through the loader from several threads while one thread keeps adding and removing log recorders and another
+// keeps renaming and labelling the session the messages refer to, and check that the recorder that stays registered
+// receives every message exactly once, with names and labels intact.
+DEFINE_TEST(TestLoggingStress) {
+    INIT_TEST(TestLoggingStress)
+
+    try {
+        const uint32_t thread_count = 8;
+        const uint32_t submit_iterations = 20000;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestLoggingStress)
+            return;
+        }
+
+        const char* debug_utils_name = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = &debug_utils_name;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance with XR_EXT_debug_utils")
+        if (XR_FAILED(create_result)) {
+            CleanupEnvironmentVariables();
+            TEST_REPORT(TestLoggingStress)
+            return;
+        }
+
+        PFN_xrSubmitDebugUtilsMessageEXT pfn_submit_dmsg = nullptr;
+        PFN_xrCreateDebugUtilsMessengerEXT pfn_create_messenger = nullptr;
+        PFN_xrDestroyDebugUtilsMessengerEXT pfn_destroy_messenger = nullptr;
+        PFN_xrSetDebugUtilsObjectNameEXT pfn_set_name = nullptr;
+        PFN_xrSessionBeginDebugUtilsLabelRegionEXT pfn_begin_region = nullptr;
+        PFN_xrSessionEndDebugUtilsLabelRegionEXT pfn_end_region = nullptr;
+        PFN_xrSessionInsertDebugUtilsLabelEXT pfn_insert_label = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_submit_dmsg)),
+                   XR_SUCCESS, "Get xrSubmitDebugUtilsMessageEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_create_messenger)),
+                   XR_SUCCESS, "Get xrCreateDebugUtilsMessengerEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_destroy_messenger)),
+                   XR_SUCCESS, "Get xrDestroyDebugUtilsMessengerEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_set_name)),
+                   XR_SUCCESS, "Get xrSetDebugUtilsObjectNameEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSessionBeginDebugUtilsLabelRegionEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_begin_region)),
+                   XR_SUCCESS, "Get xrSessionBeginDebugUtilsLabelRegionEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSessionEndDebugUtilsLabelRegionEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_end_region)),
+                   XR_SUCCESS, "Get xrSessionEndDebugUtilsLabelRegionEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSessionInsertDebugUtilsLabelEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_insert_label)),
+                   XR_SUCCESS, "Get xrSessionInsertDebugUtilsLabelEXT function pointer")
+
+        if (pfn_submit_dmsg != nullptr && pfn_create_messenger != nullptr && pfn_destroy_messenger != nullptr &&
+            pfn_set_name != nullptr && pfn_begin_region != nullptr && pfn_end_region != nullptr && pfn_insert_label != nullptr) {
+            std::atomic<uint32_t> received(0);
+            std::atomic<uint32_t> churn_received(0);
+            XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+            messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+            messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+            messenger_create_info.userCallback = CountingDebugUtilsCallback;
+            messenger_create_info.userData = &received;
+            XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+            TEST_EQUAL(pfn_create_messenger(instance, &messenger_create_info, &messenger), XR_SUCCESS,
+                       "Creating the messenger that stays registered")
+
+            // A stand-in session; the loader only tracks its name and labels.  It is named before logging starts,
+            // since messages only have labels added when some object has a name.
+            const uint64_t session_handle = 0x5E55;
+            XrSession session = TreatIntegerAsHandle<XrSession>(session_handle);
+            XrDebugUtilsObjectNameInfoEXT name_info = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, XR_OBJECT_TYPE_SESSION,
+                                                       session_handle, "stress session"};
+            TEST_EQUAL(pfn_set_name(instance, &name_info), XR_SUCCESS, "Naming the session")
+
+            XrDebugUtilsObjectNameInfoEXT session_object = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr,
+                                                            XR_OBJECT_TYPE_SESSION, session_handle, nullptr};
+            XrDebugUtilsMessengerCallbackDataEXT callback_data = {};
+            callback_data.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callback_data.messageId = "LoggingStress";
+            callback_data.functionName = "TestLoggingStress";
+            callback_data.message = "Message logged while recorders come and go";
+            callback_data.objectCount = 1;
+            callback_data.objects = &session_object;
+
+            std::atomic<bool> submitting(true);
+            std::atomic<uint32_t> submit_failures(0);
+            std::atomic<uint32_t> churn_failures(0);
+            std::atomic<uint32_t> churn_count(0);
+            std::atomic<uint32_t> label_failures(0);
+            std::atomic<uint32_t> label_count(0);
+
+            // Keep adding and removing a recorder while the other threads log.
+            std::thread churn_thread([&]() {
+                XrDebugUtilsMessengerCreateInfoEXT churn_create_info = messenger_create_info;
+                churn_create_info.userData = &churn_received;
+                while (submitting.load()) {
+                    XrDebugUtilsMessengerEXT churn_messenger = XR_NULL_HANDLE;
+                    if (XR_FAILED(pfn_create_messenger(instance, &churn_create_info, &churn_messenger)) ||
+                        XR_FAILED(pfn_destroy_messenger(churn_messenger))) {
+                        churn_failures++;
+                    }
+                    churn_count++;
+                }
+            });
+
+            // Keep renaming the session and changing its labels while the other threads log messages about it.  The
+            // names keep changing, so that old names are freed while messages may still be using them.
+            std::thread label_thread([&]() {
+                uint32_t iteration = 0;
+                while (submitting.load()) {
+                    const std::string session_name = "stress session " + std::to_string(iteration % 1000);
+                    const std::string outer_name = "stress label outer " + std::to_string(iteration % 1000);
+                    const std::string inner_name = "stress label inner " + std::to_string(iteration % 997);
+                    XrDebugUtilsObjectNameInfoEXT rename_info = name_info;
+                    rename_info.objectName = session_name.c_str();
+                    XrDebugUtilsLabelEXT outer_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, outer_name.c_str()};
+                    XrDebugUtilsLabelEXT inner_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, inner_name.c_str()};
+                    if (XR_FAILED(pfn_set_name(instance, &rename_info)) || XR_FAILED(pfn_begin_region(session, &outer_label)) ||
+                        XR_FAILED(pfn_insert_label(session, &inner_label)) || XR_FAILED(pfn_end_region(session))) {
+                        label_failures++;
+                    }
+                    label_count++;
+                    iteration++;
+                }
+            });
+
+            std::vector<std::thread> threads;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+                threads.emplace_back([&]() {
+                    for (uint32_t iteration = 0; iteration < submit_iterations; ++iteration) {
+                        if (XR_FAILED(pfn_submit_dmsg(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+                                                      XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data))) {
+                            submit_failures++;
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            submitting.store(false);
+            churn_thread.join();
+            label_thread.join();
+
+            TEST_EQUAL(submit_failures.load(), 0u, "xrSubmitDebugUtilsMessageEXT from " + std::to_string(thread_count) + " threads")
+            TEST_EQUAL(churn_failures.load(), 0u, "Creating and destroying messengers while other threads log")
+            TEST_EQUAL(label_failures.load(), 0u, "Naming and labelling the session while other threads log")
+            TEST_EQUAL(received.load(), thread_count * submit_iterations, "Every message reaches the registered messenger once")
+            TEST_EQUAL(pfn_destroy_messenger(messenger), XR_SUCCESS, "Destroying the messenger that stayed registered")
+
+            const double seconds = std::chrono::duration<double>(elapsed).count();
+            cout << "        Logging from " << thread_count << " threads while " << churn_count.load()
+                 << " recorders came and went and the session was labelled " << label_count.load()
+                 << " times: " << (thread_count * submit_iterations) / seconds / 1000000.0
+                 << " million messages per second" << endl;
+        }
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance with XR_EXT_debug_utils")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestLoggingStress)
+}
+
+// Checks the object names the loader adds to messages; userData is an atomic count of messages whose every object
+// arrived with the name "object <handle>".
+XrBool32 XRAPI_PTR NamedObjectsDebugUtilsCallback(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                                  XrDebugUtilsMessageTypeFlagsEXT /*messageType*/,
+                                                  const XrDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+    if (callbackData->messageId == nullptr || strcmp(callbackData->messageId, "ObjectNames") != 0) {
+        return XR_FALSE;
+    }
+    for (uint32_t object = 0; object < callbackData->objectCount; ++object) {
+        const XrDebugUtilsObjectNameInfoEXT& info = callbackData->objects[object];
+        if (info.objectName == nullptr || std::string(info.objectName) != "object " + std::to_string(info.objectHandle)) {
+            return XR_FALSE;
+        }
+    }
+    static_cast<std::atomic<uint32_t>*>(userData)->fetch_add(1);
+    return XR_FALSE;
+}
+
+// Time naming many objects with xrSetDebugUtilsObjectNameEXT, and submitting messages that refer to them, which
+// has the loader look up each object's name.
+DEFINE_TEST(TestObjectNameTiming) {
+    INIT_TEST(TestObjectNameTiming)
+
+    try {
+        const uint32_t object_count = 10000;
+        const uint32_t objects_per_message = 4;
+        const uint32_t submit_iterations = 20000;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestObjectNameTiming)
+            return;
+        }
+
+        const char* debug_utils_name = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = &debug_utils_name;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance with XR_EXT_debug_utils")
+        if (XR_FAILED(create_result)) {
+            CleanupEnvironmentVariables();
+            TEST_REPORT(TestObjectNameTiming)
+            return;
+        }
+
+        PFN_xrSetDebugUtilsObjectNameEXT pfn_set_name = nullptr;
+        PFN_xrSubmitDebugUtilsMessageEXT pfn_submit_dmsg = nullptr;
+        PFN_xrCreateDebugUtilsMessengerEXT pfn_create_messenger = nullptr;
+        PFN_xrDestroyDebugUtilsMessengerEXT pfn_destroy_messenger = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_set_name)),
+                   XR_SUCCESS, "Get xrSetDebugUtilsObjectNameEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_submit_dmsg)),
+                   XR_SUCCESS, "Get xrSubmitDebugUtilsMessageEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_create_messenger)),
+                   XR_SUCCESS, "Get xrCreateDebugUtilsMessengerEXT function pointer")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                                         reinterpret_cast<PFN_xrVoidFunction*>(&pfn_destroy_messenger)),
+                   XR_SUCCESS, "Get xrDestroyDebugUtilsMessengerEXT function pointer")
+
+        if (pfn_set_name != nullptr && pfn_submit_dmsg != nullptr && pfn_create_messenger != nullptr &&
+            pfn_destroy_messenger != nullptr) {
+            std::atomic<uint32_t> named_messages(0);
+            XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+            messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+            messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+            messenger_create_info.userCallback = NamedObjectsDebugUtilsCallback;
+            messenger_create_info.userData = &named_messages;
+            XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+            TEST_EQUAL(pfn_create_messenger(instance, &messenger_create_info, &messenger), XR_SUCCESS,
+                       "Creating a debug utils messenger")
+
+            // Stand-ins for the spaces an application might name; the loader does not check the handles.
+            uint32_t name_failures = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t object = 1; object <= object_count; ++object) {
+                const std::string name = "object " + std::to_string(object);
+                XrDebugUtilsObjectNameInfoEXT name_info = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, XR_OBJECT_TYPE_SPACE,
+                                                           object, name.c_str()};
+                if (XR_FAILED(pfn_set_name(instance, &name_info))) {
+                    name_failures++;
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(name_failures, 0u, "Naming " + std::to_string(object_count) + " objects")
+            cout << "        xrSetDebugUtilsObjectNameEXT with up to " << object_count
+                 << " named objects: " << NanosecondsPerIteration(elapsed, object_count) / 1000.0 << " us per call" << endl;
+
+            // Spread the referenced objects over the whole collection.
+            XrDebugUtilsObjectNameInfoEXT objects[objects_per_message] = {};
+            XrDebugUtilsMessengerCallbackDataEXT callback_data = {};
+            callback_data.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callback_data.messageId = "ObjectNames";
+            callback_data.functionName = "TestObjectNameTiming";
+            callback_data.message = "Message about named objects";
+            callback_data.objectCount = objects_per_message;
+            callback_data.objects = objects;
+            uint32_t submit_failures = 0;
+            start = std::chrono::steady_clock::now();
+            for (uint32_t iteration = 0; iteration < submit_iterations; ++iteration) {
+                for (uint32_t object = 0; object < objects_per_message; ++object) {
+                    objects[object] = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, XR_OBJECT_TYPE_SPACE,
+                                       1 + (iteration * 7919 + object * 2503) % object_count, nullptr};
+                }
+                if (XR_FAILED(pfn_submit_dmsg(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+                                              XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data))) {
+                    submit_failures++;
+                }
+            }
+            elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(submit_failures, 0u, "Submitting messages that refer to named objects")
+            TEST_EQUAL(named_messages.load(), submit_iterations, "Every object in every message arrives with its name")
+            cout << "        xrSubmitDebugUtilsMessageEXT naming " << objects_per_message << " of " << object_count
+                 << " objects: " << NanosecondsPerIteration(elapsed, submit_iterations) / 1000.0 << " us per call" << endl;
+
+            TEST_EQUAL(pfn_destroy_messenger(messenger), XR_SUCCESS, "Destroying a debug utils messenger")
+        }
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance with XR_EXT_debug_utils")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestObjectNameTiming)
+}
+
+// The labels a message about a session is expected to arrive with, innermost first, and how many messages did.
+struct ExpectedSessionLabels {
+    std::vector<std::string> names;
+    uint32_t matched = 0;
+};
+
+XrBool32 XRAPI_PTR SessionLabelsDebugUtilsCallback(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                                   XrDebugUtilsMessageTypeFlagsEXT /*messageType*/,
+                                                   const XrDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+    auto* expected = static_cast<ExpectedSessionLabels*>(userData);
+    if (callbackData->messageId == nullptr || strcmp(callbackData->messageId, "SessionLabels") != 0 ||
+        callbackData->sessionLabelCount != expected->names.size()) {
+        return XR_FALSE;
+    }
+    for (uint32_t label = 0; label < callbackData->sessionLabelCount; ++label) {
+        if (expected->names[label] != callbackData->sessionLabels[label].labelName) {
+            return XR_FALSE;
+        }
+    }
+    expected->matched++;
+    return XR_FALSE;
+}
+
+// Time the label calls an application makes around each frame, and check that messages about the session carry
+// the current labels.  Each frame's outermost label has a name of its own, as when it includes the frame number.
+DEFINE_TEST(TestSessionLabelTiming) {
+    INIT_TEST(TestSessionLabelTiming)
+
+    try {
+        const uint32_t frame_count = 20000;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestSessionLabelTiming)
+            return;
+        }
+
+        const char* debug_utils_name = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = &debug_utils_name;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrResult create_result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance with XR_EXT_debug_utils")
+        if (XR_FAILED(create_result)) {
+            CleanupEnvironmentVariables();
+            TEST_REPORT(TestSessionLabelTiming)
+            return;
+        }
+
+        PFN_xrSetDebugUtilsObjectNameEXT pfn_set_name = nullptr;
+        PFN_xrSubmitDebugUtilsMessageEXT pfn_submit_dmsg = nullptr;
+        PFN_xrCreateDebugUtilsMessengerEXT pfn_create_messenger = nullptr;
+        PFN_xrDestroyDebugUtilsMessengerEXT pfn_destroy_messenger = nullptr;
+        PFN_xrSessionBeginDebugUtilsLabelRegionEXT pfn_begin_region = nullptr;
+        PFN_xrSessionEndDebugUtilsLabelRegionEXT pfn_end_region = nullptr;
+        PFN_xrSessionInsertDebugUtilsLabelEXT pfn_insert_label = nullptr;
+        xrGetInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_set_name));
+        xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT", reinterpret_cast<PFN_xrVoidFunction*>(&pfn_submit_dmsg));
+        xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT",
+                              reinterpret_cast<PFN_xrVoidFunction*>(&pfn_create_messenger));
+        xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                              reinterpret_cast<PFN_xrVoidFunction*>(&pfn_destroy_messenger));
+        xrGetInstanceProcAddr(instance, "xrSessionBeginDebugUtilsLabelRegionEXT",
+                              reinterpret_cast<PFN_xrVoidFunction*>(&pfn_begin_region));
+        xrGetInstanceProcAddr(instance, "xrSessionEndDebugUtilsLabelRegionEXT",
+                              reinterpret_cast<PFN_xrVoidFunction*>(&pfn_end_region));
+        xrGetInstanceProcAddr(instance, "xrSessionInsertDebugUtilsLabelEXT",
+                              reinterpret_cast<PFN_xrVoidFunction*>(&pfn_insert_label));
+        TEST_EQUAL(pfn_set_name != nullptr && pfn_submit_dmsg != nullptr && pfn_create_messenger != nullptr &&
+                       pfn_destroy_messenger != nullptr && pfn_begin_region != nullptr && pfn_end_region != nullptr &&
+                       pfn_insert_label != nullptr,
+                   true, "Get debug utils function pointers")
+
+        if (pfn_set_name != nullptr && pfn_submit_dmsg != nullptr && pfn_create_messenger != nullptr &&
+            pfn_destroy_messenger != nullptr && pfn_begin_region != nullptr && pfn_end_region != nullptr &&
+            pfn_insert_label != nullptr) {
+            ExpectedSessionLabels expected;
+            XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+            messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+            messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+            messenger_create_info.userCallback = SessionLabelsDebugUtilsCallback;
+            messenger_create_info.userData = &expected;
+            XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+            TEST_EQUAL(pfn_create_messenger(instance, &messenger_create_info, &messenger), XR_SUCCESS,
+                       "Creating a debug utils messenger")
+
+            // A stand-in session; the loader only tracks labels for it.  It is named, since messages only have
+            // labels added when some object has a name.
+            const uint64_t session_handle = 0x5E55;
+            XrSession session = TreatIntegerAsHandle<XrSession>(session_handle);
+            XrDebugUtilsObjectNameInfoEXT name_info = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, XR_OBJECT_TYPE_SESSION,
+                                                       session_handle, "labelled session"};
+            TEST_EQUAL(pfn_set_name(instance, &name_info), XR_SUCCESS, "Naming the session")
+
+            XrDebugUtilsObjectNameInfoEXT session_object = {XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr,
+                                                            XR_OBJECT_TYPE_SESSION, session_handle, nullptr};
+            XrDebugUtilsMessengerCallbackDataEXT callback_data = {};
+            callback_data.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callback_data.messageId = "SessionLabels";
+            callback_data.functionName = "TestSessionLabelTiming";
+            callback_data.message = "Message about a labelled session";
+            callback_data.objectCount = 1;
+            callback_data.objects = &session_object;
+
+            std::vector<std::string> frame_names;
+            frame_names.reserve(frame_count);
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frame_names.push_back("frame " + std::to_string(frame));
+            }
+            XrDebugUtilsLabelEXT frame_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, nullptr};
+            XrDebugUtilsLabelEXT render_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, "render"};
+            XrDebugUtilsLabelEXT draw_label = {XR_TYPE_DEBUG_UTILS_LABEL_EXT, nullptr, "draw"};
+
+            uint32_t label_failures = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frame_label.labelName = frame_names[frame].c_str();
+                label_failures += XR_FAILED(pfn_begin_region(session, &frame_label)) ? 1 : 0;
+                label_failures += XR_FAILED(pfn_begin_region(session, &render_label)) ? 1 : 0;
+                label_failures += XR_FAILED(pfn_insert_label(session, &draw_label)) ? 1 : 0;
+                label_failures += XR_FAILED(pfn_end_region(session)) ? 1 : 0;
+                label_failures += XR_FAILED(pfn_end_region(session)) ? 1 : 0;
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(label_failures, 0u, "Beginning, inserting and ending labels")
+            cout << "        Label calls for one frame: " << NanosecondsPerIteration(elapsed, frame_count) << " ns" << endl;
+
+            uint32_t submit_failures = 0;
+            start = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frame_label.labelName = frame_names[frame].c_str();
+                pfn_begin_region(session, &frame_label);
+                pfn_begin_region(session, &render_label);
+                pfn_insert_label(session, &draw_label);
+                expected.names = {"draw", "render", frame_names[frame]};
+                submit_failures += XR_FAILED(pfn_submit_dmsg(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+                                                             XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data))
+                                       ? 1
+                                       : 0;
+                pfn_end_region(session);
+                pfn_end_region(session);
+            }
+            elapsed = std::chrono::steady_clock::now() - start;
+            TEST_EQUAL(submit_failures, 0u, "Submitting messages about the labelled session")
+            TEST_EQUAL(expected.matched, frame_count, "Every message arrives with the session's labels, innermost first")
+            cout << "        Label calls and one message for one frame: " << NanosecondsPerIteration(elapsed, frame_count)
+                 << " ns" << endl;
+
+            TEST_EQUAL(pfn_destroy_messenger(messenger), XR_SUCCESS, "Destroying a debug utils messenger")
+        }
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance with XR_EXT_debug_utils")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestSessionLabelTiming)
+}
+
+// Check the formatting functions in format_buffer.h against the std::string ones they replace, and time them.
+DEFINE_TEST(TestFormatBuffer) {
+    INIT_TEST(TestFormatBuffer)
+
+    try {
+        const uint64_t handle = 0x00005E55C0FFEE42ULL;
+        FixedFormatBuffer<128> buffer;
+        AppendHex(buffer, handle);
+        TEST_EQUAL(std::string(buffer.c_str()), Uint64ToHexString(handle), "AppendHex matches Uint64ToHexString")
+
+        buffer.Clear();
+        AppendPointer(buffer, &buffer);
+        TEST_EQUAL(std::string(buffer.c_str()), PointerToHexString(&buffer), "AppendPointer matches PointerToHexString")
+
+        buffer.Clear();
+        AppendHexInteger(buffer, 0);
+        buffer.Append(" ");
+        AppendHexInteger(buffer, 0x1a2bU);
+        TEST_EQUAL(std::string(buffer.c_str()), std::string("0x0 0x1a2b"), "AppendHexInteger drops leading zeros")
+
+        buffer.Clear();
+        AppendDecimal(buffer, INT64_MIN);
+        buffer.Append(" ");
+        AppendDecimal(buffer, UINT64_MAX);
+        buffer.Append(" ");
+        AppendDecimal(buffer, 7);
+        TEST_EQUAL(std::string(buffer.c_str()), std::to_string(INT64_MIN) + " " + std::to_string(UINT64_MAX) + " 7",
+                   "AppendDecimal matches std::to_string")
+
+        buffer.Clear();
+        AppendResult(buffer, XR_ERROR_HANDLE_INVALID);
+        buffer.Append(" ");
+        AppendResult(buffer, static_cast<XrResult>(-987654));
+        buffer.Append(" ");
+        AppendStructureType(buffer, XR_TYPE_INSTANCE_CREATE_INFO);
+        TEST_EQUAL(std::string(buffer.c_str()),
+                   std::string("XR_ERROR_HANDLE_INVALID XR_UNKNOWN_FAILURE_-987654 XR_TYPE_INSTANCE_CREATE_INFO"),
+                   "Results and structure types are named")
+
+        buffer.Clear();
+        AppendFlags(buffer, XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT | 0x100,
+                    XrSpaceLocationFlagsBitsByName);
+        TEST_EQUAL(std::string(buffer.c_str()),
+                   std::string("XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT | 0x100"),
+                   "Flags are named bit by bit")
+
+        FixedFormatBuffer<8> small;
+        small.Append("0123456789");
+        TEST_EQUAL(std::string(small.c_str()) == "0123456" && small.Truncated(), true, "Text that does not fit is dropped")
+
+        const uint32_t iterations = 1000000;
+        size_t total_length = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            total_length += Uint64ToHexString(handle + iteration).size();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        Uint64ToHexString: " << NanosecondsPerIteration(elapsed, iterations) << " ns per handle" << endl;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            FixedFormatBuffer<XR_HEX_STRING_LENGTH(8) + 1> handle_text;
+            AppendHex(handle_text, handle + iteration);
+            total_length += handle_text.size();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        AppendHex into a FixedFormatBuffer: " << NanosecondsPerIteration(elapsed, iterations) << " ns per handle"
+             << endl;
+        TEST_EQUAL(total_length, static_cast<size_t>(2 * iterations * XR_HEX_STRING_LENGTH(8)), "Every handle was formatted")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Output results for this test
+    TEST_REPORT(TestFormatBuffer)
+}
+
+static_assert(XrSdkCompareNames(XrSdkEnumName(XR_ERROR_HANDLE_INVALID), "XR_ERROR_HANDLE_INVALID") == 0,
+              "Enumerants are named in constant expressions");
+
+#define ENUM_NAME_STRCMP(name, value) \
+    if (strcmp(text, #name) == 0) {   \
+        *structure_type = name;       \
+        return true;                  \
+    }
+
+// Parse a structure type name by comparing it with every name in turn, as code did before the sorted tables.
+static bool LinearStructureTypeFromName(const char* text, XrStructureType* structure_type) {
+    // clang-format off
+    XR_LIST_ENUM_XrStructureType(ENUM_NAME_STRCMP)
+    // clang-format on
+    return false;
+}
+
+// Check the names in enum_names.h both ways round, and time parsing names with the sorted tables.
+DEFINE_TEST(TestEnumNames) {
+    INIT_TEST(TestEnumNames)
+
+    try {
+        bool all_round_trip = true;
+        for (const XrSdkNamedValue<XrStructureType>& entry : XrStructureTypeNamesByName) {
+            XrStructureType parsed = XR_TYPE_UNKNOWN;
+            all_round_trip = all_round_trip && XrSdkEnumFromName(entry.name, &parsed) && parsed == entry.value &&
+                             strcmp(XrSdkEnumName(parsed), entry.name) == 0;
+        }
+        TEST_EQUAL(all_round_trip, true, "Every structure type name parses to its value and back")
+
+        XrResult result = XR_SUCCESS;
+        TEST_EQUAL(XrSdkEnumFromName("XR_ERROR_RUNTIME_FAILURE", &result) && result == XR_ERROR_RUNTIME_FAILURE, true,
+                   "Result names parse")
+        TEST_EQUAL(XrSdkEnumFromName("XR_ERROR_RUNTIME", &result) || XrSdkEnumFromName("", &result), false,
+                   "Partial and empty names do not parse")
+        TEST_EQUAL(result, XR_ERROR_RUNTIME_FAILURE, "A name that does not parse leaves the value alone")
+        TEST_EQUAL(XrSdkEnumName(static_cast<XrResult>(-987654)) == nullptr, true, "Unknown results have no name")
+        TEST_EQUAL(std::string(XrSdkEnumName(XR_FORM_FACTOR_HANDHELD_DISPLAY)), std::string("XR_FORM_FACTOR_HANDHELD_DISPLAY"),
+                   "Form factors are named")
+
+        const XrSdkNamedValue<XrFlags64>* bit =
+            XrSdkFindByName(XrSpaceLocationFlagsBitsByName, "XR_SPACE_LOCATION_POSITION_TRACKED_BIT");
+        TEST_EQUAL(bit != nullptr && bit->value == XR_SPACE_LOCATION_POSITION_TRACKED_BIT, true, "Flag bit names parse")
+        bit = XrSdkFindByName(XrSwapchainUsageFlagsBitsByName, "XR_SWAPCHAIN_USAGE_SAMPLED_BIT");
+        TEST_EQUAL(bit != nullptr && bit->value == XR_SWAPCHAIN_USAGE_SAMPLED_BIT, true, "Every flags type has its bits named")
+
+        const uint32_t iterations = 200000;
+        const size_t type_count = sizeof(XrStructureTypeNamesByName) / sizeof(XrStructureTypeNamesByName[0]);
+        int64_t total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            XrStructureType parsed = XR_TYPE_UNKNOWN;
+            LinearStructureTypeFromName(XrStructureTypeNamesByName[iteration % type_count].name, &parsed);
+            total += parsed;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        Comparing with each name: " << NanosecondsPerIteration(elapsed, iterations) << " ns per name" << endl;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            XrStructureType parsed = XR_TYPE_UNKNOWN;
+            XrSdkEnumFromName(XrStructureTypeNamesByName[iteration % type_count].name, &parsed);
+            total -= parsed;
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        cout << "        XrSdkEnumFromName: " << NanosecondsPerIteration(elapsed, iterations) << " ns per name" << endl;
+        TEST_EQUAL(total, static_cast<int64_t>(0), "Both ways of parsing agree")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Output results for this test
+    TEST_REPORT(TestEnumNames)
+}
+
+// Allocation callbacks that count what the loader asks them for.
+struct CountingAllocator {
+    uint64_t allocations[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT];
+    uint64_t frees;
+    bool over_aligned;
+
+    uint64_t TotalAllocations() const {
+        uint64_t total = 0;
+        for (uint64_t subsystem_allocations : allocations) {
+            total += subsystem_allocations;
+        }
+        return total;
+    }
+};
+
+static void* XRAPI_CALL CountingAllocate(void* userData, size_t size, size_t alignment, OpenXRLoaderAllocationSubsystem subsystem) {
+    auto* counting = static_cast<CountingAllocator*>(userData);
+    ++counting->allocations[subsystem];
+    counting->over_aligned = counting->over_aligned || alignment > alignof(std::max_align_t);
+    return std::malloc(size);
+}
+
+static void XRAPI_CALL CountingFree(void* userData, void* memory) {
+    ++static_cast<CountingAllocator*>(userData)->frees;
+    std::free(memory);
+}
+
+// Check that the loader allocates its objects through the application's allocation callbacks, gives back everything
+// it allocated for an instance once the instance is destroyed, and allocates nothing at all in steady-state frames.
+DEFINE_TEST(TestAllocationCallbacks) {
+    INIT_TEST(TestAllocationCallbacks)
+
+    try {
+        const uint32_t frame_count = 1000;
+
+        if (!UseTestRuntime()) {
+            TEST_FAIL("Unable to set test runtime path")
+            TEST_REPORT(TestAllocationCallbacks)
+            return;
+        }
+
+        OpenXRLoaderAllocationCallbacks callbacks = {};
+        callbacks.structVersion = OPENXR_LOADER_ALLOCATION_CALLBACKS_STRUCT_VERSION;
+        callbacks.structSize = sizeof(OpenXRLoaderAllocationCallbacks);
+        callbacks.pfnAllocation = CountingAllocate;
+        callbacks.pfnFree = CountingFree;
+
+        OpenXRLoaderAllocationCallbacks invalid_callbacks = callbacks;
+        invalid_callbacks.structSize = offsetof(OpenXRLoaderAllocationCallbacks, pfnFree);
+        TEST_EQUAL(openxrLoaderSetAllocationCallbacks(&invalid_callbacks), XR_ERROR_VALIDATION_FAILURE,
+                   "Callbacks in a structure that is too small are rejected")
+        OpenXRLoaderAllocationStatistics statistics = {};
+        TEST_EQUAL(openxrLoaderGetAllocationStatistics(OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT, &statistics),
+                   XR_ERROR_VALIDATION_FAILURE, "Statistics for an unknown subsystem are rejected")
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name;
+            if (test == 0) {
+                subtest_name = "with no API layers";
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                subtest_name = "with the test API layer";
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            OpenXRLoaderAllocationStatistics before[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT];
+            for (int subsystem = 0; subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT; ++subsystem) {
+                openxrLoaderGetAllocationStatistics(static_cast<OpenXRLoaderAllocationSubsystem>(subsystem), &before[subsystem]);
+            }
+
+            CountingAllocator counting = {};
+            callbacks.userData = &counting;
+            TEST_EQUAL(openxrLoaderSetAllocationCallbacks(&callbacks), XR_SUCCESS, "Setting allocation callbacks " + subtest_name)
+
+            LoaderTestSession test_session;
+            XrResult create_result = LoaderTestCreateSession(test_session);
+            TEST_EQUAL(create_result, XR_SUCCESS, "Creating instance, session and space " + subtest_name)
+            if (XR_FAILED(create_result)) {
+                openxrLoaderSetAllocationCallbacks(nullptr);
+                continue;
+            }
+
+            TEST_EQUAL(counting.allocations[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_INSTANCE] > 0 &&
+                           counting.allocations[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_MANIFEST] > 0 &&
+                           counting.allocations[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_DISPATCH_TABLE] > 0 &&
+                           counting.allocations[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_HANDLE_MAP] > 0,
+                       true, "Instance, manifest, dispatch table and handle map allocations use the callbacks " + subtest_name)
+            TEST_EQUAL(counting.over_aligned, false, "No allocation needs more than the usual alignment " + subtest_name)
+
+            OpenXRLoaderAllocationStatistics frames_before[OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT];
+            for (int subsystem = 0; subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT; ++subsystem) {
+                openxrLoaderGetAllocationStatistics(static_cast<OpenXRLoaderAllocationSubsystem>(subsystem),
+                                                    &frames_before[subsystem]);
+            }
+            const uint64_t callback_allocations_before_frames = counting.TotalAllocations();
+
+            bool frames_succeeded = true;
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                frames_succeeded = LoaderTestRunFrame(test_session) && frames_succeeded;
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            LoaderTestReportTime("Frame " + subtest_name, elapsed, frame_count, "frame");
+
+            TEST_EQUAL(frames_succeeded, true, "Frame calls succeed " + subtest_name)
+            TEST_EQUAL(counting.TotalAllocations(), callback_allocations_before_frames,
+                       "Frames allocate nothing through the callbacks " + subtest_name)
+            bool loader_allocated = false;
+            for (int subsystem = 0; subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT; ++subsystem) {
+                openxrLoaderGetAllocationStatistics(static_cast<OpenXRLoaderAllocationSubsystem>(subsystem), &statistics);
+                loader_allocated = loader_allocated || statistics.totalAllocations != frames_before[subsystem].totalAllocations;
+            }
+            TEST_EQUAL(loader_allocated, false, "The loader counts no allocations in frames " + subtest_name)
+
+            TEST_EQUAL(LoaderTestDestroySession(test_session), XR_SUCCESS,
+                       "Destroying space, session and instance " + subtest_name)
+            TEST_EQUAL(openxrLoaderSetAllocationCallbacks(nullptr), XR_SUCCESS, "Removing allocation callbacks " + subtest_name)
+
+            uint64_t allocated = 0;
+            bool all_freed = true;
+            for (int subsystem = 0; subsystem < OPENXR_LOADER_ALLOCATION_SUBSYSTEM_COUNT; ++subsystem) {
+                openxrLoaderGetAllocationStatistics(static_cast<OpenXRLoaderAllocationSubsystem>(subsystem), &statistics);
+                all_freed = all_freed && statistics.liveAllocations == before[subsystem].liveAllocations &&
+                            statistics.liveBytes == before[subsystem].liveBytes;
+                allocated += counting.allocations[subsystem];
+            }
+            TEST_EQUAL(all_freed, true, "Everything allocated for the instance is freed " + subtest_name)
+            TEST_EQUAL(counting.frees, allocated, "Every allocation from the callbacks is freed through them " + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestAllocationCallbacks)
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t total_tests = 0;
+    uint32_t total_passed = 0;
+    uint32_t total_skipped = 0;
+    uint32_t total_failed = 0;
+
+    if (argc > 1 && strcmp(argv[1], kStartupTimingChildArg) == 0) {
+        return RunStartupTimingChild();
+    }
+    if (argc > 2 && strcmp(argv[1], kBinaryLogChildArg) == 0) {
+        return RunBinaryLogChild(argv[2]);
+    }
+    g_loader_test_path = argv[0];
 
 #if FILTER_OUT_LOADER_ERRORS == 1
     // Re-direct std::cerr to a string since we're intentionally causing errors and we don't
@@ -2098,6 +4225,26 @@ int main(int argc, char* argv[]) {
 
     TestEnumLayers(total_tests, total_passed, total_skipped, total_failed);
     TestEnumInstanceExtensions(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestCache(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestDiscoveryScaling(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestDirectoryScan(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestParserTiming(total_tests, total_passed, total_skipped, total_failed);
+
+    cout << "Test runtime timing" << endl;
+    cout << "-------------------" << endl;
+    TestGetInstanceProcAddrTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestTrampolineTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestMultiInstanceStress(total_tests, total_passed, total_skipped, total_failed);
+    TestDebugUtilsContentionTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestResidentRuntimeTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestStartupTimingTrace(total_tests, total_passed, total_skipped, total_failed);
+    TestBinaryLogRoundTrip(total_tests, total_passed, total_skipped, total_failed);
+    TestLoggingStress(total_tests, total_passed, total_skipped, total_failed);
+    TestObjectNameTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestSessionLabelTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestFormatBuffer(total_tests, total_passed, total_skipped, total_failed);
+    TestEnumNames(total_tests, total_passed, total_skipped, total_failed);
+    TestAllocationCallbacks(total_tests, total_passed, total_skipped, total_failed);
 
     if (g_has_installed_runtime) {
         cout << "Installed XR runtime detected - doing active runtime tests" << endl;
@@ -28,8 +28,16 @@
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 
 #if defined(XR_OS_WINDOWS)
 
@@ -52,6 +60,12 @@ bool LoaderTestUnsetEnvironmentVariable(const std::string &variable) {
     return TRUE == SetEnvironmentVariable(variable.c_str(), "");
 }
 
+bool LoaderTestCreateDirectory(const std::string &path) {
+    return TRUE == CreateDirectory(path.c_str(), nullptr) || ERROR_ALREADY_EXISTS == GetLastError();
+}
+
+bool LoaderTestRemoveDirectory(const std::string &path) { return TRUE == RemoveDirectory(path.c_str()); }
+
 #elif defined(XR_OS_LINUX)
 
 bool LoaderTestSetEnvironmentVariable(const std::string &variable, const std::string &value) {
@@ -69,6 +83,10 @@ bool LoaderTestGetEnvironmentVariable(const std::string &variable, std::string &
 
 bool LoaderTestUnsetEnvironmentVariable(const std::string &variable) { return 0 == unsetenv(variable.c_str()); }
 
+bool LoaderTestCreateDirectory(const std::string &path) { return 0 == mkdir(path.c_str(), 0755) || EEXIST == errno; }
+
+bool LoaderTestRemoveDirectory(const std::string &path) { return 0 == rmdir(path.c_str()); }
+
 #elif defined(XR_OS_APPLE)
 
 bool LoaderTestSetEnvironmentVariable(const std::string &variable, const std::string &value) {
@@ -94,8 +112,102 @@ bool LoaderTestUnsetEnvironmentVariable(const std::string &variable) {
     return false;
 }
 
+bool LoaderTestCreateDirectory(const std::string &path) { return 0 == mkdir(path.c_str(), 0755) || EEXIST == errno; }
+
+bool LoaderTestRemoveDirectory(const std::string &path) { return 0 == rmdir(path.c_str()); }
+
 #else
 
 #error "Unsupported platform"
 
 #endif
+
+void CleanupEnvironmentVariables() {
+    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+    LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+    LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_RESIDENT_RUNTIME");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_RESIDENT_RUNTIME_IDLE_MS");
+}
+
+bool UseTestRuntime() { return LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", TEST_RUNTIME_JSON); }
+
+double NanosecondsPerIteration(std::chrono::steady_clock::duration elapsed, uint32_t iterations) {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+double LoaderTestReportTime(const std::string &label, std::chrono::steady_clock::duration elapsed, uint32_t iterations,
+                            const char *unit) {
+    const double nanoseconds = NanosecondsPerIteration(elapsed, iterations);
+    std::cout << "        " << label << ": " << nanoseconds << " ns per " << unit << std::endl;
+    return nanoseconds;
+}
+
+XrResult LoaderTestCreateSession(LoaderTestSession &test_session) {
+    XrInstanceCreateInfo instance_create_info = {};
+    instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    XrResult result = xrCreateInstance(&instance_create_info, &test_session.instance);
+    if (XR_FAILED(result)) {
+        test_session.instance = XR_NULL_HANDLE;
+        return result;
+    }
+
+    // The test runtime has a single system.
+    XrSessionCreateInfo session_create_info = {};
+    session_create_info.type = XR_TYPE_SESSION_CREATE_INFO;
+    session_create_info.systemId = 1;
+    result = xrCreateSession(test_session.instance, &session_create_info, &test_session.session);
+    if (XR_SUCCEEDED(result)) {
+        XrReferenceSpaceCreateInfo space_create_info = {};
+        space_create_info.type = XR_TYPE_REFERENCE_SPACE_CREATE_INFO;
+        space_create_info.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+        space_create_info.poseInReferenceSpace.orientation.w = 1.0f;
+        result = xrCreateReferenceSpace(test_session.session, &space_create_info, &test_session.space);
+    } else {
+        test_session.session = XR_NULL_HANDLE;
+    }
+    if (XR_FAILED(result)) {
+        test_session.space = XR_NULL_HANDLE;
+        LoaderTestDestroySession(test_session);
+    }
+    return result;
+}
+
+XrResult LoaderTestDestroySession(LoaderTestSession &test_session) {
+    XrResult result = XR_SUCCESS;
+    if (XR_NULL_HANDLE != test_session.space) {
+        result = xrDestroySpace(test_session.space);
+        test_session.space = XR_NULL_HANDLE;
+    }
+    if (XR_NULL_HANDLE != test_session.session) {
+        XrResult session_result = xrDestroySession(test_session.session);
+        result = XR_SUCCEEDED(result) ? session_result : result;
+        test_session.session = XR_NULL_HANDLE;
+    }
+    if (XR_NULL_HANDLE != test_session.instance) {
+        XrResult instance_result = xrDestroyInstance(test_session.instance);
+        result = XR_SUCCEEDED(result) ? instance_result : result;
+        test_session.instance = XR_NULL_HANDLE;
+    }
+    return result;
+}
+
+bool LoaderTestRunFrame(const LoaderTestSession &test_session) {
+    XrFrameWaitInfo wait_info = {XR_TYPE_FRAME_WAIT_INFO, nullptr};
+    XrFrameState frame_state = {XR_TYPE_FRAME_STATE, nullptr};
+    if (XR_FAILED(xrWaitFrame(test_session.session, &wait_info, &frame_state))) {
+        return false;
+    }
+    XrFrameBeginInfo begin_info = {XR_TYPE_FRAME_BEGIN_INFO, nullptr};
+    XrSpaceLocation location = {XR_TYPE_SPACE_LOCATION, nullptr};
+    if (XR_FAILED(xrBeginFrame(test_session.session, &begin_info)) ||
+        XR_FAILED(xrLocateSpace(test_session.space, test_session.space, frame_state.predictedDisplayTime, &location))) {
+        return false;
+    }
+    XrFrameEndInfo end_info = {XR_TYPE_FRAME_END_INFO, nullptr};
+    end_info.displayTime = frame_state.predictedDisplayTime;
+    end_info.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+    return XR_SUCCEEDED(xrEndFrame(test_session.session, &end_info));
+}
@@ -21,6 +21,11 @@
 
 #pragma once
 
+#include <openxr/openxr.h>
+
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
 #include <string>
 
 #if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
@@ -39,3 +44,102 @@
 bool LoaderTestSetEnvironmentVariable(const std::string& variable, const std::string& value);
 bool LoaderTestGetEnvironmentVariable(const std::string& variable, std::string& value);
 bool LoaderTestUnsetEnvironmentVariable(const std::string& variable);
+
+// Create a directory, succeeding if it already exists.
+bool LoaderTestCreateDirectory(const std::string& path);
+
+// Remove an empty directory.
+bool LoaderTestRemoveDirectory(const std::string& path);
+
+// Unset the environment variables that choose the runtime and API layers.
+void CleanupEnvironmentVariables();
+
+// Point the loader at the test runtime built alongside the tests.
+bool UseTestRuntime();
+
+// Average time, in nanoseconds, taken by each of the given number of iterations.
+double NanosecondsPerIteration(std::chrono::steady_clock::duration elapsed, uint32_t iterations);
+
+// Print "<label>: <nanoseconds> ns per <unit>", indented as a test result, for elapsed split over iterations, and
+// return the nanoseconds.
+double LoaderTestReportTime(const std::string& label, std::chrono::steady_clock::duration elapsed, uint32_t iterations,
+                            const char* unit = "call");
+
+// Time iterations calls of call(iteration), report them with LoaderTestReportTime and return the nanoseconds per call.
+template <typename Call>
+double LoaderTestTimeCalls(const std::string& label, uint32_t iterations, Call&& call) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+        call(iteration);
+    }
+    return LoaderTestReportTime(label, std::chrono::steady_clock::now() - start, iterations);
+}
+
+// An instance of the test runtime, with a session and a local reference space, as the timing tests use.
+struct LoaderTestSession {
+    XrInstance instance = XR_NULL_HANDLE;
+    XrSession session = XR_NULL_HANDLE;
+    XrSpace space = XR_NULL_HANDLE;
+};
+
+// Create the instance, session and space of test_session with the API layers currently enabled.  Returns the first
+// failure, having destroyed whatever was created.
+XrResult LoaderTestCreateSession(LoaderTestSession& test_session);
+
+// Destroy the space, session and instance of test_session, returning the first failure.
+XrResult LoaderTestDestroySession(LoaderTestSession& test_session);
+
+// Wait for, begin and end one frame of test_session, locating its space in between.  Returns whether every call
+// succeeded.
+bool LoaderTestRunFrame(const LoaderTestSession& test_session);
+
+// Each test is a function that adds its results to the totals passed in.
+#define DEFINE_TEST(test_name) void test_name(uint32_t& total, uint32_t& passed, uint32_t& skipped, uint32_t& failed)
+
+#define INIT_TEST(test_name)    \
+    uint32_t local_total = 0;   \
+    uint32_t local_passed = 0;  \
+    uint32_t local_skipped = 0; \
+    uint32_t local_failed = 0;  \
+    std::cout << "    Starting " << #test_name << std::endl;
+
+#define TEST_REPORT(test_name)                                                                                                  \
+    std::cout << "    Finished " << #test_name << ": ";                                                                         \
+    if (local_failed > 0) {                                                                                                     \
+        std::cout << "Failed (Local - Passed: " << std::to_string(local_passed) << ", Failed: " << std::to_string(local_failed) \
+                  << ", Skipped: " << std::to_string(local_skipped) << ")" << std::endl                                         \
+                  << std::endl;                                                                                                 \
+    } else {                                                                                                                    \
+        std::cout << "Passed (Local - Passed: " << std::to_string(local_passed) << ", Failed: " << std::to_string(local_failed) \
+                  << ", Skipped: " << std::to_string(local_skipped) << ")" << std::endl                                         \
+                  << std::endl;                                                                                                 \
+    }                                                                                                                           \
+    total += local_total;                                                                                                       \
+    passed += local_passed;                                                                                                     \
+    failed += local_failed;                                                                                                     \
+    skipped += local_skipped;
+
+#define TEST_EQUAL(test, expected, cout_string)                            \
+    local_total++;                                                         \
+    if (expected != (test)) {                                              \
+        std::cout << "        " << cout_string << ": Failed" << std::endl; \
+        local_failed++;                                                    \
+    } else {                                                               \
+        std::cout << "        " << cout_string << ": Passed" << std::endl; \
+        local_passed++;                                                    \
+    }
+
+#define TEST_NOT_EQUAL(test, expected, cout_string)                        \
+    local_total++;                                                         \
+    if (expected == (test)) {                                              \
+        std::cout << "        " << cout_string << ": Failed" << std::endl; \
+        local_failed++;                                                    \
+    } else {                                                               \
+        std::cout << "        " << cout_string << ": Passed" << std::endl; \
+        local_passed++;                                                    \
+    }
+
+#define TEST_FAIL(cout_string) \
+    local_total++;             \
+    local_failed++;            \
+    std::cout << "        " << cout_string << ": Failed" << std::endl;
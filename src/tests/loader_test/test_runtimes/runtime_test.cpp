@@ -19,6 +19,8 @@
 // Author: Mark Young <marky@lunarg.com>
 //
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
@@ -35,10 +37,16 @@
 #define RUNTIME_EXPORT
 #endif
 
+// Hand out a distinct handle for each instance, so the loader can tell concurrent instances apart.  Each type of handle
+// is counted separately, as some runtimes do, so handles of different types can share a value.
+static std::atomic<uint64_t> g_next_instance_handle(1);
+static std::atomic<uint64_t> g_next_session_handle(1);
+static std::atomic<uint64_t> g_next_space_handle(1);
+
 extern "C" {
 
 XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateInstance(const XrInstanceCreateInfo *info, XrInstance *instance) {
-    *instance = (XrInstance)1;
+    *instance = (XrInstance)g_next_instance_handle++;
     return XR_SUCCESS;
 }
 
@@ -81,6 +89,42 @@ XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetSystemProperties(XrInstance insta
     return XR_SUCCESS;
 }
 
+// Sessions and spaces only exist so the loader's steady-state frame calls can be exercised.
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateSession(XrInstance instance, const XrSessionCreateInfo *createInfo,
+                                                          XrSession *session) {
+    *session = (XrSession)g_next_session_handle++;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrDestroySession(XrSession session) { return XR_SUCCESS; }
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo *createInfo,
+                                                                 XrSpace *space) {
+    *space = (XrSpace)g_next_space_handle++;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrDestroySpace(XrSpace space) { return XR_SUCCESS; }
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrWaitFrame(XrSession session, const XrFrameWaitInfo *frameWaitInfo,
+                                                      XrFrameState *frameState) {
+    frameState->predictedDisplayTime = 1;
+    frameState->predictedDisplayPeriod = 1;
+    frameState->shouldRender = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrBeginFrame(XrSession session, const XrFrameBeginInfo *frameBeginInfo) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrEndFrame(XrSession session, const XrFrameEndInfo *frameEndInfo) { return XR_SUCCESS; }
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation *location) {
+    location->locationFlags = 0;
+    return XR_SUCCESS;
+}
+
 XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddr(XrInstance instance, const char *name,
                                                                 PFN_xrVoidFunction *function) {
     if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
@@ -95,6 +139,22 @@ XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddr(XrInstance insta
         *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrGetSystem);
     } else if (0 == strcmp(name, "xrGetSystemProperties")) {
         *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrGetSystemProperties);
+    } else if (0 == strcmp(name, "xrCreateSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrCreateSession);
+    } else if (0 == strcmp(name, "xrDestroySession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrDestroySession);
+    } else if (0 == strcmp(name, "xrCreateReferenceSpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrCreateReferenceSpace);
+    } else if (0 == strcmp(name, "xrDestroySpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrDestroySpace);
+    } else if (0 == strcmp(name, "xrWaitFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrWaitFrame);
+    } else if (0 == strcmp(name, "xrBeginFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrBeginFrame);
+    } else if (0 == strcmp(name, "xrEndFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrEndFrame);
+    } else if (0 == strcmp(name, "xrLocateSpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrLocateSpace);
     } else {
         *function = nullptr;
     }
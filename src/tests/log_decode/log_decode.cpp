@@ -0,0 +1,268 @@
+// Copyright (c) 2017-2020 The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Turns a binary log written by the loader, when XR_LOADER_BINARY_LOG_FILE is set, into text or JSON.
+
+#include "loader_binary_log.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The XR_LOADER_LOG_MESSAGE_SEVERITY_*_BIT values in the loader's loader_logger.hpp.
+const char* SeverityName(uint32_t severity) {
+    if (severity < 0x00000010) {
+        return "Verbose";
+    } else if (severity < 0x00000100) {
+        return "Info";
+    } else if (severity < 0x00001000) {
+        return "Warning";
+    }
+    return "Error";
+}
+
+// The XR_LOADER_LOG_MESSAGE_TYPE_*_BIT values in the loader's loader_logger.hpp.
+const char* TypeName(uint32_t type) {
+    switch (type) {
+        case 0x00000001:
+            return "GENERAL";
+        case 0x00000002:
+            return "SPEC";
+        case 0x00000004:
+            return "PERF";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+std::string HexString(uint64_t value) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::setw(16) << std::setfill('0') << value;
+    return oss.str();
+}
+
+std::string JsonString(const std::string& value) {
+    std::ostringstream out;
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    out << c;
+                }
+                break;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+class LogDecoder {
+   public:
+    LogDecoder(const std::vector<char>& data, bool json) : _data(data), _json(json) {}
+
+    bool Decode() {
+        BinaryLogFileHeader header = {};
+        if (_data.size() < sizeof(header)) {
+            std::cerr << "File is too short to be a loader binary log" << std::endl;
+            return false;
+        }
+        memcpy(&header, _data.data(), sizeof(header));
+        if (memcmp(header.magic, XR_LOADER_BINARY_LOG_MAGIC, sizeof(header.magic)) != 0) {
+            std::cerr << "File is not a loader binary log" << std::endl;
+            return false;
+        }
+        if (header.version != XR_LOADER_BINARY_LOG_VERSION || header.header_size < sizeof(header)) {
+            std::cerr << "Unsupported loader binary log version " << header.version << std::endl;
+            return false;
+        }
+        _start_time_ns = header.start_time_ns;
+
+        if (_json) {
+            std::cout << "[";
+        }
+        size_t offset = header.header_size;
+        bool first_message = true;
+        bool ok = true;
+        while (offset + sizeof(BinaryLogRecordHeader) <= _data.size()) {
+            BinaryLogRecordHeader record_header = {};
+            memcpy(&record_header, _data.data() + offset, sizeof(record_header));
+            if (record_header.size == 0) {
+                break;
+            }
+            if (record_header.size < sizeof(record_header) || record_header.size > _data.size() - offset) {
+                std::cerr << "Truncated record at offset " << offset << std::endl;
+                ok = false;
+                break;
+            }
+            const char* record = _data.data() + offset;
+            if (record_header.kind == BINARY_LOG_RECORD_STRING) {
+                ok = DecodeString(record, record_header.size);
+            } else if (record_header.kind == BINARY_LOG_RECORD_MESSAGE) {
+                ok = DecodeMessage(record, record_header.size, first_message);
+                first_message = false;
+            }
+            // Records of other kinds are skipped, so newer writers can add them.
+            if (!ok) {
+                std::cerr << "Malformed record at offset " << offset << std::endl;
+                break;
+            }
+            offset += record_header.size;
+        }
+        if (_json) {
+            std::cout << (first_message ? "]" : "\n]") << std::endl;
+        }
+        return ok;
+    }
+
+   private:
+    bool DecodeString(const char* record, uint32_t size) {
+        BinaryLogStringRecord string_record = {};
+        if (size < sizeof(string_record)) {
+            return false;
+        }
+        memcpy(&string_record, record, sizeof(string_record));
+        if (string_record.length > size - sizeof(string_record) || string_record.index != _strings.size()) {
+            return false;
+        }
+        _strings.emplace_back(record + sizeof(string_record), string_record.length);
+        return true;
+    }
+
+    const std::string& String(uint32_t index) const {
+        static const std::string empty;
+        return index < _strings.size() ? _strings[index] : empty;
+    }
+
+    bool DecodeMessage(const char* record, uint32_t size, bool first_message) {
+        BinaryLogMessageRecord message = {};
+        if (size < sizeof(message)) {
+            return false;
+        }
+        memcpy(&message, record, sizeof(message));
+        const size_t objects_size = message.object_count * sizeof(BinaryLogObject);
+        const size_t labels_size = message.session_label_count * sizeof(uint32_t);
+        if (sizeof(message) + objects_size + labels_size + message.payload_length > size) {
+            return false;
+        }
+        const char* cursor = record + sizeof(message);
+        std::vector<BinaryLogObject> objects(message.object_count);
+        if (objects_size != 0) {
+            memcpy(objects.data(), cursor, objects_size);
+            cursor += objects_size;
+        }
+        std::vector<uint32_t> labels(message.session_label_count);
+        if (labels_size != 0) {
+            memcpy(labels.data(), cursor, labels_size);
+            cursor += labels_size;
+        }
+        const std::string payload = message.payload != XR_LOADER_BINARY_LOG_NO_STRING ? String(message.payload)
+                                                                                      : std::string(cursor, message.payload_length);
+
+        if (_json) {
+            std::cout << (first_message ? "\n" : ",\n") << "{\"time_ns\": " << _start_time_ns + message.timestamp_ns
+                      << ", \"thread\": " << message.thread_id << ", \"severity\": " << JsonString(SeverityName(message.severity))
+                      << ", \"type\": " << JsonString(TypeName(message.type))
+                      << ", \"command\": " << JsonString(String(message.command_name))
+                      << ", \"message_id\": " << JsonString(String(message.message_id))
+                      << ", \"message\": " << JsonString(payload) << ", \"objects\": [";
+            for (size_t index = 0; index < objects.size(); ++index) {
+                std::cout << (index == 0 ? "" : ", ") << "{\"handle\": " << JsonString(HexString(objects[index].handle))
+                          << ", \"type\": " << objects[index].type;
+                if (objects[index].name != XR_LOADER_BINARY_LOG_NO_STRING) {
+                    std::cout << ", \"name\": " << JsonString(String(objects[index].name));
+                }
+                std::cout << "}";
+            }
+            std::cout << "], \"session_labels\": [";
+            for (size_t index = 0; index < labels.size(); ++index) {
+                std::cout << (index == 0 ? "" : ", ") << JsonString(String(labels[index]));
+            }
+            std::cout << "]}";
+            return true;
+        }
+
+        // Same layout as the loader's text output, preceded by the time in seconds since the log was opened and
+        // the thread.
+        std::cout << std::fixed << std::setprecision(6) << static_cast<double>(message.timestamp_ns) / 1e9 << " [thread "
+                  << message.thread_id << "] " << SeverityName(message.severity) << " [" << TypeName(message.type) << " | "
+                  << String(message.command_name) << " | " << String(message.message_id) << "] : " << payload << "\n";
+        for (size_t index = 0; index < objects.size(); ++index) {
+            std::cout << "    Object[" << index << "] = " << HexString(objects[index].handle);
+            if (objects[index].name != XR_LOADER_BINARY_LOG_NO_STRING) {
+                std::cout << " (" << String(objects[index].name) << ")";
+            }
+            std::cout << "\n";
+        }
+        for (size_t index = 0; index < labels.size(); ++index) {
+            std::cout << "    SessionLabel[" << index << "] = " << String(labels[index]) << "\n";
+        }
+        return true;
+    }
+
+    const std::vector<char>& _data;
+    const bool _json;
+    uint64_t _start_time_ns = 0;
+    std::vector<std::string> _strings;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    const char* filename = nullptr;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--json") == 0) {
+            json = true;
+        } else if (filename == nullptr) {
+            filename = argv[arg];
+        } else {
+            filename = nullptr;
+            break;
+        }
+    }
+    if (filename == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--json] <binary log file>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file_stream(filename, std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.is_open()) {
+        std::cerr << "Unable to open " << filename << std::endl;
+        return 1;
+    }
+    const std::vector<char> data((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+
+    LogDecoder decoder(data, json);
+    return decoder.Decode() ? 0 : 1;
+}